@@ -57,29 +57,53 @@
     float horizontal_offset = region.origin.x + (display_width - ((float)character_width * pixel_size)) / 2.0;
     float vertical_offset = region.origin.y + (display_height - ((float)character_height * pixel_size)) / 2.0;
 
-    
-    for (int x = 0; x < character_width; x++)
+    /* Fill the clear and the set pixels a row at a time, each through a mask made from the glyph atlas
+     * image of the character, rather than filling every pixel separately.
+     */
+    CGRect glyph_rect = CGRectMake(horizontal_offset, vertical_offset, character_width * pixel_size, character_height * pixel_size);
+    CGImageRef set_mask = [neoFontEditor glyphImage:[neoFontEditor characterNumber]];
+    static const CGFloat clear_decode[2] = { 0.0, 1.0 };
+    CGImageRef clear_mask = CGImageMaskCreate(CGImageGetWidth(set_mask), CGImageGetHeight(set_mask), 8, 8,
+        CGImageGetBytesPerRow(set_mask), CGImageGetDataProvider(set_mask), clear_decode, false);
+    CGContextSetInterpolationQuality(context, kCGInterpolationNone);
+
+    CGContextSaveGState(context);
+    CGContextClipToMask(context, glyph_rect, clear_mask);
+    for (int y = 0; y < character_height; y++)
     {
-        for (int y = 0; y < character_height; y++)
-        {
-            int pixel_state = character->getPixel(x, (character_height - y - 1));
-
-            CGContextSetRGBStrokeColor(context, 0.9, 0.9, 1.0, 0.75);
-            if (pixel_state) CGContextSetRGBFillColor(context,  0.0, 0.0, 0.5 * (((double)y)/character_height), 0.75);
-            else if (highlightRow[y]) CGContextSetRGBFillColor(context,  0.7, 0.7, 0.9, 0.75);
-            else CGContextSetRGBFillColor(context,  0.8, 0.8, 1.0, 0.75);
-
-            CGRect pixel_rect = CGRectMake(
-                horizontal_offset + (x * pixel_size),
-                vertical_offset + (y * pixel_size),
-                pixel_size,
-                pixel_size);
-
-            CGContextSetLineWidth(context, 2.0);
-            CGContextFillRect(context, pixel_rect);
-            CGContextStrokeRect(context, pixel_rect);
-        }
+        if (highlightRow[y]) CGContextSetRGBFillColor(context,  0.7, 0.7, 0.9, 0.75);
+        else CGContextSetRGBFillColor(context,  0.8, 0.8, 1.0, 0.75);
+        CGContextFillRect(context, CGRectMake(horizontal_offset, vertical_offset + (y * pixel_size), glyph_rect.size.width, pixel_size));
+    }
+    CGContextRestoreGState(context);
+
+    CGContextSaveGState(context);
+    CGContextClipToMask(context, glyph_rect, set_mask);
+    for (int y = 0; y < character_height; y++)
+    {
+        CGContextSetRGBFillColor(context,  0.0, 0.0, 0.5 * (((double)y)/character_height), 0.75);
+        CGContextFillRect(context, CGRectMake(horizontal_offset, vertical_offset + (y * pixel_size), glyph_rect.size.width, pixel_size));
+    }
+    CGContextRestoreGState(context);
+    CGImageRelease(clear_mask);
+
+    /* Draw the pixel grid as one set of line segments.
+     */
+    CGPoint grid[2 * (kNeoCharacterMaxWidth + kNeoCharacterMaxHeight + 2)];
+    int points = 0;
+    for (int x = 0; x <= character_width; x++)
+    {
+        grid[points++] = CGPointMake(horizontal_offset + (x * pixel_size), vertical_offset);
+        grid[points++] = CGPointMake(horizontal_offset + (x * pixel_size), vertical_offset + glyph_rect.size.height);
+    }
+    for (int y = 0; y <= character_height; y++)
+    {
+        grid[points++] = CGPointMake(horizontal_offset, vertical_offset + (y * pixel_size));
+        grid[points++] = CGPointMake(horizontal_offset + glyph_rect.size.width, vertical_offset + (y * pixel_size));
     }
+    CGContextSetRGBStrokeColor(context, 0.9, 0.9, 1.0, 0.75);
+    CGContextSetLineWidth(context, 2.0);
+    CGContextStrokeLineSegments(context, grid, points);
 }
 
 
@@ -167,6 +191,7 @@
             drag.pixelState = ([neoFontEditor pixelInCharacter:[neoFontEditor characterNumber] atX:x y:y]) ? 0 : 1;
             drag.lastX = x;
             drag.lastY = y;
+            [neoFontEditor beginStroke];
             [neoFontEditor setPixelInCharacter:[neoFontEditor characterNumber] atX:x y:y to:drag.pixelState];
             [self setNeedsDisplay:YES];
         }
@@ -194,6 +219,7 @@
 {
     drag.lastX = -1;
     drag.lastY = -1;
+    [neoFontEditor endStroke];
 }
 
 
@@ -47,27 +47,29 @@
     /* Render the current character.
      */
     CGContextSetGrayFillColor(context, 0.0, 1.0);
-    [neoFontEditor renderCharacter:character context:context x:horizontal_offset y:vertical_offset size:pixel_size];
+    int character_number = [neoFontEditor characterNumber];
+    [neoFontEditor renderCharacter:character_number context:context x:horizontal_offset y:vertical_offset size:pixel_size];
 
     /* Render following and preceeding characters.
      */
     CGContextSetGrayFillColor(context, 0.4, 1.0);
     float x = horizontal_offset;
-    int character_number = [neoFontEditor characterNumber];
     for (unsigned int i = 1; i <= 32; i++)
     {
         x += (character->width() + 2.0) * pixel_size;
 		if (x >= display_width) break;  // off right hand edge of visible display
-        character = font->character((character_number + i) % kNeoFontCharacterCount);
-        [neoFontEditor renderCharacter:character context:context x:x y:vertical_offset size:pixel_size];
+        int n = (character_number + i) % kNeoFontCharacterCount;
+        character = font->character(n);
+        [neoFontEditor renderCharacter:n context:context x:x y:vertical_offset size:pixel_size];
     }
 	x = horizontal_offset;
     for (unsigned int i = 1; i <= 32; i++)
     {
-        character = font->character((character_number - i) % kNeoFontCharacterCount);
+        int n = (character_number + kNeoFontCharacterCount - i) % kNeoFontCharacterCount;
+        character = font->character(n);
 		if (x < 0.0) break;  // off left hand edge of visible display
         x -= (character->width() + 2.0) * pixel_size;
-        [neoFontEditor renderCharacter:character context:context x:x y:vertical_offset size:pixel_size];
+        [neoFontEditor renderCharacter:n context:context x:x y:vertical_offset size:pixel_size];
     }
 }
 
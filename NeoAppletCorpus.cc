@@ -0,0 +1,371 @@
+/** @file       NeoAppletCorpus.cc
+ *  @brief      Memory mapped collection of Neo font smart applets.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "NeoAppletCorpus.h"
+#include "NeoAppletFormat.h"
+
+
+#define kNeoCorpusUnchecked     (0)         /**< The applet has not been checked. */
+#define kNeoCorpusHeader        (1)         /**< The applet header has been checked. */
+#define kNeoCorpusComplete      (2)         /**< The whole applet has been checked. */
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      Private Data.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** A mapped file.
+ */
+struct NeoAppletCorpusFile
+{
+    char *path;                     /**< The file name. */
+    const uint8_t *data;            /**< The mapped file. */
+    unsigned int length;            /**< The size of the file, in bytes. */
+};
+
+
+/** An applet in a mapped file.
+ */
+struct NeoAppletCorpusEntry
+{
+    unsigned int file;              /**< Index of the file holding the applet. */
+    unsigned int offset;            /**< Offset of the applet in the file. */
+    unsigned int length;            /**< Length of the applet, in bytes. */
+    int checked;                    /**< How much of the applet has been checked (kNeoCorpusUnchecked etc). */
+    NeoAppletView view;             /**< View of the applet, attached as far as it has been checked. */
+};
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      Private Functions.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Compare two file names, for use with qsort().
+ */
+static int compareNames(const void *a, const void *b)
+{
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+
+/** Test if a file name has the applet extension. The comparison ignores case.
+ *
+ *  @param  name    The file name.
+ *  @return         Logical true if the name ends with kNeoAppletCorpusExtension.
+ */
+static bool hasAppletExtension(const char *name)
+{
+    size_t length = strlen(name);
+    size_t ext_length = strlen(kNeoAppletCorpusExtension);
+    return length > ext_length && 0 == strcasecmp(&name[length - ext_length], kNeoAppletCorpusExtension);
+}
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      NeoAppletCorpus class definition.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Class constructor. The corpus is empty.
+ */
+NeoAppletCorpus::NeoAppletCorpus()
+    :
+        m_files(0),
+        m_fileCount(0),
+        m_fileCapacity(0),
+        m_entries(0),
+        m_count(0),
+        m_capacity(0)
+{
+    // Nothing.
+}
+
+
+/** Destructor. Every file is unmapped.
+ */
+NeoAppletCorpus::~NeoAppletCorpus()
+{
+    close();
+}
+
+
+/** Map a file and add the applets in it. The file can hold a single applet or a pack of applets stored
+ *  back to back. Only the size field of each applet is read. If a size is not plausible, the rest of the
+ *  file is added as a single applet, which will fail its checks.
+ *
+ *  @param  path    The file name.
+ *  @return         Logical true if the file was mapped. Empty files are not mapped.
+ */
+bool NeoAppletCorpus::addFile(const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (0 != fstat(fd, &st) || !S_ISREG(st.st_mode) || 0 == st.st_size || (uint64_t)st.st_size > 0xffffffffu)
+    {
+        ::close(fd);
+        return false;
+    }
+    void *map = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (MAP_FAILED == map) return false;
+    posix_madvise(map, st.st_size, POSIX_MADV_RANDOM);      // Read only the pages that are used
+
+    if (m_fileCount == m_fileCapacity)
+    {
+        unsigned int capacity = (0 == m_fileCapacity) ? 16 : (m_fileCapacity * 2);
+        NeoAppletCorpusFile *files = new NeoAppletCorpusFile[capacity];
+        for (unsigned int i = 0; i < m_fileCount; i++) files[i] = m_files[i];
+        delete[] m_files;
+        m_files = files;
+        m_fileCapacity = capacity;
+    }
+    NeoAppletCorpusFile *file = &m_files[m_fileCount];
+    file->path = new char[strlen(path) + 1];
+    strcpy(file->path, path);
+    file->data = (const uint8_t *)map;
+    file->length = (unsigned int)st.st_size;
+
+    const uint8_t *data = file->data;
+    unsigned int offset = 0;
+    while (offset < file->length)
+    {
+        unsigned int remaining = file->length - offset;
+        unsigned int size = (remaining >= kAppletOffFileSize + 4) ? XB32(data, offset + kAppletOffFileSize) : 0;
+        if (size <= kAppletOffFontName || size > remaining) size = remaining;
+        addEntry(m_fileCount, offset, size);
+        offset += size;
+    }
+    m_fileCount++;
+    return true;
+}
+
+
+/** Add every applet file in a directory, in name order. Files are recognised by their extension, and
+ *  subdirectories are not searched.
+ *
+ *  @param  path    The directory name.
+ *  @return         The number of files added, or -1 if the directory could not be read.
+ */
+int NeoAppletCorpus::addDirectory(const char *path)
+{
+    DIR *dir = opendir(path);
+    if (0 == dir) return -1;
+
+    unsigned int count = 0;
+    unsigned int capacity = 64;
+    char **names = new char *[capacity];
+    for (struct dirent *e = readdir(dir); 0 != e; e = readdir(dir))
+    {
+        if (!hasAppletExtension(e->d_name)) continue;
+        if (count == capacity)
+        {
+            char **grown = new char *[capacity * 2];
+            memcpy(grown, names, count * sizeof names[0]);
+            delete[] names;
+            names = grown;
+            capacity *= 2;
+        }
+        names[count] = new char[strlen(path) + strlen(e->d_name) + 2];
+        strcpy(names[count], path);
+        strcat(names[count], "/");
+        strcat(names[count], e->d_name);
+        count++;
+    }
+    closedir(dir);
+
+    qsort(names, count, sizeof names[0], compareNames);
+    int added = 0;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (addFile(names[i])) added++;
+        delete[] names[i];
+    }
+    delete[] names;
+    return added;
+}
+
+
+/** Unmap every file and remove every applet.
+ */
+void NeoAppletCorpus::close()
+{
+    for (unsigned int i = 0; i < m_fileCount; i++)
+    {
+        munmap(const_cast<uint8_t *>(m_files[i].data), m_files[i].length);
+        delete[] m_files[i].path;
+    }
+    delete[] m_files;
+    delete[] m_entries;
+    m_files = 0;
+    m_fileCount = 0;
+    m_fileCapacity = 0;
+    m_entries = 0;
+    m_count = 0;
+    m_capacity = 0;
+}
+
+
+/** Return the number of applets.
+ */
+unsigned int NeoAppletCorpus::count() const
+{
+    return m_count;
+}
+
+
+/** Get the name of the file holding an applet.
+ *
+ *  @param  index   The applet number.
+ *  @return         The file name, or zero if index is out of range.
+ */
+const char *NeoAppletCorpus::path(unsigned int index) const
+{
+    if (index >= m_count) return 0;
+    else return m_files[m_entries[index].file].path;
+}
+
+
+/** Get the position of an applet in its file.
+ *
+ *  @param  index   The applet number.
+ *  @return         The offset, in bytes, or zero if index is out of range.
+ */
+unsigned int NeoAppletCorpus::offset(unsigned int index) const
+{
+    if (index >= m_count) return 0;
+    else return m_entries[index].offset;
+}
+
+
+/** Get the length of an applet.
+ *
+ *  @param  index   The applet number.
+ *  @return         The number of bytes, or zero if index is out of range.
+ */
+unsigned int NeoAppletCorpus::length(unsigned int index) const
+{
+    if (index >= m_count) return 0;
+    else return m_entries[index].length;
+}
+
+
+/** Get a view of an applet's header. Only the applet fields (names, version and ID) may be read from the
+ *  view, unless it is complete (see NeoAppletView::isComplete()).
+ *
+ *  @param  index   The applet number.
+ *  @return         The view, or zero if index is out of range or the header is not valid.
+ */
+const NeoAppletView *NeoAppletCorpus::header(unsigned int index)
+{
+    if (index >= m_count) return 0;
+    NeoAppletCorpusEntry *e = &m_entries[index];
+    if (kNeoCorpusUnchecked == e->checked)
+    {
+        e->view.attachHeader(&m_files[e->file].data[e->offset], e->length);
+        e->checked = kNeoCorpusHeader;
+    }
+    return e->view.isValid() ? &e->view : 0;
+}
+
+
+/** Get a complete view of an applet.
+ *
+ *  @param  index   The applet number.
+ *  @return         The view, or zero if index is out of range or the applet is not valid.
+ */
+const NeoAppletView *NeoAppletCorpus::view(unsigned int index)
+{
+    if (index >= m_count) return 0;
+    NeoAppletCorpusEntry *e = &m_entries[index];
+    if (kNeoCorpusComplete != e->checked)
+    {
+        const uint8_t *data = &m_files[e->file].data[e->offset];
+        if (!e->view.attach(data, e->length)) e->view.attachHeader(data, e->length);
+        e->checked = kNeoCorpusComplete;
+    }
+    return e->view.isComplete() ? &e->view : 0;
+}
+
+
+/** Load an applet in to a font.
+ *
+ *  @param  index   The applet number.
+ *  @param  font    The font.
+ *  @return         Logical true if the applet was loaded.
+ */
+bool NeoAppletCorpus::decode(unsigned int index, NeoFont *font)
+{
+    const NeoAppletView *v = view(index);
+    return 0 != v && font->decodeApplet(v->data(), v->length());
+}
+
+
+/** Return the amount of memory used by the corpus, excluding the mapped files.
+ *
+ *  @return     The number of bytes used.
+ */
+unsigned int NeoAppletCorpus::storageSize() const
+{
+    unsigned int size = sizeof *this;
+    size += m_fileCapacity * sizeof m_files[0];
+    size += m_capacity * sizeof m_entries[0];
+    for (unsigned int i = 0; i < m_fileCount; i++) size += strlen(m_files[i].path) + 1;
+    return size;
+}
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      NeoAppletCorpus private methods.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Add an unchecked applet.
+ *
+ *  @param  file    The index of the file holding the applet.
+ *  @param  offset  The offset of the applet in the file.
+ *  @param  length  The length of the applet, in bytes.
+ */
+void NeoAppletCorpus::addEntry(unsigned int file, unsigned int offset, unsigned int length)
+{
+    if (m_count == m_capacity)
+    {
+        unsigned int capacity = (0 == m_capacity) ? 64 : (m_capacity * 2);
+        NeoAppletCorpusEntry *entries = new NeoAppletCorpusEntry[capacity];
+        for (unsigned int i = 0; i < m_count; i++) entries[i] = m_entries[i];
+        delete[] m_entries;
+        m_entries = entries;
+        m_capacity = capacity;
+    }
+    NeoAppletCorpusEntry *e = &m_entries[m_count++];
+    e->file = file;
+    e->offset = offset;
+    e->length = length;
+    e->checked = kNeoCorpusUnchecked;
+    e->view.detach();
+}
@@ -0,0 +1,72 @@
+/** @file       NeoAppletCorpus.h
+ *  @brief      Memory mapped collection of Neo font smart applets.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+#ifndef _NEOAPPLETCORPUS_H_
+#define _NEOAPPLETCORPUS_H_     (1)
+
+#include <stdint.h>
+#include "NeoFont.h"
+#include "NeoAppletView.h"
+
+
+#define kNeoAppletCorpusExtension   ".OS3KApp"      /**< File extension of the applets added from a directory. */
+
+
+struct NeoAppletCorpusFile;
+struct NeoAppletCorpusEntry;
+
+
+/** Class giving read-only access to a large number of font applets without reading them in to memory.
+ *  Applets are added from individual files, from directories of files, or from pack files holding any
+ *  number of applets back to back. Every file is memory mapped, so the operating system reads only the
+ *  pages that are actually used.
+ *
+ *  Adding a file reads only the size field of each applet in it, which is enough to find the next one.
+ *  Each applet is then checked when it is first used: header() checks and reads just the applet header,
+ *  which is enough to list the names, versions and IDs of the applets, and view() checks the whole applet
+ *  before its font information and glyphs are read. Each check is made only once.
+ *
+ *  The files remain mapped until the corpus is closed or destroyed. Views returned by the corpus are valid
+ *  until then, or until more files are added.
+ */
+class NeoAppletCorpus
+{
+public:
+
+    NeoAppletCorpus();
+    ~NeoAppletCorpus();
+
+    bool addFile(const char *path);
+    int addDirectory(const char *path);
+    void close();
+
+    unsigned int count() const;
+    const char *path(unsigned int index) const;
+    unsigned int offset(unsigned int index) const;
+    unsigned int length(unsigned int index) const;
+
+    const NeoAppletView *header(unsigned int index);
+    const NeoAppletView *view(unsigned int index);
+    bool decode(unsigned int index, NeoFont *font);
+
+    unsigned int storageSize() const;
+
+private:
+
+    NeoAppletCorpusFile *m_files;       /**< The mapped files. */
+    unsigned int m_fileCount;           /**< The number of mapped files. */
+    unsigned int m_fileCapacity;        /**< The size of the m_files array. */
+    NeoAppletCorpusEntry *m_entries;    /**< The applets, in the order they were added. */
+    unsigned int m_count;               /**< The number of applets. */
+    unsigned int m_capacity;            /**< The size of the m_entries array. */
+
+    NeoAppletCorpus(const NeoAppletCorpus &other);
+    NeoAppletCorpus &operator=(const NeoAppletCorpus &other);
+
+    void addEntry(unsigned int file, unsigned int offset, unsigned int length);
+};
+
+
+
+#endif  // _NEOAPPLETCORPUS_H_
@@ -0,0 +1,243 @@
+/** @file       NeoAppletEncoder.cc
+ *  @brief      Smart applet encoder that updates its previous output as the font changes.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "NeoAppletEncoder.h"
+
+
+/* Fields that change the position of the bitmap data or the size of every character, so that the whole
+ * applet must be encoded again.
+ */
+#define kNeoAppletEncoderLayoutFields   (kNeoFontFieldFontName | kNeoFontFieldHeight)
+
+/* Fields held in the applet header.
+ */
+#define kNeoAppletEncoderHeaderFields   (kNeoFontFieldAppletName | kNeoFontFieldAppletInfo | kNeoFontFieldVersion | kNeoFontFieldIdent)
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      NeoAppletEncoder class definition.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Class constructor. The encoder subscribes to changes to the font, and must be destroyed before the font
+ *  is. No memory is allocated for the applet until the first call to update().
+ *
+ *  @param  font    The font to encode.
+ */
+NeoAppletEncoder::NeoAppletEncoder(NeoFont *font)
+    :
+        m_font(font),
+        m_changes(font),
+        m_data(0),
+        m_capacity(0),
+        m_length(0),
+        m_bitmapOffset(0),
+        m_widths(),
+        m_offsets()
+{
+    invalidate();
+}
+
+
+/** Destructor.
+ */
+NeoAppletEncoder::~NeoAppletEncoder()
+{
+    delete[] m_data;
+}
+
+
+/** Return the font that is encoded.
+ */
+NeoFont *NeoAppletEncoder::font() const
+{
+    return m_font;
+}
+
+
+/** Obtain read access to the applet.
+ *
+ *  @return         The applet data, as at the last update(), or zero if update() has not yet been called.
+ */
+const uint8_t *NeoAppletEncoder::data() const
+{
+    return m_data;
+}
+
+
+/** Return the length of the applet.
+ *
+ *  @return         The number of bytes in the applet, as at the last update().
+ */
+unsigned int NeoAppletEncoder::length() const
+{
+    return m_length;
+}
+
+
+/** Force the next update() to encode the whole applet.
+ */
+void NeoAppletEncoder::invalidate()
+{
+    m_changes.markAll();
+}
+
+
+/** Bring the applet up to date with the font, rewriting only the parts affected by the changes made since
+ *  the last update.
+ *
+ *  @param  encoded     If not zero, receives the number of characters whose bitmap data was encoded.
+ *  @return             The number of bytes in the applet.
+ */
+unsigned int NeoAppletEncoder::update(int *encoded)
+{
+    int count = 0;
+    unsigned int fields = m_changes.fields();
+    if (0 == m_data || 0 != (fields & kNeoAppletEncoderLayoutFields))
+    {
+        encodeAll();
+        count = kNeoFontCharacterCount;
+    }
+    else if (!m_changes.isEmpty())
+    {
+        // Rewriting the header also resets the file size and loader references, so the tables must follow
+        bool tables = moveBitmaps();
+        if (0 != (fields & kNeoAppletEncoderHeaderFields))
+        {
+            m_font->encodeAppletHeader(m_data);
+            tables = true;
+        }
+
+        for (int index = m_changes.nextDirty(0); index >= 0; index = m_changes.nextDirty(index + 1))
+        {
+            NeoCharacterRect r = m_changes.dirtyRect(index);
+            m_font->encodeCharacter(index, r.y0, r.y1, &m_data[m_bitmapOffset + m_offsets[index]]);
+            count++;
+        }
+
+        if (tables) m_length = m_font->encodeAppletTables(m_data, m_bitmapOffset);
+    }
+
+    m_changes.clear();
+    if (0 != encoded) *encoded = count;
+    return m_length;
+}
+
+
+/** Return the amount of memory used by the encoder, including its copy of the applet.
+ *
+ *  @return     The number of bytes used.
+ */
+unsigned int NeoAppletEncoder::storageSize() const
+{
+    return sizeof *this + m_capacity;
+}
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      NeoAppletEncoder private methods.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Make sure that the applet buffer can hold a number of bytes, keeping the current applet. The buffer is
+ *  grown with some room to spare, so that a series of small increases does not copy the applet every time.
+ *
+ *  @param  size    The number of bytes needed.
+ */
+void NeoAppletEncoder::reserve(unsigned int size)
+{
+    if (size <= m_capacity) return;
+    unsigned int capacity = size + (size / 8);
+    uint8_t *data = new uint8_t[capacity]();
+    if (0 != m_data) memcpy(data, m_data, m_length);
+    delete[] m_data;
+    m_data = data;
+    m_capacity = capacity;
+}
+
+
+/** Encode the whole applet and record the position of each character's bitmap data.
+ */
+void NeoAppletEncoder::encodeAll()
+{
+    reserve(m_font->appletSize());
+
+    unsigned int column = (m_font->height() + 7) / 8;
+    m_bitmapOffset = m_font->encodeAppletHeader(m_data);
+    m_offsets[0] = 0;
+    for (int i = 0; i < kNeoFontCharacterCount; i++)
+    {
+        m_widths[i] = m_font->character(i)->width();
+        m_offsets[i + 1] = m_offsets[i] + (m_widths[i] * column);
+        m_font->encodeCharacter(i, 0, m_font->height(), &m_data[m_bitmapOffset + m_offsets[i]]);
+    }
+    m_length = m_font->encodeAppletTables(m_data, m_bitmapOffset);
+}
+
+
+/** Move the bitmap data to suit any changes to the character widths. Only changed characters can change
+ *  width, and each run of characters between two that did is moved as a block. Blocks moving towards the
+ *  start of the applet are moved first, in order, and then those moving towards the end, in reverse order,
+ *  so that no block overwrites another before it has been moved. A character that changed width is marked
+ *  as changed throughout, so that it is encoded completely in its new position.
+ *
+ *  @return         Logical true if any character changed width.
+ */
+bool NeoAppletEncoder::moveBitmaps()
+{
+    int resized[kNeoFontCharacterCount];
+    int count = 0;
+    for (int index = m_changes.nextDirty(0); index >= 0; index = m_changes.nextDirty(index + 1))
+    {
+        if (m_font->character(index)->width() != m_widths[index]) resized[count++] = index;
+    }
+    if (0 == count) return false;
+
+    unsigned int column = (m_font->height() + 7) / 8;
+    unsigned int offsets[kNeoFontCharacterCount + 1];
+    offsets[0] = 0;
+    for (int i = 0; i < kNeoFontCharacterCount; i++)
+    {
+        offsets[i + 1] = offsets[i] + (m_font->character(i)->width() * column);
+    }
+    reserve(m_font->appletSize());
+
+    // Block n holds the characters after resized[n - 1] up to (but not including) resized[n]
+    uint8_t *bitmaps = &m_data[m_bitmapOffset];
+    for (int n = 0; n <= count; n++)
+    {
+        int first = (0 == n) ? 0 : (resized[n - 1] + 1);
+        int end = (count == n) ? kNeoFontCharacterCount : resized[n];
+        if (first < end && offsets[first] < m_offsets[first])
+        {
+            memmove(&bitmaps[offsets[first]], &bitmaps[m_offsets[first]], m_offsets[end] - m_offsets[first]);
+        }
+    }
+    for (int n = count; n >= 0; n--)
+    {
+        int first = (0 == n) ? 0 : (resized[n - 1] + 1);
+        int end = (count == n) ? kNeoFontCharacterCount : resized[n];
+        if (first < end && offsets[first] > m_offsets[first])
+        {
+            memmove(&bitmaps[offsets[first]], &bitmaps[m_offsets[first]], m_offsets[end] - m_offsets[first]);
+        }
+    }
+
+    for (int n = 0; n < count; n++)
+    {
+        m_widths[resized[n]] = m_font->character(resized[n])->width();
+        m_changes.markCharacter(resized[n]);
+    }
+    memcpy(m_offsets, offsets, sizeof m_offsets);
+    return true;
+}
@@ -0,0 +1,63 @@
+/** @file       NeoAppletEncoder.h
+ *  @brief      Smart applet encoder that updates its previous output as the font changes.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+#ifndef _NEOAPPLETENCODER_H_
+#define _NEOAPPLETENCODER_H_    (1)
+
+#include <stdint.h>
+#include "NeoFont.h"
+#include "NeoFontSubscription.h"
+
+
+
+/** Class that keeps an encoded smart applet up to date with a font. The first update() encodes the whole
+ *  applet, exactly as NeoFont::encodeApplet() does. Later updates follow the changes reported through a
+ *  NeoFontSubscription and rewrite only what those changes affect:
+ *
+ *  - Pixel changes re-encode only the 8 pixel strips holding the changed rows of the changed characters.
+ *  - Width changes move the bitmap data of the following characters, and rewrite the width and offset
+ *    tables, the font information structure and the loader's references to it.
+ *  - Changes to the applet name, information, version or ID rewrite the header.
+ *  - Changes to the font name or height re-encode the whole applet.
+ *
+ *  The result is always identical to the output of NeoFont::encodeApplet() for the current font.
+ */
+class NeoAppletEncoder
+{
+public:
+
+    NeoAppletEncoder(NeoFont *font);
+    ~NeoAppletEncoder();
+
+    NeoFont *font() const;
+    const uint8_t *data() const;
+    unsigned int length() const;
+
+    void invalidate();
+    unsigned int update(int *encoded = 0);
+
+    unsigned int storageSize() const;
+
+private:
+
+    NeoFont *m_font;                                        /**< The font. */
+    NeoFontSubscription m_changes;                          /**< Changes made since the applet was last updated. */
+    uint8_t *m_data;                                        /**< The applet. */
+    unsigned int m_capacity;                                /**< Size of m_data, in bytes. */
+    unsigned int m_length;                                  /**< Length of the applet, in bytes. */
+    unsigned int m_bitmapOffset;                            /**< Offset of the bitmap data in the applet. */
+    int m_widths[kNeoFontCharacterCount];                   /**< Width of each character, as encoded. */
+    unsigned int m_offsets[kNeoFontCharacterCount + 1];     /**< Offset of each character's bitmap, as encoded. */
+
+    NeoAppletEncoder(const NeoAppletEncoder &other);
+    NeoAppletEncoder &operator=(const NeoAppletEncoder &other);
+
+    void reserve(unsigned int size);
+    void encodeAll();
+    bool moveBitmaps();
+};
+
+
+
+#endif  // _NEOAPPLETENCODER_H_
@@ -0,0 +1,45 @@
+/** @file       NeoAppletFormat.h
+ *  @brief      Definitions describing the layout of a Neo font smart applet file.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+#ifndef _NEOAPPLETFORMAT_H_
+#define _NEOAPPLETFORMAT_H_ (1)
+
+/* Applet file definition constants.
+ */
+#define kAppletOffMagic1            (0x0000)        /**< kMagic1 (big-endian, 32 bit). */
+#define kAppletOffFileSize          (0x0004)        /**< File size (big-endian, 32 bit). */
+#define kAppletOffID1               (0x0014)        /**< ID byte */
+#define kAppletOffID0               (0x0015)        /**< ID byte */
+#define kAppletOffControlCode       (0x0142)        /**< Very dubious offset to 68k lea code for data table (!). */
+#define kAppletOffFontName          (0x01f2)        /**< Start of zero terminated font name. */
+#define kAppletOffAppletName        (0x0018)        /**< Start of zero terminated smart applet name (description). */
+#define kAppletOffVersionMajor      (0x003c)        /**< Major version number. */
+#define kAppletOffVersionMinor      (0x003d)        /**< Minor version number. */
+#define kAppletOffVersionBuild      (0x003e)        /**< Release code (letter). */
+#define kAppletOffAppletInfo        (0x0040)        /**< Applet information string (64 bytes long). */
+
+#define kAppletAppletNameLength     (36)            /**< Size of the applet name field, including the terminator. */
+#define kAppletAppletInfoLength     (64)            /**< Size of the applet info field, including the terminator. */
+
+#define kAppletRelOffFontHeight     (0x00)          /**< Offset to font height, relative to 16 byte font info structure. */
+#define kAppletRelOffMaxWidth       (0x01)          /**< Offset to the maximum character width, relative to font info structure. */
+#define kAppletRelOffMaxBytes       (0x02)          /**< Offset to the maximum character bitmap size, relative to font info structure. */
+#define kAppletRelOffWidthTable     (0x04)          /**< Offset to 8 bute font width table, relative to font info structure. */
+#define kAppletRelOffLocationTable  (0x08)          /**< Offset to 16 bit bit data offset table, relative to font info structure. */
+#define kAppletRelOffBitmaps        (0x0c)          /**< Start of font bitmap data, relative to font info structure. */
+#define kAppletFontInfoSize         (0x10)          /**< Size of the font info structure. */
+
+#define kMagic1              (0xc0ffeeadu)          /**< Value for kAppletOffMagic. */
+
+
+
+/* Helper macros used to decode big-endian values from a byte array.
+ */
+#define XB8(a, x)   ((unsigned)a[x])
+#define XB16(a, x)  ((((unsigned)a[x]) << 8) | (((unsigned)a[x+1]) << 0))
+#define XB32(a, x)  ((((unsigned)a[x]) << 24) | (((unsigned)a[x+1]) << 16) | (((unsigned)a[x+2]) << 8) | (((unsigned)a[x+3]) << 0))
+
+
+
+#endif  // _NEOAPPLETFORMAT_H_
@@ -0,0 +1,418 @@
+/** @file       NeoAppletView.cc
+ *  @brief      Read-only view of a Neo font smart applet held in memory.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+
+#include <string.h>
+#include <stdint.h>
+#include "NeoAppletView.h"
+#include "NeoAppletFormat.h"
+
+
+
+/** Check that a range of bytes lies entirely within a buffer. The calculation is performed using 64 bit
+ *  arithmetic so that offsets read from the file cannot cause it to wrap.
+ *
+ *  @param  offset      The start of the range.
+ *  @param  size        The number of bytes in the range.
+ *  @param  length      The size of the buffer.
+ *  @return             Logical true if the range is contained in the buffer.
+ */
+static inline bool inBounds(uint64_t offset, uint64_t size, unsigned int length)
+{
+    return (offset + size) <= (uint64_t)length;
+}
+
+
+/** Check that a zero terminated string lies entirely within a field.
+ *
+ *  @param  data        The buffer.
+ *  @param  offset      The start of the field.
+ *  @param  size        The size of the field, including space for the terminator.
+ *  @return             Logical true if a terminator is found within the field.
+ */
+static inline bool isTerminated(const uint8_t *data, unsigned int offset, unsigned int size)
+{
+    return 0 != memchr(&data[offset], 0, size);
+}
+
+
+/** Class constructor. The view is not attached to any data.
+ */
+NeoAppletView::NeoAppletView()
+    :
+        m_data(0),
+        m_length(0),
+        m_fontInfo(0),
+        m_widthTable(0),
+        m_locationTable(0),
+        m_bitmaps(0),
+        m_complete(false),
+        m_error(kNeoAppletOK)
+{
+    // Nothing.
+}
+
+
+/** Class constructor. The view is attached to the supplied data, if it is valid.
+ *
+ *  @param  data    A pointer to the applet data.
+ *  @param  length  The number of bytes of data.
+ */
+NeoAppletView::NeoAppletView(const uint8_t *data, unsigned int length)
+    :
+        m_data(0),
+        m_length(0),
+        m_fontInfo(0),
+        m_widthTable(0),
+        m_locationTable(0),
+        m_bitmaps(0),
+        m_complete(false),
+        m_error(kNeoAppletOK)
+{
+    attach(data, length);
+}
+
+
+/** Class destructor.
+ */
+NeoAppletView::~NeoAppletView()
+{
+    // Nothing.
+}
+
+
+/** Attach the view to applet data. Every structure that the accessors refer to is checked against the
+ *  buffer length. If any check fails, the view is left detached.
+ *
+ *  @param  data    A pointer to the applet data.
+ *  @param  length  The number of bytes of data.
+ *  @return         Logical true if the data is a valid font applet.
+ */
+bool NeoAppletView::attach(const uint8_t *data, unsigned int length)
+{
+    if (!attachHeader(data, length))
+    {
+        return false;
+    }
+
+    /* Check the tables referenced by the font information structure.
+     */
+    unsigned int font_info = m_fontInfo;
+    unsigned int width_table = XB32(data, font_info + kAppletRelOffWidthTable);
+    unsigned int location_table = XB32(data, font_info + kAppletRelOffLocationTable);
+    unsigned int bitmaps = XB32(data, font_info + kAppletRelOffBitmaps);
+    if (!inBounds(width_table, kNeoFontCharacterCount, length) ||
+        !inBounds(location_table, kNeoFontCharacterCount * 2, length) ||
+        !inBounds(bitmaps, 0, length))
+    {
+        return fail(kNeoAppletErrorTable);
+    }
+
+    unsigned int strips = (XB8(data, font_info + kAppletRelOffFontHeight) + 7) / 8;
+    for (unsigned int i = 0; i < kNeoFontCharacterCount; i++)
+    {
+        uint64_t offset = (uint64_t)bitmaps + XB16(data, location_table + (i * 2));
+        if (!inBounds(offset, strips * XB8(data, width_table + i), length))
+        {
+            return fail(kNeoAppletErrorBitmap);
+        }
+    }
+
+    m_widthTable = width_table;
+    m_locationTable = location_table;
+    m_bitmaps = bitmaps;
+    m_complete = true;
+    m_error = kNeoAppletOK;
+    return true;
+}
+
+
+/** Attach the view to the header of applet data. Only the fixed header, the font name and the loader code
+ *  are checked, so only the first page or so of the applet is read. The applet fields (names, version and
+ *  ID) may then be read, but the font information and glyphs may not (see isComplete()).
+ *
+ *  @param  data    A pointer to the applet data.
+ *  @param  length  The number of bytes of data.
+ *  @return         Logical true if the data has a valid font applet header.
+ */
+bool NeoAppletView::attachHeader(const uint8_t *data, unsigned int length)
+{
+    detach();
+
+    /* Check that the fixed header is present, then check the magic number and the file length.
+     */
+    if (0 == data || !inBounds(kAppletOffFontName, 1, length))
+    {
+        return fail(kNeoAppletErrorTruncated);
+    }
+    if (XB32(data, kAppletOffMagic1) != kMagic1)
+    {
+        return fail(kNeoAppletErrorMagic);
+    }
+    if (XB32(data, kAppletOffFileSize) != length)
+    {
+        return fail(kNeoAppletErrorFileSize);
+    }
+    if (!isTerminated(data, kAppletOffAppletName, kAppletAppletNameLength) ||
+        !isTerminated(data, kAppletOffAppletInfo, kAppletAppletInfoLength) ||
+        !isTerminated(data, kAppletOffFontName, length - kAppletOffFontName))
+    {
+        return fail(kNeoAppletErrorString);
+    }
+
+    /* Decode the instructions that contain the address of the font data descriptor structure. This is
+     * dependent on the code in the applet prefix (see NeoFont::encodeApplet()).
+     */
+    unsigned int code0 = XB16(data, 0x0142);    // movea.l #<value>, a0
+    unsigned int code1 = XB32(data, 0x0144);    //          <value>
+    unsigned int code2 = XB16(data, 0x0148);    // lea (<offset>, pc, a0.l), a0
+    unsigned int code3 =  XB8(data, 0x014a);    //
+    unsigned int code4 =  XB8(data, 0x014b);    //      <offset>
+    if ((code0 != 0x207c) || (code2 != 0x41fb) || (code3 != 0x88))
+    {
+        return fail(kNeoAppletErrorLoader);
+    }
+
+    int pc_rel_offset = (code4 < 128) ? (code4) : (code4 - 256);
+    unsigned int font_info = 0x148 + 2 + pc_rel_offset + code1;         // The 68k address calculation wraps at 32 bits
+    if (!inBounds(font_info, kAppletFontInfoSize, length))
+    {
+        return fail(kNeoAppletErrorFontInfo);
+    }
+
+    m_data = data;
+    m_length = length;
+    m_fontInfo = font_info;
+    m_error = kNeoAppletOK;
+    return true;
+}
+
+
+/** Detach the view from its data. The result of the last attach is kept (see error()).
+ */
+void NeoAppletView::detach()
+{
+    m_data = 0;
+    m_length = 0;
+    m_fontInfo = 0;
+    m_widthTable = 0;
+    m_locationTable = 0;
+    m_bitmaps = 0;
+    m_complete = false;
+}
+
+
+/** Test if the view is attached to valid applet data.
+ *
+ *  @return         Logical true if the view is valid. The other accessors must not be used if this is false.
+ */
+bool NeoAppletView::isValid() const
+{
+    return 0 != m_data;
+}
+
+
+/** Test if the whole applet has been checked. If the view was attached with attachHeader(), only the
+ *  accessors for the applet fields may be used; height(), maxWidth(), strips() and the glyph accessors
+ *  need a complete view.
+ *
+ *  @return         Logical true if the view was attached with attach().
+ */
+bool NeoAppletView::isComplete() const
+{
+    return m_complete;
+}
+
+
+/** Find out why the view was not attached.
+ *
+ *  @return         kNeoAppletOK if the last attach succeeded, or the kNeoAppletError... code for the first
+ *                  check that it failed.
+ */
+int NeoAppletView::error() const
+{
+    return m_error;
+}
+
+
+/** Get a description of a result code.
+ *
+ *  @param  error   The result code (kNeoAppletOK or kNeoAppletError...).
+ *  @return         A short description, such as "bad file size".
+ */
+const char *NeoAppletView::errorText(int error)
+{
+    static const char *const text[kNeoAppletErrorCount] =
+    {
+        "valid applet",
+        "truncated applet header",
+        "not an applet",
+        "bad file size",
+        "unterminated string",
+        "unrecognised loader code",
+        "font information outside file",
+        "font table outside file",
+        "character bitmap outside file"
+    };
+    if (error < 0 || error >= kNeoAppletErrorCount) return "unknown error";
+    else return text[error];
+}
+
+
+/** Get the applet data.
+ *
+ *  @return         A pointer to the data, or zero if the view is not attached.
+ */
+const uint8_t *NeoAppletView::data() const
+{
+    return m_data;
+}
+
+
+/** Get the length of the applet data.
+ *
+ *  @return         The number of bytes in the applet.
+ */
+unsigned int NeoAppletView::length() const
+{
+    return m_length;
+}
+
+
+/** Get the name of the applet.
+ *
+ *  @return         A pointer to a c-string within the applet data.
+ */
+const char *NeoAppletView::appletName() const
+{
+    return (const char *) &m_data[kAppletOffAppletName];
+}
+
+
+/** Get the applet info string.
+ *
+ *  @return         A pointer to a c-string within the applet data.
+ */
+const char *NeoAppletView::appletInfo() const
+{
+    return (const char *) &m_data[kAppletOffAppletInfo];
+}
+
+
+/** Get the font name embedded in the applet.
+ *
+ *  @return         A pointer to a c-string within the applet data.
+ */
+const char *NeoAppletView::fontName() const
+{
+    return (const char *) &m_data[kAppletOffFontName];
+}
+
+
+/** Get the major version number.
+ *
+ *  @return         The version number.
+ */
+int NeoAppletView::versionMajor() const
+{
+    return XB8(m_data, kAppletOffVersionMajor);
+}
+
+
+/** Get the minor version number.
+ *
+ *  @return         The version number.
+ */
+int NeoAppletView::versionMinor() const
+{
+    return XB8(m_data, kAppletOffVersionMinor);
+}
+
+
+/** Get the build code.
+ *
+ *  @return         The build code (an ASCII character).
+ */
+int NeoAppletView::versionBuild() const
+{
+    return XB8(m_data, kAppletOffVersionBuild);
+}
+
+
+/** Get the applet ID.
+ *
+ *  @return         The 16 bit applet ID.
+ */
+int NeoAppletView::ident() const
+{
+    return (XB8(m_data, kAppletOffID1) * 256) + XB8(m_data, kAppletOffID0);
+}
+
+
+/** Record why the data was rejected and leave the view detached.
+ *
+ *  @param  error   The reason (kNeoAppletError...).
+ *  @return         Logical false, for use as the result of attach() or attachHeader().
+ */
+bool NeoAppletView::fail(int error)
+{
+    detach();
+    m_error = error;
+    return false;
+}
+
+
+/** Get the font height.
+ *
+ *  @return         The height, in pixels, as stored in the applet.
+ */
+int NeoAppletView::height() const
+{
+    return XB8(m_data, m_fontInfo + kAppletRelOffFontHeight);
+}
+
+
+/** Get the maximum character width.
+ *
+ *  @return         The width, in pixels, as stored in the applet.
+ */
+int NeoAppletView::maxWidth() const
+{
+    return XB8(m_data, m_fontInfo + kAppletRelOffMaxWidth);
+}
+
+
+/** Get the number of 8 pixel strips used for each character.
+ *
+ *  @return         The number of strips. Each strip contains one byte per pixel column.
+ */
+unsigned int NeoAppletView::strips() const
+{
+    return (height() + 7) / 8;
+}
+
+
+/** Get the width of a character.
+ *
+ *  @param  index   The character number.
+ *  @return         The width, in pixels, as stored in the applet, or zero if index is out of range.
+ */
+int NeoAppletView::glyphWidth(int index) const
+{
+    if (index < 0 || index >= kNeoFontCharacterCount) return 0;
+    else return XB8(m_data, m_widthTable + index);
+}
+
+
+/** Get the bitmap data for a character. This is strips() strips of glyphWidth() bytes each, with bit n of
+ *  each byte giving row n of the strip.
+ *
+ *  @param  index   The character number.
+ *  @return         A pointer in to the applet data, or zero if index is out of range.
+ */
+const uint8_t *NeoAppletView::glyphBits(int index) const
+{
+    if (index < 0 || index >= kNeoFontCharacterCount) return 0;
+    else return &m_data[m_bitmaps + XB16(m_data, m_locationTable + (index * 2))];
+}
@@ -0,0 +1,84 @@
+/** @file       NeoAppletView.h
+ *  @brief      Read-only view of a Neo font smart applet held in memory.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+#ifndef _NEOAPPLETVIEW_H_
+#define _NEOAPPLETVIEW_H_   (1)
+
+#include <stdint.h>
+#include "NeoFont.h"
+
+
+/* Reasons for rejecting applet data (see NeoAppletView::error()).
+ */
+#define kNeoAppletOK                (0)     /**< The data is a valid font applet. */
+#define kNeoAppletErrorTruncated    (1)     /**< Too short to hold the applet header. */
+#define kNeoAppletErrorMagic        (2)     /**< Not an applet (unexpected magic number). */
+#define kNeoAppletErrorFileSize     (3)     /**< The file size in the header does not match the data length. */
+#define kNeoAppletErrorString       (4)     /**< The applet name, info or font name is not terminated. */
+#define kNeoAppletErrorLoader       (5)     /**< The loader code is not that written by NeoFont::encodeApplet(). */
+#define kNeoAppletErrorFontInfo     (6)     /**< The font information structure is outside the data. */
+#define kNeoAppletErrorTable        (7)     /**< The width or location table is outside the data. */
+#define kNeoAppletErrorBitmap       (8)     /**< A character bitmap is outside the data. */
+#define kNeoAppletErrorCount        (9)     /**< Number of result codes. */
+
+
+/** Class giving read-only access to the contents of a font applet without copying it. All of the offsets
+ *  in the applet are validated when the view is attached, so that the accessors can then be used without
+ *  further checks. The view does not own the data, which must remain valid while the view is in use.
+ *
+ *  If the data is rejected, error() gives the reason. A view can also be attached to just the applet
+ *  header, which checks and reads only the first page or so of the applet. This is enough to list the
+ *  applet name, font name, version and ID of a large set of applets.
+ */
+class NeoAppletView
+{
+public:
+
+    NeoAppletView();
+    NeoAppletView(const uint8_t *data, unsigned int length);
+    ~NeoAppletView();
+
+    bool attach(const uint8_t *data, unsigned int length);
+    bool attachHeader(const uint8_t *data, unsigned int length);
+    void detach();
+    bool isValid() const;
+    bool isComplete() const;
+    int error() const;
+    static const char *errorText(int error);
+
+    const uint8_t *data() const;
+    unsigned int length() const;
+
+    const char *appletName() const;
+    const char *appletInfo() const;
+    const char *fontName() const;
+    int versionMajor() const;
+    int versionMinor() const;
+    int versionBuild() const;
+    int ident() const;
+
+    int height() const;
+    int maxWidth() const;
+    unsigned int strips() const;
+
+    int glyphWidth(int index) const;
+    const uint8_t *glyphBits(int index) const;
+
+private:
+
+    const uint8_t *m_data;              /**< The applet data, or zero if not attached. */
+    unsigned int m_length;              /**< The number of bytes of applet data. */
+    unsigned int m_fontInfo;            /**< Offset to the font information structure. */
+    unsigned int m_widthTable;          /**< Offset to the character width table. */
+    unsigned int m_locationTable;       /**< Offset to the bitmap location table. */
+    unsigned int m_bitmaps;             /**< Offset to the start of the bitmap data. */
+    bool m_complete;                    /**< Logical true if the tables and bitmaps have been checked. */
+    int m_error;                        /**< Why the last attach failed (kNeoAppletError...), or kNeoAppletOK. */
+
+    bool fail(int error);
+};
+
+
+
+#endif  // _NEOAPPLETVIEW_H_
@@ -0,0 +1,343 @@
+/** @file       NeoArchive.cc
+ *  @brief      Portable byte stream used for font and character archives.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "NeoArchive.h"
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      NeoArchiveWriter class definition.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Class constructor.
+ *
+ *  @param  data    The buffer to write to, or zero to count the bytes without writing them. The buffer must be
+ *                  large enough for the complete archive.
+ */
+NeoArchiveWriter::NeoArchiveWriter(uint8_t *data)
+    :
+        m_data(data),
+        m_length(0),
+        m_bits(0),
+        m_bitCount(0)
+{
+    // Nothing.
+}
+
+
+/** Write a byte.
+ *
+ *  @param  value   The value to write (only the low 8 bits are used).
+ */
+void NeoArchiveWriter::putByte(unsigned int value)
+{
+    if (0 != m_data) m_data[m_length] = (uint8_t)value;
+    m_length++;
+}
+
+
+/** Write an array of bytes.
+ *
+ *  @param  data    The bytes to write.
+ *  @param  length  The number of bytes.
+ */
+void NeoArchiveWriter::putBytes(const void *data, unsigned int length)
+{
+    if (0 != m_data) memcpy(&m_data[m_length], data, length);
+    m_length += length;
+}
+
+
+/** Write an unsigned value as a varint: seven bits per byte, least significant first, with the top bit
+ *  of each byte set if more bytes follow.
+ *
+ *  @param  value   The value to write.
+ */
+void NeoArchiveWriter::putVarint(uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        putByte((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    putByte(value);
+}
+
+
+/** Write a string as a varint length followed by the characters (without a terminator).
+ *
+ *  @param  s       The string.
+ */
+void NeoArchiveWriter::putString(const char *s)
+{
+    unsigned int length = strlen(s);
+    putVarint(length);
+    putBytes(s, length);
+}
+
+
+/** Write a magic code and the current format version.
+ *
+ *  @param  magic   The magic code (kNeoArchiveMagicLength characters).
+ */
+void NeoArchiveWriter::putMagic(const char *magic)
+{
+    putBytes(magic, kNeoArchiveMagicLength);
+    putVarint(kNeoArchiveVersion);
+}
+
+
+/** Write a sequence of bits. Bits are packed least significant first, with no padding between calls.
+ *  flushBits() must be called before any other value is written.
+ *
+ *  @param  value   The bits to write.
+ *  @param  count   The number of bits, from 0 to 64.
+ */
+void NeoArchiveWriter::putBits(uint64_t value, int count)
+{
+    if (count <= 0) return;
+    if (count < 64) value &= (((uint64_t)1) << count) - 1;
+
+    m_bits |= value << m_bitCount;
+    if (m_bitCount + count < 64)
+    {
+        m_bitCount += count;
+        return;
+    }
+
+    // A complete word is available
+    if (0 != m_data)
+    {
+        uint8_t *out = &m_data[m_length];
+        for (int i = 0; i < 8; i++) out[i] = (uint8_t)(m_bits >> (i * 8));
+    }
+    m_length += 8;
+    m_bits = (0 == m_bitCount) ? 0 : (value >> (64 - m_bitCount));
+    m_bitCount = m_bitCount + count - 64;
+}
+
+
+/** Write a bitmap row of a character.
+ *
+ *  @param  row     The row, with pixel x in bit (x % 64) of word (x / 64).
+ *  @param  width   The number of pixels to write.
+ */
+void NeoArchiveWriter::putRow(const uint64_t *row, int width)
+{
+    for (int x = 0; x < width; x += 64)
+    {
+        putBits(row[x / 64], (width - x < 64) ? (width - x) : 64);
+    }
+}
+
+
+/** Write any pending bits, padding to a byte boundary with zeros.
+ */
+void NeoArchiveWriter::flushBits()
+{
+    while (m_bitCount > 0)
+    {
+        putByte((unsigned int)(m_bits & 255));
+        m_bits >>= 8;
+        m_bitCount -= 8;
+    }
+    m_bits = 0;
+    m_bitCount = 0;
+}
+
+
+/** Return the number of bytes written.
+ */
+unsigned int NeoArchiveWriter::length() const
+{
+    return m_length;
+}
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      NeoArchiveReader class definition.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Class constructor.
+ *
+ *  @param  data    The archive data.
+ *  @param  length  The number of bytes of data.
+ */
+NeoArchiveReader::NeoArchiveReader(const uint8_t *data, unsigned int length)
+    :
+        m_data(data),
+        m_length(length),
+        m_position(0),
+        m_bits(0),
+        m_bitCount(0),
+        m_valid(0 != data)
+{
+    // Nothing.
+}
+
+
+/** Read a byte.
+ *
+ *  @return         The value, or zero if there is no more data.
+ */
+unsigned int NeoArchiveReader::getByte()
+{
+    if (m_position >= m_length)
+    {
+        m_valid = false;
+        return 0;
+    }
+    return m_data[m_position++];
+}
+
+
+/** Read a varint.
+ *
+ *  @return         The value, or zero if the data is invalid.
+ */
+uint32_t NeoArchiveReader::getVarint()
+{
+    uint32_t value = 0;
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        unsigned int byte = getByte();
+        value |= ((uint32_t)(byte & 0x7f)) << shift;
+        if (0 == (byte & 0x80)) return value;
+    }
+    m_valid = false;
+    return 0;
+}
+
+
+/** Read a string. A string that is too long for the buffer is truncated.
+ *
+ *  @param  s       The buffer to receive the zero terminated string.
+ *  @param  size    The size of the buffer, in bytes.
+ */
+void NeoArchiveReader::getString(char *s, unsigned int size)
+{
+    uint32_t length = getVarint();
+    if (length > m_length - m_position)
+    {
+        m_valid = false;
+        length = 0;
+    }
+    unsigned int n = (length < size - 1) ? length : (size - 1);
+    memcpy(s, &m_data[m_position], n);
+    s[n] = 0;
+    m_position += length;
+}
+
+
+/** Read and check a magic code and format version.
+ *
+ *  @param  magic   The expected magic code (kNeoArchiveMagicLength characters).
+ *  @return         Logical true if the magic code matches and the version can be read by this code.
+ */
+bool NeoArchiveReader::getMagic(const char *magic)
+{
+    if (m_length - m_position < kNeoArchiveMagicLength || 0 != memcmp(&m_data[m_position], magic, kNeoArchiveMagicLength))
+    {
+        m_valid = false;
+        return false;
+    }
+    m_position += kNeoArchiveMagicLength;
+    uint32_t version = getVarint();
+    if (version < 1 || version > kNeoArchiveVersion) m_valid = false;
+    return m_valid;
+}
+
+
+/** Read a sequence of bits written by NeoArchiveWriter::putBits(). alignBits() must be called before any
+ *  other value is read.
+ *
+ *  @param  count   The number of bits, from 0 to 64.
+ *  @return         The bits, or zero if there is not enough data.
+ */
+uint64_t NeoArchiveReader::getBits(int count)
+{
+    if (count <= 0) return 0;
+
+    uint64_t value;
+    if (count <= m_bitCount)
+    {
+        value = m_bits;
+        m_bits = (64 == count) ? 0 : (m_bits >> count);
+        m_bitCount -= count;
+    }
+    else
+    {
+        // Load up to another word of data
+        unsigned int bytes = m_length - m_position;
+        if (bytes > 8) bytes = 8;
+        uint64_t word = 0;
+        for (unsigned int i = 0; i < bytes; i++) word |= ((uint64_t)m_data[m_position + i]) << (i * 8);
+        m_position += bytes;
+
+        int need = count - m_bitCount;
+        if (need > (int)(bytes * 8))
+        {
+            m_valid = false;
+            m_bits = 0;
+            m_bitCount = 0;
+            return 0;
+        }
+        value = m_bits | ((m_bitCount < 64) ? (word << m_bitCount) : 0);
+        m_bits = (64 == need) ? 0 : (word >> need);
+        m_bitCount = (bytes * 8) - need;
+    }
+
+    if (count < 64) value &= (((uint64_t)1) << count) - 1;
+    return value;
+}
+
+
+/** Read a bitmap row written by NeoArchiveWriter::putRow(). Bits beyond the width are cleared.
+ *
+ *  @param  row     The row to receive the pixels. This must have space for (width + 63) / 64 words.
+ *  @param  width   The number of pixels to read.
+ */
+void NeoArchiveReader::getRow(uint64_t *row, int width)
+{
+    for (int x = 0; x < width; x += 64)
+    {
+        row[x / 64] = getBits((width - x < 64) ? (width - x) : 64);
+    }
+}
+
+
+/** Discard any bits remaining in a partly used byte, so that the next value is read from a byte boundary.
+ */
+void NeoArchiveReader::alignBits()
+{
+    m_position -= m_bitCount / 8;
+    m_bits = 0;
+    m_bitCount = 0;
+}
+
+
+/** Test if every read so far has succeeded.
+ */
+bool NeoArchiveReader::isValid() const
+{
+    return m_valid;
+}
+
+
+/** Return the number of unread bytes.
+ */
+unsigned int NeoArchiveReader::remaining() const
+{
+    return m_length - m_position + (m_bitCount / 8);
+}
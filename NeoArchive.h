@@ -0,0 +1,85 @@
+/** @file       NeoArchive.h
+ *  @brief      Portable byte stream used for font and character archives.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+#ifndef _NEOARCHIVE_H_
+#define _NEOARCHIVE_H_  (1)
+
+#include <stdint.h>
+
+
+/* Archive identification. Every archive starts with a four byte magic code followed by the format version
+ * as a varint. All multi-byte values are written least significant byte first, so archives are independent
+ * of the host byte order and structure layout.
+ */
+#define kNeoArchiveMagicFont        "NeoF"      /**< Magic code for a font archive. */
+#define kNeoArchiveMagicCharacter   "NeoC"      /**< Magic code for a character archive. */
+#define kNeoArchiveMagicEncoding    "NeoE"      /**< Magic code for an encoding table (see NeoEncoding). */
+#define kNeoArchiveMagicLength      (4)         /**< Length of the magic code, in bytes. */
+#define kNeoArchiveVersion          (1)         /**< The format version written by this code. */
+
+
+
+/** Class used to write an archive. If the writer is created without a buffer it only counts the bytes that
+ *  would have been written, which allows the size of an archive to be found with the same code that saves it.
+ */
+class NeoArchiveWriter
+{
+public:
+
+    NeoArchiveWriter(uint8_t *data);
+
+    void putByte(unsigned int value);
+    void putBytes(const void *data, unsigned int length);
+    void putVarint(uint32_t value);
+    void putString(const char *s);
+    void putMagic(const char *magic);
+    void putBits(uint64_t value, int count);
+    void putRow(const uint64_t *row, int width);
+    void flushBits();
+
+    unsigned int length() const;
+
+private:
+
+    uint8_t *m_data;                /**< The output buffer, or zero if only counting. */
+    unsigned int m_length;          /**< The number of bytes written. */
+    uint64_t m_bits;                /**< Bits waiting to be written. */
+    int m_bitCount;                 /**< The number of valid bits in m_bits (0 to 63). */
+};
+
+
+
+/** Class used to read an archive. Reads past the end of the data return zero and mark the reader as failed,
+ *  so a caller can read a group of values and check isValid() once afterwards.
+ */
+class NeoArchiveReader
+{
+public:
+
+    NeoArchiveReader(const uint8_t *data, unsigned int length);
+
+    unsigned int getByte();
+    uint32_t getVarint();
+    void getString(char *s, unsigned int size);
+    bool getMagic(const char *magic);
+    uint64_t getBits(int count);
+    void getRow(uint64_t *row, int width);
+    void alignBits();
+
+    bool isValid() const;
+    unsigned int remaining() const;
+
+private:
+
+    const uint8_t *m_data;          /**< The archive data. */
+    unsigned int m_length;          /**< The number of bytes of data. */
+    unsigned int m_position;        /**< Offset of the next unread byte. */
+    uint64_t m_bits;                /**< Bits read from the data but not yet consumed. */
+    int m_bitCount;                 /**< The number of valid bits in m_bits (0 to 64). */
+    bool m_valid;                   /**< Logical false if a read has failed. */
+};
+
+
+
+#endif  // _NEOARCHIVE_H_
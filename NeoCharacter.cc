@@ -6,41 +6,166 @@
 #include <stdint.h>
 #include <string.h>
 #include "NeoCharacter.h"
+#include "NeoFont.h"
 
 
 
-/** Helper macto used to translate (x,y) coordinates to a byte index.
+/** Layout of the original character archive. This matches the memory image of the original fixed-size
+ *  character object (a 128 pixel row stride for every character). It is only used to load old pasteboard data.
+ */
+struct NeoCharacterArchive
+{
+    int width;                                                                  /**< Character width, in pixels. */
+    int height;                                                                 /**< Character height, in pixels. */
+    uint8_t bitmap[((kNeoCharacterMaxWidth * kNeoCharacterMaxHeight) + 7) / 8]; /**< Bitmap, 1 bit per pixel. */
+};
+
+#define kArchiveRowBytes    (kNeoCharacterMaxWidth / 8)     /**< Number of bytes per row in an archived bitmap. */
+
+
+/* Bitmap encodings used in a character record.
+ */
+#define kRecordPacked       (0)     /**< Every row, packed with no padding between rows. */
+#define kRecordElided       (1)     /**< A bit mask of the non-blank rows, followed by those rows packed. */
+
+
+/* Hash keys. Every pixel position and every character size has its own key, made by mixing a distinct
+ * value, so no two keys are the same.
+ */
+#define kHashSizeTag        (((uint64_t)1) << 32)       /**< Added to the size to make the size keys. */
+#define kHashMix1           (0xbf58476d1ce4e5b9ull)     /**< First multiplier of the SplitMix64 finaliser. */
+#define kHashMix2           (0x94d049bb133111ebull)     /**< Second multiplier of the SplitMix64 finaliser. */
+
+
+
+/** Helper macro used to translate (x,y) coordinates to a word index.
  *
  *  @param  x       Pixel x-coordinate.
  *  @param  y       Pixel y-coordinate.
- *  @return         The byte index.
+ *  @return         The word index.
+ */
+#define XY_TO_WORD(x, y)  (((y) * m_rowWords) + ((x) / 64))
+
+
+
+/** Helper macro used to translate an x coordinate to a bit mask within a word.
+ *
+ *  @param  x       Pixel x-coordinate.
+ *  @return         The bit mask.
+ */
+#define X_TO_BIT(x)       (((uint64_t)1) << ((x) & 63))
+
+
+
+/** Return the mask of valid pixels in the last word of a row.
+ *
+ *  @param  w       The character width, in pixels.
+ *  @return         The bit mask.
  */
-#define XY_TO_BYTE(x, y)  (((x) + ((y) * kNeoCharacterMaxWidth)) / 8)
+static inline uint64_t tailMask(int w)
+{
+    return (0 == (w & 63)) ? ~(uint64_t)0 : ((((uint64_t)1) << (w & 63)) - 1);
+}
 
 
+/** Mix the bits of a 64 bit value (the SplitMix64 finaliser). Every input bit affects every output bit,
+ *  and no two inputs give the same output.
+ *
+ *  @param  v       The value.
+ *  @return         The mixed value.
+ */
+static inline uint64_t mixBits(uint64_t v)
+{
+    v = (v ^ (v >> 30)) * kHashMix1;
+    v = (v ^ (v >> 27)) * kHashMix2;
+    return v ^ (v >> 31);
+}
+
 
-/** Helper macro used to translate (x,y) coordinates to a bit index within a byte.
+/** Return the hash key of a pixel position.
  *
  *  @param  x       Pixel x-coordinate.
  *  @param  y       Pixel y-coordinate.
- *  @return         The bit index.
+ *  @return         The key.
+ */
+static inline uint64_t pixelKey(int x, int y)
+{
+    return mixBits(((uint64_t)y << 8) | (uint64_t)x);
+}
+
+
+/** Reverse the order of the bits in a 64 bit word.
+ *
+ *  @param  v       The word to reverse.
+ *  @return         The reversed word (bit 0 becomes bit 63 and so on).
+ */
+static inline uint64_t reverseBits(uint64_t v)
+{
+    v = ((v >>  1) & 0x5555555555555555ull) | ((v & 0x5555555555555555ull) <<  1);
+    v = ((v >>  2) & 0x3333333333333333ull) | ((v & 0x3333333333333333ull) <<  2);
+    v = ((v >>  4) & 0x0f0f0f0f0f0f0f0full) | ((v & 0x0f0f0f0f0f0f0f0full) <<  4);
+    v = ((v >>  8) & 0x00ff00ff00ff00ffull) | ((v & 0x00ff00ff00ff00ffull) <<  8);
+    v = ((v >> 16) & 0x0000ffff0000ffffull) | ((v & 0x0000ffff0000ffffull) << 16);
+    return (v >> 32) | (v << 32);
+}
+
+
+/** Shift a bitmap row towards higher x coordinates (to the right on screen).
+ *
+ *  @param  dst     Receives the shifted row.
+ *  @param  src     The row to shift.
+ *  @param  words   The number of words in the row.
+ *  @param  n       The number of pixels to shift by, in the range 0 to (words * 64).
  */
-#if (0 == (kNeoCharacterMaxWidth & 7))
-#define XY_TO_BIT(x, y)   ((x) & 7)
-#else
-#define XY_TO_BIT(x, y)   (((x) + ((y) * kNeoCharacterMaxWidth)) & 7)
-#endif
+static inline void rowShiftUp(uint64_t *dst, const uint64_t *src, int words, int n)
+{
+    int w = n / 64;
+    int b = n & 63;
+    for (int k = words - 1; k >= 0; k--)
+    {
+        uint64_t v = 0;
+        if (k - w >= 0) v = src[k - w] << b;
+        if (b != 0 && k - w - 1 >= 0) v |= src[k - w - 1] >> (64 - b);
+        dst[k] = v;
+    }
+}
+
+
+/** Shift a bitmap row towards lower x coordinates (to the left on screen).
+ *
+ *  @param  dst     Receives the shifted row.
+ *  @param  src     The row to shift.
+ *  @param  words   The number of words in the row.
+ *  @param  n       The number of pixels to shift by, in the range 0 to (words * 64).
+ */
+static inline void rowShiftDown(uint64_t *dst, const uint64_t *src, int words, int n)
+{
+    int w = n / 64;
+    int b = n & 63;
+    for (int k = 0; k < words; k++)
+    {
+        uint64_t v = 0;
+        if (k + w < words) v = src[k + w] >> b;
+        if (b != 0 && k + w + 1 < words) v |= src[k + w + 1] << (64 - b);
+        dst[k] = v;
+    }
+}
 
 
 /** Class constructor.
  */
 NeoCharacter::NeoCharacter()
     :
-        m_width(8),
-        m_height(8),
-        m_bitmap()
+        m_width(0),
+        m_height(0),
+        m_rowWords(0),
+        m_bitmap(0),
+        m_font(0),
+        m_generation(0),
+        m_pixelHash(0),
+        m_hashGeneration(~0u)
 {
-    clear();
+    resize(8, 8);
 }
 
 
@@ -50,9 +175,14 @@ NeoCharacter::NeoCharacter(const NeoCharacter &other)
     :
         m_width(other.m_width),
         m_height(other.m_height),
-        m_bitmap()
+        m_rowWords(other.m_rowWords),
+        m_bitmap(new uint64_t[other.m_height * other.m_rowWords]),
+        m_font(0),
+        m_generation(0),
+        m_pixelHash(other.m_pixelHash),
+        m_hashGeneration((other.m_hashGeneration == other.m_generation) ? 0 : ~0u)
 {
-    memcpy(m_bitmap, other.m_bitmap, sizeof m_bitmap);
+    memcpy(m_bitmap, other.m_bitmap, m_height * m_rowWords * sizeof m_bitmap[0]);
 }
 
 
@@ -60,7 +190,59 @@ NeoCharacter::NeoCharacter(const NeoCharacter &other)
  */
 NeoCharacter::~NeoCharacter()
 {
-    // Nothing.
+    delete[] m_bitmap;
+}
+
+
+/** Assignment operator. The character remains part of the same font (if any).
+ */
+NeoCharacter &NeoCharacter::operator=(const NeoCharacter &other)
+{
+    if (this != &other)
+    {
+        int changed_width = (m_width > other.m_width) ? m_width : other.m_width;
+        int changed_height = (m_height > other.m_height) ? m_height : other.m_height;
+        if ((m_height * m_rowWords) != (other.m_height * other.m_rowWords))
+        {
+            delete[] m_bitmap;
+            m_bitmap = new uint64_t[other.m_height * other.m_rowWords];
+        }
+        setWidthValue(other.m_width);
+        m_height = other.m_height;
+        m_rowWords = other.m_rowWords;
+        memcpy(m_bitmap, other.m_bitmap, m_height * m_rowWords * sizeof m_bitmap[0]);
+        changed(0, 0, changed_width, changed_height);
+    }
+    return *this;
+}
+
+
+/** Exchange the size and pixels of two characters, without copying the bitmaps. Each character remains part
+ *  of the same font (if any), and both are reported as changed.
+ *
+ *  @param  other   The other character.
+ */
+void NeoCharacter::swap(NeoCharacter *other)
+{
+    if (this == other) return;
+    int width = m_width;
+    int height = m_height;
+    int words = m_rowWords;
+    uint64_t *bitmap = m_bitmap;
+    int changed_width = (m_width > other->m_width) ? m_width : other->m_width;
+    int changed_height = (m_height > other->m_height) ? m_height : other->m_height;
+
+    setWidthValue(other->m_width);
+    m_height = other->m_height;
+    m_rowWords = other->m_rowWords;
+    m_bitmap = other->m_bitmap;
+    other->setWidthValue(width);
+    other->m_height = height;
+    other->m_rowWords = words;
+    other->m_bitmap = bitmap;
+
+    changed(0, 0, changed_width, changed_height);
+    other->changed(0, 0, changed_width, changed_height);
 }
 
 
@@ -84,6 +266,46 @@ int NeoCharacter::height() const
 }
 
 
+/** Obtain the generation of a character. This is incremented by every change to the size or pixels of the
+ *  character, so a cache can tell if the character has changed since it was last examined.
+ *
+ *  @return         The generation count.
+ */
+uint32_t NeoCharacter::generation() const
+{
+    return m_generation;
+}
+
+
+/** Obtain a 64 bit hash of the size and pixels of a character. Characters that look the same have the
+ *  same hash, and characters that differ are very unlikely to. The hash is kept up to date as single pixels
+ *  are changed, so that reading it after each edit takes constant time. After any other change it is
+ *  recalculated when next read, in time proportional to the number of set pixels.
+ *
+ *  @return         The hash.
+ */
+uint64_t NeoCharacter::hash() const
+{
+    if (m_hashGeneration != m_generation)
+    {
+        uint64_t h = 0;
+        for (int y = 0; y < m_height; y++)
+        {
+            for (int k = 0; k < m_rowWords; k++)
+            {
+                for (uint64_t word = m_bitmap[XY_TO_WORD(k * 64, y)]; 0 != word; word &= word - 1)
+                {
+                    h ^= pixelKey((k * 64) + __builtin_ctzll(word), y);
+                }
+            }
+        }
+        m_pixelHash = h;
+        m_hashGeneration = m_generation;
+    }
+    return mixBits(m_pixelHash ^ mixBits(kHashSizeTag | ((uint64_t)m_width << 8) | (uint64_t)m_height));
+}
+
+
 /** Set the width of a character.
  *
  *  @param  w       The new width, in pixels.
@@ -93,7 +315,7 @@ int NeoCharacter::setWidth(int w)
 {
     if (w > kNeoCharacterMaxWidth) w = kNeoCharacterMaxWidth;
     if (w < kNeoCharacterMinWidth) w = kNeoCharacterMinWidth;
-    m_width = w;
+    resize(w, m_height);
     return m_width;
 }
 
@@ -107,18 +329,7 @@ int NeoCharacter::setHeight(int h)
 {
     if (h > kNeoCharacterMaxHeight) h = kNeoCharacterMaxHeight;
     if (h < kNeoCharacterMinHeight) h = kNeoCharacterMinHeight;
-    if (h > m_height)
-    {
-        for (int y = m_height; y < h; y++)
-        {
-            for (int x = 0; x < m_width; x++)
-            {   
-                // Clear newly expanded rows
-                m_bitmap[XY_TO_BYTE(x,y)] &= ~(1u << XY_TO_BIT(x,y));
-            }
-        }
-    }
-    m_height = h;
+    resize(m_width, h);
     return m_height;
 }
 
@@ -127,10 +338,8 @@ int NeoCharacter::setHeight(int h)
  */
 void NeoCharacter::clear()
 {
-    for (unsigned int i = 0; i < sizeof m_bitmap; i++)
-    {
-        m_bitmap[i] = 0;
-    }
+    memset(m_bitmap, 0, m_height * m_rowWords * sizeof m_bitmap[0]);
+    changed(0, 0, m_width, m_height);
 }
 
 
@@ -143,7 +352,7 @@ void NeoCharacter::clear()
 int NeoCharacter::getPixel(int x, int y) const
 {
     if (x < 0 || x >= m_width || y < 0 || y >= m_height) return 0;
-    else return (m_bitmap[XY_TO_BYTE(x,y)] >> XY_TO_BIT(x,y)) & 1;
+    else return (0 != (m_bitmap[XY_TO_WORD(x,y)] & X_TO_BIT(x))) ? 1 : 0;
 }
 
 
@@ -156,7 +365,13 @@ void NeoCharacter::setPixel(int x, int y)
 {
     if (x >= 0 && x < m_width && y >= 0 && y < m_height)
     {
-        m_bitmap[XY_TO_BYTE(x,y)] |= (1u << XY_TO_BIT(x,y));
+        uint64_t *word = &m_bitmap[XY_TO_WORD(x,y)];
+        if (0 == (*word & X_TO_BIT(x)))
+        {
+            *word |= X_TO_BIT(x);
+            togglePixelHash(x, y);
+            changed(x, y, x + 1, y + 1);
+        }
     }
 }
  
@@ -170,7 +385,13 @@ void NeoCharacter::clearPixel(int x, int y)
 {
     if (x >= 0 && x < m_width && y >= 0 && y < m_height)
     {
-        m_bitmap[XY_TO_BYTE(x,y)] &= ~(1u << XY_TO_BIT(x,y));
+        uint64_t *word = &m_bitmap[XY_TO_WORD(x,y)];
+        if (0 != (*word & X_TO_BIT(x)))
+        {
+            *word &= ~X_TO_BIT(x);
+            togglePixelHash(x, y);
+            changed(x, y, x + 1, y + 1);
+        }
     }
 }
 
@@ -185,7 +406,9 @@ void NeoCharacter::flipPixel(int x, int y)
 {
     if (x >= 0 && x < m_width && y >= 0 && y < m_height)
     {
-        m_bitmap[XY_TO_BYTE(x,y)] = m_bitmap[XY_TO_BYTE(x,y)] ^ (1u << XY_TO_BIT(x,y));
+        m_bitmap[XY_TO_WORD(x,y)] ^= X_TO_BIT(x);
+        togglePixelHash(x, y);
+        changed(x, y, x + 1, y + 1);
     }
 }
 
@@ -218,7 +441,48 @@ void NeoCharacter::changePixel(int x, int y, int v)
 
 
 
-/** Translate the character.
+/** Obtain the number of 64 bit words used for each row of the bitmap.
+ *
+ *  @return         The number of words per row. This is (width() + 63) / 64.
+ */
+int NeoCharacter::rowWords() const
+{
+    return m_rowWords;
+}
+
+
+/** Obtain read access to a row of the bitmap. Pixel x is held in bit (x % 64) of word (x / 64), and
+ *  bits beyond the character width are always clear.
+ *
+ *  @param  y       Vertical coordinate, in the range 0 to height() - 1.
+ *  @return         A pointer to rowWords() words of pixel data, or zero if y is out of range.
+ */
+const uint64_t *NeoCharacter::row(int y) const
+{
+    if (y < 0 || y >= m_height) return 0;
+    else return &m_bitmap[y * m_rowWords];
+}
+
+
+/** Replace a row of the bitmap. Bits beyond the character width are ignored.
+ *
+ *  @param  y       Vertical coordinate, in the range 0 to height() - 1.
+ *  @param  bits    The new row data, in the same form as returned by row(). This must contain rowWords() words.
+ */
+void NeoCharacter::setRow(int y, const uint64_t *bits)
+{
+    if (y >= 0 && y < m_height)
+    {
+        uint64_t *r = &m_bitmap[y * m_rowWords];
+        for (int k = 0; k < m_rowWords; k++) r[k] = bits[k];
+        r[m_rowWords - 1] &= tailMask(m_width);
+        changed(0, y, m_width, y + 1);
+    }
+}
+
+
+
+/** Translate the character. Pixels that move off one edge reappear on the opposite edge.
  *
  *  @param  dx      The x-displacement (positive => right, negative => left).
  *  @param  dy      The y-displacement (positive => down, negative => up).
@@ -227,16 +491,32 @@ void NeoCharacter::transformTranslate(int dx, int dy)
 {
     if (dx < 0) dx = m_width - ((-dx) % m_width);
     if (dy < 0) dy = m_height - ((-dy) % m_height);
+    dx = dx % m_width;
+    dy = dy % m_height;
+
+    uint64_t temp[kNeoCharacterMaxHeight * kNeoCharacterRowWords];
+    memcpy(temp, m_bitmap, m_height * m_rowWords * sizeof m_bitmap[0]);
 
-    NeoCharacter temp(*this);
-    clear();
-    for (int x = 0; x < m_width; x++)
+    uint64_t mask = tailMask(m_width);
+    for (int y = 0; y < m_height; y++)
     {
-        for (int y = 0; y < m_height; y++)
+        const uint64_t *src = &temp[y * m_rowWords];
+        uint64_t *dst = &m_bitmap[((y + dy) % m_height) * m_rowWords];
+        if (0 == dx)
+        {
+            for (int k = 0; k < m_rowWords; k++) dst[k] = src[k];
+        }
+        else
         {
-            if (temp.getPixel(x,y)) setPixel((x+dx) % m_width, (y+dy) % m_height);
+            // Rotate within the character width: the low bits move up by dx, the high bits wrap round
+            uint64_t wrapped[kNeoCharacterRowWords];
+            rowShiftUp(dst, src, m_rowWords, dx);
+            rowShiftDown(wrapped, src, m_rowWords, m_width - dx);
+            for (int k = 0; k < m_rowWords; k++) dst[k] |= wrapped[k];
+            dst[m_rowWords - 1] &= mask;
         }
     }
+    changed(0, 0, m_width, m_height);
 }
 
 
@@ -244,15 +524,18 @@ void NeoCharacter::transformTranslate(int dx, int dy)
  */
 void NeoCharacter::transformFlipV()
 {
-    NeoCharacter temp(*this);
-    clear();    
-    for (int x = 0; x < m_width; x++)
+    for (int y0 = 0, y1 = m_height - 1; y0 < y1; y0++, y1--)
     {
-        for (int y = 0; y < m_height; y++)
+        uint64_t *r0 = &m_bitmap[y0 * m_rowWords];
+        uint64_t *r1 = &m_bitmap[y1 * m_rowWords];
+        for (int k = 0; k < m_rowWords; k++)
         {
-            if (temp.getPixel(x,y)) setPixel(x, m_height - y - 1);
+            uint64_t t = r0[k];
+            r0[k] = r1[k];
+            r1[k] = t;
         }
     }
+    changed(0, 0, m_width, m_height);
 }
 
 
@@ -260,35 +543,50 @@ void NeoCharacter::transformFlipV()
  */
 void NeoCharacter::transformFlipH()
 {
-    NeoCharacter temp(*this);
-    clear();    
-    for (int x = 0; x < m_width; x++)
+    int unused = (m_rowWords * 64) - m_width;
+    for (int y = 0; y < m_height; y++)
     {
-        for (int y = 0; y < m_height; y++)
-        {
-            if (temp.getPixel(x,y)) setPixel(m_width - x - 1, y);
-        }
+        // Reverse the whole row, then shift the result back down so that it starts at x = 0
+        uint64_t *r = &m_bitmap[y * m_rowWords];
+        uint64_t reversed[kNeoCharacterRowWords];
+        for (int k = 0; k < m_rowWords; k++) reversed[k] = reverseBits(r[m_rowWords - 1 - k]);
+        rowShiftDown(r, reversed, m_rowWords, unused);
     }
+    changed(0, 0, m_width, m_height);
 }
 
 
-/** Make the character bolder by smearing pixels to the right. The character width is also increased.
+/** Make the character bolder by smearing pixels to the right. The character is first widened by one pixel
+ *  (up to kNeoCharacterMaxWidth), so that the smeared right-hand column has somewhere to go. This is the
+ *  only definition of bold: the editor, NeoGlyphBatch and kNeoTransformBold all use it.
  */
 void NeoCharacter::transformBold()
 {
     setWidth(m_width + 1);
+
+    uint64_t mask = tailMask(m_width);
+    uint64_t edge = X_TO_BIT(m_width - 1);
     for (int y = 0; y < m_height; y++)
     {
-        clearPixel(m_width - 1, y);
-    }
-    
-    for (int x = m_width - 2; x >= 0; x--)
-    {
-        for (int y = 0; y < m_height; y++)
-        {
-            if (getPixel(x,y)) setPixel(x+1, y);
-        }
+        uint64_t *r = &m_bitmap[y * m_rowWords];
+        r[m_rowWords - 1] &= ~edge;                     // The right-hand column is cleared before smearing
+
+        uint64_t smeared[kNeoCharacterRowWords];
+        rowShiftUp(smeared, r, m_rowWords, 1);
+        for (int k = 0; k < m_rowWords; k++) r[k] |= smeared[k];
+        r[m_rowWords - 1] &= mask;
     }
+    changed(0, 0, m_width, m_height);
+}
+
+
+/** Return the amount of memory used by the character, including its bitmap storage.
+ *
+ *  @return     The number of bytes used.
+ */
+unsigned int NeoCharacter::storageSize() const
+{
+    return sizeof *this + (m_height * m_rowWords * sizeof m_bitmap[0]);
 }
 
 
@@ -298,26 +596,209 @@ void NeoCharacter::transformBold()
  */
 unsigned int NeoCharacter::archiveSize() const
 {
-    return sizeof *this;
+    NeoArchiveWriter writer(0);
+    writer.putMagic(kNeoArchiveMagicCharacter);
+    saveRecord(&writer);
+    return writer.length();
 }
 
 
 /** Save the character object to a byte array.
  *
- *  @return     A pointer to an array of bytes to receive the archive of at least archiveSize() bytes.
+ *  @param  data    A pointer to an array of bytes to receive the archive of at least archiveSize() bytes.
  */
 void NeoCharacter::saveArchive(uint8_t *data) const
 {
-    memcpy(data, (void*)this, sizeof *this);
+    NeoArchiveWriter writer(data);
+    writer.putMagic(kNeoArchiveMagicCharacter);
+    saveRecord(&writer);
+}
+
+
+/** Load the character object from a byte array. Archives in the original fixed layout are also accepted.
+ *
+ *  @param  data    The data to load.
+ *  @param  length  The number of bytes of data.
+ *  @return         Logical true if the archive was loaded, false if it is not valid. If the archive is not
+ *                  valid, the character may have been partly modified.
+ */
+bool NeoCharacter::loadArchive(const uint8_t *data, unsigned int length)
+{
+    NeoArchiveReader reader(data, length);
+    if (reader.getMagic(kNeoArchiveMagicCharacter)) return loadRecord(&reader);
+    if (length != sizeof (NeoCharacterArchive) || sizeof (NeoCharacterArchive) != kNeoCharacterLegacyArchiveSize) return false;
+
+    NeoCharacterArchive archive;
+    memcpy(&archive, data, sizeof archive);
+    setHeight(archive.height);
+    setWidth(archive.width);
+    for (int y = 0; y < m_height; y++)
+    {
+        uint64_t bits[kNeoCharacterRowWords] = { 0 };
+        for (int i = 0; i < m_rowWords * 8; i++)
+        {
+            bits[i / 8] |= ((uint64_t)archive.bitmap[(y * kArchiveRowBytes) + i]) << ((i & 7) * 8);
+        }
+        setRow(y, bits);
+    }
+    return true;
 }
 
 
-/** Load the character object from a byte array.
+/** Write the character as part of an archive. The record holds the width and height as varints and then
+ *  only the pixels within the character, with blank rows left out if that makes the record smaller.
  *
- *  @param  data    The data to load. This must contain archiveSize() bytes.
+ *  @param  writer  The archive writer.
  */
-void NeoCharacter::loadArchive(const uint8_t *data)
+void NeoCharacter::saveRecord(NeoArchiveWriter *writer) const
 {
-    memcpy((void*)this, data, sizeof *this);
+    uint64_t mask[(kNeoCharacterMaxHeight + 63) / 64] = { 0 };
+    int rows = 0;
+    for (int y = 0; y < m_height; y++)
+    {
+        for (int k = 0; k < m_rowWords; k++)
+        {
+            if (0 != m_bitmap[XY_TO_WORD(k * 64, y)])
+            {
+                mask[y / 64] |= ((uint64_t)1) << (y & 63);
+                rows++;
+                break;
+            }
+        }
+    }
+
+    unsigned int packedBytes = ((m_width * m_height) + 7) / 8;
+    unsigned int elidedBytes = ((m_height + 7) / 8) + (((m_width * rows) + 7) / 8);
+    bool elide = elidedBytes < packedBytes;
+
+    writer->putByte(elide ? kRecordElided : kRecordPacked);
+    writer->putVarint(m_width);
+    writer->putVarint(m_height);
+    if (elide)
+    {
+        for (int y = 0; y < m_height; y += 8) writer->putByte((unsigned int)(mask[y / 64] >> (y & 63)));
+    }
+    for (int y = 0; y < m_height; y++)
+    {
+        if (!elide || 0 != (mask[y / 64] & (((uint64_t)1) << (y & 63)))) writer->putRow(&m_bitmap[XY_TO_WORD(0, y)], m_width);
+    }
+    writer->flushBits();
 }
 
+
+/** Read a character written by saveRecord(). The pixels are read directly in to the bitmap a row at a time.
+ *
+ *  @param  reader  The archive reader.
+ *  @return         Logical true if the record was read, false if it is not valid.
+ */
+bool NeoCharacter::loadRecord(NeoArchiveReader *reader)
+{
+    unsigned int encoding = reader->getByte();
+    uint32_t w = reader->getVarint();
+    uint32_t h = reader->getVarint();
+    if (!reader->isValid() || (kRecordPacked != encoding && kRecordElided != encoding) ||
+        w < kNeoCharacterMinWidth || w > kNeoCharacterMaxWidth || h < kNeoCharacterMinHeight || h > kNeoCharacterMaxHeight)
+    {
+        return false;
+    }
+
+    uint64_t mask[(kNeoCharacterMaxHeight + 63) / 64];
+    memset(mask, (kRecordPacked == encoding) ? 0xff : 0, sizeof mask);
+    if (kRecordElided == encoding)
+    {
+        for (unsigned int y = 0; y < h; y += 8) mask[y / 64] |= ((uint64_t)reader->getByte()) << (y & 63);
+    }
+
+    resize(w, h);
+    for (int y = 0; y < m_height; y++)
+    {
+        uint64_t *row = &m_bitmap[XY_TO_WORD(0, y)];
+        if (0 != (mask[y / 64] & (((uint64_t)1) << (y & 63)))) reader->getRow(row, m_width);
+        else memset(row, 0, m_rowWords * sizeof row[0]);
+    }
+    reader->alignBits();
+    changed(0, 0, m_width, m_height);
+    return reader->isValid();
+}
+
+
+/** Resize the bitmap storage. Pixels that remain within the new bounds are preserved and any newly exposed
+ *  pixels are cleared. The bitmap is only reallocated if the number of words it needs changes.
+ *
+ *  @param  w       The new width, in pixels.
+ *  @param  h       The new height, in pixels.
+ */
+void NeoCharacter::resize(int w, int h)
+{
+    if (w == m_width && h == m_height) return;
+
+    int changed_width = (w > m_width) ? w : m_width;
+    int changed_height = (h > m_height) ? h : m_height;
+    int words = (w + 63) / 64;
+    if (words != m_rowWords || h != m_height)
+    {
+        uint64_t *bitmap = new uint64_t[words * h]();
+        int rows = (h < m_height) ? h : m_height;
+        int columns = (words < m_rowWords) ? words : m_rowWords;
+        for (int y = 0; y < rows; y++)
+        {
+            for (int k = 0; k < columns; k++) bitmap[(y * words) + k] = m_bitmap[(y * m_rowWords) + k];
+        }
+        delete[] m_bitmap;
+        m_bitmap = bitmap;
+        m_rowWords = words;
+        m_height = h;
+    }
+    if (w < m_width)
+    {
+        // Clear the pixels that are no longer part of the character
+        for (int y = 0; y < m_height; y++) m_bitmap[(y * m_rowWords) + m_rowWords - 1] &= tailMask(w);
+    }
+    setWidthValue(w);
+    changed(0, 0, changed_width, changed_height);
+}
+
+
+/** Change the recorded width, informing the owning font so that it can update its metrics.
+ *
+ *  @param  w       The new width, in pixels.
+ */
+void NeoCharacter::setWidthValue(int w)
+{
+    if (0 != m_font && w != m_width) m_font->characterWidthChanged(m_width, w);
+    m_width = w;
+}
+
+
+/** Update the pixel hash for a pixel that has just been set or cleared. The hash is left alone if it is
+ *  already out of date. This must be called before changed(), which advances the generation.
+ *
+ *  @param  x       Pixel x-coordinate.
+ *  @param  y       Pixel y-coordinate.
+ */
+void NeoCharacter::togglePixelHash(int x, int y)
+{
+    if (m_hashGeneration == m_generation)
+    {
+        m_pixelHash ^= pixelKey(x, y);
+        m_hashGeneration++;
+    }
+}
+
+
+/** Record a change to the size or pixels of the character, and inform the owning font (if any).
+ *
+ *  @param  x0      Left-hand edge of the changed pixels.
+ *  @param  y0      Upper edge of the changed pixels.
+ *  @param  x1      Right-hand edge of the changed pixels (exclusive).
+ *  @param  y1      Lower edge of the changed pixels (exclusive).
+ */
+void NeoCharacter::changed(int x0, int y0, int x1, int y1)
+{
+    m_generation++;
+    if (0 != m_font)
+    {
+        NeoCharacterRect r = { x0, y0, x1, y1 };
+        m_font->characterChanged(this, r);
+    }
+}
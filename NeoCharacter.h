@@ -5,6 +5,9 @@
 #ifndef _NEOCHARACTER_H_
 #define _NEOCHARACTER_H_    (1)
 
+#include <stdint.h>
+#include "NeoArchive.h"
+
 /* Limits.
  */
 #define kNeoCharacterMaxWidth       (128)       /**< Maximum width of a single character, in pixels. */
@@ -12,6 +15,29 @@
 #define kNeoCharacterMinHeight      (1)         /**< Minimum font height, in pixels. */
 #define kNeoCharacterMaxHeight      (66)        /**< Maximum font height, in pixels. */
 
+#define kNeoCharacterRowWords       ((kNeoCharacterMaxWidth + 63) / 64)     /**< Maximum number of 64 bit words in a bitmap row. */
+#define kNeoCharacterLegacyArchiveSize  (1064)  /**< Size of a character archive in the original fixed layout, in bytes. */
+
+
+/* Hashing. Glyph hashes (see NeoCharacter::hash()) are combined, in order, in to a single hash by starting
+ * from kNeoHashSeed and, for each glyph, xoring in its hash and multiplying by kNeoHashMultiplier.
+ */
+#define kNeoHashSeed                (0x84222325cbf29ce4ull)     /**< Initial value of a combined hash. */
+#define kNeoHashMultiplier          (0x9e3779b97f4a7c15ull)     /**< Odd multiplier (2^64 / golden ratio) used to combine hashes. */
+
+
+class NeoFont;
+
+
+/** Rectangle of character pixels, from (x0, y0) up to but not including (x1, y1).
+ */
+struct NeoCharacterRect
+{
+    int x0;                         /**< Left-hand edge. */
+    int y0;                         /**< Upper edge. */
+    int x1;                         /**< Right-hand edge, exclusive. */
+    int y1;                         /**< Lower edge, exclusive. */
+};
 
 
 /** Class used to code a single character.
@@ -24,8 +50,13 @@ public:
     NeoCharacter(const NeoCharacter &other);
     ~NeoCharacter();
 
+    NeoCharacter &operator=(const NeoCharacter &other);
+    void swap(NeoCharacter *other);
+
     int width() const;
     int height() const;
+    uint32_t generation() const;
+    uint64_t hash() const;
 
     int setWidth(int w);    
     int setHeight(int h);
@@ -38,27 +69,52 @@ public:
     void flipPixel(int x, int y);
     void changePixel(int x, int y, int v);
 
+    int rowWords() const;
+    const uint64_t *row(int y) const;
+    void setRow(int y, const uint64_t *bits);
+
     void transformTranslate(int dx, int dy);
     void transformFlipV();
     void transformFlipH();
     void transformBold();
 
+    unsigned int storageSize() const;
+
     unsigned int archiveSize() const;
-    void loadArchive(const uint8_t *data);
+    bool loadArchive(const uint8_t *data, unsigned int length);
     void saveArchive(uint8_t *data) const;
 
+    void saveRecord(NeoArchiveWriter *writer) const;
+    bool loadRecord(NeoArchiveReader *reader);
+
 private:
 
-    /* Do not use pointer member variables here. The loadArchive() and saveArchive() methods both
-     * in this class and in NeoFont have a trivial implementation that will need to be significantly
-     * more complex if pointers are used.
-     */
     int m_width;                    /**< Character width, in pixels. */
     int m_height;                   /**< Character height, in pixels. */
-    
-    /** Bitmap of character data. This is treated as an array of pixels, one bit per pixel.
+    int m_rowWords;                 /**< Number of 64 bit words used for each bitmap row. */
+
+    /** Bitmap of character data, sized to the current width and height. Each row occupies m_rowWords
+     *  words, with pixel x held in bit (x % 64) of word (x / 64). Bits beyond the character width are
+     *  always kept clear.
      */
-    uint8_t m_bitmap[((kNeoCharacterMaxWidth * kNeoCharacterMaxHeight) + 7) / 8];
+    uint64_t *m_bitmap;
+
+    NeoFont *m_font;                /**< The font that owns the character, or zero. Informed of all changes. */
+    uint32_t m_generation;          /**< Count of changes made to the character. */
+
+    /** Hash of the set pixels (the exclusive-or of a key for each one), valid if m_hashGeneration equals
+     *  m_generation. Single pixel changes update it in place. Other changes leave it to be recalculated by
+     *  the next call to hash().
+     */
+    mutable uint64_t m_pixelHash;
+    mutable uint32_t m_hashGeneration;
+
+    void resize(int w, int h);
+    void togglePixelHash(int x, int y);
+    void setWidthValue(int w);
+    void changed(int x0, int y0, int x1, int y1);
+
+    friend class NeoFont;
 };
 
 
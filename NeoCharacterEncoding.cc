@@ -3,20 +3,21 @@
  *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
  */
 #include <stdint.h>
-#import "NeoCharacterEncoding.h"
+#include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "NeoCharacterEncoding.h"
+#include "NeoArchive.h"
 
 
-/** Static lookup table used to map 8 bit Neo character codes to UTF16.
+/** Static lookup table used to map 8 bit Neo character codes to UTF16. Codes 0-31 are the Neo symbol
+ *  glyphs (kNeoEncodingNeo).
  */
-static const uint16_t neoToUnicode[256] =
+static constexpr uint16_t neoToUnicode[256] =
 {
-#if 1   // translations of the Neo font characters 0-31
     0x25a0, 0x03b4, 0x0394, 0x222b, 0x0143, 0x0133, 0x274f, 0x2154, 0x02d9, 0x21e5, 0x2193, 0x2191, 0x2913, 0x21b5, 0x2908, 0x2909,
     0x2192, 0x2153, 0x039e, 0x03b1, 0x03c1, 0x2195, 0x21b5, 0x25a1, 0x221a, 0x2264, 0x2265, 0x03b8, 0x221e, 0x03a9, 0x03b2, 0x03a3,
-#else   // standard control codes, with exception of 0x0000 (solid block)
-    0x25a0, 0x0001, 0x0002, 0x0003, 0x0004, 0x0005, 0x0006, 0x0007, 0x0008, 0x0009, 0x000a, 0x000b, 0x000c, 0x000d, 0x000e, 0x000f,
-    0x0010, 0x0011, 0x0012, 0x0013, 0x0014, 0x0015, 0x0016, 0x0017, 0x0018, 0x0019, 0x001a, 0x001b, 0x001c, 0x001d, 0x001e, 0x001f,
-#endif
     0x0020, 0x0021, 0x0022, 0x0023, 0x0024, 0x0025, 0x0026, 0x0027, 0x0028, 0x0029, 0x002a, 0x002b, 0x002c, 0x002d, 0x002e, 0x002f,
     0x0030, 0x0031, 0x0032, 0x0033, 0x0034, 0x0035, 0x0036, 0x0037, 0x0038, 0x0039, 0x003a, 0x003b, 0x003c, 0x003d, 0x003e, 0x003f,
     0x0040, 0x0041, 0x0042, 0x0043, 0x0044, 0x0045, 0x0046, 0x0047, 0x0048, 0x0049, 0x004a, 0x004b, 0x004c, 0x004d, 0x004e, 0x004f,
@@ -34,6 +35,142 @@ static const uint16_t neoToUnicode[256] =
 };
 
 
+/** Codes 0-31 of kNeoEncodingControls: the standard control codes, with the exception of 0x0000 (solid
+ *  block). The other codes are as in neoToUnicode.
+ */
+static constexpr uint16_t controlsToUnicode[32] =
+{
+    0x25a0, 0x0001, 0x0002, 0x0003, 0x0004, 0x0005, 0x0006, 0x0007, 0x0008, 0x0009, 0x000a, 0x000b, 0x000c, 0x000d, 0x000e, 0x000f,
+    0x0010, 0x0011, 0x0012, 0x0013, 0x0014, 0x0015, 0x0016, 0x0017, 0x0018, 0x0019, 0x001a, 0x001b, 0x001c, 0x001d, 0x001e, 0x001f
+};
+
+
+/** Names of the built-in encodings.
+ */
+static const char *const builtInNames[kNeoEncodingBuiltInCount] = { "neo", "controls" };
+
+
+static const NeoEncoding *defaultEncodingPointer = 0;   /**< The default encoding, or zero for kNeoEncodingNeo. */
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      Private Functions.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Create a built-in encoding.
+ *
+ *  @param  n       The encoding (kNeoEncodingNeo etc).
+ *  @return         The encoding.
+ */
+static const NeoEncoding *createBuiltIn(int n)
+{
+    uint16_t unicode[256];
+    memcpy(unicode, neoToUnicode, sizeof unicode);
+    if (kNeoEncodingControls == n) memcpy(unicode, controlsToUnicode, sizeof controlsToUnicode);
+    return new NeoEncoding(unicode, builtInNames[n]);
+}
+
+
+/** Parse a number in a text encoding table: hexadecimal with a "0x" or "U+" prefix, or decimal.
+ *
+ *  @param  p       The text. Updated to point past the number.
+ *  @param  end     The end of the text.
+ *  @param  value   Receives the number.
+ *  @return         Logical true if a number was found.
+ */
+static bool parseNumber(const char **p, const char *end, uint32_t *value)
+{
+    const char *s = *p;
+    unsigned int base = 10;
+    if (end - s > 2 && '0' == s[0] && ('x' == s[1] || 'X' == s[1])) base = 16, s += 2;
+    else if (end - s > 2 && ('U' == s[0] || 'u' == s[0]) && '+' == s[1]) base = 16, s += 2;
+
+    uint32_t v = 0;
+    const char *first = s;
+    for (; s != end; s++)
+    {
+        unsigned int digit;
+        if (*s >= '0' && *s <= '9') digit = *s - '0';
+        else if (*s >= 'a' && *s <= 'f') digit = *s - 'a' + 10;
+        else if (*s >= 'A' && *s <= 'F') digit = *s - 'A' + 10;
+        else break;
+        if (digit >= base || v > 0x10ffff) return false;
+        v = (v * base) + digit;
+    }
+    if (s == first) return false;
+    *p = s;
+    *value = v;
+    return true;
+}
+
+
+/** Skip spaces and tabs.
+ */
+static const char *skipSpace(const char *p, const char *end)
+{
+    while (p != end && (' ' == *p || '\t' == *p)) p++;
+    return p;
+}
+
+
+/** Copy the leading run of characters that are the same in UTF-8 and in the Neo encoding: the printable
+ *  ASCII characters and, optionally, the control characters. Sixteen bytes are tested at a time where
+ *  SSE2 is available, and eight at a time otherwise.
+ *
+ *  @param  in          The UTF-8 text.
+ *  @param  length      The number of bytes of text.
+ *  @param  out         Receives the copied characters.
+ *  @param  controls    Logical true if control characters are copied.
+ *  @return             The number of bytes copied.
+ */
+static unsigned int copyASCII(const uint8_t *in, unsigned int length, uint8_t *out, bool controls)
+{
+    unsigned int n = 0;
+#if defined(__SSE2__)
+    const __m128i lowest = _mm_set1_epi8(controls ? 0x00 : 0x20);
+    const __m128i highest = _mm_set1_epi8(0x7e);
+    while (n + 16 <= length)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)&in[n]);
+        __m128i bad = _mm_or_si128(_mm_cmplt_epi8(v, lowest), _mm_cmpgt_epi8(v, highest));  // Bytes >= 0x80 are negative
+        if (0 != _mm_movemask_epi8(bad)) break;
+        _mm_storeu_si128((__m128i *)&out[n], v);
+        n += 16;
+    }
+#endif
+    const uint64_t ones = 0x0101010101010101ull;
+    const uint64_t highs = 0x8080808080808080ull;
+    while (n + 8 <= length)
+    {
+        uint64_t w;
+        memcpy(&w, &in[n], sizeof w);
+        uint64_t bad = (w + ones) | w;                  // Top bit set in bytes >= 0x7f
+        if (!controls) bad |= (w - (ones * 0x20)) & ~w; // Top bit set in bytes < 0x20 (if no byte is >= 0x80)
+        if (0 != (bad & highs)) break;
+        memcpy(&out[n], &w, sizeof w);
+        n += 8;
+    }
+    while (n < length && in[n] < 0x7f && (controls || in[n] >= 0x20))
+    {
+        out[n] = in[n];
+        n++;
+    }
+    return n;
+}
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      Public Functions.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
 /** Return the UTF16 equivalent to a given Neo character code.
  *
  *  @param  neoCode         The Neo character code.
@@ -41,6 +178,498 @@ static const uint16_t neoToUnicode[256] =
  */
 uint16_t NeoCharacterToUTF16(int neoCharacter)
 {
-    return (neoCharacter >= 0 && neoCharacter <= 255) ? neoToUnicode[neoCharacter] : neoToUnicode[0];
+    return NeoEncoding::defaultEncoding()->toUnicode(neoCharacter);
+}
+
+
+/** Return the Neo character code that shows a given Unicode character in the default encoding.
+ *
+ *  @param  unicode         The Unicode character (UTF-32, or a UTF-16 code unit).
+ *  @return                 The Neo character code, or kNeoCharacterNotMapped if no Neo character shows it.
+ */
+int NeoCharacterFromUnicode(uint32_t unicode)
+{
+    return NeoEncoding::defaultEncoding()->fromUnicode(unicode);
 }
 
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      NeoEncoding class definition.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Class constructor. The reverse index is built here. Where two Neo codes show the same character, the
+ *  index gives the code equal to the character if there is one, and otherwise the lower code.
+ *
+ *  @param  unicode     The character shown by each of the 256 Neo codes.
+ *  @param  name        The name of the encoding. Longer names are truncated.
+ */
+NeoEncoding::NeoEncoding(const uint16_t *unicode, const char *name)
+    :
+        m_codes(0),
+        m_ascii(true)
+{
+    strncpy(m_name, name, sizeof m_name - 1);
+    m_name[sizeof m_name - 1] = 0;
+    memcpy(m_unicode, unicode, sizeof m_unicode);
+
+    // The Basic Multilingual Plane is split in to 256 character pages. Each page holding a mapped character
+    // has a table of Neo codes, and every other page shares table zero, which maps nothing.
+    int used = 1;
+    memset(m_pages, 0, sizeof m_pages);
+    for (int code = 0; code < 256; code++)
+    {
+        unsigned int page = m_unicode[code] >> 8;
+        if (0 == m_pages[page]) m_pages[page] = used++;
+        if (code >= 0x20 && code <= 0x7e && m_unicode[code] != code) m_ascii = false;
+    }
+    m_codes = new int16_t[used][256];
+    for (int t = 0; t < used; t++)
+    {
+        for (int i = 0; i < 256; i++) m_codes[t][i] = kNeoCharacterNotMapped;
+    }
+    for (int code = 0; code < 256; code++)
+    {
+        unsigned int u = m_unicode[code];
+        int16_t *entry = &m_codes[m_pages[u >> 8]][u & 255];
+        if (kNeoCharacterNotMapped == *entry || u == (unsigned int)code) *entry = code;
+    }
+}
+
+
+/** Destructor.
+ */
+NeoEncoding::~NeoEncoding()
+{
+    delete [] m_codes;
+}
+
+
+/** Load an encoding from a binary table written by saveArchive(), or from a text table. A text table lists
+ *  one mapping per line as a Neo code and a Unicode character, each in hexadecimal ("0x41" or "U+0041") or
+ *  decimal. Text from a "#" to the end of a line is ignored, and a line "name <name>" names the encoding.
+ *  Codes that are not listed keep their kNeoEncodingNeo mapping.
+ *
+ *  @param  data        The table.
+ *  @param  length      The number of bytes of data.
+ *  @return             The new encoding, to be deleted by the caller, or zero if the table is not valid.
+ */
+NeoEncoding *NeoEncoding::load(const uint8_t *data, unsigned int length)
+{
+    if (0 == data) return 0;
+    if (length < kNeoArchiveMagicLength || 0 != memcmp(data, kNeoArchiveMagicEncoding, kNeoArchiveMagicLength))
+    {
+        return loadText((const char *)data, length);
+    }
+
+    NeoArchiveReader reader(data, length);
+    char name[kNeoEncodingNameSize];
+    uint16_t unicode[256];
+    memcpy(unicode, neoToUnicode, sizeof unicode);
+    reader.getMagic(kNeoArchiveMagicEncoding);
+    reader.getString(name, sizeof name);
+    uint32_t count = reader.getVarint();
+    if (count > 256) return 0;
+    for (uint32_t i = 0; i < count && reader.isValid(); i++)
+    {
+        unsigned int code = reader.getByte();
+        uint32_t u = reader.getVarint();
+        if (u > 0xffff) return 0;
+        unicode[code] = (uint16_t)u;
+    }
+    if (!reader.isValid() || 0 != reader.remaining()) return 0;
+    return new NeoEncoding(unicode, name);
+}
+
+
+/** Return a built-in encoding. The built-in encodings are created on first use and are never deleted.
+ *
+ *  @param  n           The encoding (kNeoEncodingNeo etc).
+ *  @return             The encoding, or zero if n is out of range.
+ */
+const NeoEncoding *NeoEncoding::builtIn(int n)
+{
+    static const NeoEncoding *const encodings[kNeoEncodingBuiltInCount] =
+    {
+        createBuiltIn(kNeoEncodingNeo),
+        createBuiltIn(kNeoEncodingControls)
+    };
+    return (n >= 0 && n < kNeoEncodingBuiltInCount) ? encodings[n] : 0;
+}
+
+
+/** Return the default encoding, used by NeoCharacterToUTF16(), NeoCharacterFromUnicode() and transcoders
+ *  created without an encoding. This is kNeoEncodingNeo unless setDefaultEncoding() has been called.
+ */
+const NeoEncoding *NeoEncoding::defaultEncoding()
+{
+    const NeoEncoding *encoding = __atomic_load_n(&defaultEncodingPointer, __ATOMIC_ACQUIRE);
+    return (0 != encoding) ? encoding : builtIn(kNeoEncodingNeo);
+}
+
+
+/** Set the default encoding. The encoding must not be deleted while it is the default, or while a
+ *  transcoder created without an encoding is still in use.
+ *
+ *  @param  encoding    The encoding, or zero for kNeoEncodingNeo.
+ */
+void NeoEncoding::setDefaultEncoding(const NeoEncoding *encoding)
+{
+    __atomic_store_n(&defaultEncodingPointer, encoding, __ATOMIC_RELEASE);
+}
+
+
+/** Return the name of the encoding.
+ */
+const char *NeoEncoding::name() const
+{
+    return m_name;
+}
+
+
+/** Return the Unicode character shown by a Neo character code.
+ *
+ *  @param  neoCharacter    The Neo character code.
+ *  @return                 The corresponding UTF16 code, in native endian form. Codes out of range give the
+ *                          character for code zero.
+ */
+uint16_t NeoEncoding::toUnicode(int neoCharacter) const
+{
+    return (neoCharacter >= 0 && neoCharacter <= 255) ? m_unicode[neoCharacter] : m_unicode[0];
+}
+
+
+/** Return the Neo character code that shows a given Unicode character.
+ *
+ *  @param  unicode         The Unicode character (UTF-32, or a UTF-16 code unit).
+ *  @return                 The Neo character code, or kNeoCharacterNotMapped if no Neo character shows it.
+ */
+int NeoEncoding::fromUnicode(uint32_t unicode) const
+{
+    if (unicode > 0xffff) return kNeoCharacterNotMapped;
+    return m_codes[m_pages[unicode >> 8]][unicode & 255];
+}
+
+
+/** Return logical true if each printable ASCII character is shown by the Neo code of the same value.
+ */
+bool NeoEncoding::isASCII() const
+{
+    return m_ascii;
+}
+
+
+/** Return the number of bytes needed by saveArchive().
+ */
+unsigned int NeoEncoding::archiveSize() const
+{
+    NeoArchiveWriter writer(0);
+    saveArchive(&writer);
+    return writer.length();
+}
+
+
+/** Save the encoding as a binary table. Only the codes that differ from kNeoEncodingNeo are stored.
+ *
+ *  @param  data        Receives the table (archiveSize() bytes).
+ */
+void NeoEncoding::saveArchive(uint8_t *data) const
+{
+    NeoArchiveWriter writer(data);
+    saveArchive(&writer);
+}
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      NeoEncoding private methods.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Write the encoding as a binary table.
+ *
+ *  @param  writer      The writer.
+ */
+void NeoEncoding::saveArchive(NeoArchiveWriter *writer) const
+{
+    unsigned int count = 0;
+    for (int code = 0; code < 256; code++)
+    {
+        if (m_unicode[code] != neoToUnicode[code]) count++;
+    }
+    writer->putMagic(kNeoArchiveMagicEncoding);
+    writer->putString(m_name);
+    writer->putVarint(count);
+    for (int code = 0; code < 256; code++)
+    {
+        if (m_unicode[code] == neoToUnicode[code]) continue;
+        writer->putByte(code);
+        writer->putVarint(m_unicode[code]);
+    }
+}
+
+
+/** Load an encoding from a text table (see load()).
+ *
+ *  @param  text        The table.
+ *  @param  length      The number of bytes of text.
+ *  @return             The new encoding, or zero if the table is not valid.
+ */
+NeoEncoding *NeoEncoding::loadText(const char *text, unsigned int length)
+{
+    char name[kNeoEncodingNameSize] = "custom";
+    uint16_t unicode[256];
+    memcpy(unicode, neoToUnicode, sizeof unicode);
+
+    const char *end = text + length;
+    const char *p = text;
+    while (p != end)
+    {
+        const char *eol = (const char *)memchr(p, '\n', end - p);
+        if (0 == eol) eol = end;
+        const char *comment = (const char *)memchr(p, '#', eol - p);
+        const char *last = (0 != comment) ? comment : eol;
+        while (last != p && (' ' == last[-1] || '\t' == last[-1] || '\r' == last[-1])) last--;
+
+        p = skipSpace(p, last);
+        if (p != last)
+        {
+            if (last - p > 4 && 0 == memcmp(p, "name", 4) && (' ' == p[4] || '\t' == p[4]))
+            {
+                p = skipSpace(p + 4, last);
+                unsigned int n = last - p;
+                if (n > sizeof name - 1) n = sizeof name - 1;
+                memcpy(name, p, n);
+                name[n] = 0;
+            }
+            else
+            {
+                uint32_t code;
+                uint32_t u;
+                if (!parseNumber(&p, last, &code) || code > 255) return 0;
+                if (p == last || (' ' != *p && '\t' != *p)) return 0;
+                p = skipSpace(p, last);
+                if (!parseNumber(&p, last, &u) || u > 0xffff || p != last) return 0;
+                unicode[code] = (uint16_t)u;
+            }
+        }
+        p = (eol == end) ? end : (eol + 1);
+    }
+    return new NeoEncoding(unicode, name);
+}
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      NeoUTF8Transcoder class definition.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Class constructor.
+ *
+ *  @param  fallback    The Neo character written in place of characters that cannot be converted.
+ *  @param  controls    Logical true to pass the control characters U+0000 to U+001F through unchanged, or
+ *                      false to convert them like any other character (normally to the fallback).
+ *  @param  encoding    The encoding, or zero for the default encoding at the time of the call.
+ */
+NeoUTF8Transcoder::NeoUTF8Transcoder(int fallback, bool controls, const NeoEncoding *encoding)
+    :
+        m_fallback((uint8_t)fallback),
+        m_controls(controls),
+        m_encoding((0 != encoding) ? encoding : NeoEncoding::defaultEncoding()),
+        m_code(0),
+        m_needed(0),
+        m_minimum(0),
+        m_fallbacks(0)
+{
+    // Nothing.
+}
+
+
+/** Destructor.
+ */
+NeoUTF8Transcoder::~NeoUTF8Transcoder()
+{
+    // Nothing.
+}
+
+
+/** Set the character written in place of characters that cannot be converted.
+ *
+ *  @param  neoCharacter    The Neo character code (0 to 255).
+ */
+void NeoUTF8Transcoder::setFallback(int neoCharacter)
+{
+    m_fallback = (uint8_t)neoCharacter;
+}
+
+
+/** Return the character written in place of characters that cannot be converted.
+ */
+int NeoUTF8Transcoder::fallback() const
+{
+    return m_fallback;
+}
+
+
+/** Set the encoding used for the characters that follow.
+ *
+ *  @param  encoding    The encoding, or zero for the default encoding at the time of the call.
+ */
+void NeoUTF8Transcoder::setEncoding(const NeoEncoding *encoding)
+{
+    m_encoding = (0 != encoding) ? encoding : NeoEncoding::defaultEncoding();
+}
+
+
+/** Return the encoding.
+ */
+const NeoEncoding *NeoUTF8Transcoder::encoding() const
+{
+    return m_encoding;
+}
+
+
+/** Convert a piece of UTF-8 text. A character that is incomplete at the end of the piece is held until the
+ *  next call.
+ *
+ *  @param  in      The text.
+ *  @param  length  The number of bytes of text.
+ *  @param  out     Receives the Neo characters. This must have space for length + kNeoTranscodeSlack bytes.
+ *  @return         The number of Neo characters written.
+ */
+unsigned int NeoUTF8Transcoder::transcode(const uint8_t *in, unsigned int length, uint8_t *out)
+{
+    uint8_t *start = out;
+    bool ascii = m_encoding->isASCII();
+    unsigned int i = 0;
+    while (i < length)
+    {
+        if (0 == m_needed)
+        {
+            if (ascii)
+            {
+                unsigned int n = copyASCII(&in[i], length - i, out, m_controls);
+                i += n;
+                out += n;
+                if (i == length) break;
+            }
+
+            uint8_t b = in[i++];
+            if (b < 0x80)
+            {
+                *out++ = lookup(b);                                             // Not copied by copyASCII()
+            }
+            else if (b >= 0xc2 && b <= 0xdf)
+            {
+                m_code = b & 0x1f;
+                m_needed = 1;
+                m_minimum = 0x80;
+            }
+            else if (b >= 0xe0 && b <= 0xef)
+            {
+                m_code = b & 0x0f;
+                m_needed = 2;
+                m_minimum = 0x800;
+            }
+            else if (b >= 0xf0 && b <= 0xf4)
+            {
+                m_code = b & 0x07;
+                m_needed = 3;
+                m_minimum = 0x10000;
+            }
+            else
+            {
+                *out++ = m_fallback;                                            // Not a lead byte
+                m_fallbacks++;
+            }
+        }
+        else if (0x80 != (in[i] & 0xc0))
+        {
+            *out++ = m_fallback;                                                // Truncated sequence
+            m_fallbacks++;
+            m_needed = 0;                                                       // The byte is then converted
+        }
+        else
+        {
+            m_code = (m_code << 6) | (in[i++] & 0x3f);
+            if (0 == --m_needed)
+            {
+                if (m_code < m_minimum || (m_code >= 0xd800 && m_code <= 0xdfff) || m_code > 0x10ffff)
+                {
+                    *out++ = m_fallback;                                        // Overlong, surrogate or out of range
+                    m_fallbacks++;
+                }
+                else
+                {
+                    *out++ = lookup(m_code);
+                }
+            }
+        }
+    }
+    return out - start;
+}
+
+
+/** Finish converting a text. A character left incomplete at the end of the text is replaced by the
+ *  fallback character. The transcoder is then ready for a new text.
+ *
+ *  @param  out     Receives the fallback character, if needed (kNeoTranscodeSlack bytes).
+ *  @return         The number of Neo characters written.
+ */
+unsigned int NeoUTF8Transcoder::finish(uint8_t *out)
+{
+    if (0 == m_needed) return 0;
+    m_needed = 0;
+    *out = m_fallback;
+    m_fallbacks++;
+    return 1;
+}
+
+
+/** Discard any incomplete character and reset the count of fallback characters.
+ */
+void NeoUTF8Transcoder::reset()
+{
+    m_code = 0;
+    m_needed = 0;
+    m_fallbacks = 0;
+}
+
+
+/** Return the number of fallback characters written since the transcoder was created or reset.
+ */
+unsigned int NeoUTF8Transcoder::fallbackCount() const
+{
+    return m_fallbacks;
+}
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      NeoUTF8Transcoder private methods.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Convert a complete character.
+ *
+ *  @param  unicode The Unicode character.
+ *  @return         The Neo character code, or the fallback character.
+ */
+uint8_t NeoUTF8Transcoder::lookup(uint32_t unicode)
+{
+    if (unicode < 0x20 && m_controls) return (uint8_t)unicode;
+    int code = m_encoding->fromUnicode(unicode);
+    if (kNeoCharacterNotMapped != code) return (uint8_t)code;
+    m_fallbacks++;
+    return m_fallback;
+}
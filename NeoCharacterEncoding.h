@@ -7,7 +7,110 @@
 
 #include <stdint.h>
 
+class NeoArchiveWriter;
+
+
+#define kNeoCharacterNotMapped      (-1)        /**< Returned by NeoCharacterFromUnicode() for unmapped characters. */
+#define kNeoTranscodeSlack          (1)         /**< Extra output space needed by NeoUTF8Transcoder::transcode(). */
+
+/* Built-in encodings (see NeoEncoding::builtIn()).
+ */
+#define kNeoEncodingNeo             (0)         /**< Codes 0-31 are the Neo symbol glyphs (the default). */
+#define kNeoEncodingControls        (1)         /**< Codes 1-31 are the standard control characters. */
+#define kNeoEncodingBuiltInCount    (2)         /**< Number of built-in encodings. */
+
+#define kNeoEncodingNameSize        (32)        /**< Size of an encoding name, including the terminator. */
+
+
 extern uint16_t NeoCharacterToUTF16(int neoCharacter);
+extern int NeoCharacterFromUnicode(uint32_t unicode);
+
+
+/** A mapping between the 256 Neo character codes and the Unicode characters that they show, with a reverse
+ *  index from Unicode back to Neo codes. An encoding does not change once it has been created, so one
+ *  encoding can be shared by any number of threads.
+ *
+ *  Encodings can be loaded from a binary table (see saveArchive()) or from a text table in the style of
+ *  the Unicode mapping files: one "0xNN 0xUUUU" pair per line, with "#" starting a comment and an optional
+ *  "name <name>" line. Codes that a table does not list are mapped as in kNeoEncodingNeo.
+ */
+class NeoEncoding
+{
+public:
+
+    NeoEncoding(const uint16_t *unicode, const char *name);
+    ~NeoEncoding();
+
+    static NeoEncoding *load(const uint8_t *data, unsigned int length);
+    static const NeoEncoding *builtIn(int n);
+    static const NeoEncoding *defaultEncoding();
+    static void setDefaultEncoding(const NeoEncoding *encoding);
+
+    const char *name() const;
+    uint16_t toUnicode(int neoCharacter) const;
+    int fromUnicode(uint32_t unicode) const;
+    bool isASCII() const;
+
+    unsigned int archiveSize() const;
+    void saveArchive(uint8_t *data) const;
+
+private:
+
+    char m_name[kNeoEncodingNameSize];      /**< The name of the encoding. */
+    uint16_t m_unicode[256];                /**< The character shown by each Neo code. */
+    uint16_t m_pages[256];                  /**< The code table used for each 256 character page of the BMP. */
+    int16_t (*m_codes)[256];                /**< Code tables. Table zero maps nothing. */
+    bool m_ascii;                           /**< Logical true if printable ASCII maps to itself. */
+
+    NeoEncoding(const NeoEncoding &other);
+    NeoEncoding &operator=(const NeoEncoding &other);
+
+    void saveArchive(NeoArchiveWriter *writer) const;
+    static NeoEncoding *loadText(const char *text, unsigned int length);
+};
+
+
+/** Class used to convert UTF-8 text to Neo character codes. Text may be supplied in pieces of any size: a
+ *  character split between two pieces is converted when the second piece arrives. Characters that have no
+ *  Neo equivalent, and bytes that are not valid UTF-8, are replaced by a fallback character.
+ *
+ *  The control characters U+0000 to U+001F are normally passed through unchanged, so that line breaks and
+ *  tabs survive conversion. The Neo glyphs with these codes can still be reached using the characters that
+ *  they show (for example U+2193 for code 10).
+ */
+class NeoUTF8Transcoder
+{
+public:
+
+    NeoUTF8Transcoder(int fallback = '?', bool controls = true, const NeoEncoding *encoding = 0);
+    ~NeoUTF8Transcoder();
+
+    void setFallback(int neoCharacter);
+    int fallback() const;
+    void setEncoding(const NeoEncoding *encoding);
+    const NeoEncoding *encoding() const;
+
+    unsigned int transcode(const uint8_t *in, unsigned int length, uint8_t *out);
+    unsigned int finish(uint8_t *out);
+    void reset();
+
+    unsigned int fallbackCount() const;
+
+private:
+
+    uint8_t m_fallback;             /**< The character written for unmapped or invalid input. */
+    bool m_controls;                /**< Logical true to pass control characters through unchanged. */
+    const NeoEncoding *m_encoding;  /**< The encoding. */
+    uint32_t m_code;                /**< The bits of a partly decoded character. */
+    int m_needed;                   /**< The number of continuation bytes still needed for m_code. */
+    uint32_t m_minimum;             /**< The smallest code that may use the length of m_code's sequence. */
+    unsigned int m_fallbacks;       /**< The number of fallback characters written. */
+
+    NeoUTF8Transcoder(const NeoUTF8Transcoder &other);
+    NeoUTF8Transcoder &operator=(const NeoUTF8Transcoder &other);
+
+    uint8_t lookup(uint32_t unicode);
+};
 
 
 #endif  // _NEOFONTENCODING_H_
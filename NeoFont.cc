@@ -8,47 +8,12 @@
 #include <stdint.h>
 #include <stdio.h>
 #include "NeoFont.h"
+#include "NeoFontSubscription.h"
+#include "NeoAppletFormat.h"
+#include "NeoAppletView.h"
 #include "AppletID.h"
 
 
-/* -------------------------------------------------------------------------------------------------------------------------------
- *
- *      Macros.
- *
- * -------------------------------------------------------------------------------------------------------------------------------
- */
-
-/* Applet file definition constants.
- */
-#define kAppletOffMagic1            (0x0000)        /**< kMagic1 (big-endian, 32 bit). */
-#define kAppletOffFileSize          (0x0004)        /**< File size (big-endian, 32 bit). */
-#define kAppletOffID1               (0x0014)        /**< ID byte */
-#define kAppletOffID0               (0x0015)        /**< ID byte */
-#define kAppletOffControlCode       (0x0142)        /**< Very dubious offset to 68k lea code for data table (!). */
-#define kAppletOffFontName          (0x01f2)        /**< Start of zero terminated font name. */
-#define kAppletOffAppletName        (0x0018)        /**< Start of zero terminated smart applet name (description). */
-#define kAppletOffVersionMajor      (0x003c)        /**< Major version number. */
-#define kAppletOffVersionMinor      (0x003d)        /**< Minor version number. */
-#define kAppletOffVersionBuild      (0x003e)        /**< Release code (letter). */
-#define kAppletOffAppletInfo        (0x0040)        /**< Applet information string (64 bytes long). */
-
-#define kAppletRelOffFontHeight     (0x00)          /**< Offset to font height, relative to 16 byte font info structure. */
-#define kAppletRelOffWidthTable     (0x04)          /**< Offset to 8 bute font width table, relative to font info structure. */
-#define kAppletRelOffLocationTable  (0x08)          /**< Offset to 16 bit bit data offset table, relative to font info structure. */
-#define kAppletRelOffBitmaps        (0x0c)          /**< Start of font bitmap data, relative to font info structure. */
-
-#define kMagic1              (0xc0ffeeadu)          /**< Value for kAppletOffMagic. */
-
-
-
-/* Helper macros used to decode big-endian values from a byte array.
- */
-#define XB8(a, x)   ((unsigned)a[x])
-#define XB16(a, x)  ((((unsigned)a[x]) << 8) | (((unsigned)a[x+1]) << 0))
-#define XB32(a, x)  ((((unsigned)a[x]) << 24) | (((unsigned)a[x+1]) << 16) | (((unsigned)a[x+2]) << 8) | (((unsigned)a[x+3]) << 0))
-
-
-
 /* -------------------------------------------------------------------------------------------------------------------------------
  *
  *      Private Data.
@@ -96,6 +61,25 @@ static uint8_t file_prefix[] =
 
 
 
+/** Layout of the fixed part of the original font archive. This matches the memory image of the original font
+ *  object, which was followed directly by the archives of each of the characters. It is only used to load
+ *  old archives.
+ */
+struct NeoFontArchive
+{
+    char appletName[36];                                    /**< The name of the applet (seen in AS Manager). */
+    char appletInfo[60];                                    /**< The applet information (copyright) text. */
+    char fontName[24];                                      /**< The name of the font (seen on the Neo). */
+    int versionMajor;                                       /**< Major version number. */
+    int versionMinor;                                       /**< Minor version number. */
+    int versionBuild;                                       /**< Build code (ASCII character). */
+    char versionString[16];                                 /**< Cached version string. */
+    int ident;                                              /**< 16 bit Unique ID code. */
+    int height;                                             /**< Font height (pixels) */
+};
+
+
+
 /* -------------------------------------------------------------------------------------------------------------------------------
  *
  *      Private Functions.
@@ -103,6 +87,22 @@ static uint8_t file_prefix[] =
  * -------------------------------------------------------------------------------------------------------------------------------
  */
 
+/** Copy a string in to a fixed size field, truncating it if necessary. The source may overlap the field (for
+ *  example when a name is set to itself).
+ *
+ *  @param  field   The field.
+ *  @param  s       The string.
+ *  @param  size    The size of the field, including space for the terminator.
+ */
+static void copyString(char *field, const char *s, unsigned int size)
+{
+    unsigned int length = 0;
+    while (length < size - 1 && 0 != s[length]) length++;
+    memmove(field, s, length);
+    memset(&field[length], 0, size - length);
+}
+
+
 /** Helper function used to write a 32 bit big endian value to a byte array.
  *
  *  @param  data    The data array.
@@ -121,6 +121,99 @@ static void write32b(uint8_t *data, int offset, int value)
 
 
 
+/** Transpose an 8x8 bit matrix held in a 64 bit word. Bit (8 * r + c) of the input becomes bit (8 * c + r)
+ *  of the output, so that a word holding eight 8-pixel row segments (one per byte) is converted in to one
+ *  holding eight 8-pixel column segments, and vice versa.
+ *
+ *  @param  x       The matrix to transpose.
+ *  @return         The transposed matrix.
+ */
+static inline uint64_t transpose8x8(uint64_t x)
+{
+    uint64_t t;
+    t = (x ^ (x >>  7)) & 0x00aa00aa00aa00aaull;  x = x ^ t ^ (t <<  7);
+    t = (x ^ (x >> 14)) & 0x0000cccc0000ccccull;  x = x ^ t ^ (t << 14);
+    t = (x ^ (x >> 28)) & 0x00000000f0f0f0f0ull;  x = x ^ t ^ (t << 28);
+    return x;
+}
+
+
+/** Convert a character bitmap to the applet's bitmap form. The Neo stores each character as a sequence of
+ *  strips, each 8 pixels tall and one byte per column, with bit n of each byte giving row n of the strip.
+ *  The row-major character bitmap is converted 8x8 pixels at a time.
+ *
+ *  @param  c           The character to encode.
+ *  @param  first       The first strip to encode.
+ *  @param  end         The strip after the last one to encode (normally (font height + 7) / 8).
+ *  @param  data        The character's bitmap data. Strip s is written to the c.width() bytes at data[s * c.width()].
+ */
+static void encodeStrips(const NeoCharacter &c, unsigned int first, unsigned int end, uint8_t *data)
+{
+    int width = c.width();
+    int height = c.height();
+    for (unsigned int s = first; s < end; s++)
+    {
+        for (int x0 = 0; x0 < width; x0 += 8)
+        {
+            // Gather an 8x8 block with one row per byte, then transpose to give one column per byte
+            uint64_t block = 0;
+            for (int r = 0; r < 8; r++)
+            {
+                int y = (s * 8) + r;
+                if (y >= height) break;
+                block |= ((c.row(y)[x0 / 64] >> (x0 & 63)) & 0xff) << (r * 8);
+            }
+            block = transpose8x8(block);
+
+            int columns = (width - x0 < 8) ? (width - x0) : 8;
+            uint8_t *out = &data[(s * width) + x0];
+            for (int i = 0; i < columns; i++) out[i] = (uint8_t)(block >> (i * 8));
+        }
+    }
+}
+
+
+
+/** Convert applet bitmap data back to a character bitmap. This is the inverse of encodeStrips(): each group
+ *  of eight column bytes is transposed to give eight 8-pixel row segments, which are assembled in to whole
+ *  rows and written to the character. The character width and height must already be set.
+ *
+ *  @param  c           The character to decode in to.
+ *  @param  strips      The number of 8 pixel strips ((font height + 7) / 8).
+ *  @param  data        The bitmap data (strips * stride bytes).
+ *  @param  stride      The number of columns stored in each strip. This is normally c.width(), but may differ
+ *                      if the width in the applet was outside the supported range.
+ */
+static void decodeStrips(NeoCharacter &c, unsigned int strips, const uint8_t *data, unsigned int stride)
+{
+    int width = ((int)stride < c.width()) ? (int)stride : c.width();
+    int height = c.height();
+    int words = c.rowWords();
+    for (unsigned int s = 0; s < strips; s++)
+    {
+        uint64_t rows[8 * kNeoCharacterRowWords] = { 0 };
+        for (int x0 = 0; x0 < width; x0 += 8)
+        {
+            // Gather up to eight columns with one column per byte, then transpose to give one row per byte
+            int columns = (width - x0 < 8) ? (width - x0) : 8;
+            const uint8_t *in = &data[(s * stride) + x0];
+            uint64_t block = 0;
+            for (int i = 0; i < columns; i++) block |= ((uint64_t)in[i]) << (i * 8);
+            block = transpose8x8(block);
+
+            for (int r = 0; r < 8; r++) rows[(r * words) + (x0 / 64)] |= ((block >> (r * 8)) & 0xff) << (x0 & 63);
+        }
+        for (int r = 0; r < 8 && (int)(s * 8) + r < height; r++) c.setRow((s * 8) + r, &rows[r * words]);
+    }
+
+    uint64_t blank[kNeoCharacterRowWords] = { 0 };
+    for (int y = strips * 8; y < height; y++) c.setRow(y, blank);
+}
+
+
+
+
+
 /* -------------------------------------------------------------------------------------------------------------------------------
  *
  *      NeoFont class definition.
@@ -140,8 +233,27 @@ NeoFont::NeoFont()
         m_versionBuild(' '),
         m_ident(kAppletID_UserMin),
         m_height(16),
-        m_characters()
+        m_characters(),
+        m_fontNameLength(0),
+        m_totalWidth(0),
+        m_maxWidth(0),
+        m_widthCount(),
+        m_generation(0),
+        m_subscriptions(0),
+        m_changeDepth(0),
+        m_pendingFields(0),
+        m_pendingCharacters(),
+        m_pendingRects(0)
 {
+    for (unsigned int i = 0; i < kNeoFontCharacterCount; i++)
+    {
+        int width = m_characters[i].width();
+        m_characters[i].m_font = this;
+        m_widthCount[width]++;
+        m_totalWidth += width;
+        if (width > m_maxWidth) m_maxWidth = width;
+    }
+
     setFontName("Unnamed");
     setAppletInfo("Neo Custom Font. Copyright (c) 2008 [author].");
     clear();
@@ -154,7 +266,7 @@ NeoFont::NeoFont()
  */
 NeoFont::~NeoFont()
 {
-    // Nothing at present.
+    delete[] m_pendingRects;
 }
 
 
@@ -218,14 +330,24 @@ int NeoFont::height() const
 }
 
 
+/** Obtain the generation of the font. This is incremented by every change to a field or a character.
+ *
+ *  @return         The generation count.
+ */
+uint32_t NeoFont::generation() const
+{
+    return m_generation;
+}
+
+
 /** Set the name of the applet.
  *
  *  @param  n          The name to use.
  */
 const char *NeoFont::setAppletName(const char* n)
 {
-    strncpy(m_appletName, n, sizeof m_appletName);
-    m_appletName[sizeof m_appletName - 1] = 0;
+    if (0 != strncmp(m_appletName, n, sizeof m_appletName - 1)) fieldsChanged(kNeoFontFieldAppletName);
+    copyString(m_appletName, n, sizeof m_appletName);
 	return m_appletName;
 }
 
@@ -236,8 +358,8 @@ const char *NeoFont::setAppletName(const char* n)
  */
 const char *NeoFont::setAppletInfo(const char* n)
 {
-    strncpy(m_appletInfo, n, sizeof m_appletInfo);
-    m_appletInfo[sizeof m_appletInfo - 1] = 0;
+    if (0 != strncmp(m_appletInfo, n, sizeof m_appletInfo - 1)) fieldsChanged(kNeoFontFieldAppletInfo);
+    copyString(m_appletInfo, n, sizeof m_appletInfo);
 	return m_appletInfo;
 }
 
@@ -248,10 +370,16 @@ const char *NeoFont::setAppletInfo(const char* n)
  */
 const char *NeoFont::setFontName(const char* n)
 {
-    strncpy(m_fontName, n, sizeof m_fontName);
-    m_fontName[sizeof m_fontName - 1] = 0;
+    unsigned int fields = 0;
+    char previous[sizeof m_appletName];
+    memcpy(previous, m_appletName, sizeof previous);
+    if (0 != strncmp(m_fontName, n, sizeof m_fontName - 1)) fields |= kNeoFontFieldFontName;
+    copyString(m_fontName, n, sizeof m_fontName);
     strncpy(m_appletName, "Neo Font - ", sizeof m_appletName);
     strncat(m_appletName, m_fontName, sizeof m_appletName - 1 - strlen(m_appletName));
+    m_fontNameLength = strlen(m_fontName);
+    if (0 != strcmp(previous, m_appletName)) fields |= kNeoFontFieldAppletName;
+    if (0 != fields) fieldsChanged(fields);
 	return m_fontName;
 }
 
@@ -267,10 +395,13 @@ const char *NeoFont::setVersion(const char *v)
     int minor = m_versionMinor;
     char bc = ' ';
     sscanf(v, "%d.%d%c", &major, &minor, &bc);
+    char previous[sizeof m_versionString];
+    memcpy(previous, m_versionString, sizeof previous);
     m_versionMajor = major & 255;
     m_versionMinor = minor & 255;
-    m_versionBuild = bc;
+    m_versionBuild = (unsigned char)bc;
     remakeVersionString();
+    if (0 != strcmp(previous, m_versionString)) fieldsChanged(kNeoFontFieldVersion);
 	return m_versionString;
 }
 
@@ -281,6 +412,7 @@ const char *NeoFont::setVersion(const char *v)
  */
 int NeoFont::setIdent(int id)
 {
+    if ((int)(id & 0xffffu) != m_ident) fieldsChanged(kNeoFontFieldIdent);
     m_ident = (id & 0xffffu);
 	return m_ident;
 }
@@ -295,6 +427,7 @@ int NeoFont::setHeight(int h)
 {
     if (h < kNeoCharacterMinHeight) h = kNeoCharacterMinHeight;
     if (h > kNeoCharacterMaxHeight) h = kNeoCharacterMaxHeight;
+    if (h != m_height) fieldsChanged(kNeoFontFieldHeight);
     
     for (unsigned int i = 0; i < kNeoFontCharacterCount; i++)
     {
@@ -337,20 +470,83 @@ NeoCharacter *NeoFont::character(int index)
 }
 
 
+/** Get a pointer to a specific character object instance, for reading.
+ *
+ * @param  index    The character number.
+ * @return          A pointer to the character object, or zero if index is out of range.
+ */
+const NeoCharacter *NeoFont::character(int index) const
+{
+    if (index < 0 || index >= kNeoFontCharacterCount) return 0;
+    else return &m_characters[index];
+}
+
+
+/** Start a group of changes. Until the matching call to endChanges(), changes to the font are collected
+ *  instead of being passed to the subscriptions, and the font generation is not advanced. Calls may be
+ *  nested.
+ */
+void NeoFont::beginChanges()
+{
+    if (0 == m_pendingRects) m_pendingRects = new NeoCharacterRect[kNeoFontCharacterCount];
+    m_changeDepth++;
+}
+
+
+/** Finish a group of changes started by beginChanges(). When the outermost group finishes, the changes
+ *  collected are passed to each subscription at once, and the font generation is advanced once.
+ */
+void NeoFont::endChanges()
+{
+    if (0 == m_changeDepth || 0 != --m_changeDepth) return;
+
+    bool changed = 0 != m_pendingFields;
+    for (int k = 0; k < kNeoFontCharacterSetWords; k++) changed = changed || 0 != m_pendingCharacters[k];
+    if (!changed) return;
+
+    m_generation++;
+    for (NeoFontSubscription *s = m_subscriptions; 0 != s; s = s->m_next)
+    {
+        s->m_fields |= m_pendingFields;
+        for (int k = 0; k < kNeoFontCharacterSetWords; k++)
+        {
+            for (uint64_t word = m_pendingCharacters[k]; 0 != word; word &= word - 1)
+            {
+                int index = (k * 64) + __builtin_ctzll(word);
+                s->addCharacter(index, m_pendingRects[index]);
+            }
+        }
+    }
+    m_pendingFields = 0;
+    for (int k = 0; k < kNeoFontCharacterSetWords; k++) m_pendingCharacters[k] = 0;
+}
+
+
 /** Method used to calculate how large an applet generated from the current font definition will be.
  *  This depends on many thing, but most notably the widths and heights of the characters.
  *
  *  @return         The size of the font file data given the current font definitions (in bytes).
  */
 unsigned int NeoFont::appletSize() const
+{
+    return appletSizeForBitmap(bitmapSize());
+}
+
+
+/** Calculate how large an applet generated from the font would be with a different amount of glyph bitmap
+ *  data, such as after the characters have been resized.
+ *
+ *  @param  bitmapBytes The number of bytes of glyph bitmaps.
+ *  @return             The size of the font file data (in bytes).
+ */
+unsigned int NeoFont::appletSizeForBitmap(unsigned int bitmapBytes) const
 {
     unsigned int size = sizeof file_prefix;                 // Header
-    size += strlen(fontName()) + 1;                         // Name string, rounded to next higher number of words
+    size += m_fontNameLength + 1;                           // Name string, rounded to next higher number of words
     while ((size % 2) != 0) size ++;                        // Pad to next word boundary
     size += kNeoFontCharacterCount;                         // Width table
     size += kNeoFontCharacterCount * 2;                     // Offset table
-    unsigned int bytes_per_column = ((height() + 7) / 8);   // Number of bytes for pixel column (common to all characters)
-    for (unsigned int i = 0; i < kNeoFontCharacterCount; i++) size += ((m_characters[i]).width())*bytes_per_column; // Per character sizes
+    size += bitmapBytes;                                    // Per character sizes
     while ((size % 4) != 0) size ++;                        // Pad to next word boundary
     size += 16;                                             // Font information table
     size += 4;                                              // Magic word 0xcafefeed at end
@@ -371,6 +567,31 @@ unsigned int NeoFont::encodeApplet(uint8_t *data, unsigned int length) const
         return 0;   // Not enough output space
     }
 
+    // Write the header and font name.
+    unsigned int bitmap_offset = encodeAppletHeader(data);
+
+    // Append the bitmap data.
+    unsigned int offset = bitmap_offset;
+    for (unsigned int i = 0; i < kNeoFontCharacterCount; i++)
+    {
+        encodeCharacter(i, 0, m_height, &data[offset]);
+        offset += m_characters[i].width() * ((m_height + 7) / 8);
+    }
+
+    // Append the tables that follow the bitmaps.
+    return encodeAppletTables(data, bitmap_offset);
+}
+
+
+/** Write the start of an applet: the prefix block (including the outline header and applet loader code),
+ *  overlaid with the applet fields, followed by the font name. The file size and the loader's references to
+ *  the font information structure are left as they are in the prefix, and are set by encodeAppletTables().
+ *
+ *  @param  data    The applet data.
+ *  @return         The offset of the bitmap data, which follows the font name.
+ */
+unsigned int NeoFont::encodeAppletHeader(uint8_t *data) const
+{
     // Copy the prefix block (including outline header and applet loader code).
     for (unsigned int i = 0; i < sizeof file_prefix; i++)
     {
@@ -387,38 +608,55 @@ unsigned int NeoFont::encodeApplet(uint8_t *data, unsigned int length) const
     data[kAppletOffVersionBuild] = (uint8_t)m_versionBuild;
     
     // Overlay the applet name.
-    for (unsigned int i = 0; i < strlen(m_appletName) && i < 31; i++)  data[i+kAppletOffAppletName] = m_appletName[i];
+    unsigned int applet_name_length = strlen(m_appletName);
+    for (unsigned int i = 0; i < applet_name_length && i < 31; i++)  data[i+kAppletOffAppletName] = m_appletName[i];
 
     // Overlay the info string.
-    for (unsigned int i = 0; i < strlen(m_appletInfo) && i < 63; i++)  data[i+kAppletOffAppletInfo] = m_appletInfo[i];
+    unsigned int applet_info_length = strlen(m_appletInfo);
+    for (unsigned int i = 0; i < applet_info_length && i < 63; i++)  data[i+kAppletOffAppletInfo] = m_appletInfo[i];
 
 
     // Append the font name string and pad to the next word boundary.
     unsigned int offset = sizeof file_prefix;
-    for (unsigned int i = 0; i < strlen(m_fontName); i++)  data[offset++] = m_fontName[i];
+    unsigned int font_name_length = strlen(m_fontName);
+    for (unsigned int i = 0; i < font_name_length; i++)  data[offset++] = m_fontName[i];
     data[offset++] = 0;
     while ((offset % 2) != 0) data[offset++] = 0;
+    return offset;
+}
 
-    // Append the bitmap data.
+
+/** Write some rows of a character's bitmap data in applet form. Only the strips holding the rows are written.
+ *
+ *  @param  index   The character number.
+ *  @param  y0      The first row to write.
+ *  @param  y1      The row after the last one to write.
+ *  @param  data    The character's bitmap data (strips * width bytes).
+ */
+void NeoFont::encodeCharacter(int index, int y0, int y1, uint8_t *data) const
+{
+    unsigned int strips = (m_height + 7) / 8;
+    unsigned int first = (y0 < 0) ? 0 : (y0 / 8);
+    unsigned int end = (y1 < 0) ? 0 : ((y1 + 7) / 8);
+    if (end > strips) end = strips;
+    encodeStrips(m_characters[index], first, end, data);
+}
+
+
+/** Write the end of an applet, from the padding after the bitmap data to the end of the file. This holds
+ *  the width and bitmap offset tables and the font information structure. The file size in the header and
+ *  the loader's references to the font information structure are also set.
+ *
+ *  @param  data            The applet data.
+ *  @param  bitmapOffset    The offset of the bitmap data, as returned by encodeAppletHeader().
+ *  @return                 The number of bytes in the file.
+ */
+unsigned int NeoFont::encodeAppletTables(uint8_t *data, unsigned int bitmapOffset) const
+{
     unsigned int bytes_per_column = ((height() + 7) / 8);
-    unsigned int bitmap_offset = offset;
-    for (unsigned int i = 0; i < kNeoFontCharacterCount; i++)
-    {
-        unsigned int width = m_characters[i].width();
-        unsigned int byte_count = bytes_per_column * m_characters[i].width();
-        for (unsigned int byte = 0; byte < byte_count; byte++)
-        {
-            unsigned int b = 0;
-            for (unsigned int bit = 0; bit < 8; bit++)
-            {
-                int x = byte % width;
-                int y = bit + ((byte / width) * 8);
-                if (m_characters[i].getPixel(x, y))  b = b | (1u << bit);
-            }
-            data[offset++] = b;
-        }
-    }
-    
+    unsigned int bitmap_offset = bitmapOffset;
+    unsigned int offset = bitmap_offset + bitmapSize();
+
     // Pad to the next word boundary.
     while ((offset % 4) != 0) data[offset++] = 0;
 
@@ -438,9 +676,10 @@ unsigned int NeoFont::encodeApplet(uint8_t *data, unsigned int length) const
         
     // Append the font inforamtion structure.
     unsigned int font_info_offset = offset;
+    int max_width = maxWidth();
     data[offset++] = height();                          // Font height
-    data[offset++] = maxWidth();                        // Maximum character width in the font
-    data[offset++] = maxWidth() * bytes_per_column;     // Maximum number of bitmap bytes in any character in the font
+    data[offset++] = max_width;                         // Maximum character width in the font
+    data[offset++] = max_width * bytes_per_column;      // Maximum number of bitmap bytes in any character in the font
     data[offset++] = 0x00;                              // *** UNKNOWN *** (probably reserved, as always zero)
     data[offset++] = (width_table_offset >> 24) & 255;
     data[offset++] = (width_table_offset >> 16) & 255;
@@ -488,121 +727,199 @@ unsigned int NeoFont::encodeApplet(uint8_t *data, unsigned int length) const
  *
  *  @param  data    A pointer to the font data (the Neo file).
  *  @param  length  The number of bytes of data.
- *  @return         Logical true if the data was parsed correctly, false otherwise.
+ *  @param  error   If not zero, receives kNeoAppletOK or the reason the data was rejected (see NeoAppletView).
+ *  @return         Logical true if the data was parsed correctly, false otherwise. The font is not modified
+ *                  if the data is rejected.
  */
-bool NeoFont::decodeApplet(const uint8_t *data, unsigned int length)
+bool NeoFont::decodeApplet(const uint8_t *data, unsigned int length, int *error)
 {
-    /* Check the magic number at the start of the file.
+    /* Validate the file structure. The view checks all of the offsets in the file, so the data
+     * can be read without further checks.
      */
-    unsigned int magic = XB32(data, kAppletOffMagic1);
-    if (magic != kMagic1)
+    NeoAppletView view;
+    bool valid = view.attach(data, length);
+    if (0 != error) *error = view.error();
+    if (!valid)
     {
-        return false;           // Unexpected magic number
+        return false;           // Not a valid font applet
     }
-    
-    /* Check the file length.
-     */
-    unsigned int filesize = XB32(data, kAppletOffFileSize);
-    if (filesize != length)
-    {
-        return false;           // Applet file size does not match supplied file size
-    }
-    
-    /* Try to decode the instructions that contain the address of the font data descriptor structure.
-     * There are lots of very dubious assumptions made here, and a new compile of code for the
-     * smart applet fonts will undoubtably break this scheme.
-     */
-    unsigned int code0 = XB16(data, 0x0142);    // movea.l #<value>, a0
-    unsigned int code1 = XB32(data, 0x0144);    //          <value>
-    unsigned int code2 = XB16(data, 0x0148);    // lea (<offset>, pc, a0.l), a0
-    unsigned int code3 =  XB8(data, 0x014a);    //
-    unsigned int code4 =  XB8(data, 0x014b);    //      <offset>
 
-    if ((code0 != 0x207c) || (code2 != 0x41fb) || (code3 != 0x88))
-    {
-        return false;           // The code is not what was expected...
-    }
-    
-    int pc_rel_offset = (code4 < 128) ? (code4) : (code4 - 256);
-    unsigned int font_config_offset = 0x148 + 2 + pc_rel_offset + code1;
+    setHeight(view.height());
 
-    unsigned int width_table = XB32(data, font_config_offset + kAppletRelOffWidthTable);
-    unsigned int location_table = XB32(data, font_config_offset + kAppletRelOffLocationTable);
-    unsigned int bitmap_start = XB32(data, font_config_offset + kAppletRelOffBitmaps);
-
-    setHeight(XB8(data, font_config_offset + kAppletRelOffFontHeight));
-
-    setAppletName((const char*) &data[kAppletOffAppletName]);
-    setAppletInfo((const char*) &data[kAppletOffAppletInfo]);
+    setAppletName(view.appletName());
+    setAppletInfo(view.appletInfo());
     if (strlen(appletName()) > 11)
     {
-        setFontName((const char*) &data[kAppletOffAppletName + 11]);        // Derive font name from applet name
+        setFontName(view.appletName() + 11);        // Derive font name from applet name
     }
     else
     {
-        setFontName((const char*) &data[kAppletOffFontName]);               // Else use embedded font name if applet name too short
+        setFontName(view.fontName());               // Else use embedded font name if applet name too short
     }
     
-    m_versionMajor = data[kAppletOffVersionMajor];
-    m_versionMinor = data[kAppletOffVersionMinor];
-    m_versionBuild = data[kAppletOffVersionBuild];
+    m_versionMajor = view.versionMajor();
+    m_versionMinor = view.versionMinor();
+    m_versionBuild = view.versionBuild();
     remakeVersionString();
     
-    m_ident = (((int)data[kAppletOffID1]) * 256) + (int)data[kAppletOffID0];
-
-    clear();        // Reset all bitmaps to empty so we only need to program 'set' pixels.
+    m_ident = view.ident();
+    fieldsChanged(kNeoFontFieldAll);
 
+    unsigned int bytes_per_column = ((m_height + 7) / 8);
+    if (bytes_per_column > view.strips()) bytes_per_column = view.strips();
     for (unsigned int i = 0; i < kNeoFontCharacterCount; i++)
     {
-        unsigned int character_width = XB8(data, (width_table + i));
-        unsigned int offset = XB16(data, (location_table + (i*2)));
-        unsigned int bits = bitmap_start + offset;
-        
+        unsigned int character_width = view.glyphWidth(i);
         m_characters[i].setWidth(character_width);
-        
-        for (unsigned int x = 0; x < character_width; x++)
-        {
-            for (unsigned int y = 0; y < m_height; y++)
-            {
-                int byte_index = ((y / 8) * character_width) + x;
-                int bit_index = y % 8;
-                bool isSet = (XB8(data, (bits + byte_index)) & (1 << bit_index)) != 0;
-                if (isSet) m_characters[i].setPixel(x, y);
-            }
-        }
+        decodeStrips(m_characters[i], bytes_per_column, view.glyphBits(i), character_width);
     }
 	
 	return true;
 }
 
 
+/** Return the amount of memory used by the font, including the bitmap storage of all characters.
+ *
+ *  @return     The number of bytes used.
+ */
+unsigned int NeoFont::storageSize() const
+{
+    unsigned int size = sizeof *this - sizeof m_characters;
+    for (unsigned int i = 0; i < kNeoFontCharacterCount; i++) size += m_characters[i].storageSize();
+    if (0 != m_pendingRects) size += kNeoFontCharacterCount * sizeof m_pendingRects[0];
+    return size;
+}
+
+
 /** Return the size of the archive data.
  *
- *  @return     The number of bytes in archive().
+ *  @return     The number of bytes written by saveArchive().
  */
 unsigned int NeoFont::archiveSize() const
 {
-    return sizeof *this;
+    NeoArchiveWriter writer(0);
+    saveRecord(&writer);
+    return writer.length();
 }
 
 
-/** Return a pointer to the raw font data.
+/** Save the font to a byte array. The archive is versioned and independent of the host byte order, and
+ *  holds only the pixels within each character.
  *
- *  @return     A pointer to an array of bytes defining the character.
+ *  @param  data    A pointer to an array of bytes to receive the archive of at least archiveSize() bytes.
  */
 void NeoFont::saveArchive(uint8_t *data) const
 {
-    memcpy(data, (void*)this, sizeof *this);
+    NeoArchiveWriter writer(data);
+    saveRecord(&writer);
 }
 
 
-/** Load raw font data.
+/** Load the font from a byte array. Archives in the original fixed layout are also accepted.
  *
- *  @param  data    The data to load. This must contain archiveSize() bytes.
+ *  @param  data    The data to load.
+ *  @param  length  The number of bytes of data.
+ *  @return         Logical true if the archive was loaded, false if it is not valid. If the archive is not
+ *                  valid, the font may have been partly modified, but every character has the font height.
  */
-void NeoFont::loadArchive(const uint8_t *data)
+bool NeoFont::loadArchive(const uint8_t *data, unsigned int length)
 {
-    memcpy((void*)this, data, sizeof *this);
+    NeoArchiveReader reader(data, length);
+    if (!reader.getMagic(kNeoArchiveMagicFont)) return loadLegacyArchive(data, length);
+
+    reader.getString(m_appletName, sizeof m_appletName);
+    reader.getString(m_appletInfo, sizeof m_appletInfo);
+    reader.getString(m_fontName, sizeof m_fontName);
+    m_fontNameLength = strlen(m_fontName);
+    m_versionMajor = reader.getByte();
+    m_versionMinor = reader.getByte();
+    m_versionBuild = reader.getByte();
+    m_ident = reader.getVarint() & 0xffffu;
+    uint32_t height = reader.getVarint();
+    uint32_t count = reader.getVarint();
+    remakeVersionString();
+    fieldsChanged(kNeoFontFieldAll);
+    if (!reader.isValid() || height < kNeoCharacterMinHeight || height > kNeoCharacterMaxHeight || kNeoFontCharacterCount != count)
+    {
+        return false;
+    }
+    m_height = height;
+
+    for (unsigned int i = 0; i < kNeoFontCharacterCount; i++)
+    {
+        if (!m_characters[i].loadRecord(&reader) || m_characters[i].height() != m_height)
+        {
+            setHeight(m_height);        // Leave every character at the font height
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/** Write the complete font archive.
+ *
+ *  @param  writer  The archive writer.
+ */
+void NeoFont::saveRecord(NeoArchiveWriter *writer) const
+{
+    writer->putMagic(kNeoArchiveMagicFont);
+    writer->putString(m_appletName);
+    writer->putString(m_appletInfo);
+    writer->putString(m_fontName);
+    writer->putByte(m_versionMajor);
+    writer->putByte(m_versionMinor);
+    writer->putByte(m_versionBuild);
+    writer->putVarint(m_ident);
+    writer->putVarint(m_height);
+    writer->putVarint(kNeoFontCharacterCount);
+    for (unsigned int i = 0; i < kNeoFontCharacterCount; i++)
+    {
+        m_characters[i].saveRecord(writer);
+    }
+}
+
+
+/** Load a font archive in the original fixed layout.
+ *
+ *  @param  data    The data to load.
+ *  @param  length  The number of bytes of data.
+ *  @return         Logical true if the archive was loaded, false if the length does not match the layout or
+ *                  the font or character heights are out of range.
+ */
+bool NeoFont::loadLegacyArchive(const uint8_t *data, unsigned int length)
+{
+    if (length != sizeof (NeoFontArchive) + (kNeoFontCharacterCount * kNeoCharacterLegacyArchiveSize)) return false;
+
+    NeoFontArchive archive;
+    memcpy(&archive, data, sizeof archive);
+    if (archive.height < kNeoCharacterMinHeight || archive.height > kNeoCharacterMaxHeight) return false;
+    memcpy(m_appletName, archive.appletName, sizeof m_appletName);
+    memcpy(m_appletInfo, archive.appletInfo, sizeof m_appletInfo);
+    memcpy(m_fontName, archive.fontName, sizeof m_fontName);
+    m_appletName[sizeof m_appletName - 1] = 0;
+    m_appletInfo[sizeof m_appletInfo - 1] = 0;
+    m_fontName[sizeof m_fontName - 1] = 0;
+    m_fontNameLength = strlen(m_fontName);
+    m_versionMajor = archive.versionMajor;
+    m_versionMinor = archive.versionMinor;
+    m_versionBuild = archive.versionBuild;
+    m_ident = archive.ident & 0xffffu;
+    m_height = archive.height;
+    remakeVersionString();
+    fieldsChanged(kNeoFontFieldAll);
+
+    data += sizeof archive;
+    for (unsigned int i = 0; i < kNeoFontCharacterCount; i++)
+    {
+        if (!m_characters[i].loadArchive(data, kNeoCharacterLegacyArchiveSize) || m_characters[i].height() != m_height)
+        {
+            setHeight(m_height);
+            return false;
+        }
+        data += kNeoCharacterLegacyArchiveSize;
+    }
+    return true;
 }
 
 
@@ -629,19 +946,142 @@ void NeoFont::remakeVersionString()
 }
 
 
-/** Get the width of the widest character in the font.
+/** Return the width of the widest character in the font.
  *
- *  @return         The maximum width, in pixels.
+ *  @return         The width, in pixels.
  */
 int NeoFont::maxWidth() const
 {
-    int max_width = 0;
-    for (unsigned int i = 0; i < kNeoFontCharacterCount; i++)
+    return m_maxWidth;
+}
+
+
+/** Return the number of bytes of bitmap data that the font needs in an applet.
+ *
+ *  @return         The total size of the character bitmaps, in bytes.
+ */
+unsigned int NeoFont::bitmapSize() const
+{
+    return m_totalWidth * ((m_height + 7) / 8);
+}
+
+
+/** Return the number of bytes of bitmap data needed by the largest character in the font.
+ *
+ *  @return         The size of the largest character bitmap, in bytes.
+ */
+unsigned int NeoFont::maxBitmapSize() const
+{
+    return m_maxWidth * ((m_height + 7) / 8);
+}
+
+
+/** Return the number of characters that have a given width.
+ *
+ *  @param  w       The width, in pixels.
+ *  @return         The number of characters.
+ */
+unsigned int NeoFont::widthCount(int w) const
+{
+    if (w < 0 || w > kNeoCharacterMaxWidth) return 0;
+    else return m_widthCount[w];
+}
+
+
+/** Obtain a 64 bit hash of the height and the glyphs of the font, in character order. Fonts that look the
+ *  same have the same hash whatever their names and IDs, so it can be used to find duplicate fonts. The
+ *  hash of each glyph is kept by the character (see NeoCharacter::hash()), so this is quick to recalculate
+ *  after an edit.
+ *
+ *  @return         The hash.
+ */
+uint64_t NeoFont::contentHash() const
+{
+    uint64_t hash = kNeoHashSeed ^ (uint64_t)m_height;
+    for (int i = 0; i < kNeoFontCharacterCount; i++)
     {
-        int width = m_characters[i].width();
-        if (width > max_width) max_width = width;
+        hash = (hash ^ m_characters[i].hash()) * kNeoHashMultiplier;
+        hash ^= hash >> 32;
+    }
+    return hash;
+}
+
+
+/** Update the metrics when the width of a character changes. This is called by the character.
+ *
+ *  @param  oldWidth    The previous width, in pixels.
+ *  @param  newWidth    The new width, in pixels.
+ */
+void NeoFont::characterWidthChanged(int oldWidth, int newWidth)
+{
+    m_widthCount[oldWidth]--;
+    m_widthCount[newWidth]++;
+    m_totalWidth += newWidth - oldWidth;
+    if (newWidth > m_maxWidth)
+    {
+        m_maxWidth = newWidth;
+    }
+    else
+    {
+        while (m_maxWidth > 0 && 0 == m_widthCount[m_maxWidth]) m_maxWidth--;
+    }
+}
+
+
+/** Record a change to a character in every subscription, or hold it back until endChanges(). This is called
+ *  by the character whenever its size or pixels change.
+ *
+ *  @param  c           The character.
+ *  @param  r           The pixels that changed.
+ */
+void NeoFont::characterChanged(const NeoCharacter *c, const NeoCharacterRect &r)
+{
+    if (0 != m_changeDepth)
+    {
+        if (r.x0 >= r.x1 || r.y0 >= r.y1) return;
+        int index = c - m_characters;
+        uint64_t bit = ((uint64_t)1) << (index & 63);
+        NeoCharacterRect &box = m_pendingRects[index];
+        if (0 == (m_pendingCharacters[index / 64] & bit))
+        {
+            m_pendingCharacters[index / 64] |= bit;
+            box = r;
+        }
+        else
+        {
+            if (r.x0 < box.x0) box.x0 = r.x0;
+            if (r.y0 < box.y0) box.y0 = r.y0;
+            if (r.x1 > box.x1) box.x1 = r.x1;
+            if (r.y1 > box.y1) box.y1 = r.y1;
+        }
+        return;
+    }
+
+    m_generation++;
+    for (NeoFontSubscription *s = m_subscriptions; 0 != s; s = s->m_next)
+    {
+        s->addCharacter(c - m_characters, r);
+    }
+}
+
+
+/** Record a change to one or more fields in every subscription, or hold it back until endChanges().
+ *
+ *  @param  fields      The fields that changed (a combination of the kNeoFontField... values).
+ */
+void NeoFont::fieldsChanged(unsigned int fields)
+{
+    if (0 != m_changeDepth)
+    {
+        m_pendingFields |= fields;
+        return;
+    }
+
+    m_generation++;
+    for (NeoFontSubscription *s = m_subscriptions; 0 != s; s = s->m_next)
+    {
+        s->m_fields |= fields;
     }
-    return max_width;
 }
 
 
@@ -10,6 +10,21 @@
 
 
 #define kNeoFontCharacterCount  (256)                   /**< The number of characters in a Neo Font. */
+#define kNeoFontCharacterSetWords   (kNeoFontCharacterCount / 64)   /**< Number of words in a set of characters. */
+
+/* Font fields, as reported by NeoFontSubscription::fields().
+ */
+#define kNeoFontFieldAppletName (1u << 0)               /**< The applet name. */
+#define kNeoFontFieldAppletInfo (1u << 1)               /**< The applet information text. */
+#define kNeoFontFieldFontName   (1u << 2)               /**< The font name. */
+#define kNeoFontFieldVersion    (1u << 3)               /**< The version. */
+#define kNeoFontFieldIdent      (1u << 4)               /**< The applet ID. */
+#define kNeoFontFieldHeight     (1u << 5)               /**< The font height. */
+#define kNeoFontFieldAll        (0x3fu)                 /**< Every field. */
+
+
+class NeoFontSubscription;
+class NeoAppletEncoder;
 
 
 /** Class describing a complete font.
@@ -27,6 +42,7 @@ public:
     const char* version() const;
     int ident() const;
     int height() const;
+    uint32_t generation() const;
 
     const char* setAppletInfo(const char* n);
     const char* setFontName(const char* n);
@@ -36,23 +52,33 @@ public:
     int setHeight(int h);    
 
     void clear();
+    bool initWithPreset(int n);
     
     NeoCharacter *character(int index);
+    const NeoCharacter *character(int index) const;
+
+    void beginChanges();
+    void endChanges();
+
+    int maxWidth() const;
+    unsigned int bitmapSize() const;
+    unsigned int maxBitmapSize() const;
+    unsigned int widthCount(int w) const;
+    uint64_t contentHash() const;
 
     unsigned int appletSize() const;
+    unsigned int appletSizeForBitmap(unsigned int bitmapBytes) const;
     unsigned int encodeApplet(uint8_t *data, unsigned int length) const;
-    bool decodeApplet(const uint8_t *data, unsigned int length);
+    bool decodeApplet(const uint8_t *data, unsigned int length, int *error = 0);
     
+    unsigned int storageSize() const;
+
     unsigned int archiveSize() const;
-    void loadArchive(const uint8_t *data);
+    bool loadArchive(const uint8_t *data, unsigned int length);
     void saveArchive(uint8_t *data) const;
 
 private:
 
-    /* Do not use pointer member variables here. The loadArchive() and saveArchive() methods both
-     * in this class and in NeoFont have a trivial implementation that will need to be significantly
-     * more complex if pointers are used.
-     */
     char m_appletName[36];                                  /**< The name of the applet (seen in AS Manager). */
     char m_appletInfo[60];                                  /**< The applet information (copyright) text. */
     char m_fontName[24];                                    /**< The name of the font (seen on the Neo). */
@@ -64,8 +90,39 @@ private:
     int m_height;                                           /**< Font height (pixels) */
 	NeoCharacter m_characters[kNeoFontCharacterCount];      /**< Array of character definitions. */
 
+    /* Metrics, kept up to date as the characters change.
+     */
+    unsigned int m_fontNameLength;                          /**< strlen(m_fontName). */
+    unsigned int m_totalWidth;                              /**< Sum of the widths of all characters. */
+    int m_maxWidth;                                         /**< Width of the widest character. */
+    unsigned int m_widthCount[kNeoCharacterMaxWidth + 1];   /**< Number of characters of each width. */
+
+    uint32_t m_generation;                                  /**< Count of changes made to the font. */
+    NeoFontSubscription *m_subscriptions;                   /**< List of subscriptions to inform of changes. */
+
+    /* Changes held back between beginChanges() and endChanges().
+     */
+    int m_changeDepth;                                      /**< Number of unmatched calls to beginChanges(). */
+    unsigned int m_pendingFields;                           /**< Fields changed. */
+    uint64_t m_pendingCharacters[kNeoFontCharacterSetWords];    /**< Set of characters changed. */
+    NeoCharacterRect *m_pendingRects;                       /**< Pixels changed in each character, or zero until first needed. */
+
+    NeoFont(const NeoFont &other);
+    NeoFont &operator=(const NeoFont &other);
+
     void remakeVersionString();
-    int maxWidth() const;
+    void saveRecord(NeoArchiveWriter *writer) const;
+    bool loadLegacyArchive(const uint8_t *data, unsigned int length);
+    void characterWidthChanged(int oldWidth, int newWidth);
+    void characterChanged(const NeoCharacter *c, const NeoCharacterRect &r);
+    void fieldsChanged(unsigned int fields);
+    unsigned int encodeAppletHeader(uint8_t *data) const;
+    void encodeCharacter(int index, int y0, int y1, uint8_t *data) const;
+    unsigned int encodeAppletTables(uint8_t *data, unsigned int bitmapOffset) const;
+
+    friend class NeoCharacter;
+    friend class NeoFontSubscription;
+    friend class NeoAppletEncoder;
 };
 
 
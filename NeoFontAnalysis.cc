@@ -0,0 +1,434 @@
+/** @file       NeoFontAnalysis.cc
+ *  @brief      Glyph metrics and quality figures for a NeoFont.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "NeoFontAnalysis.h"
+#include "NeoGlyphTable.h"
+
+
+#define kRowMaskWords       ((kNeoCharacterMaxHeight + 63) / 64)    /**< Words in a mask of character rows. */
+#define kJSONMaxPiece       (256)       /**< Longest piece of JSON written at once. */
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      Private Data.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Output buffer for JSON text. Text beyond the end of the buffer is counted but not written.
+ */
+struct NeoJSONOutput
+{
+    char *data;                     /**< The buffer, or zero to only count. */
+    unsigned int length;            /**< The size of the buffer. */
+    unsigned int used;              /**< The number of bytes of text, including any not written. */
+};
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      Private Functions.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Return the number of bitmap bytes in an applet for a glyph. Glyphs are stored a column at a time, with
+ *  each column padded to a whole number of bytes.
+ *
+ *  @param  width   The glyph width.
+ *  @param  height  The font height.
+ *  @return         The number of bytes.
+ */
+static unsigned int glyphBytes(int width, int height)
+{
+    return width * ((height + 7) / 8);
+}
+
+
+/** Measure a glyph.
+ *
+ *  @param  c       The character.
+ *  @param  m       Receives the metrics.
+ *  @param  rows    Updated with a set bit for each row holding ink.
+ */
+static void measureGlyph(const NeoCharacter *c, NeoGlyphMetrics *m, uint64_t *rows)
+{
+    uint64_t columns[kNeoCharacterRowWords] = { 0 };
+    uint64_t used[kRowMaskWords] = { 0 };
+    int words = c->rowWords();
+    int height = c->height();
+    int ink = 0;
+    const uint64_t *src = c->row(0);
+    for (int y = 0; y < height; y++, src += words)
+    {
+        uint64_t any = 0;
+        for (int k = 0; k < words; k++)
+        {
+            columns[k] |= src[k];
+            any |= src[k];
+            ink += __builtin_popcountll(src[k]);
+        }
+        used[y / 64] |= (uint64_t)(0 != any) << (y % 64);
+    }
+
+    m->width = c->width();
+    m->ink = ink;
+    m->duplicateOf = kNeoGlyphUnique;
+    m->appletBytes = glyphBytes(c->width(), c->height());
+    memset(&m->bounds, 0, sizeof m->bounds);
+    for (int k = 0; k < words; k++)
+    {
+        if (0 == columns[k]) continue;
+        if (0 == m->bounds.x1) m->bounds.x0 = (k * 64) + __builtin_ctzll(columns[k]);
+        m->bounds.x1 = (k * 64) + 64 - __builtin_clzll(columns[k]);
+    }
+    for (int k = 0; k < kRowMaskWords; k++)
+    {
+        rows[k] |= used[k];
+        if (0 == used[k]) continue;
+        if (0 == m->bounds.y1) m->bounds.y0 = (k * 64) + __builtin_ctzll(used[k]);
+        m->bounds.y1 = (k * 64) + 64 - __builtin_clzll(used[k]);
+    }
+    m->leftBearing = (0 == ink) ? 0 : m->bounds.x0;
+    m->rightBearing = (0 == ink) ? m->width : (m->width - m->bounds.x1);
+}
+
+
+/** Append formatted text to a JSON output.
+ *
+ *  @param  out     The output.
+ *  @param  format  The printf style format. The text must be shorter than kJSONMaxPiece.
+ */
+static void putJSON(NeoJSONOutput *out, const char *format, ...)
+{
+    char piece[kJSONMaxPiece];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(piece, sizeof piece, format, args);
+    va_end(args);
+    if (n < 0) return;
+    if ((unsigned int)n >= sizeof piece) n = sizeof piece - 1;
+    if (0 != out->data && out->used + n <= out->length) memcpy(&out->data[out->used], piece, n);
+    out->used += n;
+}
+
+
+/** Append a quoted JSON string. Quotes, backslashes and control characters are escaped, and bytes outside
+ *  ASCII are written as Latin-1 characters.
+ *
+ *  @param  out     The output.
+ *  @param  s       The string.
+ */
+static void putJSONString(NeoJSONOutput *out, const char *s)
+{
+    putJSON(out, "\"");
+    for (; 0 != *s; s++)
+    {
+        uint8_t c = (uint8_t)*s;
+        if ('"' == c || '\\' == c) putJSON(out, "\\%c", c);
+        else if (c < 0x20 || c >= 0x7f) putJSON(out, "\\u%04x", c);
+        else putJSON(out, "%c", c);
+    }
+    putJSON(out, "\"");
+}
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      NeoFontAnalysis class definition.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Class constructor. The analysis is of an empty font until analyse() is called.
+ */
+NeoFontAnalysis::NeoFontAnalysis()
+    :
+        m_ident(0),
+        m_height(kNeoCharacterMinHeight),
+        m_empty(0),
+        m_duplicates(0),
+        m_inkTop(0),
+        m_inkBottom(0),
+        m_bitmapBytes(0),
+        m_appletSize(0)
+{
+    memset(m_glyphs, 0, sizeof m_glyphs);
+    memset(m_widths, 0, sizeof m_widths);
+    m_fontName[0] = 0;
+}
+
+
+/** Destructor.
+ */
+NeoFontAnalysis::~NeoFontAnalysis()
+{
+    // Nothing.
+}
+
+
+/** Measure a font. The results do not change if the font is later changed or deleted.
+ *
+ *  @param  font    The font.
+ */
+void NeoFontAnalysis::analyse(const NeoFont *font)
+{
+    strncpy(m_fontName, font->fontName(), sizeof m_fontName - 1);
+    m_fontName[sizeof m_fontName - 1] = 0;
+    m_ident = font->ident();
+    m_height = font->height();
+    m_empty = 0;
+    m_bitmapBytes = 0;
+    m_appletSize = font->appletSize();
+    memset(m_widths, 0, sizeof m_widths);
+
+    uint64_t rows[kRowMaskWords] = { 0 };
+    for (int i = 0; i < kNeoFontCharacterCount; i++)
+    {
+        NeoGlyphMetrics *m = &m_glyphs[i];
+        measureGlyph(font->character(i), m, rows);
+        m_widths[m->width]++;
+        m_bitmapBytes += m->appletBytes;
+        if (0 == m->ink) m_empty++;
+    }
+
+    m_inkTop = 0;
+    m_inkBottom = 0;
+    for (int k = 0; k < kRowMaskWords; k++)
+    {
+        if (0 == rows[k]) continue;
+        if (0 == m_inkBottom) m_inkTop = (k * 64) + __builtin_ctzll(rows[k]);
+        m_inkBottom = (k * 64) + 64 - __builtin_clzll(rows[k]);
+    }
+    findDuplicates(font);
+}
+
+
+/** Return the metrics of a glyph.
+ *
+ *  @param  n       The character number.
+ *  @return         The metrics, or zero if n is out of range.
+ */
+const NeoGlyphMetrics *NeoFontAnalysis::glyph(int n) const
+{
+    return (n >= 0 && n < kNeoFontCharacterCount) ? &m_glyphs[n] : 0;
+}
+
+
+/** Return the font height.
+ */
+int NeoFontAnalysis::height() const
+{
+    return m_height;
+}
+
+
+/** Return the number of glyphs with no ink.
+ */
+int NeoFontAnalysis::emptyCount() const
+{
+    return m_empty;
+}
+
+
+/** Return the number of glyphs that have the same size and pixels as a lower numbered glyph.
+ */
+int NeoFontAnalysis::duplicateCount() const
+{
+    return m_duplicates;
+}
+
+
+/** Return the number of glyphs of a given width.
+ *
+ *  @param  width   The width, in pixels.
+ *  @return         The number of glyphs.
+ */
+unsigned int NeoFontAnalysis::widthCount(int width) const
+{
+    return (width >= 0 && width <= kNeoCharacterMaxWidth) ? m_widths[width] : 0;
+}
+
+
+/** Return the width of the narrowest glyph.
+ */
+int NeoFontAnalysis::minWidth() const
+{
+    for (int w = kNeoCharacterMinWidth; w <= kNeoCharacterMaxWidth; w++)
+    {
+        if (0 != m_widths[w]) return w;
+    }
+    return 0;
+}
+
+
+/** Return the width of the widest glyph.
+ */
+int NeoFontAnalysis::maxWidth() const
+{
+    for (int w = kNeoCharacterMaxWidth; w >= kNeoCharacterMinWidth; w--)
+    {
+        if (0 != m_widths[w]) return w;
+    }
+    return 0;
+}
+
+
+/** Return the first row holding ink in any glyph. Zero if no glyph has any ink.
+ */
+int NeoFontAnalysis::inkTop() const
+{
+    return m_inkTop;
+}
+
+
+/** Return the row following the last holding ink in any glyph. This is the smallest height that setHeight()
+ *  can be given without losing ink. Zero if no glyph has any ink.
+ */
+int NeoFontAnalysis::inkBottom() const
+{
+    return m_inkBottom;
+}
+
+
+/** Return the smallest height that would hold all of the ink if the glyphs were first moved up by inkTop()
+ *  rows.
+ */
+int NeoFontAnalysis::minimalHeight() const
+{
+    int h = m_inkBottom - m_inkTop;
+    return (h > kNeoCharacterMinHeight) ? h : kNeoCharacterMinHeight;
+}
+
+
+/** Return the number of bytes of glyph bitmaps in the applet.
+ */
+unsigned int NeoFontAnalysis::bitmapBytes() const
+{
+    return m_bitmapBytes;
+}
+
+
+/** Return the number of bytes of glyph bitmaps in the applet if the font had minimalHeight().
+ */
+unsigned int NeoFontAnalysis::minimalBitmapBytes() const
+{
+    unsigned int bytes = 0;
+    for (int i = 0; i < kNeoFontCharacterCount; i++) bytes += glyphBytes(m_glyphs[i].width, minimalHeight());
+    return bytes;
+}
+
+
+/** Return the size of the applet, as NeoFont::appletSize().
+ */
+unsigned int NeoFontAnalysis::appletSize() const
+{
+    return m_appletSize;
+}
+
+
+/** Return the number of bytes needed by encodeJSON().
+ */
+unsigned int NeoFontAnalysis::jsonSize() const
+{
+    return writeJSON(0, 0);
+}
+
+
+/** Write the analysis as a JSON object. The font fields and totals come first, followed by a "glyphs" array
+ *  with one object per glyph, one to a line.
+ *
+ *  @param  data    Receives the JSON text. This is not terminated.
+ *  @param  length  The size of the buffer.
+ *  @return         The number of bytes written, or zero if the buffer is too small.
+ */
+unsigned int NeoFontAnalysis::encodeJSON(char *data, unsigned int length) const
+{
+    unsigned int used = writeJSON(data, length);
+    return (used <= length) ? used : 0;
+}
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      NeoFontAnalysis private methods.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Find the glyphs that repeat a lower numbered glyph. The glyphs are interned in a NeoGlyphTable in
+ *  character order, so each distinct glyph is numbered in the order of its first character.
+ *
+ *  @param  font    The font.
+ */
+void NeoFontAnalysis::findDuplicates(const NeoFont *font)
+{
+    NeoGlyphTable table;
+    int first[kNeoFontCharacterCount];
+    m_duplicates = 0;
+    for (int i = 0; i < kNeoFontCharacterCount; i++)
+    {
+        unsigned int distinct = table.count();
+        int n = table.intern(font->character(i));
+        if (n == (int)distinct)
+        {
+            first[n] = i;
+        }
+        else
+        {
+            m_glyphs[i].duplicateOf = first[n];
+            m_duplicates++;
+        }
+    }
+}
+
+
+/** Write the analysis as JSON (see encodeJSON()).
+ *
+ *  @param  data    Receives the JSON text, or zero to only count it.
+ *  @param  length  The size of the buffer.
+ *  @return         The length of the JSON text. Nothing past the end of the buffer is written.
+ */
+unsigned int NeoFontAnalysis::writeJSON(char *data, unsigned int length) const
+{
+    NeoJSONOutput out = { data, length, 0 };
+    putJSON(&out, "{\n  \"fontName\": ");
+    putJSONString(&out, m_fontName);
+    putJSON(&out, ",\n  \"ident\": %d,\n  \"height\": %d,\n", m_ident, m_height);
+    putJSON(&out, "  \"inkTop\": %d,\n  \"inkBottom\": %d,\n  \"minimalHeight\": %d,\n", m_inkTop, m_inkBottom, minimalHeight());
+    putJSON(&out, "  \"emptyGlyphs\": %d,\n  \"duplicateGlyphs\": %d,\n", m_empty, m_duplicates);
+    putJSON(&out, "  \"minWidth\": %d,\n  \"maxWidth\": %d,\n  \"widthHistogram\": {", minWidth(), maxWidth());
+    const char *separator = "";
+    for (int w = kNeoCharacterMinWidth; w <= kNeoCharacterMaxWidth; w++)
+    {
+        if (0 == m_widths[w]) continue;
+        putJSON(&out, "%s\"%d\": %u", separator, w, m_widths[w]);
+        separator = ", ";
+    }
+    putJSON(&out, "},\n  \"appletSize\": %u,\n  \"bitmapBytes\": %u,\n  \"minimalBitmapBytes\": %u,\n",
+            m_appletSize, m_bitmapBytes, minimalBitmapBytes());
+    putJSON(&out, "  \"glyphs\": [\n");
+    for (int i = 0; i < kNeoFontCharacterCount; i++)
+    {
+        const NeoGlyphMetrics *m = &m_glyphs[i];
+        putJSON(&out, "    {\"code\": %d, \"width\": %d, \"ink\": %d, \"bounds\": [%d, %d, %d, %d], ", i, m->width, m->ink,
+                m->bounds.x0, m->bounds.y0, m->bounds.x1, m->bounds.y1);
+        putJSON(&out, "\"leftBearing\": %d, \"rightBearing\": %d, ", m->leftBearing, m->rightBearing);
+        if (kNeoGlyphUnique == m->duplicateOf) putJSON(&out, "\"duplicateOf\": null, ");
+        else putJSON(&out, "\"duplicateOf\": %d, ", m->duplicateOf);
+        putJSON(&out, "\"appletBytes\": %u}%s\n", m->appletBytes, (i + 1 < kNeoFontCharacterCount) ? "," : "");
+    }
+    putJSON(&out, "  ]\n}\n");
+    return out.used;
+}
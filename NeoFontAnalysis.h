@@ -0,0 +1,89 @@
+/** @file       NeoFontAnalysis.h
+ *  @brief      Glyph metrics and quality figures for a NeoFont.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+#ifndef _NEOFONTANALYSIS_H_
+#define _NEOFONTANALYSIS_H_ (1)
+
+#include <stdint.h>
+#include "NeoFont.h"
+
+
+#define kNeoGlyphUnique     (-1)        /**< NeoGlyphMetrics::duplicateOf for a glyph with no earlier copy. */
+
+
+/** Metrics for a single glyph. The ink is the set pixels. A glyph with no ink has an empty bounding box at
+ *  the origin, and bearings equal to zero and its width.
+ */
+struct NeoGlyphMetrics
+{
+    int width;                      /**< The advance width, in pixels. */
+    int ink;                        /**< The number of set pixels. */
+    NeoCharacterRect bounds;        /**< The bounding box of the ink. */
+    int leftBearing;                /**< Blank columns to the left of the ink. */
+    int rightBearing;               /**< Blank columns to the right of the ink. */
+    int duplicateOf;                /**< The lowest character with the same size and pixels, or kNeoGlyphUnique. */
+    unsigned int appletBytes;       /**< The bitmap bytes that the glyph adds to NeoFont::appletSize(). */
+};
+
+
+/** Class used to measure a font: the ink box and side bearings of each glyph, blank and duplicated glyphs,
+ *  the spread of widths, the rows used by any glyph (and so the smallest height that would keep all of the
+ *  ink), and what each glyph costs in the applet.
+ *
+ *  Each glyph is measured a row word at a time: the rows are or'ed together to find the columns holding ink,
+ *  whose first and last are found with bit scans, and the ink is counted with popcounts. The rows holding
+ *  ink are collected as bit masks, which are or'ed across the font to give its vertical extent.
+ */
+class NeoFontAnalysis
+{
+public:
+
+    NeoFontAnalysis();
+    ~NeoFontAnalysis();
+
+    void analyse(const NeoFont *font);
+
+    const NeoGlyphMetrics *glyph(int n) const;
+    int height() const;
+    int emptyCount() const;
+    int duplicateCount() const;
+    unsigned int widthCount(int width) const;
+    int minWidth() const;
+    int maxWidth() const;
+
+    int inkTop() const;
+    int inkBottom() const;
+    int minimalHeight() const;
+
+    unsigned int bitmapBytes() const;
+    unsigned int minimalBitmapBytes() const;
+    unsigned int appletSize() const;
+
+    unsigned int jsonSize() const;
+    unsigned int encodeJSON(char *data, unsigned int length) const;
+
+private:
+
+    NeoGlyphMetrics m_glyphs[kNeoFontCharacterCount];       /**< The metrics of each glyph. */
+    unsigned int m_widths[kNeoCharacterMaxWidth + 1];       /**< The number of glyphs of each width. */
+    char m_fontName[24];                                    /**< The font name. */
+    int m_ident;                    /**< The applet ID. */
+    int m_height;                   /**< The font height. */
+    int m_empty;                    /**< The number of glyphs with no ink. */
+    int m_duplicates;               /**< The number of glyphs that repeat an earlier glyph. */
+    int m_inkTop;                   /**< The first row holding ink in any glyph. */
+    int m_inkBottom;                /**< The row following the last holding ink in any glyph. */
+    unsigned int m_bitmapBytes;     /**< The bytes of bitmap data in the applet. */
+    unsigned int m_appletSize;      /**< The size of the applet. */
+
+    NeoFontAnalysis(const NeoFontAnalysis &other);
+    NeoFontAnalysis &operator=(const NeoFontAnalysis &other);
+
+    void findDuplicates(const NeoFont *font);
+    unsigned int writeJSON(char *data, unsigned int length) const;
+};
+
+
+
+#endif  // _NEOFONTANALYSIS_H_
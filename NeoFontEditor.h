@@ -6,11 +6,20 @@
 #import <Cocoa/Cocoa.h>
 #import "NeoCharacter.h"
 #import "NeoFont.h"
+#import "NeoUndoJournal.h"
+#import "NeoGlyphAtlas.h"
+#import "NeoFontSubscription.h"
+#import "NeoAppletEncoder.h"
+#import "NeoTransformEngine.h"
 
 /** Pastboard signature for character data.
  */
 #define kNeoFontEditorPboardType    @"NeoFontEditorCharacter"
 
+/** Pixel scale of the glyph images used by the navigation and preview views.
+ */
+#define kNeoFontEditorAtlasScale    (2)
+
 
 
 @interface NeoFontEditor : NSDocument
@@ -18,6 +27,16 @@
     /* Local data.
      */
     NeoFont *font;                  /**< The font. */
+    NeoUndoJournal *journal;        /**< Undo records for the font. */
+    NeoGlyphAtlas *atlas;           /**< Pre-scaled images of every character, redrawn as characters change. */
+    CGImageRef glyphImages[kNeoFontCharacterCount];     /**< Image masks made from the atlas, or zero if not yet made. */
+    NeoFontSubscription *changes;   /**< Changes to the font that are not yet shown. */
+    NeoAppletEncoder *encoder;      /**< The applet as last saved, updated incrementally on each save. */
+    NeoTransformEngine *transformer;    /**< Applies the "(all)" operations to every character in parallel. */
+    int displayedCharacter;         /**< The character number last shown, or -1 to force a complete redisplay. */
+    BOOL refreshFields;             /**< Logical true to reset every text field on the next redisplay. */
+    int strokeCount;                /**< The number of pixel strokes started. */
+    int stroke;                     /**< The current pixel stroke number, or zero if no stroke is in progress. */
     int characterNumber;            /**< The current character number. */
     NSFont *systemFont;             /**< Font context for load from system font. */
     unsigned proposedCustomIdent;   /**< Proposed custom applet ID. */
@@ -53,10 +72,14 @@
 - (int)characterNumber;
 - (void)setCharacterNumber:(int)n;
 - (void)redisplay;
-- (void)renderCharacter:(NeoCharacter*)ch context:(CGContextRef)con x:(float)x y:(float)y size:(float)size;
+- (CGImageRef)glyphImage:(int)n;
+- (void)renderCharacter:(int)n context:(CGContextRef)con x:(float)x y:(float)y size:(float)size;
 - (NSString*)previewString;
+- (NSData*)previewCodes;
 - (int)pixelInCharacter:(int)ch atX:(int)x y:(int)y;
 - (void)setPixelInCharacter:(int)ch atX:(int)x y:(int)y to:(int)v;
+- (void)beginStroke;
+- (void)endStroke;
 - (void)setIdent:(int)n;
 - (void)validateIdent;
 
@@ -4,11 +4,13 @@
  */
 
 #include <math.h>
+#include <string.h>
 #include <stdint.h>
 #import "NeoFontEditor.h"
 #import "FontConverter.h"
 #import "AppletID.h"
 #import "NeoCharacterEncoding.h"
+#import "NeoFrameBuffer.h"
 
 
 @implementation NeoFontEditor
@@ -20,6 +22,12 @@
     if ((self = [super init]))
     {
         font = new NeoFont;
+        journal = new NeoUndoJournal(font);
+        atlas = new NeoGlyphAtlas(font, kNeoFontEditorAtlasScale);
+        changes = new NeoFontSubscription(font);
+        encoder = new NeoAppletEncoder(font);
+        transformer = new NeoTransformEngine();
+        displayedCharacter = -1;
         characterNumber = 65;
         systemFont = [[NSFont systemFontOfSize:12.0] retain];
 
@@ -38,6 +46,21 @@
  */
 - (void)dealloc
 {
+    for (int i = 0; i < kNeoFontCharacterCount; i++)
+    {
+        if (0 != glyphImages[i]) CGImageRelease(glyphImages[i]);
+        glyphImages[i] = 0;
+    }
+    if (0 != transformer) delete transformer;
+    transformer = 0;
+    if (0 != encoder) delete encoder;
+    encoder = 0;
+    if (0 != changes) delete changes;
+    changes = 0;
+    if (0 != atlas) delete atlas;
+    atlas = 0;
+    if (0 != journal) delete journal;
+    journal = 0;
     if (0 != font) delete font;
     font = 0;
     [systemFont release];
@@ -120,6 +143,7 @@
         [item setTag:0];
     }
     
+    displayedCharacter = -1;
     [self redisplay];
 }
 
@@ -130,12 +154,10 @@
 {
     if ([typeName isEqualTo:@"OS3KApp"])
 	{
-		NSMutableData *data = [[NSMutableData alloc] init];
-		unsigned int length = font->appletSize();
-		[data setLength:length];
-		font->encodeApplet((uint8_t*)[data mutableBytes], [data length]);
+		unsigned int length = encoder->update();
+		NSData *data = [NSData dataWithBytes:encoder->data() length:length];
         if (error) *error = nil;
-	    return [data autorelease];
+	    return data;
 	}
 	else
 	{
@@ -175,6 +197,7 @@
             }
             [self validateIdent];
             [[self undoManager] removeAllActions];
+            journal->clear();
             [self redisplay];
             if (error) *error = nil;
             return YES;
@@ -216,70 +239,78 @@
 - (void)restoreCharacter:(int)ch from:(NSData *)data
 {
     NeoCharacter *character = font->character(ch);
-    character->loadArchive((const uint8_t*)[data bytes]);   // Restore the character
+    character->loadArchive((const uint8_t*)[data bytes], [data length]);    // Restore the character
 }
 
 
 
-/** Undo/redo handling for operations that require a single character to be archived.
+/** Start recording an operation in the undo journal. The affected characters are saved before they are
+ *  modified, and endUndo must be sent once the modification is complete. The undo manager is told of the
+ *  operation by endUndo, and only if it changed the font.
  *
- *  @param  ch      The character number.
- *  @param  data    The character object, encoded as NSData. Pass nil if setting up an initial undo request.
  *  @param  reason  Reason string used to update the undo manager.
+ *  @param  ch      The character number, or -1 if the operation may modify any part of the font.
+ *  @param  n       The pixel stroke number, or zero. Operations in the same stroke are undone together.
  */
-- (void)handleUndo:(NSData *)data reason:(NSString *)reason character:(int)ch
+- (void)beginUndo:(NSString *)reason character:(int)ch stroke:(int)n
 {
-    NeoCharacter *character = font->character(ch);
-
-    /* Archive and save the current character.
-     */
-    NSMutableData *originalData = [NSMutableData dataWithLength:character->archiveSize()];
-    character->saveArchive((uint8_t*)[originalData mutableBytes]);
-
-    /* Load the specified data, if present.
-     */
-    if (nil != data)
-    {
-        assert([data length] == character->archiveSize());
-        character->loadArchive((const uint8_t*)[data bytes]);   // Restore the character
-        [self setCharacterNumber:ch];                           // Select the target character
-        [self redisplay];                                       // Make sure that the display is updated
-    }
+    [self endUndo];
+    journal->begin([reason UTF8String], n);
 
-    /* Update the undo stack.
-     */
-    NSUndoManager *undo = [self undoManager];
-    [[undo prepareWithInvocationTarget:self] handleUndo:originalData reason:reason character:ch];
-    if (! [undo isUndoing])  [undo setActionName:reason];
+    if (ch >= 0) journal->saveCharacter(ch);
+    else journal->saveFont();
 }
 
 
-/** Undo/redo handling for operations that require the entire font to be archived..
+/** Start recording an operation in the undo journal.
  *
- *  @param  data    The character object, encoded as NSData. Pass nil if setting up an initial undo request.
  *  @param  reason  Reason string used to update the undo manager.
+ *  @param  ch      The character number, or -1 if the operation may modify any part of the font.
  */
-- (void)handleUndo:(NSData *)data reason:(NSString *)reason
+- (void)beginUndo:(NSString *)reason character:(int)ch
 {
-    /* Archive and save the current font.
-     */
-    NSMutableData *originalData = [NSMutableData dataWithLength:font->archiveSize()];
-    font->saveArchive((uint8_t*)[originalData mutableBytes]);
+    [self beginUndo:reason character:ch stroke:0];
+}
 
-    /* Load the specified data, if present.
-     */
-    if (nil != data)
+
+/** Complete the operation started by beginUndo. If the journal kept a new record, a matching action is
+ *  registered with the undo manager, so that the two undo stacks stay in step. Operations that changed
+ *  nothing, and pixel changes coalesced in to an earlier record of the same stroke, register nothing.
+ */
+- (void)endUndo
+{
+    if (journal->commit())
     {
-        assert([data length] == font->archiveSize());
-        font->loadArchive((const uint8_t*)[data bytes]);        // Restore the font
-        [self redisplay];                                       // Make sure that the display is updated
+        NSUndoManager *undo = [self undoManager];
+        [[undo prepareWithInvocationTarget:self] journalUndo];
+        if (! [undo isUndoing])  [undo setActionName:[NSString stringWithUTF8String:journal->undoReason()]];
     }
+}
 
-    /* Update the undo stack.
-     */
-    NSUndoManager *undo = [self undoManager];
-    [[undo prepareWithInvocationTarget:self] handleUndo:originalData reason:reason];
-    if (! [undo isUndoing])  [undo setActionName:reason];
+
+/** Undo the most recent journal record. Invoked by the undo manager.
+ */
+- (void)journalUndo
+{
+    if (journal->undo())
+    {
+        NSUndoManager *undo = [self undoManager];
+        [[undo prepareWithInvocationTarget:self] journalRedo];
+        [self redisplay];
+    }
+}
+
+
+/** Redo the most recently undone journal record. Invoked by the undo manager.
+ */
+- (void)journalRedo
+{
+    if (journal->redo())
+    {
+        NSUndoManager *undo = [self undoManager];
+        [[undo prepareWithInvocationTarget:self] journalUndo];
+        [self redisplay];
+    }
 }
 
 
@@ -309,17 +340,16 @@
 {
     if (ch >= 0)
     {
-        [self handleUndo:nil reason:@"set character width" character:ch];
+        [self beginUndo:@"set character width" character:ch];
         font->character(ch)->setWidth(w);
     }
     else
     {
-        [self handleUndo:nil reason:@"set character width (all)"];
-        for (unsigned i = 0; i < kNeoFontCharacterCount; i++)
-        {
-            font->character(i)->setWidth(w);
-        }
+        [self beginUndo:@"set character width (all)" character:-1];
+        NeoTransform t = { kNeoTransformSetWidth, w, 0 };
+        transformer->transform(font, 0, t);
     }
+    [self endUndo];
 
     [self redisplay];    
 }
@@ -334,17 +364,16 @@
 {
     if (ch >= 0)
     {
-        [self handleUndo:nil reason:@"adjust character width" character:ch];
+        [self beginUndo:@"adjust character width" character:ch];
         font->character(ch)->setWidth(font->character(ch)->width() + delta);
     }
     else
     {
-        [self handleUndo:nil reason:@"adjust character width (all)"];
-        for (unsigned i = 0; i < kNeoFontCharacterCount; i++)
-        {
-            font->character(i)->setWidth(font->character(i)->width() + delta);
-        }
+        [self beginUndo:@"adjust character width (all)" character:-1];
+        NeoTransform t = { kNeoTransformWidthDelta, delta, 0 };
+        transformer->transform(font, 0, t);
     }
+    [self endUndo];
 
     [self redisplay];    
 }
@@ -366,8 +395,9 @@
  */
 - (void)setFontHeight:(int)h
 {
-    [self handleUndo:nil reason:@"set font height"];
+    [self beginUndo:@"set font height" character:-1];
     font->setHeight(h);
+    [self endUndo];
     [self redisplay];    
 }
 
@@ -519,27 +549,19 @@
 {
     if (ch >= 0)
     {
-        [self handleUndo:nil reason:@"bold" character:ch];
+        [self beginUndo:@"bold" character:characterNumber];
 
-        NeoCharacter *character = font->character(characterNumber);    
-        character->setWidth(character->width() + 1);
-        character->transformBold();
+        font->character(characterNumber)->transformBold();
     }
     else
     {
-        [self handleUndo:nil reason:@"bold (all)"];
-
-        for (unsigned i = 0; i < kNeoFontCharacterCount; i++)
-        {
-            NeoCharacter *character = font->character(i);    
-            character->setWidth(character->width() + 1);
-            character->transformBold();
-        }
+        [self beginUndo:@"bold (all)" character:-1];
+        NeoTransform t = { kNeoTransformBold, 0, 0 };
+        transformer->transform(font, 0, t);
     }
+    [self endUndo];
 
-    [pixelEditor setNeedsDisplay:YES];
-    [navView setNeedsDisplay:YES];
-    [previewView setNeedsDisplay:YES];
+    [self redisplay];
 }
 
 
@@ -562,15 +584,11 @@
     }
     else
     {
-        for (unsigned i = 0; i < kNeoFontCharacterCount; i++)
-        {
-            font->character(i)->transformTranslate(dx, dy);
-        }
+        NeoTransform t = { kNeoTransformTranslate, dx, dy };
+        transformer->transform(font, 0, t);
     }
 
-    [pixelEditor setNeedsDisplay:YES];
-    [navView setNeedsDisplay:YES];
-    [previewView setNeedsDisplay:YES];
+    [self redisplay];
 }
 
 
@@ -590,15 +608,11 @@
     }
     else
     {
-        for (unsigned i = 0; i < kNeoFontCharacterCount; i++)
-        {
-            font->character(i)->transformFlipH();
-        }
+        NeoTransform t = { kNeoTransformFlipH, 0, 0 };
+        transformer->transform(font, 0, t);
     }
 
-    [pixelEditor setNeedsDisplay:YES];
-    [navView setNeedsDisplay:YES];
-    [previewView setNeedsDisplay:YES];
+    [self redisplay];
 }
 
 /** Flip the character vertically.
@@ -615,15 +629,11 @@
     }
     else
     {
-        for (unsigned i = 0; i < kNeoFontCharacterCount; i++)
-        {
-            font->character(i)->transformFlipV();
-        }
+        NeoTransform t = { kNeoTransformFlipV, 0, 0 };
+        transformer->transform(font, 0, t);
     }
 
-    [pixelEditor setNeedsDisplay:YES];
-    [navView setNeedsDisplay:YES];
-    [previewView setNeedsDisplay:YES];
+    [self redisplay];
 }
 
 
@@ -653,20 +663,31 @@
     assert(ch >= 0 && ch < kNeoFontCharacterCount);
 
     NeoCharacter *character = font->character(ch);
-    
-    NSUndoManager *undo = [self undoManager];
-    [[undo prepareWithInvocationTarget:self] setPixelInCharacter:ch atX:x y:y to:[self pixelInCharacter:ch atX:x y:y]];
-    if (! [undo isUndoing]) 
-    {
-        if (v < 0) [undo setActionName:@"toggle pixel"];
-        else if (v == 0) [undo setActionName:@"clear pixel"];
-        else [undo setActionName:@"set pixel"];
-    }
+
+    if (v < 0) [self beginUndo:@"toggle pixel" character:ch stroke:stroke];
+    else if (v == 0) [self beginUndo:@"clear pixel" character:ch stroke:stroke];
+    else [self beginUndo:@"set pixel" character:ch stroke:stroke];
     character->changePixel(x, y, v);
+    [self endUndo];
 
-    [pixelEditor setNeedsDisplay:YES];
-    [navView setNeedsDisplay:YES];
-    [previewView setNeedsDisplay:YES];
+    [self redisplay];
+}
+
+
+/** Start a pixel stroke. Pixel changes made before the matching endStroke are undone as a single operation.
+ */
+- (void)beginStroke
+{
+    [self endUndo];
+    stroke = ++strokeCount;
+}
+
+
+/** End the current pixel stroke.
+ */
+- (void)endStroke
+{
+    stroke = 0;
 }
 
 
@@ -707,6 +728,7 @@
 - (IBAction)actionCharacterWidthSet:(id)sender
 {
     int w = [characterWidthTextField intValue];
+    refreshFields = YES;
     if (![globalEditSwitch intValue])
     {
         [self setCharacter:characterNumber width:w];
@@ -737,6 +759,7 @@
  */
 - (IBAction)actionFontHeightSet:(id)sender
 {
+    refreshFields = YES;
     [self setFontHeight:[fontHeightTextField intValue]];
 }
 
@@ -757,22 +780,19 @@
 }
 
 
-/** Goto a character from an ASCII code.
+/** Goto the character that shows the character typed in the ASCII field. Characters with no Neo glyph
+ *  leave the current character unchanged.
  */
 - (IBAction)actionGotoCharacterASCII:(id)sender
 {
-	NSData *encoded_data = [[characterCodeASCII stringValue] dataUsingEncoding:NSWindowsCP1252StringEncoding allowLossyConversion:YES];
-	unsigned int len = [encoded_data length];
-	int n;
-	if (len > 0)
-	{
-		n = * ((unsigned char*) [encoded_data bytes]);
-	}
-	else
+	NSString *typed = [characterCodeASCII stringValue];
+	int n = ([typed length] > 0) ? NeoCharacterFromUnicode([typed characterAtIndex:0]) : kNeoCharacterNotMapped;
+	if (kNeoCharacterNotMapped == n)
 	{
 		n = [self characterNumber];
 	}
 		
+    refreshFields = YES;
     [self setCharacterNumber:n];
 }
 
@@ -784,6 +804,7 @@
     const char *str = [[characterCodeHEX stringValue] UTF8String];
     int n = characterNumber;
     sscanf(str, "%x", &n);
+    refreshFields = YES;
     [self setCharacterNumber:n];
 }
 
@@ -792,6 +813,7 @@
  */
 - (IBAction)actionGotoCharacterDEC:(id)sender
 {
+    refreshFields = YES;
     [self setCharacterNumber:[characterCodeDEC intValue]];
 }
 
@@ -800,6 +822,7 @@
  */
 - (IBAction)actionAppletInfo:(id)sender
 {
+    refreshFields = YES;
     [self setAppletInfo:[appletInfoTextField stringValue]];
 }
 
@@ -807,6 +830,7 @@
  */
 - (IBAction)actionFontName:(id)sender
 {
+    refreshFields = YES;
     [self setFontName:[fontNameTextField stringValue]];
 }
 
@@ -814,6 +838,7 @@
  */
 - (IBAction)actionVersion:(id)sender
 {
+    refreshFields = YES;
     [self setVersion:[versionTextField stringValue]];
 }
 
@@ -911,6 +936,7 @@
  */
 - (IBAction)actionPreviewText:(id)sender
 {
+    [previewView setNeedsDisplay:YES];
     [self redisplay];
 }
 
@@ -933,8 +959,9 @@
 - (IBAction)cut:(id)sender
 {
     [self copy:sender];
-    [self handleUndo:nil reason:@"cut" character:characterNumber];
+    [self beginUndo:@"cut" character:characterNumber];
     font->character(characterNumber)->clear();
+    [self endUndo];
     [self redisplay];
 }
 
@@ -962,23 +989,28 @@
     {
         NeoCharacter ch;
         NSData *value = [pb dataForType:kNeoFontEditorPboardType];
-        ch.loadArchive((const uint8_t*)[value bytes]);
-
-        if (ch.height() <= font->height())
+        if (!ch.loadArchive((const uint8_t*)[value bytes], [value length]))
         {
-            // The character is shorter or the same height as the current font.
-            [self handleUndo:nil reason:@"paste" character:characterNumber];
-            ch.setHeight(font->height());
-
+            NSBeep();
         }
         else
         {
-            // The character is taller than the current font height. Resize the font to accomodate.
-            [self handleUndo:nil reason:@"paste"];
-            font->setHeight(ch.height());
-        }
+            if (ch.height() <= font->height())
+            {
+                // The character is shorter or the same height as the current font.
+                [self beginUndo:@"paste" character:characterNumber];
+                ch.setHeight(font->height());
+            }
+            else
+            {
+                // The character is taller than the current font height. Resize the font to accomodate.
+                [self beginUndo:@"paste" character:-1];
+                font->setHeight(ch.height());
+            }
 
-        *font->character(characterNumber) = ch;
+            *font->character(characterNumber) = ch;
+            [self endUndo];
+        }
     }
 
     [self redisplay];
@@ -1024,11 +1056,36 @@
 }
 
 
-/** Method invoked to perform any redraws that have been requested.
+/** Return the preview string as Neo character codes. Characters with no Neo glyph are shown as '?'.
+ */
+- (NSData*)previewCodes
+{
+    const char *text = [[self previewString] UTF8String];
+    unsigned int length = strlen(text);
+    NSMutableData *codes = [NSMutableData dataWithLength:(length + kNeoTranscodeSlack)];
+    uint8_t *out = (uint8_t *) [codes mutableBytes];
+    NeoUTF8Transcoder transcoder('?');
+    unsigned int count = transcoder.transcode((const uint8_t *) text, length, out);
+    count += transcoder.finish(&out[count]);
+    [codes setLength:count];
+    return codes;
+}
+
+
+/** Method invoked to perform any redraws that have been requested. Only the text fields and views that
+ *  depend on what has changed since the last call (font fields, characters or the current character
+ *  number) are updated. Set displayedCharacter to -1 to update everything.
  */
 - (void)redisplay
 {
-    // Display the applet ID
+    BOOL everything = (displayedCharacter < 0);
+    BOOL newCharacter = (characterNumber != displayedCharacter);
+    BOOL allFields = everything || refreshFields;
+    unsigned int fields = allFields ? kNeoFontFieldAll : changes->fields();
+    displayedCharacter = characterNumber;
+    refreshFields = NO;
+
+    // Display the applet ID. This is always done, as the menu may show a selection that was not applied.
     int appletID = [self ident];
     int index = [identButton indexOfItemWithTag:appletID];
     if (index < 0)
@@ -1041,77 +1098,142 @@
     [identButton selectItemAtIndex:index];
 
     // Display the text fields in the applet
-    [appletInfoTextField setStringValue:[NSString stringWithUTF8String:font->appletInfo()]];
-    [fontNameTextField setStringValue:[NSString stringWithUTF8String:font->fontName()]];
-    [versionTextField setStringValue:[NSString stringWithUTF8String:font->version()]];
-    [appletNameTextField setStringValue:[self appletName]];
+    if (0 != (fields & kNeoFontFieldAppletInfo)) [appletInfoTextField setStringValue:[NSString stringWithUTF8String:font->appletInfo()]];
+    if (0 != (fields & kNeoFontFieldFontName)) [fontNameTextField setStringValue:[NSString stringWithUTF8String:font->fontName()]];
+    if (0 != (fields & kNeoFontFieldVersion)) [versionTextField setStringValue:[NSString stringWithUTF8String:font->version()]];
+    if (0 != (fields & kNeoFontFieldAppletName)) [appletNameTextField setStringValue:[self appletName]];
 
     // Show the number of lines that will be displayed and the unused space at the bottom of the screen
-    int linesOccupied = 66 / [self fontHeight];       // Magic number: pixel height of Neo screen
-    int unusedPixels = 66 % [self fontHeight];
-    NSString *line = [NSString stringWithFormat:@"%d line%s / %d pixel%s", linesOccupied, (linesOccupied != 1 ? "s" : ""), unusedPixels, (unusedPixels != 1 ? "s" : "")];
-    [fontLinesTextField setStringValue:line];
+    if (0 != (fields & kNeoFontFieldHeight))
+    {
+        int linesOccupied = kNeoScreenHeight / [self fontHeight];
+        int unusedPixels = kNeoScreenHeight % [self fontHeight];
+        NSString *line = [NSString stringWithFormat:@"%d line%s / %d pixel%s", linesOccupied, (linesOccupied != 1 ? "s" : ""), unusedPixels, (unusedPixels != 1 ? "s" : "")];
+        [fontLinesTextField setStringValue:line];
+        [fontHeightTextField setIntValue:[self fontHeight]];
+    }
 
-    // Show the current character width and font height
-    [characterWidthTextField setIntValue:font->character(characterNumber)->width()];
-    [fontHeightTextField setIntValue:[self fontHeight]];
+    // Show the current character width
+    BOOL characterChanged = everything || newCharacter || changes->isDirty(characterNumber);
+    if (characterChanged || allFields) [characterWidthTextField setIntValue:font->character(characterNumber)->width()];
 
     // Show the current character number. To allow the Mac encoding to function we need to
     // remap some of the control characters in CP1252.
-    uint16_t utf16 = NeoCharacterToUTF16(characterNumber);
-    CFStringRef ascii = CFStringCreateWithBytes(NULL, (const UInt8*)&utf16, sizeof utf16, kCFStringEncodingUnicode, false);
-    NSString *dec = [NSString stringWithFormat:@"%d", characterNumber];
-    NSString *hex = [NSString stringWithFormat:@"%02x", characterNumber];
+    if (allFields || newCharacter)
+    {
+        uint16_t utf16 = NeoCharacterToUTF16(characterNumber);
+        CFStringRef ascii = CFStringCreateWithBytes(NULL, (const UInt8*)&utf16, sizeof utf16, kCFStringEncodingUnicode, false);
+        NSString *dec = [NSString stringWithFormat:@"%d", characterNumber];
+        NSString *hex = [NSString stringWithFormat:@"%02x", characterNumber];
 
-    [characterCodeASCII setStringValue:(NSString*)ascii];
-    [characterCodeDEC setStringValue:dec];
-    [characterCodeHEX setStringValue:hex];
+        [characterCodeASCII setStringValue:(NSString*)ascii];
+        [characterCodeDEC setStringValue:dec];
+        [characterCodeHEX setStringValue:hex];
 
-    CFRelease(ascii);
-    ascii = 0;
+        CFRelease(ascii);
+        ascii = 0;
+    }
 
-    // Request redraws for the bit-maps and previews.
-    [pixelEditor setNeedsDisplay:YES];
-    [navView setNeedsDisplay:YES];
-    [previewView setNeedsDisplay:YES];
+    // Request redraws for the bit-maps and previews that show a changed character. The navigation view
+    // shows up to 32 characters either side of the current one, and the preview shows the preview text.
+    BOOL navChanged = everything || newCharacter;
+    for (int n = changes->nextDirty(0); !navChanged && n >= 0; n = changes->nextDirty(n + 1))
+    {
+        int distance = (n - characterNumber + kNeoFontCharacterCount) % kNeoFontCharacterCount;
+        if (distance <= 32 || distance >= kNeoFontCharacterCount - 32) navChanged = YES;
+    }
+
+    BOOL previewChanged = everything;
+    if (!previewChanged && !changes->isEmpty())
+    {
+        NSData *encoded_data = [self previewCodes];
+        const unsigned char *text = (const unsigned char *) [encoded_data bytes];
+        for (NSUInteger i = 0; !previewChanged && i < [encoded_data length]; i++)
+        {
+            if (changes->isDirty(text[i])) previewChanged = YES;
+        }
+    }
+
+    if (characterChanged) [pixelEditor setNeedsDisplay:YES];
+    if (navChanged) [navView setNeedsDisplay:YES];
+    if (previewChanged) [previewView setNeedsDisplay:YES];
+    changes->clear();
 
     // On any redraw give the character panel focus.
     [editorWindow makeFirstResponder:pixelEditor];
 }
 
 
-/** Method used to render a character on to a graphics context. Only set pixels are drawn. This could
- *  be re-written to be a lot faster.
+/** Obtain an image mask for a character, made from the glyph atlas. Any characters that have changed
+ *  since the last call are first redrawn in the atlas, and their old images discarded.
+ *
+ *  The mask is (width() * kNeoFontEditorAtlasScale) by (height() * kNeoFontEditorAtlasScale) pixels,
+ *  with the top row first. Set pixels are painted and clear pixels are masked out.
+ *
+ *  @param  n           The character number.
+ *  @return             The image, or zero if the character number is not valid. The image is owned by the
+ *                      editor and remains valid until the character next changes.
+ */
+- (CGImageRef)glyphImage:(int)n
+{
+    uint64_t updated[kNeoFontCharacterSetWords];
+    if (0 != atlas->update(updated))
+    {
+        for (int i = 0; i < kNeoFontCharacterCount; i++)
+        {
+            if (0 != glyphImages[i] && 0 != ((updated[i / 64] >> (i & 63)) & 1))
+            {
+                CGImageRelease(glyphImages[i]);
+                glyphImages[i] = 0;
+            }
+        }
+    }
+
+    NeoCharacter *ch = font->character(n);
+    if (0 == ch) return 0;
+    if (0 == glyphImages[n])
+    {
+        // Copy the character out of its cell, so that the image does not depend on the atlas memory
+        int image_width = ch->width() * atlas->scale();
+        int image_height = atlas->cellHeight();
+        const uint8_t *cell = atlas->glyph(n);
+        CFMutableDataRef data = CFDataCreateMutable(NULL, image_width * image_height);
+        for (int j = 0; j < image_height; j++) CFDataAppendBytes(data, &cell[j * atlas->width()], image_width);
+
+        // An image mask sample of one blocks painting, so invert the atlas values (255 for a set pixel)
+        static const CGFloat decode[2] = { 1.0, 0.0 };
+        CGDataProviderRef provider = CGDataProviderCreateWithCFData(data);
+        glyphImages[n] = CGImageMaskCreate(image_width, image_height, 8, 8, image_width, provider, decode, false);
+        CGDataProviderRelease(provider);
+        CFRelease(data);
+    }
+    return glyphImages[n];
+}
+
+
+/** Method used to render a character on to a graphics context. Only set pixels are drawn.
  *
  *  The current drawing colour is used.
  *  Only 'set' pixels are rendered. 'clear' pixels leave the background
- *  untouched.
+ *  untouched. The character is drawn as a single image taken from the glyph atlas, so
+ *  unchanged characters are not rebuilt from their pixels on every redraw.
  *
  *  The character is plotted on a matix of size*width() by size*height().
  *
- *  @param  ch          The character object to render.
+ *  @param  n           The number of the character to render.
  *  @param  con         The graphics context.
  *  @param  x           Coordinate for upper left point in display.
  *  @param  y           Coordinate for upper left point in display.
  *  @param  size        The pixel size.
  */
-- (void)renderCharacter:(NeoCharacter*)ch context:(CGContextRef)con x:(float)x y:(float)y size:(float)size
+- (void)renderCharacter:(int)n context:(CGContextRef)con x:(float)x y:(float)y size:(float)size
 {
-    const int ch_width = ch->width();
-    const int ch_height = ch->height();
-    CGRect pixel_rect = CGRectMake(0, 0, size, size);
-
-    for (unsigned int i = 0; i < ch_width; i++)
+    CGImageRef image = [self glyphImage:n];
+    if (0 != image)
     {
-        for (unsigned int j = 0; j < ch_height; j++)
-        {
-            if (ch->getPixel(i, (ch_height - 1 - j)))
-            {
-                pixel_rect.origin.x = x + (i * size);
-                pixel_rect.origin.y = y + (j * size);
-                CGContextFillRect(con, pixel_rect);
-            }
-        }
+        NeoCharacter *ch = font->character(n);
+        CGContextSetInterpolationQuality(con, kCGInterpolationNone);
+        CGContextDrawImage(con, CGRectMake(x, y, ch->width() * size, ch->height() * size), image);
     }
 }
 
@@ -1131,11 +1253,12 @@
 	
     if (nil != newFont)
     {
-        [self handleUndo:nil reason:@"Load system font"];
+        [self beginUndo:@"Load system font" character:-1];
         systemFont = [newFont retain];
         [oldFont release];
         
         [FontConverter loadFont:font from:systemFont];
+        [self endUndo];
     }
 
     [self redisplay];
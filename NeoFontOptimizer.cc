@@ -0,0 +1,376 @@
+/** @file       NeoFontOptimizer.cc
+ *  @brief      Trimming of blank columns and rows from a NeoFont, to reduce the applet size.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+
+#include <stdint.h>
+#include "NeoFontOptimizer.h"
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      Private Functions.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Return the number of 8-row strips, and so bytes per column, used by a glyph bitmap in the applet.
+ *
+ *  @param  height  The font height, in pixels.
+ *  @return         The number of strips.
+ */
+static int strips(int height)
+{
+    return (height + 7) / 8;
+}
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      NeoFontOptimizer class definition.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Class constructor. By default side bearings are trimmed to no columns on the left and one on the right,
+ *  glyphs with no ink are left alone, and the height is lowered to the last row holding ink.
+ */
+NeoFontOptimizer::NeoFontOptimizer()
+    :
+        m_leftBearing(0),
+        m_rightBearing(1),
+        m_blankWidth(kNeoTrimKeep),
+        m_heightMode(kNeoTrimHeightTight),
+        m_raise(false),
+        m_height(0),
+        m_raised(0),
+        m_trimmed(0),
+        m_columns(0),
+        m_bitmapBytes(0),
+        m_appletSize(0)
+{
+    for (int i = 0; i < kNeoFontCharacterCount; i++)
+    {
+        m_widths[i] = 0;
+        m_shifts[i] = 0;
+    }
+}
+
+
+/** Destructor.
+ */
+NeoFontOptimizer::~NeoFontOptimizer()
+{
+    // Nothing.
+}
+
+
+/** Set the most blank columns kept either side of the ink of each glyph.
+ *
+ *  @param  left    The columns kept to the left, or kNeoTrimKeep to leave the left bearings unchanged.
+ *  @param  right   The columns kept to the right, or kNeoTrimKeep to leave the right bearings unchanged.
+ */
+void NeoFontOptimizer::setBearings(int left, int right)
+{
+    m_leftBearing = (left < 0) ? kNeoTrimKeep : left;
+    m_rightBearing = (right < 0) ? kNeoTrimKeep : right;
+}
+
+
+/** Set the width to which glyphs with no ink, such as the space, are narrowed.
+ *
+ *  @param  w       The width, in pixels, or kNeoTrimKeep to leave blank glyphs unchanged.
+ */
+void NeoFontOptimizer::setBlankWidth(int w)
+{
+    if (w < 0) m_blankWidth = kNeoTrimKeep;
+    else m_blankWidth = (w < kNeoCharacterMinWidth) ? kNeoCharacterMinWidth : w;
+}
+
+
+/** Set how the font height is lowered.
+ *
+ *  @param  mode    kNeoTrimHeightKeep, kNeoTrimHeightTight or kNeoTrimHeightStrip.
+ */
+void NeoFontOptimizer::setHeightMode(int mode)
+{
+    m_heightMode = (kNeoTrimHeightTight == mode || kNeoTrimHeightStrip == mode) ? mode : kNeoTrimHeightKeep;
+}
+
+
+/** Set whether the ink may be moved up, in to rows that are blank in every glyph, when lowering the height.
+ *
+ *  @param  raise   Logical true to allow the ink to move.
+ */
+void NeoFontOptimizer::setRaise(bool raise)
+{
+    m_raise = raise;
+}
+
+
+/** Return the most blank columns kept to the left of the ink, or kNeoTrimKeep.
+ */
+int NeoFontOptimizer::leftBearing() const
+{
+    return m_leftBearing;
+}
+
+
+/** Return the most blank columns kept to the right of the ink, or kNeoTrimKeep.
+ */
+int NeoFontOptimizer::rightBearing() const
+{
+    return m_rightBearing;
+}
+
+
+/** Return the width to which glyphs with no ink are narrowed, or kNeoTrimKeep.
+ */
+int NeoFontOptimizer::blankWidth() const
+{
+    return m_blankWidth;
+}
+
+
+/** Return how the font height is lowered (kNeoTrimHeightKeep etc).
+ */
+int NeoFontOptimizer::heightMode() const
+{
+    return m_heightMode;
+}
+
+
+/** Return logical true if the ink may be moved up when lowering the height.
+ */
+bool NeoFontOptimizer::raise() const
+{
+    return m_raise;
+}
+
+
+/** Work out the changes that would be made to a font, without changing it. The results are read with
+ *  width(), heightAfter(), savedBytes() and so on.
+ *
+ *  @param  font    The font.
+ */
+void NeoFontOptimizer::plan(const NeoFont *font)
+{
+    m_analysis.analyse(font);
+    planHeight();
+
+    m_trimmed = 0;
+    m_columns = 0;
+    m_bitmapBytes = 0;
+    for (int i = 0; i < kNeoFontCharacterCount; i++)
+    {
+        const NeoGlyphMetrics *m = m_analysis.glyph(i);
+        int w = m->width;
+        int shift = 0;
+        if (0 == m->ink)
+        {
+            if (kNeoTrimKeep != m_blankWidth && w > m_blankWidth) w = m_blankWidth;
+        }
+        else
+        {
+            int left = m->leftBearing;
+            int right = m->rightBearing;
+            if (kNeoTrimKeep != m_leftBearing && left > m_leftBearing)
+            {
+                shift = left - m_leftBearing;
+                left = m_leftBearing;
+            }
+            if (kNeoTrimKeep != m_rightBearing && right > m_rightBearing) right = m_rightBearing;
+            w = left + (m->bounds.x1 - m->bounds.x0) + right;
+        }
+        if (w != m->width)
+        {
+            m_trimmed++;
+            m_columns += m->width - w;
+        }
+        m_widths[i] = w;
+        m_shifts[i] = shift;
+        m_bitmapBytes += w * strips(m_height);
+    }
+    m_appletSize = font->appletSizeForBitmap(m_bitmapBytes);
+}
+
+
+/** Plan the changes to a font (see plan()) and make them. Subscribers to the font receive the changes
+ *  together, and if there is an undo journal they are recorded as a single undo record.
+ *
+ *  @param  font    The font to change.
+ *  @param  journal The undo journal for the font, or zero.
+ */
+void NeoFontOptimizer::apply(NeoFont *font, NeoUndoJournal *journal)
+{
+    plan(font);
+
+    if (0 != journal)
+    {
+        journal->begin("optimise font");
+        journal->saveFont();
+    }
+    font->beginChanges();
+    for (int i = 0; i < kNeoFontCharacterCount; i++)
+    {
+        NeoCharacter *c = font->character(i);
+        int dy = (0 == m_analysis.glyph(i)->ink) ? 0 : m_raised;
+        if (0 != m_shifts[i] || 0 != dy) c->transformTranslate(-m_shifts[i], -dy);     // Blank pixels wrap round
+        if (m_widths[i] != c->width()) c->setWidth(m_widths[i]);
+    }
+    if (m_height != font->height()) font->setHeight(m_height);
+    font->endChanges();
+    if (0 != journal) journal->commit();
+}
+
+
+/** Return the planned width of a glyph.
+ *
+ *  @param  n       The character number.
+ *  @return         The width, in pixels, or zero if n is out of range.
+ */
+int NeoFontOptimizer::width(int n) const
+{
+    return (n >= 0 && n < kNeoFontCharacterCount) ? m_widths[n] : 0;
+}
+
+
+/** Return the planned move left of a glyph, which trims its left bearing.
+ *
+ *  @param  n       The character number.
+ *  @return         The move, in pixels, or zero if n is out of range.
+ */
+int NeoFontOptimizer::shift(int n) const
+{
+    return (n >= 0 && n < kNeoFontCharacterCount) ? m_shifts[n] : 0;
+}
+
+
+/** Return the height of the font planned.
+ */
+int NeoFontOptimizer::heightBefore() const
+{
+    return m_analysis.height();
+}
+
+
+/** Return the planned font height.
+ */
+int NeoFontOptimizer::heightAfter() const
+{
+    return m_height;
+}
+
+
+/** Return the planned move up of the ink, in pixels.
+ */
+int NeoFontOptimizer::rowsRaised() const
+{
+    return m_raised;
+}
+
+
+/** Return the number of 8-row strips (bytes per column) used by the font planned.
+ */
+int NeoFontOptimizer::stripsBefore() const
+{
+    return strips(m_analysis.height());
+}
+
+
+/** Return the number of 8-row strips (bytes per column) used after the planned changes.
+ */
+int NeoFontOptimizer::stripsAfter() const
+{
+    return strips(m_height);
+}
+
+
+/** Return the number of glyphs whose width is planned to change.
+ */
+int NeoFontOptimizer::trimmedCount() const
+{
+    return m_trimmed;
+}
+
+
+/** Return the total number of columns planned to be removed from the glyphs.
+ */
+int NeoFontOptimizer::columnsRemoved() const
+{
+    return m_columns;
+}
+
+
+/** Return the bytes of glyph bitmaps in the applet of the font planned.
+ */
+unsigned int NeoFontOptimizer::bitmapBytesBefore() const
+{
+    return m_analysis.bitmapBytes();
+}
+
+
+/** Return the bytes of glyph bitmaps in the applet after the planned changes.
+ */
+unsigned int NeoFontOptimizer::bitmapBytesAfter() const
+{
+    return m_bitmapBytes;
+}
+
+
+/** Return the applet size of the font planned.
+ */
+unsigned int NeoFontOptimizer::appletSizeBefore() const
+{
+    return m_analysis.appletSize();
+}
+
+
+/** Return the applet size after the planned changes.
+ */
+unsigned int NeoFontOptimizer::appletSizeAfter() const
+{
+    return m_appletSize;
+}
+
+
+/** Return the number of bytes the planned changes save in the applet.
+ */
+unsigned int NeoFontOptimizer::savedBytes() const
+{
+    return m_analysis.appletSize() - m_appletSize;
+}
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      NeoFontOptimizer private methods.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Plan the font height and the move up of the ink, from the analysis.
+ */
+void NeoFontOptimizer::planHeight()
+{
+    int height = m_analysis.height();
+    int top = m_analysis.inkTop();
+    int bottom = m_analysis.inkBottom();
+    m_height = height;
+    m_raised = 0;
+    if (kNeoTrimHeightKeep == m_heightMode || 0 == bottom) return;             // Nothing to do, or no ink to keep
+
+    int rows = m_raise ? (bottom - top) : bottom;
+    int target = rows;
+    if (kNeoTrimHeightStrip == m_heightMode)
+    {
+        target = strips(rows) * 8;                                              // Keep the rest of the last strip
+        if (target > height) target = height;
+    }
+    if (target < kNeoCharacterMinHeight) target = kNeoCharacterMinHeight;
+    m_raised = (bottom > target) ? (bottom - target) : 0;                       // Move up only as far as needed
+    m_height = target;
+}
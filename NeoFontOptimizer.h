@@ -0,0 +1,97 @@
+/** @file       NeoFontOptimizer.h
+ *  @brief      Trimming of blank columns and rows from a NeoFont, to reduce the applet size.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+#ifndef _NEOFONTOPTIMIZER_H_
+#define _NEOFONTOPTIMIZER_H_    (1)
+
+#include <stdint.h>
+#include "NeoFont.h"
+#include "NeoFontAnalysis.h"
+#include "NeoUndoJournal.h"
+
+
+#define kNeoTrimKeep                (-1)    /**< Bearing or blank width that leaves the glyphs unchanged. */
+
+#define kNeoTrimHeightKeep          (0)     /**< Leave the font height unchanged. */
+#define kNeoTrimHeightTight         (1)     /**< Lower the height to the last row holding ink. */
+#define kNeoTrimHeightStrip         (2)     /**< Lower the height only by whole 8-row strips. */
+
+
+/** Class used to make a font smaller in the applet without losing any ink. Each glyph costs its width times
+ *  ((height + 7) / 8) bytes, so blank columns cost a byte for every strip of eight rows, and each strip
+ *  removed from the height saves a byte in every column of the font.
+ *
+ *  Glyphs with ink have their side bearings trimmed to at most the configured number of blank columns
+ *  (bearings are never widened). Glyphs with no ink may be given a fixed width. The height may be lowered
+ *  to the tightest value that keeps all of the ink (kNeoTrimHeightTight), or only to the end of the strip
+ *  holding the last ink (kNeoTrimHeightStrip), which saves the same bytes while keeping as much of the
+ *  line spacing as costs nothing. If raising is enabled, the ink is also moved up in to blank rows at the
+ *  top of the font when this lowers the height further.
+ *
+ *  plan() works out the changes from a NeoFontAnalysis without touching the font, so the savings can be
+ *  reported before anything is changed; apply() plans and then makes the changes.
+ */
+class NeoFontOptimizer
+{
+public:
+
+    NeoFontOptimizer();
+    ~NeoFontOptimizer();
+
+    void setBearings(int left, int right);
+    void setBlankWidth(int w);
+    void setHeightMode(int mode);
+    void setRaise(bool raise);
+
+    int leftBearing() const;
+    int rightBearing() const;
+    int blankWidth() const;
+    int heightMode() const;
+    bool raise() const;
+
+    void plan(const NeoFont *font);
+    void apply(NeoFont *font, NeoUndoJournal *journal = 0);
+
+    int width(int n) const;
+    int shift(int n) const;
+    int heightBefore() const;
+    int heightAfter() const;
+    int rowsRaised() const;
+    int stripsBefore() const;
+    int stripsAfter() const;
+    int trimmedCount() const;
+    int columnsRemoved() const;
+
+    unsigned int bitmapBytesBefore() const;
+    unsigned int bitmapBytesAfter() const;
+    unsigned int appletSizeBefore() const;
+    unsigned int appletSizeAfter() const;
+    unsigned int savedBytes() const;
+
+private:
+
+    NeoFontAnalysis m_analysis;                 /**< The metrics of the font planned. */
+    int m_widths[kNeoFontCharacterCount];       /**< The planned width of each glyph. */
+    int m_shifts[kNeoFontCharacterCount];       /**< The planned move left of each glyph, in pixels. */
+    int m_leftBearing;              /**< Most blank columns kept left of the ink, or kNeoTrimKeep. */
+    int m_rightBearing;             /**< Most blank columns kept right of the ink, or kNeoTrimKeep. */
+    int m_blankWidth;               /**< Width given to glyphs with no ink, or kNeoTrimKeep. */
+    int m_heightMode;               /**< How the height is lowered (kNeoTrimHeightKeep etc). */
+    bool m_raise;                   /**< Logical true to move the ink up when lowering the height. */
+    int m_height;                   /**< The planned font height. */
+    int m_raised;                   /**< The planned move up of every glyph, in pixels. */
+    int m_trimmed;                  /**< The number of glyphs whose width changes. */
+    int m_columns;                  /**< The total columns removed from the glyphs. */
+    unsigned int m_bitmapBytes;     /**< The bitmap bytes after the changes. */
+    unsigned int m_appletSize;      /**< The applet size after the changes. */
+
+    NeoFontOptimizer(const NeoFontOptimizer &other);
+    NeoFontOptimizer &operator=(const NeoFontOptimizer &other);
+
+    void planHeight();
+};
+
+
+
+#endif  // _NEOFONTOPTIMIZER_H_
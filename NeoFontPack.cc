@@ -0,0 +1,829 @@
+/** @file       NeoFontPack.cc
+ *  @brief      Single file container holding many fonts, with shared glyphs and lookup indices.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "NeoFontPack.h"
+#include "NeoArchive.h"
+
+
+/* Pack header fields (byte offsets of 32 bit words).
+ */
+#define kPackOffMagic               (0)         /**< kNeoFontPackMagic. */
+#define kPackOffVersion             (4)         /**< Format version. */
+#define kPackOffFontCount           (8)         /**< Number of fonts. */
+#define kPackOffGlyphCount          (12)        /**< Number of distinct glyphs. */
+#define kPackOffRecords             (16)        /**< Offset of the font records. */
+#define kPackOffNameIndex           (20)        /**< Offset of the font numbers sorted by font name. */
+#define kPackOffIdentIndex          (24)        /**< Offset of the font numbers sorted by applet ID. */
+#define kPackOffHashIndex           (28)        /**< Offset of the font numbers sorted by content hash. */
+#define kPackOffMaps                (32)        /**< Offset of the glyph maps. */
+#define kPackOffGlyphTable          (36)        /**< Offset of the glyph table. */
+#define kPackOffGlyphData           (40)        /**< Offset of the glyph records. */
+#define kPackOffGlyphDataLength     (44)        /**< Number of bytes of glyph records. */
+#define kPackOffFileLength          (48)        /**< Length of the pack, in bytes. */
+#define kPackOffMapEntrySize        (52)        /**< Size of each glyph map entry (2 or 4 bytes). */
+
+/* Font record fields (byte offsets).
+ */
+#define kPackRecAppletName          (0)         /**< Applet name (36 bytes, zero terminated). */
+#define kPackRecAppletInfo          (36)        /**< Applet information text (60 bytes, zero terminated). */
+#define kPackRecFontName            (96)        /**< Font name (24 bytes, zero terminated). */
+#define kPackRecVersion             (120)       /**< Version string (16 bytes, zero terminated). */
+#define kPackRecIdent               (136)       /**< Applet ID (32 bit). */
+#define kPackRecHeight              (140)       /**< Font height (32 bit). */
+#define kPackRecHash                (144)       /**< Content hash (64 bit, as two 32 bit words, low word first). */
+
+#define kPackAppletNameLength       (36)        /**< Size of the applet name field. */
+#define kPackAppletInfoLength       (60)        /**< Size of the applet information field. */
+#define kPackFontNameLength         (24)        /**< Size of the font name field. */
+
+#define kPackGlyphEntrySize         (8)         /**< Size of a glyph table entry (offset and length). */
+#define kPackMaxShortGlyphs         (65536)     /**< Largest number of glyphs that can use 2 byte glyph map entries. */
+
+/** Largest possible glyph record: the encoding byte, the width and height varints, and every pixel. */
+#define kPackMaxGlyphRecord         (1 + 5 + 5 + (((kNeoCharacterMaxWidth * kNeoCharacterMaxHeight) + 7) / 8))
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      Private Data.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** A distinct glyph held by a pack writer.
+ */
+struct NeoFontPackGlyph
+{
+    uint32_t offset;                /**< Offset of the glyph record in the glyph data. */
+    uint32_t length;                /**< Length of the glyph record, in bytes. */
+};
+
+
+/** Section offsets of a pack.
+ */
+struct NeoFontPackLayout
+{
+    unsigned int records;           /**< Offset of the font records. */
+    unsigned int nameIndex;         /**< Offset of the name index. */
+    unsigned int identIndex;        /**< Offset of the applet ID index. */
+    unsigned int hashIndex;         /**< Offset of the content hash index. */
+    unsigned int maps;              /**< Offset of the glyph maps. */
+    unsigned int glyphTable;        /**< Offset of the glyph table. */
+    unsigned int glyphData;         /**< Offset of the glyph records. */
+    unsigned int length;            /**< Length of the pack. */
+    unsigned int mapEntrySize;      /**< Size of each glyph map entry. */
+};
+
+
+/** Sort keys used to build the indices.
+ */
+struct NeoFontPackNameKey { const char *name; uint32_t index; };
+struct NeoFontPackIdentKey { uint32_t ident; uint32_t index; };
+struct NeoFontPackHashKey { uint64_t hash; uint32_t index; };
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      Private Functions.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Write a 32 bit little-endian value to a byte array.
+ *
+ *  @param  data    The data array.
+ *  @param  offset  The offset.
+ *  @param  value   The value to write.
+ */
+static inline void write32l(uint8_t *data, unsigned int offset, uint32_t value)
+{
+    data[offset + 0] = (value >>  0) & 255;
+    data[offset + 1] = (value >>  8) & 255;
+    data[offset + 2] = (value >> 16) & 255;
+    data[offset + 3] = (value >> 24) & 255;
+}
+
+
+/** Read a 32 bit little-endian value from a byte array.
+ *
+ *  @param  data    The data array.
+ *  @param  offset  The offset.
+ *  @return         The value.
+ */
+static inline uint32_t read32l(const uint8_t *data, unsigned int offset)
+{
+    return ((uint32_t)data[offset + 0] <<  0) | ((uint32_t)data[offset + 1] <<  8) |
+           ((uint32_t)data[offset + 2] << 16) | ((uint32_t)data[offset + 3] << 24);
+}
+
+
+/** Round an offset up to the next page boundary.
+ */
+static inline unsigned int pageAlign(unsigned int offset)
+{
+    return (offset + kNeoFontPackPageSize - 1) & ~(kNeoFontPackPageSize - 1u);
+}
+
+
+/** Check that a range of bytes lies entirely within a buffer, using 64 bit arithmetic so that values read
+ *  from the pack cannot cause the calculation to wrap.
+ */
+static inline bool inBounds(uint64_t offset, uint64_t size, unsigned int length)
+{
+    return (offset + size) <= (uint64_t)length;
+}
+
+
+/** Work out where each section of a pack goes.
+ *
+ *  @param  layout          Receives the section offsets.
+ *  @param  fonts           The number of fonts.
+ *  @param  glyphs          The number of distinct glyphs.
+ *  @param  glyphDataLength The number of bytes of glyph records.
+ */
+static void packLayout(NeoFontPackLayout *layout, unsigned int fonts, unsigned int glyphs, unsigned int glyphDataLength)
+{
+    layout->mapEntrySize = (glyphs <= kPackMaxShortGlyphs) ? 2 : 4;
+    layout->records = pageAlign(kNeoFontPackHeaderSize);
+    layout->nameIndex = layout->records + (fonts * kNeoFontPackRecordSize);
+    layout->identIndex = layout->nameIndex + (fonts * 4);
+    layout->hashIndex = layout->identIndex + (fonts * 4);
+    layout->maps = pageAlign(layout->hashIndex + (fonts * 4));
+    layout->glyphTable = pageAlign(layout->maps + (fonts * kNeoFontCharacterCount * layout->mapEntrySize));
+    layout->glyphData = pageAlign(layout->glyphTable + (glyphs * kPackGlyphEntrySize));
+    layout->length = layout->glyphData + glyphDataLength;
+}
+
+
+/** Compare sort keys, for use with qsort(). Ties are broken by font number so the order is deterministic.
+ */
+static int compareNameKeys(const void *a, const void *b)
+{
+    const NeoFontPackNameKey *x = (const NeoFontPackNameKey *)a;
+    const NeoFontPackNameKey *y = (const NeoFontPackNameKey *)b;
+    int r = strcmp(x->name, y->name);
+    if (0 != r) return r;
+    return (x->index < y->index) ? -1 : (x->index > y->index);
+}
+
+static int compareIdentKeys(const void *a, const void *b)
+{
+    const NeoFontPackIdentKey *x = (const NeoFontPackIdentKey *)a;
+    const NeoFontPackIdentKey *y = (const NeoFontPackIdentKey *)b;
+    if (x->ident != y->ident) return (x->ident < y->ident) ? -1 : 1;
+    return (x->index < y->index) ? -1 : (x->index > y->index);
+}
+
+static int compareHashKeys(const void *a, const void *b)
+{
+    const NeoFontPackHashKey *x = (const NeoFontPackHashKey *)a;
+    const NeoFontPackHashKey *y = (const NeoFontPackHashKey *)b;
+    if (x->hash != y->hash) return (x->hash < y->hash) ? -1 : 1;
+    return (x->index < y->index) ? -1 : (x->index > y->index);
+}
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      NeoFontPackWriter class definition.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Class constructor. The pack is empty.
+ */
+NeoFontPackWriter::NeoFontPackWriter()
+    :
+        m_records(0),
+        m_maps(0),
+        m_fontCount(0),
+        m_fontCapacity(0),
+        m_table(),
+        m_glyphs(0),
+        m_glyphCapacity(0),
+        m_glyphData(0),
+        m_glyphDataLength(0),
+        m_glyphDataCapacity(0)
+{
+    // Nothing.
+}
+
+
+/** Destructor.
+ */
+NeoFontPackWriter::~NeoFontPackWriter()
+{
+    delete[] m_records;
+    delete[] m_maps;
+    delete[] m_glyphs;
+    delete[] m_glyphData;
+}
+
+
+/** Add a font to the pack. The font's fields and glyphs are copied, so the font may be changed or
+ *  destroyed afterwards.
+ *
+ *  @param  font    The font.
+ */
+void NeoFontPackWriter::add(NeoFont *font)
+{
+    if (m_fontCount == m_fontCapacity)
+    {
+        unsigned int capacity = (0 == m_fontCapacity) ? 16 : (m_fontCapacity * 2);
+        uint8_t *records = new uint8_t[capacity * kNeoFontPackRecordSize]();
+        uint32_t *maps = new uint32_t[capacity * kNeoFontCharacterCount];
+        if (0 != m_fontCount)
+        {
+            memcpy(records, m_records, m_fontCount * kNeoFontPackRecordSize);
+            memcpy(maps, m_maps, m_fontCount * kNeoFontCharacterCount * sizeof maps[0]);
+        }
+        delete[] m_records;
+        delete[] m_maps;
+        m_records = records;
+        m_maps = maps;
+        m_fontCapacity = capacity;
+    }
+
+    uint8_t *record = &m_records[m_fontCount * kNeoFontPackRecordSize];
+    uint32_t *map = &m_maps[m_fontCount * kNeoFontCharacterCount];
+    strncpy((char *)&record[kPackRecAppletName], font->appletName(), kPackAppletNameLength - 1);
+    strncpy((char *)&record[kPackRecAppletInfo], font->appletInfo(), kPackAppletInfoLength - 1);
+    strncpy((char *)&record[kPackRecFontName], font->fontName(), kPackFontNameLength - 1);
+    strncpy((char *)&record[kPackRecVersion], font->version(), kNeoFontPackVersionLength - 1);
+    write32l(record, kPackRecIdent, font->ident());
+    write32l(record, kPackRecHeight, font->height());
+
+    for (int i = 0; i < kNeoFontCharacterCount; i++) map[i] = addGlyph(font->character(i));
+    uint64_t hash = font->contentHash();
+    write32l(record, kPackRecHash + 0, (uint32_t)hash);
+    write32l(record, kPackRecHash + 4, (uint32_t)(hash >> 32));
+    m_fontCount++;
+}
+
+
+/** Return the number of fonts added.
+ */
+unsigned int NeoFontPackWriter::fontCount() const
+{
+    return m_fontCount;
+}
+
+
+/** Return the number of distinct glyphs in the fonts added.
+ */
+unsigned int NeoFontPackWriter::glyphCount() const
+{
+    return m_table.count();
+}
+
+
+/** Return the size of the pack.
+ *
+ *  @return         The number of bytes that save() will write.
+ */
+unsigned int NeoFontPackWriter::size() const
+{
+    NeoFontPackLayout layout;
+    packLayout(&layout, m_fontCount, m_table.count(), m_glyphDataLength);
+    return layout.length;
+}
+
+
+/** Write the pack. Padding between sections is zero filled.
+ *
+ *  @param  data    The output buffer.
+ *  @param  length  The size of the output buffer.
+ *  @return         The number of bytes written, or zero if the buffer is too small.
+ */
+unsigned int NeoFontPackWriter::save(uint8_t *data, unsigned int length) const
+{
+    NeoFontPackLayout layout;
+    packLayout(&layout, m_fontCount, m_table.count(), m_glyphDataLength);
+    if (length < layout.length) return 0;
+    memset(data, 0, layout.length);
+
+    // Header
+    memcpy(&data[kPackOffMagic], kNeoFontPackMagic, 4);
+    write32l(data, kPackOffVersion, kNeoFontPackVersion);
+    write32l(data, kPackOffFontCount, m_fontCount);
+    write32l(data, kPackOffGlyphCount, m_table.count());
+    write32l(data, kPackOffRecords, layout.records);
+    write32l(data, kPackOffNameIndex, layout.nameIndex);
+    write32l(data, kPackOffIdentIndex, layout.identIndex);
+    write32l(data, kPackOffHashIndex, layout.hashIndex);
+    write32l(data, kPackOffMaps, layout.maps);
+    write32l(data, kPackOffGlyphTable, layout.glyphTable);
+    write32l(data, kPackOffGlyphData, layout.glyphData);
+    write32l(data, kPackOffGlyphDataLength, m_glyphDataLength);
+    write32l(data, kPackOffFileLength, layout.length);
+    write32l(data, kPackOffMapEntrySize, layout.mapEntrySize);
+
+    // Font records and glyph maps
+    if (0 != m_fontCount) memcpy(&data[layout.records], m_records, m_fontCount * kNeoFontPackRecordSize);
+    for (unsigned int i = 0; i < m_fontCount * kNeoFontCharacterCount; i++)
+    {
+        if (2 == layout.mapEntrySize)
+        {
+            data[layout.maps + (i * 2) + 0] = (m_maps[i] >> 0) & 255;       // Glyph numbers are at most 65535
+            data[layout.maps + (i * 2) + 1] = (m_maps[i] >> 8) & 255;
+        }
+        else
+        {
+            write32l(data, layout.maps + (i * 4), m_maps[i]);
+        }
+    }
+
+    // Indices
+    NeoFontPackNameKey *names = new NeoFontPackNameKey[m_fontCount + 1];
+    NeoFontPackIdentKey *idents = new NeoFontPackIdentKey[m_fontCount + 1];
+    NeoFontPackHashKey *hashes = new NeoFontPackHashKey[m_fontCount + 1];
+    for (unsigned int i = 0; i < m_fontCount; i++)
+    {
+        const uint8_t *record = &m_records[i * kNeoFontPackRecordSize];
+        names[i].name = (const char *)&record[kPackRecFontName];
+        names[i].index = i;
+        idents[i].ident = read32l(record, kPackRecIdent);
+        idents[i].index = i;
+        hashes[i].hash = ((uint64_t)read32l(record, kPackRecHash + 4) << 32) | read32l(record, kPackRecHash + 0);
+        hashes[i].index = i;
+    }
+    qsort(names, m_fontCount, sizeof names[0], compareNameKeys);
+    qsort(idents, m_fontCount, sizeof idents[0], compareIdentKeys);
+    qsort(hashes, m_fontCount, sizeof hashes[0], compareHashKeys);
+    for (unsigned int i = 0; i < m_fontCount; i++)
+    {
+        write32l(data, layout.nameIndex + (i * 4), names[i].index);
+        write32l(data, layout.identIndex + (i * 4), idents[i].index);
+        write32l(data, layout.hashIndex + (i * 4), hashes[i].index);
+    }
+    delete[] names;
+    delete[] idents;
+    delete[] hashes;
+
+    // Glyph table and glyph records
+    for (unsigned int i = 0; i < m_table.count(); i++)
+    {
+        write32l(data, layout.glyphTable + (i * kPackGlyphEntrySize) + 0, m_glyphs[i].offset);
+        write32l(data, layout.glyphTable + (i * kPackGlyphEntrySize) + 4, m_glyphs[i].length);
+    }
+    if (0 != m_glyphDataLength) memcpy(&data[layout.glyphData], m_glyphData, m_glyphDataLength);
+    return layout.length;
+}
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      NeoFontPackWriter private methods.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Find a glyph, adding it if it is not already in the pack. The record of a new glyph is written to the
+ *  end of the glyph data.
+ *
+ *  @param  c       The character.
+ *  @return         The glyph number.
+ */
+uint32_t NeoFontPackWriter::addGlyph(const NeoCharacter *c)
+{
+    unsigned int count = m_table.count();
+    uint32_t glyph = m_table.intern(c);
+    if (glyph < count) return glyph;
+
+    if (count == m_glyphCapacity)
+    {
+        unsigned int capacity = (0 == m_glyphCapacity) ? 256 : (m_glyphCapacity * 2);
+        NeoFontPackGlyph *glyphs = new NeoFontPackGlyph[capacity];
+        if (0 != count) memcpy(glyphs, m_glyphs, count * sizeof glyphs[0]);
+        delete[] m_glyphs;
+        m_glyphs = glyphs;
+        m_glyphCapacity = capacity;
+    }
+    if (m_glyphDataLength + kPackMaxGlyphRecord > m_glyphDataCapacity)
+    {
+        unsigned int capacity = (m_glyphDataCapacity * 2) + kPackMaxGlyphRecord + 4096;
+        uint8_t *data = new uint8_t[capacity];
+        if (0 != m_glyphDataLength) memcpy(data, m_glyphData, m_glyphDataLength);
+        delete[] m_glyphData;
+        m_glyphData = data;
+        m_glyphDataCapacity = capacity;
+    }
+    NeoArchiveWriter writer(&m_glyphData[m_glyphDataLength]);
+    c->saveRecord(&writer);
+    m_glyphs[glyph].offset = m_glyphDataLength;
+    m_glyphs[glyph].length = writer.length();
+    m_glyphDataLength += writer.length();
+    return glyph;
+}
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      NeoFontPack class definition.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Class constructor. The view is not attached to any data.
+ */
+NeoFontPack::NeoFontPack()
+    :
+        m_data(0),
+        m_length(0),
+        m_count(0),
+        m_glyphCount(0),
+        m_records(0),
+        m_nameIndex(0),
+        m_identIndex(0),
+        m_hashIndex(0),
+        m_maps(0),
+        m_mapEntrySize(0),
+        m_glyphTable(0),
+        m_glyphData(0),
+        m_glyphDataLength(0)
+{
+    // Nothing.
+}
+
+
+/** Class constructor. The view is attached to the supplied data, if it is valid.
+ *
+ *  @param  data    A pointer to the pack data.
+ *  @param  length  The number of bytes of data.
+ */
+NeoFontPack::NeoFontPack(const uint8_t *data, unsigned int length)
+    :
+        m_data(0),
+        m_length(0),
+        m_count(0),
+        m_glyphCount(0),
+        m_records(0),
+        m_nameIndex(0),
+        m_identIndex(0),
+        m_hashIndex(0),
+        m_maps(0),
+        m_mapEntrySize(0),
+        m_glyphTable(0),
+        m_glyphData(0),
+        m_glyphDataLength(0)
+{
+    attach(data, length);
+}
+
+
+/** Destructor.
+ */
+NeoFontPack::~NeoFontPack()
+{
+    // Nothing.
+}
+
+
+/** Attach the view to pack data. The header, every font record and the indices are checked. If any check
+ *  fails, the view is left detached.
+ *
+ *  @param  data    A pointer to the pack data.
+ *  @param  length  The number of bytes of data.
+ *  @return         Logical true if the data is a valid pack.
+ */
+bool NeoFontPack::attach(const uint8_t *data, unsigned int length)
+{
+    detach();
+    if (0 == data || length < kNeoFontPackHeaderSize || 0 != memcmp(&data[kPackOffMagic], kNeoFontPackMagic, 4))
+    {
+        return false;           // Not a pack
+    }
+    if (kNeoFontPackVersion != read32l(data, kPackOffVersion) || read32l(data, kPackOffFileLength) > length)
+    {
+        return false;           // Unsupported version, or truncated
+    }
+
+    uint64_t count = read32l(data, kPackOffFontCount);
+    uint64_t glyphs = read32l(data, kPackOffGlyphCount);
+    unsigned int records = read32l(data, kPackOffRecords);
+    unsigned int name_index = read32l(data, kPackOffNameIndex);
+    unsigned int ident_index = read32l(data, kPackOffIdentIndex);
+    unsigned int hash_index = read32l(data, kPackOffHashIndex);
+    unsigned int maps = read32l(data, kPackOffMaps);
+    unsigned int glyph_table = read32l(data, kPackOffGlyphTable);
+    unsigned int glyph_data = read32l(data, kPackOffGlyphData);
+    unsigned int glyph_data_length = read32l(data, kPackOffGlyphDataLength);
+    unsigned int map_entry_size = read32l(data, kPackOffMapEntrySize);
+    if ((2 != map_entry_size && 4 != map_entry_size) || (2 == map_entry_size && glyphs > kPackMaxShortGlyphs))
+    {
+        return false;           // Unsupported glyph map
+    }
+    if (!inBounds(records, count * kNeoFontPackRecordSize, length) ||
+        !inBounds(name_index, count * 4, length) ||
+        !inBounds(ident_index, count * 4, length) ||
+        !inBounds(hash_index, count * 4, length) ||
+        !inBounds(maps, count * kNeoFontCharacterCount * map_entry_size, length) ||
+        !inBounds(glyph_table, glyphs * kPackGlyphEntrySize, length) ||
+        !inBounds(glyph_data, glyph_data_length, length))
+    {
+        return false;           // Section is outside the pack
+    }
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        const uint8_t *record = &data[records + (i * kNeoFontPackRecordSize)];
+        if (0 == memchr(&record[kPackRecAppletName], 0, kPackAppletNameLength) ||
+            0 == memchr(&record[kPackRecAppletInfo], 0, kPackAppletInfoLength) ||
+            0 == memchr(&record[kPackRecFontName], 0, kPackFontNameLength) ||
+            0 == memchr(&record[kPackRecVersion], 0, kNeoFontPackVersionLength))
+        {
+            return false;       // Unterminated string
+        }
+        if (read32l(data, name_index + (i * 4)) >= count ||
+            read32l(data, ident_index + (i * 4)) >= count ||
+            read32l(data, hash_index + (i * 4)) >= count)
+        {
+            return false;       // Index refers to a font that does not exist
+        }
+    }
+
+    m_data = data;
+    m_length = length;
+    m_count = (unsigned int)count;
+    m_glyphCount = (unsigned int)glyphs;
+    m_records = records;
+    m_nameIndex = name_index;
+    m_identIndex = ident_index;
+    m_hashIndex = hash_index;
+    m_maps = maps;
+    m_mapEntrySize = map_entry_size;
+    m_glyphTable = glyph_table;
+    m_glyphData = glyph_data;
+    m_glyphDataLength = glyph_data_length;
+    return true;
+}
+
+
+/** Detach the view from its data.
+ */
+void NeoFontPack::detach()
+{
+    m_data = 0;
+    m_length = 0;
+    m_count = 0;
+    m_glyphCount = 0;
+    m_records = 0;
+    m_nameIndex = 0;
+    m_identIndex = 0;
+    m_hashIndex = 0;
+    m_maps = 0;
+    m_mapEntrySize = 0;
+    m_glyphTable = 0;
+    m_glyphData = 0;
+    m_glyphDataLength = 0;
+}
+
+
+/** Test if the view is attached to a valid pack.
+ *
+ *  @return         Logical true if the view is valid.
+ */
+bool NeoFontPack::isValid() const
+{
+    return 0 != m_data;
+}
+
+
+/** Return the number of fonts in the pack.
+ */
+unsigned int NeoFontPack::count() const
+{
+    return m_count;
+}
+
+
+/** Return the number of distinct glyphs in the pack.
+ */
+unsigned int NeoFontPack::glyphCount() const
+{
+    return m_glyphCount;
+}
+
+
+/** Get the applet name of a font.
+ *
+ *  @param  index   The font number.
+ *  @return         A pointer to a c-string within the pack data, or zero if index is out of range.
+ */
+const char *NeoFontPack::appletName(unsigned int index) const
+{
+    const uint8_t *r = record(index);
+    return (0 == r) ? 0 : (const char *)&r[kPackRecAppletName];
+}
+
+
+/** Get the applet information text of a font.
+ *
+ *  @param  index   The font number.
+ *  @return         A pointer to a c-string within the pack data, or zero if index is out of range.
+ */
+const char *NeoFontPack::appletInfo(unsigned int index) const
+{
+    const uint8_t *r = record(index);
+    return (0 == r) ? 0 : (const char *)&r[kPackRecAppletInfo];
+}
+
+
+/** Get the name of a font.
+ *
+ *  @param  index   The font number.
+ *  @return         A pointer to a c-string within the pack data, or zero if index is out of range.
+ */
+const char *NeoFontPack::fontName(unsigned int index) const
+{
+    const uint8_t *r = record(index);
+    return (0 == r) ? 0 : (const char *)&r[kPackRecFontName];
+}
+
+
+/** Get the version string of a font.
+ *
+ *  @param  index   The font number.
+ *  @return         A pointer to a c-string within the pack data, or zero if index is out of range.
+ */
+const char *NeoFontPack::version(unsigned int index) const
+{
+    const uint8_t *r = record(index);
+    return (0 == r) ? 0 : (const char *)&r[kPackRecVersion];
+}
+
+
+/** Get the applet ID of a font.
+ *
+ *  @param  index   The font number.
+ *  @return         The 16 bit ID, or -1 if index is out of range.
+ */
+int NeoFontPack::ident(unsigned int index) const
+{
+    const uint8_t *r = record(index);
+    return (0 == r) ? -1 : (int)(read32l(r, kPackRecIdent) & 0xffffu);
+}
+
+
+/** Get the height of a font.
+ *
+ *  @param  index   The font number.
+ *  @return         The height, in pixels, or zero if index is out of range.
+ */
+int NeoFontPack::height(unsigned int index) const
+{
+    const uint8_t *r = record(index);
+    return (0 == r) ? 0 : (int)read32l(r, kPackRecHeight);
+}
+
+
+/** Get the content hash of a font (see NeoFont::contentHash()).
+ *
+ *  @param  index   The font number.
+ *  @return         The hash, or zero if index is out of range.
+ */
+uint64_t NeoFontPack::hash(unsigned int index) const
+{
+    const uint8_t *r = record(index);
+    return (0 == r) ? 0 : (((uint64_t)read32l(r, kPackRecHash + 4) << 32) | read32l(r, kPackRecHash + 0));
+}
+
+
+/** Find a font by name.
+ *
+ *  @param  name    The font name.
+ *  @return         The number of the first font (in pack order) with the name, or kNeoFontPackNotFound.
+ */
+int NeoFontPack::findName(const char *name) const
+{
+    unsigned int lo = 0;
+    unsigned int hi = m_count;
+    while (lo < hi)
+    {
+        unsigned int mid = lo + ((hi - lo) / 2);
+        if (strcmp(fontName(indexEntry(m_nameIndex, mid)), name) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo < m_count && 0 == strcmp(fontName(indexEntry(m_nameIndex, lo)), name)) return indexEntry(m_nameIndex, lo);
+    return kNeoFontPackNotFound;
+}
+
+
+/** Find a font by applet ID.
+ *
+ *  @param  ident   The applet ID.
+ *  @return         The number of the first font (in pack order) with the ID, or kNeoFontPackNotFound.
+ */
+int NeoFontPack::findIdent(int ident) const
+{
+    unsigned int lo = 0;
+    unsigned int hi = m_count;
+    while (lo < hi)
+    {
+        unsigned int mid = lo + ((hi - lo) / 2);
+        if (this->ident(indexEntry(m_identIndex, mid)) < ident) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo < m_count && this->ident(indexEntry(m_identIndex, lo)) == ident) return indexEntry(m_identIndex, lo);
+    return kNeoFontPackNotFound;
+}
+
+
+/** Find a font by content hash.
+ *
+ *  @param  hash    The content hash, as returned by NeoFont::contentHash().
+ *  @return         The number of the first font (in pack order) with the hash, or kNeoFontPackNotFound.
+ */
+int NeoFontPack::findHash(uint64_t hash) const
+{
+    unsigned int lo = 0;
+    unsigned int hi = m_count;
+    while (lo < hi)
+    {
+        unsigned int mid = lo + ((hi - lo) / 2);
+        if (this->hash(indexEntry(m_hashIndex, mid)) < hash) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo < m_count && this->hash(indexEntry(m_hashIndex, lo)) == hash) return indexEntry(m_hashIndex, lo);
+    return kNeoFontPackNotFound;
+}
+
+
+/** Load a font from the pack. Only the font's record, glyph map and glyphs are read, and each glyph is
+ *  checked as it is loaded.
+ *
+ *  @param  index   The font number.
+ *  @param  font    The font to load in to.
+ *  @return         Logical true if the font was loaded, false if index is out of range or the font's glyphs
+ *                  are not valid. If the glyphs are not valid, the font may have been partly modified.
+ */
+bool NeoFontPack::load(unsigned int index, NeoFont *font) const
+{
+    const uint8_t *r = record(index);
+    if (0 == r) return false;
+
+    int h = (int)read32l(r, kPackRecHeight);
+    if (h != font->setHeight(h)) return false;
+    font->setAppletInfo((const char *)&r[kPackRecAppletInfo]);
+    font->setFontName((const char *)&r[kPackRecFontName]);
+    font->setAppletName((const char *)&r[kPackRecAppletName]);
+    font->setVersion((const char *)&r[kPackRecVersion]);
+    font->setIdent(read32l(r, kPackRecIdent) & 0xffffu);
+
+    const uint8_t *map = &m_data[m_maps + (index * kNeoFontCharacterCount * m_mapEntrySize)];
+    for (int i = 0; i < kNeoFontCharacterCount; i++)
+    {
+        uint32_t glyph = (2 == m_mapEntrySize) ? (map[i * 2] | (map[(i * 2) + 1] << 8)) : read32l(map, i * 4);
+        if (glyph >= m_glyphCount) return false;
+        unsigned int entry = m_glyphTable + (glyph * kPackGlyphEntrySize);
+        uint32_t offset = read32l(m_data, entry + 0);
+        uint32_t length = read32l(m_data, entry + 4);
+        if (!inBounds(offset, length, m_glyphDataLength)) return false;
+
+        NeoArchiveReader reader(&m_data[m_glyphData + offset], length);
+        NeoCharacter *c = font->character(i);
+        if (!c->loadRecord(&reader) || c->height() != h) return false;
+    }
+    return true;
+}
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      NeoFontPack private methods.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Get a font record.
+ *
+ *  @param  index   The font number.
+ *  @return         A pointer to the record, or zero if index is out of range.
+ */
+const uint8_t *NeoFontPack::record(unsigned int index) const
+{
+    if (index >= m_count) return 0;
+    else return &m_data[m_records + (index * kNeoFontPackRecordSize)];
+}
+
+
+/** Read an entry from one of the sorted indices.
+ *
+ *  @param  index       The offset of the index.
+ *  @param  position    The position in the index.
+ *  @return             The font number.
+ */
+unsigned int NeoFontPack::indexEntry(unsigned int index, unsigned int position) const
+{
+    return read32l(m_data, index + (position * 4));
+}
@@ -0,0 +1,132 @@
+/** @file       NeoFontPack.h
+ *  @brief      Single file container holding many fonts, with shared glyphs and lookup indices.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+#ifndef _NEOFONTPACK_H_
+#define _NEOFONTPACK_H_     (1)
+
+#include <stdint.h>
+#include "NeoFont.h"
+#include "NeoGlyphTable.h"
+
+
+/* Pack identification and layout. All values are little-endian 32 bit words (except the glyph maps, which use
+ * 16 bit words if there are few enough glyphs), so a pack can be used in place from a memory mapped file on
+ * any host. Every section starts on a page boundary.
+ */
+#define kNeoFontPackMagic           "NeoP"      /**< Magic code at the start of a pack. */
+#define kNeoFontPackVersion         (1)         /**< The format version written by this code. */
+#define kNeoFontPackPageSize        (4096)      /**< Alignment of each section, in bytes. */
+#define kNeoFontPackHeaderSize      (64)        /**< Size of the pack header, in bytes. */
+#define kNeoFontPackRecordSize      (160)       /**< Size of each font record, in bytes. */
+#define kNeoFontPackVersionLength   (16)        /**< Size of the version string field, including the terminator. */
+
+#define kNeoFontPackNotFound        (-1)        /**< Value returned by the find methods if there is no match. */
+
+
+struct NeoFontPackGlyph;
+
+
+/** Class used to build a font pack. Fonts are added one at a time, and each distinct glyph (the same
+ *  size and pixels) is stored once however many fonts use it. When every font has been added, the pack is
+ *  written with save().
+ */
+class NeoFontPackWriter
+{
+public:
+
+    NeoFontPackWriter();
+    ~NeoFontPackWriter();
+
+    void add(NeoFont *font);
+
+    unsigned int fontCount() const;
+    unsigned int glyphCount() const;
+    unsigned int size() const;
+    unsigned int save(uint8_t *data, unsigned int length) const;
+
+private:
+
+    uint8_t *m_records;                 /**< Font records, kNeoFontPackRecordSize bytes each. */
+    uint32_t *m_maps;                   /**< Glyph number of each character of each font. */
+    unsigned int m_fontCount;           /**< The number of fonts added. */
+    unsigned int m_fontCapacity;        /**< The number of fonts that m_records and m_maps can hold. */
+
+    NeoGlyphTable m_table;              /**< The distinct glyphs. */
+    NeoFontPackGlyph *m_glyphs;         /**< Position of each distinct glyph's record in m_glyphData. */
+    unsigned int m_glyphCapacity;       /**< The size of the m_glyphs array. */
+    uint8_t *m_glyphData;               /**< The glyph records, one after another. */
+    unsigned int m_glyphDataLength;     /**< The number of bytes of glyph records. */
+    unsigned int m_glyphDataCapacity;   /**< The size of m_glyphData. */
+
+    NeoFontPackWriter(const NeoFontPackWriter &other);
+    NeoFontPackWriter &operator=(const NeoFontPackWriter &other);
+
+    uint32_t addGlyph(const NeoCharacter *c);
+};
+
+
+
+/** Class giving read-only access to a font pack held in memory, without copying it. Fonts are found by
+ *  number, or through sorted indices of font name, applet ID and content hash. Loading a font reads just
+ *  its record, its glyph map and its glyphs, however many fonts the pack holds.
+ *
+ *  The header, the font records and the indices are checked when the view is attached. Each font's glyphs
+ *  are checked as it is loaded. The view does not own the data, which must remain valid while the view is
+ *  in use.
+ */
+class NeoFontPack
+{
+public:
+
+    NeoFontPack();
+    NeoFontPack(const uint8_t *data, unsigned int length);
+    ~NeoFontPack();
+
+    bool attach(const uint8_t *data, unsigned int length);
+    void detach();
+    bool isValid() const;
+
+    unsigned int count() const;
+    unsigned int glyphCount() const;
+
+    const char *appletName(unsigned int index) const;
+    const char *appletInfo(unsigned int index) const;
+    const char *fontName(unsigned int index) const;
+    const char *version(unsigned int index) const;
+    int ident(unsigned int index) const;
+    int height(unsigned int index) const;
+    uint64_t hash(unsigned int index) const;
+
+    int findName(const char *name) const;
+    int findIdent(int ident) const;
+    int findHash(uint64_t hash) const;
+
+    bool load(unsigned int index, NeoFont *font) const;
+
+private:
+
+    const uint8_t *m_data;              /**< The pack data, or zero if not attached. */
+    unsigned int m_length;              /**< The number of bytes of pack data. */
+    unsigned int m_count;               /**< The number of fonts. */
+    unsigned int m_glyphCount;          /**< The number of distinct glyphs. */
+    unsigned int m_records;             /**< Offset of the font records. */
+    unsigned int m_nameIndex;           /**< Offset of the font numbers, sorted by font name. */
+    unsigned int m_identIndex;          /**< Offset of the font numbers, sorted by applet ID. */
+    unsigned int m_hashIndex;           /**< Offset of the font numbers, sorted by content hash. */
+    unsigned int m_maps;                /**< Offset of the glyph maps (256 glyph numbers per font). */
+    unsigned int m_mapEntrySize;        /**< Size of each glyph number in the glyph maps (2 or 4 bytes). */
+    unsigned int m_glyphTable;          /**< Offset of the glyph table (offset and length of each glyph). */
+    unsigned int m_glyphData;           /**< Offset of the glyph records. */
+    unsigned int m_glyphDataLength;     /**< The number of bytes of glyph records. */
+
+    NeoFontPack(const NeoFontPack &other);
+    NeoFontPack &operator=(const NeoFontPack &other);
+
+    const uint8_t *record(unsigned int index) const;
+    unsigned int indexEntry(unsigned int index, unsigned int position) const;
+};
+
+
+
+#endif  // _NEOFONTPACK_H_
@@ -0,0 +1,199 @@
+/** @file       NeoFontSubscription.cc
+ *  @brief      Record of the changes made to a font, used to update views and caches incrementally.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+
+#include <stdint.h>
+#include "NeoFontSubscription.h"
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      NeoFontSubscription class definition.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Class constructor. The subscription is attached to the font, and must be destroyed before the font is.
+ *  It starts with no changes recorded.
+ *
+ *  @param  font    The font to follow.
+ */
+NeoFontSubscription::NeoFontSubscription(NeoFont *font)
+    :
+        m_font(font),
+        m_next(font->m_subscriptions),
+        m_fields(0),
+        m_dirty(),
+        m_rects()
+{
+    m_font->m_subscriptions = this;
+}
+
+
+/** Destructor. The subscription is detached from its font.
+ */
+NeoFontSubscription::~NeoFontSubscription()
+{
+    NeoFontSubscription **link = &m_font->m_subscriptions;
+    while (0 != *link && this != *link) link = &(*link)->m_next;
+    if (0 != *link) *link = m_next;
+}
+
+
+/** Return the font that the subscription follows.
+ */
+NeoFont *NeoFontSubscription::font() const
+{
+    return m_font;
+}
+
+
+/** Test if any change has been recorded since the last clear().
+ */
+bool NeoFontSubscription::isEmpty() const
+{
+    uint64_t any = 0;
+    for (int k = 0; k < kNeoFontCharacterSetWords; k++) any |= m_dirty[k];
+    return 0 == m_fields && 0 == any;
+}
+
+
+/** Return the fields that have changed.
+ *
+ *  @return         A combination of the kNeoFontField... values.
+ */
+unsigned int NeoFontSubscription::fields() const
+{
+    return m_fields;
+}
+
+
+/** Obtain the set of characters that have changed.
+ *
+ *  @return         kNeoFontCharacterSetWords words, with character n in bit (n % 64) of word (n / 64).
+ */
+const uint64_t *NeoFontSubscription::characters() const
+{
+    return m_dirty;
+}
+
+
+/** Return the number of characters that have changed.
+ */
+int NeoFontSubscription::characterCount() const
+{
+    int count = 0;
+    for (int k = 0; k < kNeoFontCharacterSetWords; k++) count += __builtin_popcountll(m_dirty[k]);
+    return count;
+}
+
+
+/** Test if a character has changed.
+ *
+ *  @param  index   The character number.
+ *  @return         Logical true if the character has changed.
+ */
+bool NeoFontSubscription::isDirty(int index) const
+{
+    if (index < 0 || index >= kNeoFontCharacterCount) return false;
+    return 0 != (m_dirty[index / 64] & (((uint64_t)1) << (index & 63)));
+}
+
+
+/** Find the next character that has changed. Use nextDirty(0), then nextDirty(n + 1), to visit every
+ *  changed character in order.
+ *
+ *  @param  index   The first character number to consider.
+ *  @return         The number of the first changed character at or after index, or -1 if there are none.
+ */
+int NeoFontSubscription::nextDirty(int index) const
+{
+    if (index < 0) index = 0;
+    for (int k = index / 64; k < kNeoFontCharacterSetWords; k++)
+    {
+        uint64_t word = m_dirty[k];
+        if (k == index / 64) word &= ~((uint64_t)0) << (index & 63);
+        if (0 != word) return (k * 64) + __builtin_ctzll(word);
+    }
+    return -1;
+}
+
+
+/** Obtain the bounding box of the pixels that have changed in a character. A change of size is reported
+ *  as a change to every pixel of the larger of the old and new sizes.
+ *
+ *  @param  index   The character number.
+ *  @return         The rectangle, which is empty if the character has not changed.
+ */
+NeoCharacterRect NeoFontSubscription::dirtyRect(int index) const
+{
+    NeoCharacterRect empty = { 0, 0, 0, 0 };
+    return isDirty(index) ? m_rects[index] : empty;
+}
+
+
+/** Mark every pixel of a character as changed.
+ *
+ *  @param  index   The character number.
+ */
+void NeoFontSubscription::markCharacter(int index)
+{
+    NeoCharacterRect all = { 0, 0, kNeoCharacterMaxWidth, kNeoCharacterMaxHeight };
+    addCharacter(index, all);
+}
+
+
+/** Mark every field and every pixel of every character as changed.
+ */
+void NeoFontSubscription::markAll()
+{
+    NeoCharacterRect all = { 0, 0, kNeoCharacterMaxWidth, kNeoCharacterMaxHeight };
+    for (int i = 0; i < kNeoFontCharacterCount; i++) m_rects[i] = all;
+    for (int k = 0; k < kNeoFontCharacterSetWords; k++) m_dirty[k] = ~((uint64_t)0);
+    m_fields = kNeoFontFieldAll;
+}
+
+
+/** Forget all recorded changes.
+ */
+void NeoFontSubscription::clear()
+{
+    for (int k = 0; k < kNeoFontCharacterSetWords; k++) m_dirty[k] = 0;
+    m_fields = 0;
+}
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      NeoFontSubscription private methods.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Record a change to a character, growing its bounding box to include the changed pixels.
+ *
+ *  @param  index   The character number.
+ *  @param  r       The pixels that changed.
+ */
+void NeoFontSubscription::addCharacter(int index, const NeoCharacterRect &r)
+{
+    if (index < 0 || index >= kNeoFontCharacterCount || r.x0 >= r.x1 || r.y0 >= r.y1) return;
+
+    uint64_t bit = ((uint64_t)1) << (index & 63);
+    NeoCharacterRect &box = m_rects[index];
+    if (0 == (m_dirty[index / 64] & bit))
+    {
+        m_dirty[index / 64] |= bit;
+        box = r;
+    }
+    else
+    {
+        if (r.x0 < box.x0) box.x0 = r.x0;
+        if (r.y0 < box.y0) box.y0 = r.y0;
+        if (r.x1 > box.x1) box.x1 = r.x1;
+        if (r.y1 > box.y1) box.y1 = r.y1;
+    }
+}
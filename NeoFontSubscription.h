@@ -0,0 +1,59 @@
+/** @file       NeoFontSubscription.h
+ *  @brief      Record of the changes made to a font, used to update views and caches incrementally.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+#ifndef _NEOFONTSUBSCRIPTION_H_
+#define _NEOFONTSUBSCRIPTION_H_     (1)
+
+#include <stdint.h>
+#include "NeoFont.h"
+
+
+
+/** Class that collects the changes made to a font. The subscription is attached to the font for its
+ *  lifetime, and is informed of every change to a character (with the bounding box of the changed
+ *  pixels) or to a font field. The owner reads the changes when convenient, updates whatever depends
+ *  on them, and then calls clear().
+ *
+ *  Any number of subscriptions can be attached to a font, each with its own record of changes.
+ */
+class NeoFontSubscription
+{
+public:
+
+    NeoFontSubscription(NeoFont *font);
+    ~NeoFontSubscription();
+
+    NeoFont *font() const;
+
+    bool isEmpty() const;
+    unsigned int fields() const;
+    const uint64_t *characters() const;
+    int characterCount() const;
+    bool isDirty(int index) const;
+    int nextDirty(int index) const;
+    NeoCharacterRect dirtyRect(int index) const;
+
+    void markCharacter(int index);
+    void markAll();
+    void clear();
+
+private:
+
+    NeoFont *m_font;                                        /**< The font. */
+    NeoFontSubscription *m_next;                            /**< The next subscription to the same font. */
+    unsigned int m_fields;                                  /**< Fields changed (kNeoFontField... values). */
+    uint64_t m_dirty[kNeoFontCharacterSetWords];            /**< Set of characters changed. */
+    NeoCharacterRect m_rects[kNeoFontCharacterCount];       /**< Pixels changed in each changed character. */
+
+    NeoFontSubscription(const NeoFontSubscription &other);
+    NeoFontSubscription &operator=(const NeoFontSubscription &other);
+
+    void addCharacter(int index, const NeoCharacterRect &r);
+
+    friend class NeoFont;
+};
+
+
+
+#endif  // _NEOFONTSUBSCRIPTION_H_
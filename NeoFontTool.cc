@@ -0,0 +1,895 @@
+/** @file       NeoFontTool.cc
+ *  @brief      Command line tool used to convert Neo fonts in bulk, without the Cocoa editor.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "NeoFont.h"
+#include "NeoFontAnalysis.h"
+#include "NeoFontOptimizer.h"
+#include "NeoAppletCorpus.h"
+#include "NeoFontPack.h"
+#include "NeoAppletFormat.h"
+#include "NeoAppletView.h"
+#include "NeoCharacterEncoding.h"
+#include "NeoFrameBuffer.h"
+#include "NeoTextLayout.h"
+#include "PresetFonts.h"
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      Types.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+#define kToolFormatApplet           (0)             /**< Output a smart applet. */
+#define kToolFormatArchive          (1)             /**< Output a font archive. */
+#define kToolFormatPBM              (2)             /**< Output a preview of the Neo screen as a PBM image. */
+#define kToolFormatPNG              (3)             /**< Output a preview of the Neo screen as a PNG image. */
+#define kToolFormatJSON             (4)             /**< Output a JSON report of the font metrics. */
+
+#define kToolExtApplet              ".OS3KApp"      /**< File extension used for smart applets. */
+#define kToolExtArchive             ".neofont"      /**< File extension used for font archives. */
+#define kToolExtPBM                 ".pbm"          /**< File extension used for PBM previews. */
+#define kToolExtPNG                 ".png"          /**< File extension used for PNG previews. */
+#define kToolExtJSON                ".json"         /**< File extension used for metrics reports. */
+#define kToolOutputSuffix           "-out"          /**< Added to an output name that would overwrite its input. */
+#define kToolPresetPrefix           "preset:"       /**< Input prefix used to select a preset font. */
+
+#define kToolMaxThreads             (64)            /**< Maximum number of worker threads. */
+#define kToolMaxEncodingSize        (1 << 20)       /**< Largest encoding table file read. */
+#define kToolMaxScoreSize           (256 << 20)     /**< Largest text file laid out by -s. */
+
+#define kToolPreviewText            "The quick brown fox jumps over the lazy dog.\n0123456789 !\"#$%&'()*+,-./:;<=>?@[]"   /**< Default preview text. */
+
+
+/** File extension for each output format.
+ */
+static const char *tool_extensions[] = { kToolExtApplet, kToolExtArchive, kToolExtPBM, kToolExtPNG, kToolExtJSON };
+
+
+/** Options that apply to every file converted.
+ */
+struct ToolOptions
+{
+    int format;                     /**< The output format (kToolFormatApplet etc). */
+    const char *outputDirectory;    /**< Output directory, or zero to write next to the input. */
+    const char *fontName;           /**< Replacement font name, or zero. */
+    const char *appletInfo;         /**< Replacement applet info string, or zero. */
+    const char *version;            /**< Replacement version string, or zero. */
+    int ident;                      /**< Replacement applet ID, or -1. */
+    const char *previewText;        /**< Text drawn in preview images (UTF-8). Lines are separated by newlines. */
+    const char *encoding;           /**< Encoding name or table file used to convert the preview text. */
+    uint8_t *previewCodes;          /**< The preview text as Neo character codes. */
+    unsigned int previewLength;     /**< The number of characters in previewCodes. */
+    int threads;                    /**< Number of worker threads. */
+    bool quiet;                     /**< Logical true to suppress the per-file report. */
+    bool list;                      /**< Logical true to list the applets instead of converting them. */
+    const char *pack;               /**< Font pack to write all of the inputs to, or zero. */
+    const char *score;              /**< Text file to lay out with each input font instead of converting, or zero. */
+    bool optimise;                  /**< Logical true to trim blank columns and rows before converting. */
+    int leftBearing;                /**< Most blank columns kept left of each glyph, or kNeoTrimKeep. */
+    int rightBearing;               /**< Most blank columns kept right of each glyph, or kNeoTrimKeep. */
+    int heightMode;                 /**< How the font height is lowered (kNeoTrimHeightKeep etc). */
+    bool raise;                     /**< Logical true to move the ink up when lowering the height. */
+};
+
+
+/** A single conversion.
+ */
+struct ToolJob
+{
+    const char *input;              /**< Input file name, or preset specifier. */
+    char output[1024];              /**< Output file name. */
+    bool ok;                        /**< Logical true if the conversion succeeded. */
+    const char *error;              /**< Description of the failure. */
+    unsigned int bytesIn;           /**< Number of bytes read. */
+    unsigned int bytesOut;          /**< Number of bytes written. */
+    unsigned int bytesSaved;        /**< Number of applet bytes saved by trimming the font. */
+    double seconds;                 /**< Time taken. */
+};
+
+
+/** State shared by all worker threads.
+ */
+struct ToolQueue
+{
+    const ToolOptions *options;     /**< The conversion options. */
+    ToolJob *jobs;                  /**< The list of jobs. */
+    int jobCount;                   /**< The number of jobs. */
+    int nextJob;                    /**< Index of the next job to start. */
+    pthread_mutex_t lock;           /**< Lock for nextJob and the report output. */
+};
+
+
+/** Per-thread state. The font and the buffers are reused for every file handled by the worker.
+ */
+struct ToolWorker
+{
+    ToolQueue *queue;               /**< The shared queue. */
+    NeoFont font;                   /**< Font used for conversions. */
+    NeoFrameBuffer screen;          /**< Frame buffer used for previews. */
+    NeoTextLayout layout;           /**< Layout of the preview text. */
+    NeoFontAnalysis analysis;       /**< Metrics of the font, for reports. */
+    NeoFontOptimizer optimizer;     /**< Trims the font, if requested. */
+    uint8_t *buffer;                /**< Input and output buffer. */
+    unsigned int capacity;          /**< Size of the buffer. */
+};
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      Private Functions.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Read the monotonic clock.
+ *
+ *  @return         The time, in seconds.
+ */
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec * 1e-9);
+}
+
+
+/** Make sure that a worker buffer is at least a given size.
+ *
+ *  @param  worker  The worker.
+ *  @param  size    The required size, in bytes.
+ *  @return         Logical true if the buffer is large enough.
+ */
+static bool reserve(ToolWorker *worker, unsigned int size)
+{
+    if (size > worker->capacity)
+    {
+        uint8_t *buffer = (uint8_t *) realloc(worker->buffer, size);
+        if (0 == buffer) return false;
+        worker->buffer = buffer;
+        worker->capacity = size;
+    }
+    return true;
+}
+
+
+/** Build the output file name for an input. If that would name the input file itself, as when converting
+ *  an applet to an applet in place, kToolOutputSuffix is added to the name so that the input is kept.
+ *
+ *  @param  job     The job. The output name is written to job->output.
+ *  @param  options The conversion options.
+ */
+static void makeOutputName(ToolJob *job, const ToolOptions *options)
+{
+    const char *input = job->input;
+    char stem[512];
+    if (0 == strncmp(input, kToolPresetPrefix, strlen(kToolPresetPrefix)))
+    {
+        snprintf(stem, sizeof stem, "preset-%s", input + strlen(kToolPresetPrefix));
+    }
+    else
+    {
+        const char *base = strrchr(input, '/');
+        base = (0 == base) ? input : (base + 1);
+        snprintf(stem, sizeof stem, "%s", (0 == options->outputDirectory) ? input : base);
+        char *dot = strrchr(stem, '.');
+        char *slash = strrchr(stem, '/');
+        if (0 != dot && (0 == slash || dot > slash)) *dot = 0;
+    }
+
+    const char *ext = tool_extensions[options->format];
+    const char *suffix = "";
+    for (int pass = 0; pass < 2; pass++)
+    {
+        if (0 == options->outputDirectory) snprintf(job->output, sizeof job->output, "%s%s%s", stem, suffix, ext);
+        else snprintf(job->output, sizeof job->output, "%s/%s%s%s", options->outputDirectory, stem, suffix, ext);
+
+        struct stat in;
+        struct stat out;
+        if (0 != stat(input, &in) || 0 != stat(job->output, &out) || in.st_dev != out.st_dev || in.st_ino != out.st_ino) break;
+        suffix = kToolOutputSuffix;
+    }
+}
+
+
+/** Load the input for a job in to the worker's font.
+ *
+ *  @param  worker  The worker.
+ *  @param  job     The job.
+ *  @return         Logical true if the font was loaded.
+ */
+static bool loadInput(ToolWorker *worker, ToolJob *job)
+{
+    if (0 == strncmp(job->input, kToolPresetPrefix, strlen(kToolPresetPrefix)))
+    {
+        job->error = "unknown preset";
+        return worker->font.initWithPreset(atoi(job->input + strlen(kToolPresetPrefix)));
+    }
+
+    FILE *file = fopen(job->input, "rb");
+    if (0 == file)
+    {
+        job->error = "cannot open input";
+        return false;
+    }
+    unsigned int length = 0;
+    size_t count;
+    do
+    {
+        if (!reserve(worker, length + 65536))
+        {
+            fclose(file);
+            job->error = "out of memory";
+            return false;
+        }
+        count = fread(worker->buffer + length, 1, worker->capacity - length, file);
+        length += count;
+    } while (count > 0);
+    fclose(file);
+    job->bytesIn = length;
+
+    if (length >= 4 && XB32(worker->buffer, kAppletOffMagic1) == kMagic1)
+    {
+        int error;
+        bool valid = worker->font.decodeApplet(worker->buffer, length, &error);
+        job->error = NeoAppletView::errorText(error);
+        return valid;
+    }
+    else
+    {
+        job->error = "unrecognised input format";
+        return worker->font.loadArchive(worker->buffer, length);
+    }
+}
+
+
+/** Draw the first screen of the preview text in the worker's frame buffer. Lines are wrapped to the screen
+ *  width as on the Neo.
+ *
+ *  @param  worker  The worker.
+ *  @param  text    The text, as Neo character codes.
+ *  @param  length  The number of characters.
+ */
+static void renderPreview(ToolWorker *worker, const uint8_t *text, unsigned int length)
+{
+    NeoFrameBuffer *screen = &worker->screen;
+    NeoTextLayout *layout = &worker->layout;
+    layout->layout(&worker->font, text, length, screen->width(), screen->height());
+    screen->clear();
+    for (unsigned int i = 0; i < layout->linesPerPage() && i < layout->lineCount(); i++)
+    {
+        const NeoTextLine *line = layout->line(i);
+        screen->drawText(&worker->font, &text[line->start], line->length, 0, i * layout->lineHeight());
+    }
+}
+
+
+/** Write the worker's font to the output for a job.
+ *
+ *  @param  worker  The worker.
+ *  @param  job     The job.
+ *  @return         Logical true if the output was written.
+ */
+static bool saveOutput(ToolWorker *worker, ToolJob *job)
+{
+    const ToolOptions *options = worker->queue->options;
+    unsigned int length;
+    if (kToolFormatApplet == options->format)
+    {
+        length = worker->font.appletSize();
+        if (!reserve(worker, length))
+        {
+            job->error = "out of memory";
+            return false;
+        }
+        length = worker->font.encodeApplet(worker->buffer, length);
+    }
+    else if (kToolFormatArchive == options->format)
+    {
+        length = worker->font.archiveSize();
+        if (!reserve(worker, length))
+        {
+            job->error = "out of memory";
+            return false;
+        }
+        worker->font.saveArchive(worker->buffer);
+    }
+    else if (kToolFormatJSON == options->format)
+    {
+        worker->analysis.analyse(&worker->font);
+        length = worker->analysis.jsonSize();
+        if (!reserve(worker, length))
+        {
+            job->error = "out of memory";
+            return false;
+        }
+        length = worker->analysis.encodeJSON((char *) worker->buffer, length);
+    }
+    else
+    {
+        renderPreview(worker, options->previewCodes, options->previewLength);
+        length = (kToolFormatPBM == options->format) ? worker->screen.pbmSize() : worker->screen.pngSize();
+        if (!reserve(worker, length))
+        {
+            job->error = "out of memory";
+            return false;
+        }
+        if (kToolFormatPBM == options->format) length = worker->screen.encodePBM(worker->buffer, length);
+        else length = worker->screen.encodePNG(worker->buffer, length);
+    }
+
+    FILE *file = fopen(job->output, "wb");
+    if (0 == file)
+    {
+        job->error = "cannot create output";
+        return false;
+    }
+    bool ok = (fwrite(worker->buffer, 1, length, file) == length);
+    ok = (0 == fclose(file)) && ok;
+    if (!ok)
+    {
+        job->error = "write failed";
+        return false;
+    }
+    job->bytesOut = length;
+    return true;
+}
+
+
+/** Apply the metadata changes requested on the command line.
+ *
+ *  @param  font    The font to modify.
+ *  @param  options The conversion options.
+ */
+static void applyMetadata(NeoFont *font, const ToolOptions *options)
+{
+    if (0 != options->fontName) font->setFontName(options->fontName);
+    if (0 != options->appletInfo) font->setAppletInfo(options->appletInfo);
+    if (0 != options->version) font->setVersion(options->version);
+    if (options->ident >= 0) font->setIdent(options->ident);
+}
+
+
+/** Trim blank columns and rows from the worker's font, as requested on the command line.
+ *
+ *  @param  worker  The worker.
+ *  @param  options The conversion options.
+ *  @param  job     The job. The applet bytes saved are written to job->bytesSaved.
+ */
+static void optimiseFont(ToolWorker *worker, const ToolOptions *options, ToolJob *job)
+{
+    NeoFontOptimizer *optimizer = &worker->optimizer;
+    optimizer->setBearings(options->leftBearing, options->rightBearing);
+    optimizer->setHeightMode(options->heightMode);
+    optimizer->setRaise(options->raise);
+    optimizer->apply(&worker->font);
+    job->bytesSaved = optimizer->savedBytes();
+}
+
+
+/** Worker thread. Jobs are taken from the shared queue until none remain.
+ *
+ *  @param  context The ToolWorker object for the thread.
+ *  @return         Zero.
+ */
+static void *workerThread(void *context)
+{
+    ToolWorker *worker = (ToolWorker *) context;
+    ToolQueue *queue = worker->queue;
+    for (;;)
+    {
+        pthread_mutex_lock(&queue->lock);
+        int index = queue->nextJob++;
+        pthread_mutex_unlock(&queue->lock);
+        if (index >= queue->jobCount) break;
+
+        ToolJob *job = &queue->jobs[index];
+        double start = now();
+        makeOutputName(job, queue->options);
+        job->ok = loadInput(worker, job);
+        if (job->ok)
+        {
+            applyMetadata(&worker->font, queue->options);
+            if (queue->options->optimise) optimiseFont(worker, queue->options, job);
+            job->ok = saveOutput(worker, job);
+        }
+        job->seconds = now() - start;
+
+        if (!queue->options->quiet || !job->ok)
+        {
+            pthread_mutex_lock(&queue->lock);
+            if (job->ok && queue->options->optimise)
+            {
+                printf("%s -> %s: %u bytes (%u applet bytes trimmed), %.3f ms\n", job->input, job->output, job->bytesOut,
+                       job->bytesSaved, job->seconds * 1e3);
+            }
+            else if (job->ok) printf("%s -> %s: %u bytes, %.3f ms\n", job->input, job->output, job->bytesOut, job->seconds * 1e3);
+            else fprintf(stderr, "%s: %s\n", job->input, job->error);
+            pthread_mutex_unlock(&queue->lock);
+        }
+    }
+    return 0;
+}
+
+
+/** Convert the two character sequence "\\n" in a command line argument to a newline, in place.
+ *
+ *  @param  text    The argument.
+ *  @return         The converted argument.
+ */
+static char *unescapeText(char *text)
+{
+    char *out = text;
+    for (const char *in = text; 0 != *in; in++)
+    {
+        if ('\\' == in[0] && 'n' == in[1])
+        {
+            *out++ = '\n';
+            in++;
+        }
+        else
+        {
+            *out++ = *in;
+        }
+    }
+    *out = 0;
+    return text;
+}
+
+
+/** Read a whole file.
+ *
+ *  @param  name    The file name.
+ *  @param  length  Receives the length of the file.
+ *  @param  limit   The largest file accepted, in bytes.
+ *  @return         The file contents, to be freed by the caller, or zero if the file could not be read or is
+ *                  too large.
+ */
+static uint8_t *readFile(const char *name, unsigned int *length, unsigned int limit)
+{
+    FILE *file = fopen(name, "rb");
+    if (0 == file) return 0;
+    uint8_t *data = 0;
+    unsigned int used = 0;
+    size_t count;
+    do
+    {
+        uint8_t *grown = (uint8_t *) realloc(data, used + 65536);
+        if (0 == grown)
+        {
+            used = limit + 1;
+            break;
+        }
+        data = grown;
+        count = fread(data + used, 1, 65536, file);
+        used += count;
+    } while (count > 0 && used <= limit);
+    fclose(file);
+    if (used > limit)
+    {
+        free(data);
+        return 0;
+    }
+    *length = used;
+    return data;
+}
+
+
+/** Find a built-in encoding by name, or load an encoding table from a file (see NeoEncoding::load()).
+ *
+ *  @param  name    The encoding name or table file name.
+ *  @param  owned   Receives the loaded encoding, which the caller must delete, or zero for a built-in.
+ *  @return         The encoding, or zero if it could not be found or loaded.
+ */
+static const NeoEncoding *loadEncoding(const char *name, NeoEncoding **owned)
+{
+    *owned = 0;
+    for (int i = 0; i < kNeoEncodingBuiltInCount; i++)
+    {
+        if (0 == strcmp(name, NeoEncoding::builtIn(i)->name())) return NeoEncoding::builtIn(i);
+    }
+
+    unsigned int length;
+    uint8_t *data = readFile(name, &length, kToolMaxEncodingSize);
+    if (0 != data) *owned = NeoEncoding::load(data, length);
+    free(data);
+    return *owned;
+}
+
+
+/** Convert UTF-8 text to Neo character codes.
+ *
+ *  @param  text        The text.
+ *  @param  length      The number of bytes of text.
+ *  @param  encoding    The encoding.
+ *  @param  codes       Receives the Neo character codes, to be freed by the caller.
+ *  @return             The number of Neo characters.
+ */
+static unsigned int transcodeText(const uint8_t *text, unsigned int length, const NeoEncoding *encoding, uint8_t **codes)
+{
+    NeoUTF8Transcoder transcoder('?', true, encoding);
+    *codes = (uint8_t *) malloc(length + kNeoTranscodeSlack);
+    unsigned int count = transcoder.transcode(text, length, *codes);
+    return count + transcoder.finish(&(*codes)[count]);
+}
+
+
+/** List the applets in a set of files, pack files and directories. Only the applet headers are read.
+ *
+ *  @param  count   The number of inputs.
+ *  @param  inputs  The input file and directory names.
+ *  @return         The process exit code.
+ */
+static int listApplets(int count, char **inputs)
+{
+    NeoAppletCorpus corpus;
+    double start = now();
+    int failed = 0;
+    for (int i = 0; i < count; i++)
+    {
+        struct stat st;
+        bool ok = (0 == stat(inputs[i], &st) && S_ISDIR(st.st_mode)) ? (corpus.addDirectory(inputs[i]) >= 0) : corpus.addFile(inputs[i]);
+        if (!ok)
+        {
+            fprintf(stderr, "%s: cannot read input\n", inputs[i]);
+            failed++;
+        }
+    }
+
+    for (unsigned int i = 0; i < corpus.count(); i++)
+    {
+        const NeoAppletView *v = corpus.header(i);
+        if (0 == v)
+        {
+            fprintf(stderr, "%s@%u: invalid applet\n", corpus.path(i), corpus.offset(i));
+            failed++;
+            continue;
+        }
+        char version[16];
+        if (' ' == v->versionBuild()) snprintf(version, sizeof version, "%d.%d", v->versionMajor(), v->versionMinor());
+        else snprintf(version, sizeof version, "%d.%d%c", v->versionMajor(), v->versionMinor(), v->versionBuild());
+        printf("%s@%u\t0x%04x\t%s\t%s\t%s\n", corpus.path(i), corpus.offset(i), v->ident(), version, v->fontName(), v->appletName());
+    }
+    printf("%u applets (%d failed) in %.3f s\n", corpus.count(), failed, now() - start);
+    return (0 == failed) ? 0 : 1;
+}
+
+
+/** Write every input font in to a single font pack. Glyphs shared between the fonts are stored once.
+ *
+ *  @param  options The conversion options.
+ *  @param  count   The number of inputs.
+ *  @param  inputs  The input file names and preset specifiers.
+ *  @return         The process exit code.
+ */
+static int packFonts(const ToolOptions *options, int count, char **inputs)
+{
+    ToolWorker *worker = new ToolWorker;
+    worker->buffer = 0;
+    worker->capacity = 0;
+    NeoFontPackWriter *writer = new NeoFontPackWriter;
+    double start = now();
+    int failed = 0;
+    uint64_t bytes_in = 0;
+    for (int i = 0; i < count; i++)
+    {
+        ToolJob job;
+        memset(&job, 0, sizeof job);
+        job.input = inputs[i];
+        if (!loadInput(worker, &job))
+        {
+            fprintf(stderr, "%s: %s\n", job.input, job.error);
+            failed++;
+            continue;
+        }
+        applyMetadata(&worker->font, options);
+        if (options->optimise) optimiseFont(worker, options, &job);
+        writer->add(&worker->font);
+        bytes_in += job.bytesIn;
+    }
+
+    unsigned int length = writer->size();
+    bool ok = reserve(worker, length);
+    if (ok)
+    {
+        writer->save(worker->buffer, length);
+        FILE *file = fopen(options->pack, "wb");
+        ok = (0 != file) && (fwrite(worker->buffer, 1, length, file) == length);
+        ok = (0 != file) && (0 == fclose(file)) && ok;
+    }
+    if (!ok)
+    {
+        fprintf(stderr, "%s: write failed\n", options->pack);
+        failed++;
+    }
+    printf("%u fonts (%d failed), %u distinct glyphs, %llu bytes in, %u bytes out in %.3f s\n",
+           writer->fontCount(), failed, writer->glyphCount(), (unsigned long long)bytes_in, length, now() - start);
+
+    free(worker->buffer);
+    delete writer;
+    delete worker;
+    return (0 == failed) ? 0 : 1;
+}
+
+
+/** Lay out a text file with each input font and report the number of lines and screens it fills, and the
+ *  average number of characters on a screen.
+ *
+ *  @param  options     The conversion options.
+ *  @param  encoding    The encoding of the text.
+ *  @param  count       The number of inputs.
+ *  @param  inputs      The input file names and preset specifiers.
+ *  @return             The process exit code.
+ */
+static int scoreFonts(const ToolOptions *options, const NeoEncoding *encoding, int count, char **inputs)
+{
+    unsigned int length;
+    uint8_t *text = readFile(options->score, &length, kToolMaxScoreSize);
+    if (0 == text)
+    {
+        fprintf(stderr, "%s: cannot read text\n", options->score);
+        return 1;
+    }
+    uint8_t *codes;
+    length = transcodeText(text, length, encoding, &codes);
+    free(text);
+
+    ToolWorker *worker = new ToolWorker;
+    worker->buffer = 0;
+    worker->capacity = 0;
+    double start = now();
+    double layout_time = 0.0;
+    int failed = 0;
+    for (int i = 0; i < count; i++)
+    {
+        ToolJob job;
+        memset(&job, 0, sizeof job);
+        job.input = inputs[i];
+        if (!loadInput(worker, &job))
+        {
+            fprintf(stderr, "%s: %s\n", job.input, job.error);
+            failed++;
+            continue;
+        }
+        if (options->optimise) optimiseFont(worker, options, &job);
+        double layout_start = now();
+        worker->layout.layout(&worker->font, codes, length, worker->screen.width(), worker->screen.height());
+        layout_time += now() - layout_start;
+        printf("%s\t%u lines\t%u screens\t%.1f characters/screen\n", job.input, worker->layout.lineCount(),
+               worker->layout.pageCount(), worker->layout.charactersPerPage());
+    }
+    printf("%d fonts (%d failed), %u characters of text in %.3f s (%.3f ms/layout)\n", count, failed, length, now() - start,
+           (count > failed) ? ((layout_time / (count - failed)) * 1e3) : 0.0);
+
+    free(worker->buffer);
+    delete worker;
+    free(codes);
+    return (0 == failed) ? 0 : 1;
+}
+
+
+/** Print the command line usage.
+ *
+ *  @param  name    The program name.
+ */
+static void usage(const char *name)
+{
+    fprintf(stderr,
+        "usage: %s [options] input...\n"
+        "\n"
+        "Converts Neo font applets (" kToolExtApplet "), font archives (" kToolExtArchive ") and preset fonts.\n"
+        "Use " kToolPresetPrefix "N as an input to select preset font N. The pbm and png formats write an\n"
+        "image of the first Neo screen of the preview text, wrapped to the screen width. The json format\n"
+        "writes a report of the glyph metrics.\n"
+        "\n"
+        "  -f format           output format: applet, archive, pbm, png or json (default applet)\n"
+        "  -t text             preview text (UTF-8), with \\n between lines\n"
+        "  -e encoding         encoding of the preview text: neo (default), controls, or an encoding\n"
+        "                      table file\n"
+        "  -o dir              output directory (default: next to each input). An output that would\n"
+        "                      replace its input is named with a " kToolOutputSuffix " suffix instead\n"
+        "  -n name             set the font name (and the applet name)\n"
+        "  -a info             set the applet info string\n"
+        "  -v version          set the version, e.g. 1.2a\n"
+        "  -i id               set the applet ID (decimal or 0x hex)\n"
+        "  -j threads          number of worker threads (default 1)\n"
+        "  -q                  only report failures and the summary\n"
+        "  -l                  list the ID, version and names of the applets in each input instead of\n"
+        "                      converting them. Inputs may be applets, packs of applets stored back to\n"
+        "                      back, or directories of " kToolExtApplet " files.\n"
+        "  -p pack             write every input to a single font pack, sharing identical glyphs\n"
+        "  -s text             lay out a text file (UTF-8) with each input font instead of converting, and\n"
+        "                      report the lines, screens and characters per screen it needs\n"
+        "  -b left,right       trim the blank columns either side of each glyph to at most left and\n"
+        "                      right columns (either may be empty to leave that side alone)\n"
+        "  -r tight|strip      lower the font height to the last row holding ink (tight), or only by\n"
+        "                      whole 8-row strips (strip). Nothing is trimmed unless -b or -r is given\n"
+        "  -R tight|strip      as -r, but first move the ink up in to rows blank in every glyph\n",
+        name);
+}
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      Entry point.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+int main(int argc, char **argv)
+{
+    ToolOptions options;
+    options.format = kToolFormatApplet;
+    options.outputDirectory = 0;
+    options.fontName = 0;
+    options.appletInfo = 0;
+    options.version = 0;
+    options.ident = -1;
+    options.previewText = kToolPreviewText;
+    options.encoding = "neo";
+    options.threads = 1;
+    options.quiet = false;
+    options.list = false;
+    options.pack = 0;
+    options.score = 0;
+    options.optimise = false;
+    options.leftBearing = kNeoTrimKeep;
+    options.rightBearing = kNeoTrimKeep;
+    options.heightMode = kNeoTrimHeightKeep;
+    options.raise = false;
+
+    int arg = 1;
+    for (; arg < argc && '-' == argv[arg][0]; arg++)
+    {
+        const char *opt = argv[arg];
+        const char *value = (arg + 1 < argc) ? argv[arg + 1] : 0;
+        if (0 == strcmp(opt, "-q"))
+        {
+            options.quiet = true;
+            continue;
+        }
+        if (0 == strcmp(opt, "-l"))
+        {
+            options.list = true;
+            continue;
+        }
+        if (0 == value || 0 != opt[2])
+        {
+            usage(argv[0]);
+            return 2;
+        }
+        switch (opt[1])
+        {
+            case 'f':
+                if (0 == strcmp(value, "applet")) options.format = kToolFormatApplet;
+                else if (0 == strcmp(value, "archive")) options.format = kToolFormatArchive;
+                else if (0 == strcmp(value, "pbm")) options.format = kToolFormatPBM;
+                else if (0 == strcmp(value, "png")) options.format = kToolFormatPNG;
+                else if (0 == strcmp(value, "json")) options.format = kToolFormatJSON;
+                else { usage(argv[0]); return 2; }
+                break;
+            case 'o':   options.outputDirectory = value;                    break;
+            case 'n':   options.fontName = value;                           break;
+            case 'a':   options.appletInfo = value;                         break;
+            case 'v':   options.version = value;                            break;
+            case 't':   options.previewText = unescapeText(argv[arg + 1]);  break;
+            case 'e':   options.encoding = value;                           break;
+            case 'i':   options.ident = (int) strtol(value, 0, 0) & 0xffff; break;
+            case 'j':   options.threads = atoi(value);                      break;
+            case 'p':   options.pack = value;                               break;
+            case 's':   options.score = value;                              break;
+            case 'b':
+            {
+                const char *comma = strchr(value, ',');
+                if (0 == comma) { usage(argv[0]); return 2; }
+                options.leftBearing = (comma == value) ? kNeoTrimKeep : atoi(value);
+                options.rightBearing = (0 == comma[1]) ? kNeoTrimKeep : atoi(comma + 1);
+                options.optimise = true;
+                break;
+            }
+            case 'r':
+            case 'R':
+                if (0 == strcmp(value, "tight")) options.heightMode = kNeoTrimHeightTight;
+                else if (0 == strcmp(value, "strip")) options.heightMode = kNeoTrimHeightStrip;
+                else { usage(argv[0]); return 2; }
+                options.raise = ('R' == opt[1]);
+                options.optimise = true;
+                break;
+            default:    usage(argv[0]);                                     return 2;
+        }
+        arg++;
+    }
+    if (arg >= argc)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+    if (options.list)
+    {
+        return listApplets(argc - arg, &argv[arg]);
+    }
+    if (0 != options.pack)
+    {
+        return packFonts(&options, argc - arg, &argv[arg]);
+    }
+    if (options.threads < 1) options.threads = 1;
+    if (options.threads > kToolMaxThreads) options.threads = kToolMaxThreads;
+
+    NeoEncoding *loaded_encoding;
+    const NeoEncoding *encoding = loadEncoding(options.encoding, &loaded_encoding);
+    if (0 == encoding)
+    {
+        fprintf(stderr, "%s: unknown encoding or invalid encoding table\n", options.encoding);
+        return 2;
+    }
+    if (0 != options.score)
+    {
+        int result = scoreFonts(&options, encoding, argc - arg, &argv[arg]);
+        delete loaded_encoding;
+        return result;
+    }
+    options.previewLength = transcodeText((const uint8_t *) options.previewText, strlen(options.previewText), encoding, &options.previewCodes);
+
+    ToolQueue queue;
+    queue.options = &options;
+    queue.jobCount = argc - arg;
+    queue.jobs = (ToolJob *) calloc(queue.jobCount, sizeof (ToolJob));
+    queue.nextJob = 0;
+    pthread_mutex_init(&queue.lock, 0);
+    for (int i = 0; i < queue.jobCount; i++) queue.jobs[i].input = argv[arg + i];
+
+    if (options.threads > queue.jobCount) options.threads = queue.jobCount;
+    ToolWorker *workers = new ToolWorker[options.threads];
+    pthread_t threads[kToolMaxThreads];
+
+    double start = now();
+    for (int i = 0; i < options.threads; i++)
+    {
+        workers[i].queue = &queue;
+        workers[i].buffer = 0;
+        workers[i].capacity = 0;
+        if (0 != i) pthread_create(&threads[i], 0, workerThread, &workers[i]);
+    }
+    workerThread(&workers[0]);
+    for (int i = 1; i < options.threads; i++) pthread_join(threads[i], 0);
+    double elapsed = now() - start;
+
+    /* Summarise the run.
+     */
+    int failed = 0;
+    double busy = 0.0;
+    uint64_t bytes_in = 0;
+    uint64_t bytes_out = 0;
+    for (int i = 0; i < queue.jobCount; i++)
+    {
+        if (!queue.jobs[i].ok) failed++;
+        busy += queue.jobs[i].seconds;
+        bytes_in += queue.jobs[i].bytesIn;
+        bytes_out += queue.jobs[i].bytesOut;
+    }
+    printf("%d files (%d failed) in %.3f s on %d threads: %.1f files/s, %.2f MB/s in, %.2f MB/s out, %.3f ms/file\n",
+           queue.jobCount, failed, elapsed, options.threads,
+           queue.jobCount / elapsed, (bytes_in / 1e6) / elapsed, (bytes_out / 1e6) / elapsed,
+           (busy / queue.jobCount) * 1e3);
+
+    for (int i = 0; i < options.threads; i++) free(workers[i].buffer);
+    delete[] workers;
+    pthread_mutex_destroy(&queue.lock);
+    free(queue.jobs);
+    free(options.previewCodes);
+    delete loaded_encoding;
+    return (0 == failed) ? 0 : 1;
+}
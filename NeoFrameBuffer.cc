@@ -0,0 +1,437 @@
+/** @file       NeoFrameBuffer.cc
+ *  @brief      1 bit per pixel frame buffer used to render text with a NeoFont.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "NeoFrameBuffer.h"
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      Private Data.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+#define kPNGStoredBlockMax      (65535)     /**< Maximum number of bytes in a stored deflate block. */
+
+
+/** PNG file signature.
+ */
+static const uint8_t png_signature[] = { 0x89, 'P', 'N', 'G', 0x0d, 0x0a, 0x1a, 0x0a };
+
+
+/** CRC-32 lookup table (polynomial 0xedb88320), indexed by four bits at a time.
+ */
+static const uint32_t crc_table[16] =
+{
+    0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+    0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c
+};
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      Private Functions.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Mask of the valid bits in the last word of a row.
+ *
+ *  @param  w       The row width, in pixels.
+ *  @return         The mask.
+ */
+static inline uint64_t tailMask(int w)
+{
+    return (0 == (w & 63)) ? ~((uint64_t)0) : ((((uint64_t)1) << (w & 63)) - 1);
+}
+
+
+/** Reverse the order of the bits within each byte of a word.
+ */
+static inline uint64_t reverseByteBits(uint64_t v)
+{
+    v = ((v >> 1) & 0x5555555555555555ull) | ((v & 0x5555555555555555ull) << 1);
+    v = ((v >> 2) & 0x3333333333333333ull) | ((v & 0x3333333333333333ull) << 2);
+    v = ((v >> 4) & 0x0f0f0f0f0f0f0f0full) | ((v & 0x0f0f0f0f0f0f0f0full) << 4);
+    return v;
+}
+
+
+/** Update a CRC-32.
+ *
+ *  @param  crc     The CRC so far (initially 0xffffffff).
+ *  @param  data    The data.
+ *  @param  length  The number of bytes of data.
+ *  @return         The updated CRC. This must be inverted once all data has been added.
+ */
+static uint32_t updateCRC(uint32_t crc, const uint8_t *data, unsigned int length)
+{
+    for (unsigned int i = 0; i < length; i++)
+    {
+        crc ^= data[i];
+        crc = crc_table[crc & 15] ^ (crc >> 4);
+        crc = crc_table[crc & 15] ^ (crc >> 4);
+    }
+    return crc;
+}
+
+
+/** Helper function used to write a 32 bit big endian value to a byte array.
+ *
+ *  @param  data    The data array.
+ *  @param  value   The value to write.
+ */
+static void write32b(uint8_t *data, uint32_t value)
+{
+    data[0] = (value >> 24) & 255;
+    data[1] = (value >> 16) & 255;
+    data[2] = (value >>  8) & 255;
+    data[3] = (value >>  0) & 255;
+}
+
+
+/** Write a PNG chunk.
+ *
+ *  @param  out     Where to write the chunk. The chunk data must already be in place, 8 bytes after this.
+ *  @param  type    The four character chunk type.
+ *  @param  length  The number of bytes of chunk data.
+ *  @return         The total size of the chunk, in bytes.
+ */
+static unsigned int finishChunk(uint8_t *out, const char *type, unsigned int length)
+{
+    write32b(out, length);
+    memcpy(out + 4, type, 4);
+    uint32_t crc = updateCRC(0xffffffffu, out + 4, length + 4);
+    write32b(out + 8 + length, crc ^ 0xffffffffu);
+    return length + 12;
+}
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      NeoFrameBuffer class definition.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Class constructor. The frame buffer is initially clear.
+ *
+ *  @param  width   Width, in pixels.
+ *  @param  height  Height, in pixels.
+ */
+NeoFrameBuffer::NeoFrameBuffer(int width, int height)
+    :
+        m_width((width > 0) ? width : 1),
+        m_height((height > 0) ? height : 1),
+        m_rowWords((m_width + 63) / 64),
+        m_bitmap(new uint64_t[m_rowWords * m_height]())
+{
+    // Nothing.
+}
+
+
+/** Class destructor.
+ */
+NeoFrameBuffer::~NeoFrameBuffer()
+{
+    delete[] m_bitmap;
+}
+
+
+/** Return the width, in pixels.
+ */
+int NeoFrameBuffer::width() const
+{
+    return m_width;
+}
+
+
+/** Return the height, in pixels.
+ */
+int NeoFrameBuffer::height() const
+{
+    return m_height;
+}
+
+
+/** Return the number of 64 bit words in each row.
+ */
+int NeoFrameBuffer::rowWords() const
+{
+    return m_rowWords;
+}
+
+
+/** Obtain read access to a row of pixels.
+ *
+ *  @param  y       Vertical coordinate, in the range 0 to height() - 1.
+ *  @return         A pointer to rowWords() words of pixel data, or zero if y is out of range.
+ */
+const uint64_t *NeoFrameBuffer::row(int y) const
+{
+    if (y < 0 || y >= m_height) return 0;
+    else return &m_bitmap[y * m_rowWords];
+}
+
+
+/** Clear all pixels.
+ */
+void NeoFrameBuffer::clear()
+{
+    memset(m_bitmap, 0, m_rowWords * m_height * sizeof m_bitmap[0]);
+}
+
+
+/** Read a pixel.
+ *
+ *  @param  x       Horizontal coordinate.
+ *  @param  y       Vertical coordinate.
+ *  @return         One if the pixel is set, zero if it is clear or outside the frame buffer.
+ */
+int NeoFrameBuffer::getPixel(int x, int y) const
+{
+    if (x < 0 || x >= m_width || y < 0 || y >= m_height) return 0;
+    else return (int)((m_bitmap[(y * m_rowWords) + (x / 64)] >> (x & 63)) & 1);
+}
+
+
+/** Draw a character. Set pixels in the character are combined with the frame buffer using logical OR, and
+ *  the character is clipped to the edges of the frame buffer. Each row is copied a word at a time.
+ *
+ *  @param  c       The character.
+ *  @param  x       Horizontal coordinate of the left edge of the character.
+ *  @param  y       Vertical coordinate of the top edge of the character.
+ */
+void NeoFrameBuffer::drawCharacter(const NeoCharacter *c, int x, int y)
+{
+    int words = c->rowWords();
+    if (x >= m_width || x + c->width() <= 0) return;
+
+    int top = (y < 0) ? -y : 0;
+    int bottom = (y + c->height() > m_height) ? (m_height - y) : c->height();
+    if (top >= bottom) return;
+
+    int shift = x & 63;
+    int first = (x - shift) / 64;                       // Word that receives the first source word (may be negative)
+    bool clip = (x < 0) || (first + words + ((0 != shift) ? 1 : 0) > m_rowWords) || (x + c->width() > m_width);
+    const uint64_t *src = c->row(top);
+    uint64_t *dst = &m_bitmap[(y + top) * m_rowWords];
+
+    if (!clip && 0 == shift)
+    {
+        for (int cy = top; cy < bottom; cy++, src += words, dst += m_rowWords)
+        {
+            for (int k = 0; k < words; k++) dst[first + k] |= src[k];
+        }
+    }
+    else if (!clip)
+    {
+        for (int cy = top; cy < bottom; cy++, src += words, dst += m_rowWords)
+        {
+            for (int k = 0; k < words; k++)
+            {
+                dst[first + k] |= src[k] << shift;
+                dst[first + k + 1] |= src[k] >> (64 - shift);
+            }
+        }
+    }
+    else
+    {
+        // The character overlaps an edge
+        uint64_t tail = tailMask(m_width);
+        for (int cy = top; cy < bottom; cy++, src += words, dst += m_rowWords)
+        {
+            for (int k = 0; k < words; k++)
+            {
+                int i = first + k;
+                if (i >= 0 && i < m_rowWords) dst[i] |= src[k] << shift;
+                if (0 != shift && i + 1 >= 0 && i + 1 < m_rowWords) dst[i + 1] |= src[k] >> (64 - shift);
+            }
+            dst[m_rowWords - 1] &= tail;
+        }
+    }
+}
+
+
+/** Draw a string of characters on a single line. No wrapping is performed.
+ *
+ *  @param  font    The font.
+ *  @param  text    The character codes.
+ *  @param  length  The number of characters.
+ *  @param  x       Horizontal coordinate of the left edge of the first character.
+ *  @param  y       Vertical coordinate of the top edge of the line.
+ *  @return         The horizontal coordinate following the last character.
+ */
+int NeoFrameBuffer::drawText(NeoFont *font, const uint8_t *text, unsigned int length, int x, int y)
+{
+    for (unsigned int i = 0; i < length; i++)
+    {
+        const NeoCharacter *c = font->character(text[i]);
+        drawCharacter(c, x, y);
+        x += c->width();
+    }
+    return x;
+}
+
+
+/** Format the PBM header.
+ *
+ *  @param  header  Buffer to receive the header.
+ *  @param  size    The size of the buffer.
+ *  @return         The length of the header, in bytes.
+ */
+unsigned int NeoFrameBuffer::headerPBM(char *header, unsigned int size) const
+{
+    return (unsigned int)snprintf(header, size, "P4\n%d %d\n", m_width, m_height);
+}
+
+
+/** Pack a row in to bytes with the leftmost pixel in the most significant bit, as used by PBM and PNG.
+ *
+ *  @param  out     Receives (width() + 7) / 8 bytes.
+ *  @param  y       The row.
+ *  @param  invert  Logical true to store set pixels as zero bits.
+ */
+void NeoFrameBuffer::packRow(uint8_t *out, int y, bool invert) const
+{
+    unsigned int bytes = (m_width + 7) / 8;
+    const uint64_t *src = &m_bitmap[y * m_rowWords];
+    for (unsigned int i = 0; i < bytes; i += 8)
+    {
+        uint64_t v = reverseByteBits(src[i / 8]);
+        if (invert) v = ~v;
+        for (unsigned int j = 0; j < 8 && i + j < bytes; j++) out[i + j] = (uint8_t)(v >> (j * 8));
+    }
+}
+
+
+/** Return the size of a PBM file of the frame buffer.
+ *
+ *  @return         The number of bytes needed by encodePBM().
+ */
+unsigned int NeoFrameBuffer::pbmSize() const
+{
+    char header[32];
+    return headerPBM(header, sizeof header) + (((m_width + 7) / 8) * m_height);
+}
+
+
+/** Convert the frame buffer to a binary PBM (portable bitmap) file. Set pixels are black.
+ *
+ *  @param  data    Buffer to receive the file.
+ *  @param  length  The size of the buffer.
+ *  @return         The number of bytes in the file, or zero if the buffer is too small.
+ */
+unsigned int NeoFrameBuffer::encodePBM(uint8_t *data, unsigned int length) const
+{
+    unsigned int size = pbmSize();
+    if (length < size) return 0;
+
+    char header[32];
+    unsigned int offset = headerPBM(header, sizeof header);
+    memcpy(data, header, offset);
+    for (int y = 0; y < m_height; y++)
+    {
+        packRow(&data[offset], y, false);
+        offset += (m_width + 7) / 8;
+    }
+    return offset;
+}
+
+
+/** Return the size of a PNG file of the frame buffer.
+ *
+ *  @return         The number of bytes needed by encodePNG().
+ */
+unsigned int NeoFrameBuffer::pngSize() const
+{
+    unsigned int raw = (1 + ((m_width + 7) / 8)) * m_height;
+    unsigned int blocks = (raw + kPNGStoredBlockMax - 1) / kPNGStoredBlockMax;
+    return sizeof png_signature + (12 + 13) + (12 + 2 + raw + (5 * blocks) + 4) + 12;
+}
+
+
+/** Convert the frame buffer to a 1 bit greyscale PNG file. Set pixels are black. The image data is held in
+ *  stored (uncompressed) deflate blocks, so no compression library is needed.
+ *
+ *  @param  data    Buffer to receive the file.
+ *  @param  length  The size of the buffer.
+ *  @return         The number of bytes in the file, or zero if the buffer is too small.
+ */
+unsigned int NeoFrameBuffer::encodePNG(uint8_t *data, unsigned int length) const
+{
+    unsigned int size = pngSize();
+    if (length < size) return 0;
+
+    unsigned int offset = 0;
+    memcpy(data, png_signature, sizeof png_signature);
+    offset += sizeof png_signature;
+
+    // Header: width, height, bit depth 1, greyscale, default compression, filter and interlace methods.
+    uint8_t *ihdr = &data[offset + 8];
+    write32b(&ihdr[0], m_width);
+    write32b(&ihdr[4], m_height);
+    ihdr[8] = 1;
+    ihdr[9] = 0;
+    ihdr[10] = 0;
+    ihdr[11] = 0;
+    ihdr[12] = 0;
+    offset += finishChunk(&data[offset], "IHDR", 13);
+
+    // Image data: a zlib stream of stored blocks holding each row preceded by a zero filter type byte.
+    unsigned int row_bytes = 1 + ((m_width + 7) / 8);
+    unsigned int raw = row_bytes * m_height;
+    uint8_t *image = new uint8_t[raw];
+    for (int y = 0; y < m_height; y++)
+    {
+        image[y * row_bytes] = 0;
+        packRow(&image[(y * row_bytes) + 1], y, true);
+    }
+
+    uint8_t *idat = &data[offset + 8];
+    unsigned int n = 0;
+    idat[n++] = 0x78;
+    idat[n++] = 0x01;
+    uint32_t a = 1;
+    uint32_t b = 0;
+    for (unsigned int done = 0; done < raw; )
+    {
+        unsigned int block = raw - done;
+        if (block > kPNGStoredBlockMax) block = kPNGStoredBlockMax;
+        idat[n++] = (done + block == raw) ? 1 : 0;
+        idat[n++] = block & 255;
+        idat[n++] = (block >> 8) & 255;
+        idat[n++] = ~block & 255;
+        idat[n++] = (~block >> 8) & 255;
+        memcpy(&idat[n], &image[done], block);
+        for (unsigned int i = 0; i < block; )
+        {
+            // Adler-32, taking the modulus only as often as needed to avoid overflow
+            unsigned int end = (block - i > 5552) ? (i + 5552) : block;
+            for (; i < end; i++)
+            {
+                a += image[done + i];
+                b += a;
+            }
+            a %= 65521;
+            b %= 65521;
+        }
+        n += block;
+        done += block;
+    }
+    write32b(&idat[n], (b << 16) | a);
+    n += 4;
+    delete[] image;
+    offset += finishChunk(&data[offset], "IDAT", n);
+
+    offset += finishChunk(&data[offset], "IEND", 0);
+    return offset;
+}
@@ -0,0 +1,59 @@
+/** @file       NeoFrameBuffer.h
+ *  @brief      1 bit per pixel frame buffer used to render text with a NeoFont.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+#ifndef _NEOFRAMEBUFFER_H_
+#define _NEOFRAMEBUFFER_H_  (1)
+
+#include <stdint.h>
+#include "NeoFont.h"
+
+
+#define kNeoScreenWidth     (320)       /**< Width of the Neo screen, in pixels. */
+#define kNeoScreenHeight    (66)        /**< Height of the Neo screen, in pixels. */
+
+
+
+/** Class holding a monochrome image, as it would appear on the Neo screen. Pixels are packed in the same
+ *  way as a NeoCharacter bitmap (pixel x of a row is bit (x % 64) of word (x / 64)), so characters can be
+ *  drawn a word at a time. Images can be exported as PBM or PNG files without any other libraries.
+ */
+class NeoFrameBuffer
+{
+public:
+
+    NeoFrameBuffer(int width = kNeoScreenWidth, int height = kNeoScreenHeight);
+    ~NeoFrameBuffer();
+
+    int width() const;
+    int height() const;
+    int rowWords() const;
+    const uint64_t *row(int y) const;
+
+    void clear();
+    int getPixel(int x, int y) const;
+    void drawCharacter(const NeoCharacter *c, int x, int y);
+    int drawText(NeoFont *font, const uint8_t *text, unsigned int length, int x, int y);
+
+    unsigned int pbmSize() const;
+    unsigned int encodePBM(uint8_t *data, unsigned int length) const;
+    unsigned int pngSize() const;
+    unsigned int encodePNG(uint8_t *data, unsigned int length) const;
+
+private:
+
+    int m_width;                    /**< Width, in pixels. */
+    int m_height;                   /**< Height, in pixels. */
+    int m_rowWords;                 /**< Number of 64 bit words in each row. */
+    uint64_t *m_bitmap;             /**< The pixels, m_rowWords words per row. */
+
+    NeoFrameBuffer(const NeoFrameBuffer &other);
+    NeoFrameBuffer &operator=(const NeoFrameBuffer &other);
+
+    unsigned int headerPBM(char *header, unsigned int size) const;
+    void packRow(uint8_t *out, int y, bool invert) const;
+};
+
+
+
+#endif  // _NEOFRAMEBUFFER_H_
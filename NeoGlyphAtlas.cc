@@ -0,0 +1,275 @@
+/** @file       NeoGlyphAtlas.cc
+ *  @brief      Cache of pre-scaled glyph images used to redraw the editor views.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "NeoGlyphAtlas.h"
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      NeoGlyphAtlas class definition.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Class constructor. The atlas subscribes to changes to the font, and must be destroyed before the font is.
+ *  No memory is allocated for the image until the first call to update().
+ *
+ *  @param  font    The font to draw.
+ *  @param  scale   The size of a character pixel, in atlas pixels.
+ */
+NeoGlyphAtlas::NeoGlyphAtlas(NeoFont *font, int scale)
+    :
+        m_font(font),
+        m_changes(font),
+        m_scale(1),
+        m_cellWidth(0),
+        m_cellHeight(0),
+        m_pixels(0)
+{
+    setScale(scale);
+    invalidateAll();
+}
+
+
+/** Destructor.
+ */
+NeoGlyphAtlas::~NeoGlyphAtlas()
+{
+    delete[] m_pixels;
+}
+
+
+/** Return the font that the atlas draws.
+ */
+NeoFont *NeoGlyphAtlas::font() const
+{
+    return m_font;
+}
+
+
+/** Return the size of a character pixel, in atlas pixels.
+ */
+int NeoGlyphAtlas::scale() const
+{
+    return m_scale;
+}
+
+
+/** Change the pixel scale. The image is discarded and every character is redrawn by the next update().
+ *
+ *  @param  s       The new scale, from 1 to kNeoGlyphAtlasMaxScale.
+ *  @return         The actual scale used.
+ */
+int NeoGlyphAtlas::setScale(int s)
+{
+    if (s < 1) s = 1;
+    if (s > kNeoGlyphAtlasMaxScale) s = kNeoGlyphAtlasMaxScale;
+    if (s != m_scale)
+    {
+        delete[] m_pixels;
+        m_pixels = 0;
+        m_cellWidth = 0;
+        m_cellHeight = 0;
+        m_scale = s;
+        invalidateAll();
+    }
+    return m_scale;
+}
+
+
+/** Return the width of the image, in pixels. This is also the number of bytes in each row.
+ */
+int NeoGlyphAtlas::width() const
+{
+    return kNeoGlyphAtlasColumns * m_cellWidth;
+}
+
+
+/** Return the height of the image, in pixels.
+ */
+int NeoGlyphAtlas::height() const
+{
+    return ((kNeoFontCharacterCount + kNeoGlyphAtlasColumns - 1) / kNeoGlyphAtlasColumns) * m_cellHeight;
+}
+
+
+/** Return the width of each cell, in pixels. A cell is wide enough for the widest character in the font
+ *  at the time it was laid out, and does not shrink if the characters later become narrower.
+ */
+int NeoGlyphAtlas::cellWidth() const
+{
+    return m_cellWidth;
+}
+
+
+/** Return the height of each cell, in pixels. This is the font height multiplied by the scale.
+ */
+int NeoGlyphAtlas::cellHeight() const
+{
+    return m_cellHeight;
+}
+
+
+/** Obtain read access to the image.
+ *
+ *  @return         The image, with width() bytes in each row, or zero if update() has not yet been called.
+ */
+const uint8_t *NeoGlyphAtlas::pixels() const
+{
+    return m_pixels;
+}
+
+
+/** Obtain read access to the image of a character. The character occupies (width() * scale()) pixels of
+ *  each of the cellHeight() rows, with width() bytes between rows. Any remaining pixels in the cell are clear.
+ *
+ *  @param  index   The character number.
+ *  @return         The top left pixel of the character, or zero if the index or the atlas are not valid.
+ */
+const uint8_t *NeoGlyphAtlas::glyph(int index) const
+{
+    if (0 == m_pixels || index < 0 || index >= kNeoFontCharacterCount) return 0;
+    int row = index / kNeoGlyphAtlasColumns;
+    int column = index % kNeoGlyphAtlasColumns;
+    return &m_pixels[(row * m_cellHeight * width()) + (column * m_cellWidth)];
+}
+
+
+/** Mark a character as needing to be redrawn. Changes made through the font are noted automatically.
+ *
+ *  @param  index   The character number.
+ */
+void NeoGlyphAtlas::invalidate(int index)
+{
+    m_changes.markCharacter(index);
+}
+
+
+/** Mark every character as needing to be redrawn.
+ */
+void NeoGlyphAtlas::invalidateAll()
+{
+    m_changes.markAll();
+}
+
+
+/** Test if a character has changed since it was last drawn.
+ *
+ *  @param  index   The character number.
+ *  @return         Logical true if the character will be redrawn by the next update().
+ */
+bool NeoGlyphAtlas::isDirty(int index) const
+{
+    return m_changes.isDirty(index);
+}
+
+
+/** Redraw the changed rows of every character that has changed. If the font has become taller, shorter or
+ *  wider than the cells allow, the image is first laid out again and every character is redrawn.
+ *
+ *  @param  updated     If not zero, receives the set of characters that were redrawn (kNeoFontCharacterSetWords
+ *                      words, with character n in bit (n % 64) of word (n / 64)).
+ *  @return             The number of characters redrawn.
+ */
+int NeoGlyphAtlas::update(uint64_t *updated)
+{
+    if (0 == m_pixels || (m_font->height() * m_scale) != m_cellHeight || (m_font->maxWidth() * m_scale) > m_cellWidth)
+    {
+        layout();
+    }
+
+    int count = 0;
+    for (int index = m_changes.nextDirty(0); index >= 0; index = m_changes.nextDirty(index + 1))
+    {
+        NeoCharacterRect r = m_changes.dirtyRect(index);
+        rasterize(index, r.y0, r.y1);
+        count++;
+    }
+    if (0 != updated)
+    {
+        for (int k = 0; k < kNeoFontCharacterSetWords; k++) updated[k] = m_changes.characters()[k];
+    }
+    m_changes.clear();
+    return count;
+}
+
+
+/** Return the amount of memory used by the atlas, including its image.
+ *
+ *  @return     The number of bytes used.
+ */
+unsigned int NeoGlyphAtlas::storageSize() const
+{
+    return sizeof *this + (width() * height());
+}
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      NeoGlyphAtlas private methods.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Size the cells to suit the current font and allocate a new, blank, image. Every character is marked
+ *  as dirty.
+ */
+void NeoGlyphAtlas::layout()
+{
+    delete[] m_pixels;
+    m_cellWidth = m_font->maxWidth() * m_scale;
+    m_cellHeight = m_font->height() * m_scale;
+    m_pixels = new uint8_t[width() * height()]();
+    invalidateAll();
+}
+
+
+/** Draw some rows of a character in to its cell. Each character row is drawn once, a run of set pixels at a
+ *  time, and then copied to the remaining (scale - 1) atlas rows.
+ *
+ *  @param  index   The character number.
+ *  @param  y0      The first character row to draw.
+ *  @param  y1      The row after the last character row to draw.
+ */
+void NeoGlyphAtlas::rasterize(int index, int y0, int y1)
+{
+    const NeoCharacter *c = m_font->character(index);
+    int stride = width();
+    int columns = m_cellWidth / m_scale;
+    int rows = m_cellHeight / m_scale;
+    int w = (c->width() < columns) ? c->width() : columns;
+    int h = (c->height() < rows) ? c->height() : rows;
+    uint8_t *cell = const_cast<uint8_t *>(glyph(index));
+    if (y1 > rows) y1 = rows;
+
+    for (int y = y0; y < y1; y++)
+    {
+        uint8_t *out = &cell[y * m_scale * stride];
+        memset(out, 0, m_cellWidth);
+        if (y < h)
+        {
+            const uint64_t *bits = c->row(y);
+            int x = 0;
+            while (x < w)
+            {
+                uint64_t word = bits[x / 64] >> (x & 63);
+                if (0 == word)
+                {
+                    x = (x | 63) + 1;       // Skip to the next word
+                    continue;
+                }
+                x += __builtin_ctzll(word);
+                int start = x;
+                while (x < w && 0 != ((bits[x / 64] >> (x & 63)) & 1)) x++;
+                memset(&out[start * m_scale], 255, (x - start) * m_scale);
+            }
+        }
+        for (int r = 1; r < m_scale; r++) memcpy(&out[r * stride], out, m_cellWidth);
+    }
+}
@@ -0,0 +1,68 @@
+/** @file       NeoGlyphAtlas.h
+ *  @brief      Cache of pre-scaled glyph images used to redraw the editor views.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+#ifndef _NEOGLYPHATLAS_H_
+#define _NEOGLYPHATLAS_H_   (1)
+
+#include <stdint.h>
+#include "NeoFont.h"
+#include "NeoFontSubscription.h"
+
+
+#define kNeoGlyphAtlasColumns   (16)                            /**< Number of glyph cells in each row of the atlas. */
+#define kNeoGlyphAtlasMaxScale  (4)                             /**< Largest supported pixel scale. */
+
+
+
+/** Class holding an image of every character in a font at a fixed pixel scale. Each character is drawn in
+ *  its own cell of a 16 x 16 grid, one byte per pixel (0 for clear, 255 for set), with the top row first.
+ *
+ *  The atlas follows its font through a NeoFontSubscription. Any change to a character marks that character
+ *  as dirty, and update() redraws only the changed rows of the dirty characters, so views can copy glyphs
+ *  from the atlas instead of rebuilding them from individual pixels on every redraw.
+ */
+class NeoGlyphAtlas
+{
+public:
+
+    NeoGlyphAtlas(NeoFont *font, int scale = 1);
+    ~NeoGlyphAtlas();
+
+    NeoFont *font() const;
+    int scale() const;
+    int setScale(int s);
+
+    int width() const;
+    int height() const;
+    int cellWidth() const;
+    int cellHeight() const;
+    const uint8_t *pixels() const;
+    const uint8_t *glyph(int index) const;
+
+    void invalidate(int index);
+    void invalidateAll();
+    bool isDirty(int index) const;
+    int update(uint64_t *updated = 0);
+
+    unsigned int storageSize() const;
+
+private:
+
+    NeoFont *m_font;                            /**< The font. */
+    NeoFontSubscription m_changes;              /**< Characters that have changed since they were drawn. */
+    int m_scale;                                /**< Size of a character pixel, in atlas pixels. */
+    int m_cellWidth;                            /**< Width of each cell, in atlas pixels. */
+    int m_cellHeight;                           /**< Height of each cell, in atlas pixels. */
+    uint8_t *m_pixels;                          /**< The image, with (16 * m_cellWidth) bytes per row. */
+
+    NeoGlyphAtlas(const NeoGlyphAtlas &other);
+    NeoGlyphAtlas &operator=(const NeoGlyphAtlas &other);
+
+    void layout();
+    void rasterize(int index, int y0, int y1);
+};
+
+
+
+#endif  // _NEOGLYPHATLAS_H_
@@ -0,0 +1,530 @@
+/** @file       NeoGlyphSelection.cc
+ *  @brief      Set of characters, and batched operations on the selected characters of a font.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "NeoGlyphSelection.h"
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      Private Functions.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Select characters of a given width, for use with addMatching().
+ *
+ *  @param  c       The character.
+ *  @param  index   The character number (not used).
+ *  @param  context The width (a pointer to an int).
+ *  @return         Logical true if the character has the width.
+ */
+static bool matchWidth(const NeoCharacter *c, int index, void *context)
+{
+    (void)index;
+    return c->width() == *(const int *)context;
+}
+
+
+/** Select characters with no pixels set, for use with addMatching().
+ *
+ *  @param  c       The character.
+ *  @param  index   The character number (not used).
+ *  @param  context Not used.
+ *  @return         Logical true if the character is blank.
+ */
+static bool matchBlank(const NeoCharacter *c, int index, void *context)
+{
+    (void)index;
+    (void)context;
+    for (int y = 0; y < c->height(); y++)
+    {
+        const uint64_t *row = c->row(y);
+        for (int k = 0; k < c->rowWords(); k++)
+        {
+            if (0 != row[k]) return false;
+        }
+    }
+    return true;
+}
+
+
+/** Set or clear the pixels of a character that lie within a rectangle, a row at a time.
+ *
+ *  @param  c       The character.
+ *  @param  r       The rectangle. This is clipped to the character.
+ *  @param  set     Logical true to set the pixels, false to clear them.
+ */
+static void fillCharacter(NeoCharacter *c, const NeoCharacterRect &r, bool set)
+{
+    int x0 = (r.x0 < 0) ? 0 : r.x0;
+    int y0 = (r.y0 < 0) ? 0 : r.y0;
+    int x1 = (r.x1 > c->width()) ? c->width() : r.x1;
+    int y1 = (r.y1 > c->height()) ? c->height() : r.y1;
+    if (x0 >= x1 || y0 >= y1) return;
+
+    uint64_t mask[kNeoCharacterRowWords];
+    for (int k = 0; k < c->rowWords(); k++)
+    {
+        int first = (x0 > k * 64) ? (x0 - (k * 64)) : 0;
+        int end = (x1 < (k + 1) * 64) ? (x1 - (k * 64)) : 64;
+        if (first >= end) mask[k] = 0;
+        else mask[k] = ((64 == end) ? ~(uint64_t)0 : ((((uint64_t)1) << end) - 1)) & ~((((uint64_t)1) << first) - 1);
+    }
+    for (int y = y0; y < y1; y++)
+    {
+        uint64_t bits[kNeoCharacterRowWords];
+        const uint64_t *row = c->row(y);
+        for (int k = 0; k < c->rowWords(); k++) bits[k] = set ? (row[k] | mask[k]) : (row[k] & ~mask[k]);
+        c->setRow(y, bits);
+    }
+}
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      NeoGlyphSelection class definition.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Class constructor. No characters are selected.
+ */
+NeoGlyphSelection::NeoGlyphSelection()
+    :
+        m_words()
+{
+    // Nothing.
+}
+
+
+/** Class constructor. A range of characters is selected.
+ *
+ *  @param  first   The first character number.
+ *  @param  last    The last character number (inclusive).
+ */
+NeoGlyphSelection::NeoGlyphSelection(int first, int last)
+    :
+        m_words()
+{
+    addRange(first, last);
+}
+
+
+/** Deselect every character.
+ */
+void NeoGlyphSelection::clear()
+{
+    for (int k = 0; k < kNeoFontCharacterSetWords; k++) m_words[k] = 0;
+}
+
+
+/** Select every character.
+ */
+void NeoGlyphSelection::selectAll()
+{
+    for (int k = 0; k < kNeoFontCharacterSetWords; k++) m_words[k] = ~(uint64_t)0;
+}
+
+
+/** Select a character.
+ *
+ *  @param  index   The character number. Out of range values are ignored.
+ */
+void NeoGlyphSelection::add(int index)
+{
+    if (index >= 0 && index < kNeoFontCharacterCount) m_words[index / 64] |= ((uint64_t)1) << (index & 63);
+}
+
+
+/** Deselect a character.
+ *
+ *  @param  index   The character number. Out of range values are ignored.
+ */
+void NeoGlyphSelection::remove(int index)
+{
+    if (index >= 0 && index < kNeoFontCharacterCount) m_words[index / 64] &= ~(((uint64_t)1) << (index & 63));
+}
+
+
+/** Select a range of characters.
+ *
+ *  @param  first   The first character number.
+ *  @param  last    The last character number (inclusive). The range is clipped to the valid numbers.
+ */
+void NeoGlyphSelection::addRange(int first, int last)
+{
+    if (first < 0) first = 0;
+    if (last >= kNeoFontCharacterCount) last = kNeoFontCharacterCount - 1;
+    for (int i = first; i <= last; i++) m_words[i / 64] |= ((uint64_t)1) << (i & 63);
+}
+
+
+/** Deselect a range of characters.
+ *
+ *  @param  first   The first character number.
+ *  @param  last    The last character number (inclusive). The range is clipped to the valid numbers.
+ */
+void NeoGlyphSelection::removeRange(int first, int last)
+{
+    if (first < 0) first = 0;
+    if (last >= kNeoFontCharacterCount) last = kNeoFontCharacterCount - 1;
+    for (int i = first; i <= last; i++) m_words[i / 64] &= ~(((uint64_t)1) << (i & 63));
+}
+
+
+/** Select the characters that are not selected, and deselect those that are.
+ */
+void NeoGlyphSelection::invert()
+{
+    for (int k = 0; k < kNeoFontCharacterSetWords; k++) m_words[k] = ~m_words[k];
+}
+
+
+/** Select every character that is selected in another selection.
+ */
+void NeoGlyphSelection::unite(const NeoGlyphSelection &other)
+{
+    for (int k = 0; k < kNeoFontCharacterSetWords; k++) m_words[k] |= other.m_words[k];
+}
+
+
+/** Deselect every character that is not selected in another selection.
+ */
+void NeoGlyphSelection::intersect(const NeoGlyphSelection &other)
+{
+    for (int k = 0; k < kNeoFontCharacterSetWords; k++) m_words[k] &= other.m_words[k];
+}
+
+
+/** Deselect every character that is selected in another selection.
+ */
+void NeoGlyphSelection::subtract(const NeoGlyphSelection &other)
+{
+    for (int k = 0; k < kNeoFontCharacterSetWords; k++) m_words[k] &= ~other.m_words[k];
+}
+
+
+/** Select the characters of a font that meet a condition.
+ *
+ *  @param  font        The font.
+ *  @param  predicate   The condition.
+ *  @param  context     Passed to the predicate.
+ */
+void NeoGlyphSelection::addMatching(const NeoFont *font, NeoGlyphPredicate predicate, void *context)
+{
+    for (int i = 0; i < kNeoFontCharacterCount; i++)
+    {
+        if (predicate(font->character(i), i, context)) m_words[i / 64] |= ((uint64_t)1) << (i & 63);
+    }
+}
+
+
+/** Select the characters of a font that have a given width.
+ *
+ *  @param  font    The font.
+ *  @param  w       The width, in pixels.
+ */
+void NeoGlyphSelection::addWidth(const NeoFont *font, int w)
+{
+    if (0 != font->widthCount(w)) addMatching(font, matchWidth, &w);
+}
+
+
+/** Select the characters of a font that have no pixels set.
+ *
+ *  @param  font    The font.
+ */
+void NeoGlyphSelection::addBlank(const NeoFont *font)
+{
+    addMatching(font, matchBlank, 0);
+}
+
+
+/** Test if a character is selected.
+ *
+ *  @param  index   The character number.
+ *  @return         Logical true if the character is selected, false if not or if index is out of range.
+ */
+bool NeoGlyphSelection::contains(int index) const
+{
+    if (index < 0 || index >= kNeoFontCharacterCount) return false;
+    else return 0 != (m_words[index / 64] & (((uint64_t)1) << (index & 63)));
+}
+
+
+/** Test if no characters are selected.
+ */
+bool NeoGlyphSelection::isEmpty() const
+{
+    for (int k = 0; k < kNeoFontCharacterSetWords; k++)
+    {
+        if (0 != m_words[k]) return false;
+    }
+    return true;
+}
+
+
+/** Return the number of characters selected.
+ */
+int NeoGlyphSelection::count() const
+{
+    int count = 0;
+    for (int k = 0; k < kNeoFontCharacterSetWords; k++) count += __builtin_popcountll(m_words[k]);
+    return count;
+}
+
+
+/** Find the next selected character.
+ *
+ *  @param  index   The character number to start searching from.
+ *  @return         The number of the first selected character at or after index, or -1 if there is none.
+ */
+int NeoGlyphSelection::next(int index) const
+{
+    if (index < 0) index = 0;
+    for (int k = index / 64; k < kNeoFontCharacterSetWords; k++)
+    {
+        uint64_t word = m_words[k];
+        if (k == index / 64) word &= ~((((uint64_t)1) << (index & 63)) - 1);
+        if (0 != word) return (k * 64) + __builtin_ctzll(word);
+    }
+    return -1;
+}
+
+
+/** Obtain the selection as a set of words (see the class description).
+ */
+const uint64_t *NeoGlyphSelection::words() const
+{
+    return m_words;
+}
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      NeoGlyphBatch class definition.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Class constructor.
+ *
+ *  @param  font    The font to modify.
+ *  @param  journal The undo journal in which to record each operation, or zero. This must be a journal for
+ *                  the same font.
+ */
+NeoGlyphBatch::NeoGlyphBatch(NeoFont *font, NeoUndoJournal *journal)
+    :
+        m_font(font),
+        m_journal(journal)
+{
+    // Nothing.
+}
+
+
+/** Destructor.
+ */
+NeoGlyphBatch::~NeoGlyphBatch()
+{
+    // Nothing.
+}
+
+
+/** Return the font that is modified.
+ */
+NeoFont *NeoGlyphBatch::font() const
+{
+    return m_font;
+}
+
+
+/** Set the width of the selected characters.
+ *
+ *  @param  s       The characters to change.
+ *  @param  w       The new width, in pixels.
+ *  @return         The number of characters selected.
+ */
+int NeoGlyphBatch::setWidth(const NeoGlyphSelection &s, int w)
+{
+    begin("set character width", s);
+    for (int i = s.next(0); i >= 0; i = s.next(i + 1)) m_font->character(i)->setWidth(w);
+    return end(s);
+}
+
+
+/** Change the width of the selected characters.
+ *
+ *  @param  s       The characters to change.
+ *  @param  delta   The change in width, in pixels.
+ *  @return         The number of characters selected.
+ */
+int NeoGlyphBatch::adjustWidth(const NeoGlyphSelection &s, int delta)
+{
+    begin("adjust character width", s);
+    for (int i = s.next(0); i >= 0; i = s.next(i + 1))
+    {
+        NeoCharacter *c = m_font->character(i);
+        c->setWidth(c->width() + delta);
+    }
+    return end(s);
+}
+
+
+/** Set the pixels of the selected characters that lie within a rectangle.
+ *
+ *  @param  s       The characters to change.
+ *  @param  r       The rectangle. This is clipped to each character.
+ *  @return         The number of characters selected.
+ */
+int NeoGlyphBatch::setRegion(const NeoGlyphSelection &s, const NeoCharacterRect &r)
+{
+    return fillRegion("set region", s, r, true);
+}
+
+
+/** Clear the pixels of the selected characters that lie within a rectangle.
+ *
+ *  @param  s       The characters to change.
+ *  @param  r       The rectangle. This is clipped to each character.
+ *  @return         The number of characters selected.
+ */
+int NeoGlyphBatch::clearRegion(const NeoGlyphSelection &s, const NeoCharacterRect &r)
+{
+    return fillRegion("clear region", s, r, false);
+}
+
+
+/** Translate the selected characters (see NeoCharacter::transformTranslate()).
+ *
+ *  @param  s       The characters to change.
+ *  @param  dx      The x-displacement (positive => right, negative => left).
+ *  @param  dy      The y-displacement (positive => down, negative => up).
+ *  @return         The number of characters selected.
+ */
+int NeoGlyphBatch::translate(const NeoGlyphSelection &s, int dx, int dy)
+{
+    begin("translate", s);
+    for (int i = s.next(0); i >= 0; i = s.next(i + 1)) m_font->character(i)->transformTranslate(dx, dy);
+    return end(s);
+}
+
+
+/** Reflect the selected characters horizontally.
+ *
+ *  @param  s       The characters to change.
+ *  @return         The number of characters selected.
+ */
+int NeoGlyphBatch::flipH(const NeoGlyphSelection &s)
+{
+    begin("flip-horizontal", s);
+    for (int i = s.next(0); i >= 0; i = s.next(i + 1)) m_font->character(i)->transformFlipH();
+    return end(s);
+}
+
+
+/** Reflect the selected characters vertically.
+ *
+ *  @param  s       The characters to change.
+ *  @return         The number of characters selected.
+ */
+int NeoGlyphBatch::flipV(const NeoGlyphSelection &s)
+{
+    begin("flip-vertical", s);
+    for (int i = s.next(0); i >= 0; i = s.next(i + 1)) m_font->character(i)->transformFlipV();
+    return end(s);
+}
+
+
+/** Embolden the selected characters (see NeoCharacter::transformBold(), which also widens each character
+ *  by one pixel). The result is the same as the engine's kNeoTransformBold.
+ *
+ *  @param  s       The characters to change.
+ *  @return         The number of characters selected.
+ */
+int NeoGlyphBatch::bold(const NeoGlyphSelection &s)
+{
+    begin("bold", s);
+    for (int i = s.next(0); i >= 0; i = s.next(i + 1)) m_font->character(i)->transformBold();
+    return end(s);
+}
+
+
+/** Copy the selected characters from another font. If the fonts have different heights, each copied
+ *  character is cropped or extended at the bottom to the height of this font.
+ *
+ *  @param  s       The characters to copy.
+ *  @param  source  The font to copy from.
+ *  @return         The number of characters selected.
+ */
+int NeoGlyphBatch::copyFrom(const NeoGlyphSelection &s, const NeoFont *source)
+{
+    begin("copy characters", s);
+    for (int i = s.next(0); i >= 0; i = s.next(i + 1))
+    {
+        NeoCharacter *c = m_font->character(i);
+        *c = *source->character(i);
+        c->setHeight(m_font->height());
+    }
+    return end(s);
+}
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      NeoGlyphBatch private methods.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Start an operation: open an undo record holding the selected characters, and hold back change
+ *  notifications until the operation ends.
+ *
+ *  @param  reason  Description of the operation, for the undo record.
+ *  @param  s       The characters that the operation may change.
+ */
+void NeoGlyphBatch::begin(const char *reason, const NeoGlyphSelection &s)
+{
+    if (0 != m_journal)
+    {
+        m_journal->begin(reason);
+        for (int i = s.next(0); i >= 0; i = s.next(i + 1)) m_journal->saveCharacter(i);
+    }
+    m_font->beginChanges();
+}
+
+
+/** Finish an operation started by begin().
+ *
+ *  @param  s       The characters that the operation may have changed.
+ *  @return         The number of characters selected.
+ */
+int NeoGlyphBatch::end(const NeoGlyphSelection &s)
+{
+    m_font->endChanges();
+    if (0 != m_journal) m_journal->commit();
+    return s.count();
+}
+
+
+/** Set or clear the pixels of the selected characters that lie within a rectangle.
+ *
+ *  @param  reason  Description of the operation, for the undo record.
+ *  @param  s       The characters to change.
+ *  @param  r       The rectangle.
+ *  @param  set     Logical true to set the pixels, false to clear them.
+ *  @return         The number of characters selected.
+ */
+int NeoGlyphBatch::fillRegion(const char *reason, const NeoGlyphSelection &s, const NeoCharacterRect &r, bool set)
+{
+    begin(reason, s);
+    for (int i = s.next(0); i >= 0; i = s.next(i + 1)) fillCharacter(m_font->character(i), r, set);
+    return end(s);
+}
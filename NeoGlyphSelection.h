@@ -0,0 +1,100 @@
+/** @file       NeoGlyphSelection.h
+ *  @brief      Set of characters, and batched operations on the selected characters of a font.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+#ifndef _NEOGLYPHSELECTION_H_
+#define _NEOGLYPHSELECTION_H_   (1)
+
+#include <stdint.h>
+#include "NeoFont.h"
+#include "NeoUndoJournal.h"
+
+
+/** Function used to select characters that meet some condition.
+ *
+ *  @param  c       The character.
+ *  @param  index   The character number.
+ *  @param  context The context passed to NeoGlyphSelection::addMatching().
+ *  @return         Logical true to select the character.
+ */
+typedef bool (*NeoGlyphPredicate)(const NeoCharacter *c, int index, void *context);
+
+
+/** A set of character numbers. Characters can be selected singly, as ranges of codes, or by testing the
+ *  characters of a font. The set is held as kNeoFontCharacterSetWords words, with bit (i % 64) of word
+ *  (i / 64) set if character i is selected, which is the form used by NeoTransformEngine.
+ */
+class NeoGlyphSelection
+{
+public:
+
+    NeoGlyphSelection();
+    NeoGlyphSelection(int first, int last);
+
+    void clear();
+    void selectAll();
+    void add(int index);
+    void remove(int index);
+    void addRange(int first, int last);
+    void removeRange(int first, int last);
+    void invert();
+    void unite(const NeoGlyphSelection &other);
+    void intersect(const NeoGlyphSelection &other);
+    void subtract(const NeoGlyphSelection &other);
+
+    void addMatching(const NeoFont *font, NeoGlyphPredicate predicate, void *context);
+    void addWidth(const NeoFont *font, int w);
+    void addBlank(const NeoFont *font);
+
+    bool contains(int index) const;
+    bool isEmpty() const;
+    int count() const;
+    int next(int index) const;
+    const uint64_t *words() const;
+
+private:
+
+    uint64_t m_words[kNeoFontCharacterSetWords];            /**< The selected characters. */
+};
+
+
+
+/** Class used to apply operations to the selected characters of a font. Each operation is made in a single
+ *  pass over the selection. If there is an undo journal, each operation is recorded as one undo record, and
+ *  subscribers to the font receive the changes made by an operation together, when it has finished.
+ */
+class NeoGlyphBatch
+{
+public:
+
+    NeoGlyphBatch(NeoFont *font, NeoUndoJournal *journal = 0);
+    ~NeoGlyphBatch();
+
+    NeoFont *font() const;
+
+    int setWidth(const NeoGlyphSelection &s, int w);
+    int adjustWidth(const NeoGlyphSelection &s, int delta);
+    int setRegion(const NeoGlyphSelection &s, const NeoCharacterRect &r);
+    int clearRegion(const NeoGlyphSelection &s, const NeoCharacterRect &r);
+    int translate(const NeoGlyphSelection &s, int dx, int dy);
+    int flipH(const NeoGlyphSelection &s);
+    int flipV(const NeoGlyphSelection &s);
+    int bold(const NeoGlyphSelection &s);
+    int copyFrom(const NeoGlyphSelection &s, const NeoFont *source);
+
+private:
+
+    NeoFont *m_font;                /**< The font. */
+    NeoUndoJournal *m_journal;      /**< The undo journal, or zero. */
+
+    NeoGlyphBatch(const NeoGlyphBatch &other);
+    NeoGlyphBatch &operator=(const NeoGlyphBatch &other);
+
+    void begin(const char *reason, const NeoGlyphSelection &s);
+    int end(const NeoGlyphSelection &s);
+    int fillRegion(const char *reason, const NeoGlyphSelection &s, const NeoCharacterRect &r, bool set);
+};
+
+
+
+#endif  // _NEOGLYPHSELECTION_H_
@@ -0,0 +1,224 @@
+/** @file       NeoGlyphTable.cc
+ *  @brief      Table of distinct glyphs, found by content.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "NeoGlyphTable.h"
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      Private Data.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** A distinct glyph.
+ */
+struct NeoGlyphTableEntry
+{
+    uint64_t hash;                  /**< Hash of the glyph size and pixels. */
+    NeoCharacter *glyph;            /**< Copy of the glyph. */
+};
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      Private Functions.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Test if two characters have the same size and pixels. Bits beyond the width are always clear, so whole
+ *  words can be compared.
+ *
+ *  @param  a       The first character.
+ *  @param  b       The second character.
+ *  @return         Logical true if the characters look the same.
+ */
+static bool sameGlyph(const NeoCharacter *a, const NeoCharacter *b)
+{
+    if (a->width() != b->width() || a->height() != b->height()) return false;
+    for (int y = 0; y < a->height(); y++)
+    {
+        if (0 != memcmp(a->row(y), b->row(y), a->rowWords() * sizeof (uint64_t))) return false;
+    }
+    return true;
+}
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      NeoGlyphTable class definition.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Class constructor. The table is empty.
+ */
+NeoGlyphTable::NeoGlyphTable()
+    :
+        m_glyphs(0),
+        m_count(0),
+        m_capacity(0),
+        m_slots(0),
+        m_slotCount(0)
+{
+    grow();
+}
+
+
+/** Destructor.
+ */
+NeoGlyphTable::~NeoGlyphTable()
+{
+    clear();
+    delete[] m_glyphs;
+    delete[] m_slots;
+}
+
+
+/** Find a glyph, adding a copy of it if there is no identical glyph in the table.
+ *
+ *  @param  c       The character.
+ *  @return         The glyph number.
+ */
+int NeoGlyphTable::intern(const NeoCharacter *c)
+{
+    uint64_t h = c->hash();
+    unsigned int slot = lookup(c, h);
+    if (0 != m_slots[slot]) return m_slots[slot] - 1;
+
+    if (m_count == m_capacity)
+    {
+        unsigned int capacity = (0 == m_capacity) ? 256 : (m_capacity * 2);
+        NeoGlyphTableEntry *glyphs = new NeoGlyphTableEntry[capacity];
+        if (0 != m_count) memcpy(glyphs, m_glyphs, m_count * sizeof glyphs[0]);
+        delete[] m_glyphs;
+        m_glyphs = glyphs;
+        m_capacity = capacity;
+    }
+    m_glyphs[m_count].hash = h;
+    m_glyphs[m_count].glyph = new NeoCharacter(*c);
+    m_slots[slot] = ++m_count;
+    if ((m_count * 2) > m_slotCount) grow();
+    return m_count - 1;
+}
+
+
+/** Find a glyph.
+ *
+ *  @param  c       The character.
+ *  @return         The number of the identical glyph, or kNeoGlyphTableNotFound if there is none.
+ */
+int NeoGlyphTable::find(const NeoCharacter *c) const
+{
+    uint32_t entry = m_slots[lookup(c, c->hash())];
+    return (0 == entry) ? kNeoGlyphTableNotFound : (int)(entry - 1);
+}
+
+
+/** Remove every glyph. The memory used by the table is kept for reuse.
+ */
+void NeoGlyphTable::clear()
+{
+    for (unsigned int i = 0; i < m_count; i++) delete m_glyphs[i].glyph;
+    memset(m_slots, 0, m_slotCount * sizeof m_slots[0]);
+    m_count = 0;
+}
+
+
+/** Return the number of distinct glyphs.
+ */
+unsigned int NeoGlyphTable::count() const
+{
+    return m_count;
+}
+
+
+/** Get a glyph.
+ *
+ *  @param  index   The glyph number.
+ *  @return         The glyph, or zero if index is out of range.
+ */
+const NeoCharacter *NeoGlyphTable::glyph(unsigned int index) const
+{
+    if (index >= m_count) return 0;
+    else return m_glyphs[index].glyph;
+}
+
+
+/** Get the hash of a glyph.
+ *
+ *  @param  index   The glyph number.
+ *  @return         The hash (as returned by NeoCharacter::hash()), or zero if index is out of range.
+ */
+uint64_t NeoGlyphTable::hash(unsigned int index) const
+{
+    if (index >= m_count) return 0;
+    else return m_glyphs[index].hash;
+}
+
+
+/** Return the amount of memory used by the table, including its copies of the glyphs.
+ *
+ *  @return     The number of bytes used.
+ */
+unsigned int NeoGlyphTable::storageSize() const
+{
+    unsigned int size = sizeof *this;
+    size += m_capacity * sizeof m_glyphs[0];
+    size += m_slotCount * sizeof m_slots[0];
+    for (unsigned int i = 0; i < m_count; i++) size += m_glyphs[i].glyph->storageSize();
+    return size;
+}
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      NeoGlyphTable private methods.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Find the slot holding a glyph, or the empty slot where it would be added.
+ *
+ *  @param  c       The character.
+ *  @param  hash    The hash of the character.
+ *  @return         The slot number.
+ */
+unsigned int NeoGlyphTable::lookup(const NeoCharacter *c, uint64_t hash) const
+{
+    unsigned int mask = m_slotCount - 1;
+    for (unsigned int slot = (unsigned int)hash & mask; ; slot = (slot + 1) & mask)
+    {
+        uint32_t entry = m_slots[slot];
+        if (0 == entry) return slot;
+        const NeoGlyphTableEntry *e = &m_glyphs[entry - 1];
+        if (e->hash == hash && sameGlyph(e->glyph, c)) return slot;
+    }
+}
+
+
+/** Double the size of the hash table (or create it), and add every glyph to the new table.
+ */
+void NeoGlyphTable::grow()
+{
+    unsigned int size = (0 == m_slotCount) ? 1024 : (m_slotCount * 2);
+    uint32_t *slots = new uint32_t[size]();
+    for (unsigned int i = 0; i < m_count; i++)
+    {
+        unsigned int slot = (unsigned int)m_glyphs[i].hash & (size - 1);
+        while (0 != slots[slot]) slot = (slot + 1) & (size - 1);
+        slots[slot] = i + 1;
+    }
+    delete[] m_slots;
+    m_slots = slots;
+    m_slotCount = size;
+}
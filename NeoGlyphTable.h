@@ -0,0 +1,57 @@
+/** @file       NeoGlyphTable.h
+ *  @brief      Table of distinct glyphs, found by content.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+#ifndef _NEOGLYPHTABLE_H_
+#define _NEOGLYPHTABLE_H_   (1)
+
+#include <stdint.h>
+#include "NeoCharacter.h"
+
+
+#define kNeoGlyphTableNotFound      (-1)        /**< Value returned by find() if there is no matching glyph. */
+
+
+struct NeoGlyphTableEntry;
+
+
+/** Class used to intern glyphs. Each distinct glyph (the same size and pixels) is held once and given a
+ *  number, in the order the glyphs were first added, so any number of fonts can refer to a shared set of
+ *  glyphs. Glyphs are found through their hash (see NeoCharacter::hash()) and then compared pixel by pixel,
+ *  so different glyphs are never merged even if their hashes are the same.
+ */
+class NeoGlyphTable
+{
+public:
+
+    NeoGlyphTable();
+    ~NeoGlyphTable();
+
+    int intern(const NeoCharacter *c);
+    int find(const NeoCharacter *c) const;
+    void clear();
+
+    unsigned int count() const;
+    const NeoCharacter *glyph(unsigned int index) const;
+    uint64_t hash(unsigned int index) const;
+
+    unsigned int storageSize() const;
+
+private:
+
+    NeoGlyphTableEntry *m_glyphs;       /**< The distinct glyphs, in the order they were added. */
+    unsigned int m_count;               /**< The number of distinct glyphs. */
+    unsigned int m_capacity;            /**< The size of the m_glyphs array. */
+    uint32_t *m_slots;                  /**< Hash table of glyph numbers plus one (zero for an empty slot). */
+    unsigned int m_slotCount;           /**< The number of slots in m_slots (a power of two). */
+
+    NeoGlyphTable(const NeoGlyphTable &other);
+    NeoGlyphTable &operator=(const NeoGlyphTable &other);
+
+    unsigned int lookup(const NeoCharacter *c, uint64_t hash) const;
+    void grow();
+};
+
+
+
+#endif  // _NEOGLYPHTABLE_H_
@@ -0,0 +1,328 @@
+/** @file       NeoTextLayout.cc
+ *  @brief      Word wrapping and pagination of Neo text with a NeoFont.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "NeoTextLayout.h"
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      Private Functions.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Find the end of the longest run of characters, starting at a given character, that fits in a width.
+ *
+ *  @param  prefix  The prefix sums of the character widths.
+ *  @param  start   Offset of the first character.
+ *  @param  last    The largest end offset allowed.
+ *  @param  width   The width available, in pixels.
+ *  @return         The largest end offset, from start to last, whose characters fit.
+ */
+static unsigned int fitCharacters(const uint32_t *prefix, unsigned int start, unsigned int last, unsigned int width)
+{
+    uint32_t limit = prefix[start] + width;
+    if (last - start > width) last = start + width;             // Every character is at least one pixel wide
+    unsigned int lo = start;
+    unsigned int hi = last;
+    while (lo < hi)
+    {
+        unsigned int mid = lo + ((hi - lo + 1) / 2);
+        if (prefix[mid] <= limit) lo = mid;
+        else hi = mid - 1;
+    }
+    return lo;
+}
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      NeoTextLayout class definition.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Class constructor. The layout is empty.
+ */
+NeoTextLayout::NeoTextLayout()
+    :
+        m_prefix(0),
+        m_length(0),
+        m_prefixCapacity(0),
+        m_lines(0),
+        m_lineCount(0),
+        m_lineCapacity(0),
+        m_width(kNeoScreenWidth),
+        m_lineHeight(1),
+        m_linesPerPage(1)
+{
+    // Nothing.
+}
+
+
+/** Destructor.
+ */
+NeoTextLayout::~NeoTextLayout()
+{
+    delete[] m_prefix;
+    delete[] m_lines;
+}
+
+
+/** Lay out a text. Any previous layout is discarded, but its memory is reused.
+ *
+ *  @param  font    The font.
+ *  @param  text    The text, as Neo character codes. kNeoTextNewline ends a paragraph.
+ *  @param  length  The number of characters of text.
+ *  @param  width   The line width, in pixels.
+ *  @param  height  The page height, in pixels. A page holds at least one line.
+ */
+void NeoTextLayout::layout(const NeoFont *font, const uint8_t *text, unsigned int length, int width, int height)
+{
+    m_width = (width > 0) ? width : 1;
+    m_lineHeight = font->height();
+    m_linesPerPage = (height > m_lineHeight) ? (height / m_lineHeight) : 1;
+    m_lineCount = 0;
+
+    if (length + 1 > m_prefixCapacity)
+    {
+        delete[] m_prefix;
+        m_prefixCapacity = length + 1;
+        m_prefix = new uint32_t[m_prefixCapacity];
+    }
+    m_length = length;
+
+    uint32_t widths[kNeoFontCharacterCount];
+    for (int i = 0; i < kNeoFontCharacterCount; i++) widths[i] = font->character(i)->width();
+    uint32_t sum = 0;
+    m_prefix[0] = 0;
+    for (unsigned int i = 0; i < length; i++)
+    {
+        sum += widths[text[i]];
+        m_prefix[i + 1] = sum;
+    }
+
+    unsigned int start = 0;
+    unsigned int newline = 0;       // Offset of the next newline (or length) at or after start
+    bool found = false;
+    while (start < length)
+    {
+        if (!found || newline < start)
+        {
+            const uint8_t *p = (const uint8_t *)memchr(&text[start], kNeoTextNewline, length - start);
+            newline = (0 == p) ? length : (p - text);
+            found = true;
+        }
+
+        unsigned int end = fitCharacters(m_prefix, start, newline, m_width);
+        if (end == newline)
+        {
+            addLine(start, end);                                        // The rest of the paragraph fits
+            start = end + 1;
+            continue;
+        }
+
+        unsigned int next;
+        if (kNeoTextSpace == text[end])
+        {
+            next = end;                                                 // Wrap at the spaces following the line
+        }
+        else
+        {
+            unsigned int space = end;
+            while (space > start && kNeoTextSpace != text[space - 1]) space--;
+            if (space > start)
+            {
+                end = space - 1;                                        // Wrap after the last space that fits
+                next = space;
+            }
+            else
+            {
+                if (end == start) end++;                                // A line holds at least one character
+                next = end;                                             // Break a word wider than the line
+            }
+        }
+        while (end > start && kNeoTextSpace == text[end - 1]) end--;
+        addLine(start, end);
+        while (next < newline && kNeoTextSpace == text[next]) next++;
+        if (next == newline) next++;                                    // The wrap also ends the paragraph
+        start = next;
+    }
+}
+
+
+/** Discard the layout and free its memory.
+ */
+void NeoTextLayout::clear()
+{
+    delete[] m_prefix;
+    delete[] m_lines;
+    m_prefix = 0;
+    m_lines = 0;
+    m_length = 0;
+    m_prefixCapacity = 0;
+    m_lineCount = 0;
+    m_lineCapacity = 0;
+}
+
+
+/** Return the number of characters laid out.
+ */
+unsigned int NeoTextLayout::length() const
+{
+    return m_length;
+}
+
+
+/** Return the line width, in pixels.
+ */
+int NeoTextLayout::width() const
+{
+    return m_width;
+}
+
+
+/** Return the line height, in pixels.
+ */
+int NeoTextLayout::lineHeight() const
+{
+    return m_lineHeight;
+}
+
+
+/** Return the width of a run of characters as if drawn on one line.
+ *
+ *  @param  start   Offset of the first character.
+ *  @param  end     Offset following the last character. Offsets beyond the text are limited to its end.
+ *  @return         The width, in pixels.
+ */
+unsigned int NeoTextLayout::textWidth(unsigned int start, unsigned int end) const
+{
+    if (end > m_length) end = m_length;
+    if (start >= end) return 0;
+    return m_prefix[end] - m_prefix[start];
+}
+
+
+/** Return the number of lines.
+ */
+unsigned int NeoTextLayout::lineCount() const
+{
+    return m_lineCount;
+}
+
+
+/** Return a line.
+ *
+ *  @param  n       The line number.
+ *  @return         The line, or zero if n is out of range.
+ */
+const NeoTextLine *NeoTextLayout::line(unsigned int n) const
+{
+    return (n < m_lineCount) ? &m_lines[n] : 0;
+}
+
+
+/** Find the line holding a character. Characters dropped at a wrap or a newline belong to the line before.
+ *
+ *  @param  offset  The character offset.
+ *  @return         The line number, or lineCount() if there are no lines.
+ */
+unsigned int NeoTextLayout::lineAt(unsigned int offset) const
+{
+    if (0 == m_lineCount) return 0;
+    unsigned int lo = 0;
+    unsigned int hi = m_lineCount - 1;
+    while (lo < hi)
+    {
+        unsigned int mid = lo + ((hi - lo + 1) / 2);
+        if (m_lines[mid].start <= offset) lo = mid;
+        else hi = mid - 1;
+    }
+    return lo;
+}
+
+
+/** Return the number of lines on each page.
+ */
+unsigned int NeoTextLayout::linesPerPage() const
+{
+    return m_linesPerPage;
+}
+
+
+/** Return the number of pages.
+ */
+unsigned int NeoTextLayout::pageCount() const
+{
+    return (m_lineCount + m_linesPerPage - 1) / m_linesPerPage;
+}
+
+
+/** Return the offset of the first character on a page.
+ *
+ *  @param  page    The page number.
+ *  @return         The offset, or length() if the page is out of range.
+ */
+unsigned int NeoTextLayout::pageStart(unsigned int page) const
+{
+    return (page < pageCount()) ? m_lines[page * m_linesPerPage].start : m_length;
+}
+
+
+/** Return the number of characters on a page, including the spaces and newlines that end its lines.
+ *
+ *  @param  page    The page number.
+ *  @return         The number of characters, or zero if the page is out of range.
+ */
+unsigned int NeoTextLayout::pageLength(unsigned int page) const
+{
+    return pageStart(page + 1) - pageStart(page);
+}
+
+
+/** Return the average number of characters on a page, used to compare how much text fonts fit on the
+ *  screen. Every page but the last is full, so long texts give the most useful figures.
+ */
+double NeoTextLayout::charactersPerPage() const
+{
+    unsigned int pages = pageCount();
+    return (0 == pages) ? 0.0 : (double)m_length / pages;
+}
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      NeoTextLayout private methods.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Add a line.
+ *
+ *  @param  start   Offset of the first character.
+ *  @param  end     Offset following the last character drawn.
+ */
+void NeoTextLayout::addLine(unsigned int start, unsigned int end)
+{
+    if (m_lineCount == m_lineCapacity)
+    {
+        unsigned int capacity = (0 == m_lineCapacity) ? 256 : (m_lineCapacity * 2);
+        NeoTextLine *lines = new NeoTextLine[capacity];
+        if (0 != m_lineCount) memcpy(lines, m_lines, m_lineCount * sizeof lines[0]);
+        delete[] m_lines;
+        m_lines = lines;
+        m_lineCapacity = capacity;
+    }
+    NeoTextLine *line = &m_lines[m_lineCount++];
+    line->start = start;
+    line->length = end - start;
+    line->width = m_prefix[end] - m_prefix[start];
+}
@@ -0,0 +1,79 @@
+/** @file       NeoTextLayout.h
+ *  @brief      Word wrapping and pagination of Neo text with a NeoFont.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+#ifndef _NEOTEXTLAYOUT_H_
+#define _NEOTEXTLAYOUT_H_   (1)
+
+#include <stdint.h>
+#include "NeoFont.h"
+#include "NeoFrameBuffer.h"
+
+
+#define kNeoTextNewline     ('\n')      /**< Character code that ends a paragraph. */
+#define kNeoTextSpace       (' ')       /**< Character code at which lines may be wrapped. */
+
+
+/** A line of laid out text.
+ */
+struct NeoTextLine
+{
+    uint32_t start;                 /**< Offset of the first character. */
+    uint32_t length;                /**< The number of characters drawn (spaces at a wrap are not drawn). */
+    uint32_t width;                 /**< The width of the drawn characters, in pixels. */
+};
+
+
+/** Class used to lay out Neo text as the Neo does: words are wrapped to the screen width, newlines start a
+ *  new paragraph, and the screen shows as many whole lines as fit in its height. Lines are wrapped after
+ *  the last space that fits; a word wider than the screen is broken at the screen edge.
+ *
+ *  Glyph widths are summed once over the whole text, so the width of any run of characters is a single
+ *  subtraction and each line break is found by a binary search rather than by adding up widths.
+ */
+class NeoTextLayout
+{
+public:
+
+    NeoTextLayout();
+    ~NeoTextLayout();
+
+    void layout(const NeoFont *font, const uint8_t *text, unsigned int length, int width = kNeoScreenWidth, int height = kNeoScreenHeight);
+    void clear();
+
+    unsigned int length() const;
+    int width() const;
+    int lineHeight() const;
+    unsigned int textWidth(unsigned int start, unsigned int end) const;
+
+    unsigned int lineCount() const;
+    const NeoTextLine *line(unsigned int n) const;
+    unsigned int lineAt(unsigned int offset) const;
+
+    unsigned int linesPerPage() const;
+    unsigned int pageCount() const;
+    unsigned int pageStart(unsigned int page) const;
+    unsigned int pageLength(unsigned int page) const;
+    double charactersPerPage() const;
+
+private:
+
+    uint32_t *m_prefix;             /**< m_prefix[i] is the width of the first i characters. */
+    unsigned int m_length;          /**< The number of characters laid out. */
+    unsigned int m_prefixCapacity;  /**< The size of the m_prefix array. */
+    NeoTextLine *m_lines;           /**< The lines. */
+    unsigned int m_lineCount;       /**< The number of lines. */
+    unsigned int m_lineCapacity;    /**< The size of the m_lines array. */
+    int m_width;                    /**< The line width, in pixels. */
+    int m_lineHeight;               /**< The line height (the font height), in pixels. */
+    unsigned int m_linesPerPage;    /**< The number of lines on each page. */
+
+    NeoTextLayout(const NeoTextLayout &other);
+    NeoTextLayout &operator=(const NeoTextLayout &other);
+
+    void addLine(unsigned int start, unsigned int end);
+};
+
+
+
+#endif  // _NEOTEXTLAYOUT_H_
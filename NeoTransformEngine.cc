@@ -0,0 +1,369 @@
+/** @file       NeoTransformEngine.cc
+ *  @brief      Applies character transforms to many glyphs at once, using a pool of threads.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include "NeoTransformEngine.h"
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      Private Data.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** A worker thread.
+ */
+struct NeoTransformWorker
+{
+    NeoTransformEngine *engine;     /**< The engine that owns the thread. */
+    int number;                     /**< The thread number (the calling thread is number zero). */
+    pthread_t thread;               /**< The thread. */
+};
+
+
+/** A thread's share of a job: the items from head up to (but not including) tail, packed in to one word so
+ *  that both ends can be updated atomically. The owner takes items from the head and other threads take
+ *  them from the tail. Each range has a cache line to itself.
+ */
+struct NeoTransformRange
+{
+    uint64_t bounds;                /**< The head (low 32 bits) and tail (high 32 bits). */
+    uint8_t padding[56];            /**< Unused. */
+};
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      NeoTransformEngine class definition.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Class constructor. The worker threads are started, and then wait for work.
+ *
+ *  @param  threads The number of threads to use, including the calling thread. Zero uses one thread for each
+ *                  processor. With one thread, every job is done by the calling thread.
+ */
+NeoTransformEngine::NeoTransformEngine(int threads)
+    :
+        m_threadCount(threads),
+        m_workers(0),
+        m_ranges(0),
+        m_job(0),
+        m_running(0),
+        m_quit(false),
+        m_cancelled(0),
+        m_kernel(0),
+        m_context(0),
+        m_font(0),
+        m_fonts(0),
+        m_done(0),
+        m_indices(),
+        m_indexCount(0),
+        m_results(new NeoCharacter[kNeoFontCharacterCount]),
+        m_completed(0)
+{
+    if (m_threadCount <= 0) m_threadCount = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (m_threadCount < 1) m_threadCount = 1;
+    if (m_threadCount > kNeoTransformMaxThreads) m_threadCount = kNeoTransformMaxThreads;
+
+    pthread_mutex_init(&m_lock, 0);
+    pthread_cond_init(&m_start, 0);
+    pthread_cond_init(&m_finish, 0);
+    m_ranges = new NeoTransformRange[m_threadCount];
+    m_workers = new NeoTransformWorker[m_threadCount];
+    for (int i = 1; i < m_threadCount; i++)
+    {
+        m_workers[i].engine = this;
+        m_workers[i].number = i;
+        if (0 != pthread_create(&m_workers[i].thread, 0, threadMain, &m_workers[i]))
+        {
+            m_threadCount = i;          // Carry on with the threads that did start
+            break;
+        }
+    }
+}
+
+
+/** Destructor. The worker threads are stopped.
+ */
+NeoTransformEngine::~NeoTransformEngine()
+{
+    pthread_mutex_lock(&m_lock);
+    m_quit = true;
+    pthread_cond_broadcast(&m_start);
+    pthread_mutex_unlock(&m_lock);
+    for (int i = 1; i < m_threadCount; i++) pthread_join(m_workers[i].thread, 0);
+
+    pthread_cond_destroy(&m_finish);
+    pthread_cond_destroy(&m_start);
+    pthread_mutex_destroy(&m_lock);
+    delete[] m_workers;
+    delete[] m_ranges;
+    delete[] m_results;
+}
+
+
+/** Return the number of threads used, including the calling thread.
+ */
+int NeoTransformEngine::threadCount() const
+{
+    return m_threadCount;
+}
+
+
+/** Apply a function to characters of a font. The function is applied to copies of the characters, in
+ *  parallel, and the copies are then swapped in to the font in character order by the calling thread. The
+ *  font's subscriptions receive all of the changes at once.
+ *
+ *  @param  font    The font.
+ *  @param  set     The characters to transform, as a set of kNeoFontCharacterSetWords words with bit (i % 64)
+ *                  of word (i / 64) set for character i. Zero transforms every character.
+ *  @param  kernel  The function to apply to each character.
+ *  @param  context Passed to the kernel.
+ *  @return         Logical true if the font was transformed, false if the job was cancelled (in which case the
+ *                  font is unchanged).
+ */
+bool NeoTransformEngine::apply(NeoFont *font, const uint64_t *set, NeoGlyphKernel kernel, void *context)
+{
+    m_kernel = kernel;
+    m_context = context;
+    m_font = font;
+    m_fonts = 0;
+    m_indexCount = 0;
+    for (int i = 0; i < kNeoFontCharacterCount; i++)
+    {
+        if (0 == set || 0 != (set[i / 64] & (((uint64_t)1) << (i & 63)))) m_indices[m_indexCount++] = i;
+    }
+
+    run(m_indexCount);
+    if (isCancelled()) return false;
+    font->beginChanges();
+    for (int n = 0; n < m_indexCount; n++)
+    {
+        int i = m_indices[n];
+        font->character(i)->swap(&m_results[i]);
+    }
+    font->endChanges();
+    return true;
+}
+
+
+/** Apply a built-in transform to characters of a font (see apply()).
+ *
+ *  @param  font    The font.
+ *  @param  set     The characters to transform, or zero for every character.
+ *  @param  t       The transform.
+ *  @return         Logical true if the font was transformed, false if the job was cancelled.
+ */
+bool NeoTransformEngine::transform(NeoFont *font, const uint64_t *set, const NeoTransform &t)
+{
+    return apply(font, set, transformKernel, const_cast<NeoTransform *>(&t));
+}
+
+
+/** Apply a function to characters of a number of fonts. Each font is transformed in place by one thread,
+ *  with its characters in order, so each font's subscribers (if any) are called by that thread.
+ *
+ *  @param  fonts   The fonts. Each font must appear only once.
+ *  @param  count   The number of fonts.
+ *  @param  set     The characters to transform in each font, or zero for every character (see apply()).
+ *  @param  kernel  The function to apply to each character.
+ *  @param  context Passed to the kernel.
+ *  @param  done    If not zero, an array of count flags, set for the fonts that were transformed.
+ *  @return         The number of fonts transformed. This is less than count only if the job was cancelled.
+ */
+unsigned int NeoTransformEngine::applyFonts(NeoFont **fonts, unsigned int count, const uint64_t *set, NeoGlyphKernel kernel, void *context, bool *done)
+{
+    m_kernel = kernel;
+    m_context = context;
+    m_font = 0;
+    m_fonts = fonts;
+    m_done = done;
+    m_completed = 0;
+    m_indexCount = 0;
+    for (int i = 0; i < kNeoFontCharacterCount; i++)
+    {
+        if (0 == set || 0 != (set[i / 64] & (((uint64_t)1) << (i & 63)))) m_indices[m_indexCount++] = i;
+    }
+    if (0 != done) memset(done, 0, count * sizeof done[0]);
+
+    run(count);
+    return m_completed;
+}
+
+
+/** Cancel the job in progress, if any. Characters (or fonts) already started are finished, but no more are
+ *  started. This may be called by any thread, including from a kernel.
+ */
+void NeoTransformEngine::cancel()
+{
+    __atomic_store_n(&m_cancelled, 1, __ATOMIC_RELEASE);
+}
+
+
+/** Test if the current (or last) job was cancelled.
+ */
+bool NeoTransformEngine::isCancelled() const
+{
+    return 0 != __atomic_load_n(&m_cancelled, __ATOMIC_ACQUIRE);
+}
+
+
+/** Apply a built-in transform to a character. This is the kernel used by transform().
+ *
+ *  @param  c       The character.
+ *  @param  index   The character number (not used).
+ *  @param  context The transform (a pointer to a NeoTransform).
+ */
+void NeoTransformEngine::transformKernel(NeoCharacter *c, int index, void *context)
+{
+    const NeoTransform *t = (const NeoTransform *)context;
+    (void)index;
+    switch (t->type)
+    {
+        case kNeoTransformTranslate:    c->transformTranslate(t->x, t->y);      break;
+        case kNeoTransformFlipH:        c->transformFlipH();                    break;
+        case kNeoTransformFlipV:        c->transformFlipV();                    break;
+        case kNeoTransformBold:         c->transformBold();                     break;
+        case kNeoTransformSetWidth:     c->setWidth(t->x);                      break;
+        case kNeoTransformWidthDelta:   c->setWidth(c->width() + t->x);         break;
+        default:                                                                break;
+    }
+}
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      NeoTransformEngine private methods.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Run the current job, sharing the items between the threads, and wait for it to finish.
+ *
+ *  @param  items   The number of items (characters for apply(), fonts for applyFonts()).
+ */
+void NeoTransformEngine::run(unsigned int items)
+{
+    // A job with fewer items than threads is not worth waking the workers for
+    int threads = (items < (unsigned int)m_threadCount) ? 1 : m_threadCount;
+    for (int i = 0; i < m_threadCount; i++)
+    {
+        uint64_t head = (i < threads) ? (((uint64_t)items * i) / threads) : 0;
+        uint64_t tail = (i < threads) ? (((uint64_t)items * (i + 1)) / threads) : 0;
+        m_ranges[i].bounds = head | (tail << 32);
+    }
+    __atomic_store_n(&m_cancelled, 0, __ATOMIC_RELEASE);
+
+    if (threads > 1)
+    {
+        pthread_mutex_lock(&m_lock);
+        m_running = m_threadCount - 1;
+        m_job++;
+        pthread_cond_broadcast(&m_start);
+        pthread_mutex_unlock(&m_lock);
+    }
+
+    work(0);
+
+    if (threads > 1)
+    {
+        pthread_mutex_lock(&m_lock);
+        while (0 != m_running) pthread_cond_wait(&m_finish, &m_lock);
+        pthread_mutex_unlock(&m_lock);
+    }
+}
+
+
+/** Do items of the current job until none remain or the job is cancelled.
+ *
+ *  @param  thread  The thread number.
+ */
+void NeoTransformEngine::work(int thread)
+{
+    unsigned int item;
+    while (!isCancelled() && nextItem(thread, &item))
+    {
+        if (0 != m_font)
+        {
+            int i = m_indices[item];
+            m_results[i] = *m_font->character(i);
+            m_kernel(&m_results[i], i, m_context);
+        }
+        else
+        {
+            NeoFont *font = m_fonts[item];
+            for (int n = 0; n < m_indexCount; n++) m_kernel(font->character(m_indices[n]), m_indices[n], m_context);
+            if (0 != m_done) m_done[item] = true;
+            __atomic_fetch_add(&m_completed, 1, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+
+/** Take the next item for a thread: from the head of its own range if that is not empty, otherwise from the
+ *  tail of another thread's range.
+ *
+ *  @param  thread  The thread number.
+ *  @param  item    Receives the item number.
+ *  @return         Logical true if an item was taken, false if none remain.
+ */
+bool NeoTransformEngine::nextItem(int thread, unsigned int *item)
+{
+    for (int k = 0; k < m_threadCount; k++)
+    {
+        uint64_t *bounds = &m_ranges[(thread + k) % m_threadCount].bounds;
+        uint64_t v = __atomic_load_n(bounds, __ATOMIC_ACQUIRE);
+        for (;;)
+        {
+            uint32_t head = (uint32_t)v;
+            uint32_t tail = (uint32_t)(v >> 32);
+            if (head >= tail) break;
+            uint64_t taken = (0 == k) ? (v + 1) : (v - (((uint64_t)1) << 32));
+            if (__atomic_compare_exchange_n(bounds, &v, taken, true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            {
+                *item = (0 == k) ? head : (tail - 1);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+
+/** Worker thread. The thread waits for each job to start, works on it, and reports when it has finished.
+ *
+ *  @param  context The NeoTransformWorker object for the thread.
+ *  @return         Zero.
+ */
+void *NeoTransformEngine::threadMain(void *context)
+{
+    NeoTransformWorker *worker = (NeoTransformWorker *)context;
+    NeoTransformEngine *engine = worker->engine;
+
+    uint32_t job = 0;                       // No job can start until the constructor has returned
+    pthread_mutex_lock(&engine->m_lock);
+    for (;;)
+    {
+        while (job == engine->m_job && !engine->m_quit) pthread_cond_wait(&engine->m_start, &engine->m_lock);
+        if (engine->m_quit) break;
+        job = engine->m_job;
+        pthread_mutex_unlock(&engine->m_lock);
+
+        engine->work(worker->number);
+
+        pthread_mutex_lock(&engine->m_lock);
+        if (0 == --engine->m_running) pthread_cond_signal(&engine->m_finish);
+    }
+    pthread_mutex_unlock(&engine->m_lock);
+    return 0;
+}
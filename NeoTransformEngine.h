@@ -0,0 +1,120 @@
+/** @file       NeoTransformEngine.h
+ *  @brief      Applies character transforms to many glyphs at once, using a pool of threads.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+#ifndef _NEOTRANSFORMENGINE_H_
+#define _NEOTRANSFORMENGINE_H_  (1)
+
+#include <stdint.h>
+#include <pthread.h>
+#include "NeoFont.h"
+
+
+#define kNeoTransformMaxThreads     (64)        /**< Maximum number of threads, including the calling thread. */
+
+
+/* Built-in transforms (see NeoTransform).
+ */
+#define kNeoTransformTranslate      (0)         /**< transformTranslate(x, y). */
+#define kNeoTransformFlipH          (1)         /**< transformFlipH(). */
+#define kNeoTransformFlipV          (2)         /**< transformFlipV(). */
+#define kNeoTransformBold           (3)         /**< transformBold(). */
+#define kNeoTransformSetWidth       (4)         /**< setWidth(x). */
+#define kNeoTransformWidthDelta     (5)         /**< setWidth(width() + x). */
+
+
+/** A built-in transform, for use with NeoTransformEngine::transform() or NeoTransformEngine::transformKernel().
+ */
+struct NeoTransform
+{
+    int type;                       /**< The transform (kNeoTransformTranslate etc). */
+    int x;                          /**< The x-displacement, width or width change. */
+    int y;                          /**< The y-displacement. */
+};
+
+
+/** Function applied to each character by a NeoTransformEngine. The function is called by several threads at
+ *  once, for different characters. It must change only the character it is passed, and the result must
+ *  depend only on the character, its number and the context.
+ *
+ *  @param  c       The character to change. This is not part of a font.
+ *  @param  index   The character number.
+ *  @param  context The context passed to the engine.
+ */
+typedef void (*NeoGlyphKernel)(NeoCharacter *c, int index, void *context);
+
+
+struct NeoTransformWorker;
+struct NeoTransformRange;
+
+
+/** Class used to transform many characters at once. Work is shared between the calling thread and a pool of
+ *  worker threads, each taking characters from its own share of the job and taking them from the others'
+ *  shares when its own runs out.
+ *
+ *  apply() transforms characters of a single font. Each character is transformed in a private copy and the
+ *  copies are written back to the font by the calling thread, in character order, once every character has
+ *  been done. The font therefore ends up the same however many threads are used, and font subscribers are
+ *  only ever called by the calling thread.
+ *
+ *  applyFonts() transforms a list of fonts, each in place by a single thread. It is meant for batch jobs on
+ *  fonts that are not otherwise in use while the job runs.
+ *
+ *  A job in progress can be cancelled from any thread (or from a kernel). A cancelled apply() leaves the font
+ *  unchanged, and a cancelled applyFonts() leaves each font either completely transformed or unchanged.
+ *  Only one job can run at a time.
+ */
+class NeoTransformEngine
+{
+public:
+
+    NeoTransformEngine(int threads = 0);
+    ~NeoTransformEngine();
+
+    int threadCount() const;
+
+    bool apply(NeoFont *font, const uint64_t *set, NeoGlyphKernel kernel, void *context);
+    bool transform(NeoFont *font, const uint64_t *set, const NeoTransform &t);
+    unsigned int applyFonts(NeoFont **fonts, unsigned int count, const uint64_t *set, NeoGlyphKernel kernel, void *context, bool *done = 0);
+
+    void cancel();
+    bool isCancelled() const;
+
+    static void transformKernel(NeoCharacter *c, int index, void *context);
+
+private:
+
+    int m_threadCount;                  /**< Number of threads used, including the calling thread. */
+    NeoTransformWorker *m_workers;      /**< The worker threads (m_threadCount - 1 of them). */
+    NeoTransformRange *m_ranges;        /**< Each thread's share of the current job. */
+    pthread_mutex_t m_lock;             /**< Lock for the job start and finish state. */
+    pthread_cond_t m_start;             /**< Signalled when a job starts, or the workers must quit. */
+    pthread_cond_t m_finish;            /**< Signalled when the last worker finishes a job. */
+    uint32_t m_job;                     /**< Job number, incremented as each job starts. */
+    int m_running;                      /**< Number of workers still working on the current job. */
+    bool m_quit;                        /**< Set to stop the workers. */
+    int m_cancelled;                    /**< Set to cancel the current job (accessed atomically). */
+
+    /* The current job. */
+    NeoGlyphKernel m_kernel;            /**< The function applied to each character. */
+    void *m_context;                    /**< The context passed to m_kernel. */
+    NeoFont *m_font;                    /**< The font, for apply(). */
+    NeoFont **m_fonts;                  /**< The fonts, for applyFonts(). */
+    bool *m_done;                       /**< Set for each font completed by applyFonts(), or zero. */
+    int m_indices[kNeoFontCharacterCount];  /**< The characters to transform. */
+    int m_indexCount;                   /**< The number of characters to transform. */
+    NeoCharacter *m_results;            /**< Transformed copy of each character, for apply(). */
+    unsigned int m_completed;           /**< Number of fonts completed by applyFonts() (accessed atomically). */
+
+    NeoTransformEngine(const NeoTransformEngine &other);
+    NeoTransformEngine &operator=(const NeoTransformEngine &other);
+
+    void run(unsigned int items);
+    void work(int thread);
+    bool nextItem(int thread, unsigned int *item);
+    static void *threadMain(void *context);
+};
+
+
+
+#endif  // _NEOTRANSFORMENGINE_H_
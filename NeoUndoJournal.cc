@@ -0,0 +1,730 @@
+/** @file       NeoUndoJournal.cc
+ *  @brief      Undo/redo journal for NeoFont edits.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "NeoUndoJournal.h"
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      Private Types.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+#define kMaskWords          ((kNeoCharacterMaxHeight + 63) / 64)        /**< Number of words in a row mask. */
+#define kGlyphSetWords      ((kNeoFontCharacterCount + 63) / 64)        /**< Number of words in a glyph set. */
+#define kHeaderStringLength (64)                                        /**< Space for each header string. */
+
+
+/** Saved font settings.
+ */
+struct NeoUndoHeader
+{
+    char appletName[kHeaderStringLength];       /**< Applet name. */
+    char appletInfo[kHeaderStringLength];       /**< Applet info string. */
+    char fontName[kHeaderStringLength];         /**< Font name. */
+    char version[kHeaderStringLength];          /**< Version string. */
+    int ident;                                  /**< Applet ID. */
+    int height;                                 /**< Font height. */
+};
+
+
+/** Saved rows of a single character. Rows that are not in rowMask are the same in the saved state and in
+ *  the state the record is swapped with. Rows beyond the character height are treated as blank.
+ */
+struct NeoUndoGlyph
+{
+    NeoUndoGlyph *next;                         /**< The next glyph in the record. */
+    int index;                                  /**< Character number. */
+    int width;                                  /**< Character width. */
+    int height;                                 /**< Character height. */
+    int rowWords;                               /**< Number of words in each saved row. */
+    int rowCount;                               /**< Number of saved rows. */
+    uint64_t rowMask[kMaskWords];               /**< Bit y is set if row y is saved. */
+    uint64_t *rows;                             /**< The saved rows, in ascending order. */
+};
+
+
+/** A single undoable operation.
+ */
+struct NeoUndoRecord
+{
+    NeoUndoRecord *prev;                        /**< The next older record. */
+    NeoUndoRecord *next;                        /**< The next newer record. */
+    char reason[kNeoUndoReasonLength];          /**< Description of the operation. */
+    int stroke;                                 /**< Stroke number used for coalescing, or zero. */
+    NeoUndoHeader *header;                      /**< Saved font settings, or zero. */
+    NeoUndoGlyph *glyphs;                       /**< List of saved glyphs. */
+    uint64_t saved[kGlyphSetWords];             /**< Set of glyphs saved while the record is open. */
+    unsigned int bytes;                         /**< Memory used by the record. */
+    bool reopened;                              /**< Logical true if the record was reopened to coalesce an operation. */
+};
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      Private Functions.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Test a bit in a mask.
+ */
+static inline bool testBit(const uint64_t *mask, int n)
+{
+    return 0 != (mask[n / 64] & (((uint64_t)1) << (n & 63)));
+}
+
+
+/** Set a bit in a mask.
+ */
+static inline void setBit(uint64_t *mask, int n)
+{
+    mask[n / 64] |= ((uint64_t)1) << (n & 63);
+}
+
+
+/** Compare two bitmap rows, treating missing words as blank.
+ *
+ *  @param  a       The first row, or zero for a blank row.
+ *  @param  aWords  The number of words in the first row.
+ *  @param  b       The second row, or zero for a blank row.
+ *  @param  bWords  The number of words in the second row.
+ *  @return         Logical true if the rows hold the same pixels.
+ */
+static bool rowsEqual(const uint64_t *a, int aWords, const uint64_t *b, int bWords)
+{
+    for (int k = 0; k < kNeoCharacterRowWords; k++)
+    {
+        uint64_t va = (0 != a && k < aWords) ? a[k] : 0;
+        uint64_t vb = (0 != b && k < bWords) ? b[k] : 0;
+        if (va != vb) return false;
+    }
+    return true;
+}
+
+
+/** Calculate the memory used by a saved glyph.
+ */
+static unsigned int glyphBytes(const NeoUndoGlyph *g)
+{
+    return sizeof *g + (g->rowCount * g->rowWords * sizeof g->rows[0]);
+}
+
+
+/** Release a saved glyph.
+ */
+static void freeGlyph(NeoUndoGlyph *g)
+{
+    delete[] g->rows;
+    delete g;
+}
+
+
+/** Save rows of a character.
+ *
+ *  @param  c       The character.
+ *  @param  index   The character number.
+ *  @param  mask    The rows to save, or zero to save every row. Rows beyond the character height are saved as blank.
+ *  @return         The saved glyph.
+ */
+static NeoUndoGlyph *captureGlyph(const NeoCharacter *c, int index, const uint64_t *mask)
+{
+    NeoUndoGlyph *g = new NeoUndoGlyph;
+    g->next = 0;
+    g->index = index;
+    g->width = c->width();
+    g->height = c->height();
+    g->rowWords = c->rowWords();
+    g->rowCount = 0;
+    memset(g->rowMask, 0, sizeof g->rowMask);
+    for (int y = 0; y < kNeoCharacterMaxHeight; y++)
+    {
+        if ((0 == mask) ? (y < g->height) : testBit(mask, y))
+        {
+            setBit(g->rowMask, y);
+            g->rowCount++;
+        }
+    }
+
+    g->rows = new uint64_t[g->rowCount * g->rowWords]();
+    uint64_t *out = g->rows;
+    for (int y = 0; y < kNeoCharacterMaxHeight; y++)
+    {
+        if (testBit(g->rowMask, y))
+        {
+            if (y < g->height) memcpy(out, c->row(y), g->rowWords * sizeof out[0]);
+            out += g->rowWords;
+        }
+    }
+    return g;
+}
+
+
+/** Restore a saved glyph to a character.
+ *
+ *  @param  c       The character.
+ *  @param  g       The saved glyph.
+ */
+static void applyGlyph(NeoCharacter *c, const NeoUndoGlyph *g)
+{
+    c->setHeight(g->height);
+    c->setWidth(g->width);
+    const uint64_t *in = g->rows;
+    for (int y = 0; y < kNeoCharacterMaxHeight; y++)
+    {
+        if (testBit(g->rowMask, y))
+        {
+            c->setRow(y, in);
+            in += g->rowWords;
+        }
+    }
+}
+
+
+/** Reduce a complete glyph snapshot to the rows that differ from the current state of the character.
+ *
+ *  @param  g       The saved glyph. This is released if it is replaced.
+ *  @param  c       The character in its current state.
+ *  @return         The reduced glyph, or zero if the character has not changed.
+ */
+static NeoUndoGlyph *compactGlyph(NeoUndoGlyph *g, const NeoCharacter *c)
+{
+    uint64_t changed[kMaskWords] = { 0 };
+    int count = 0;
+    int rows = (g->height > c->height()) ? g->height : c->height();
+    const uint64_t *in = g->rows;
+    for (int y = 0; y < rows; y++)
+    {
+        const uint64_t *saved = 0;
+        if (testBit(g->rowMask, y))
+        {
+            saved = in;
+            in += g->rowWords;
+        }
+        if (!rowsEqual(saved, g->rowWords, c->row(y), c->rowWords()))
+        {
+            setBit(changed, y);
+            count++;
+        }
+    }
+
+    if (0 == count && g->width == c->width() && g->height == c->height())
+    {
+        freeGlyph(g);
+        return 0;
+    }
+
+    uint64_t *reduced = new uint64_t[count * g->rowWords]();
+    uint64_t *out = reduced;
+    in = g->rows;
+    for (int y = 0; y < kNeoCharacterMaxHeight; y++)
+    {
+        bool saved = testBit(g->rowMask, y);
+        if (testBit(changed, y))
+        {
+            if (saved) memcpy(out, in, g->rowWords * sizeof out[0]);
+            out += g->rowWords;
+        }
+        if (saved) in += g->rowWords;
+    }
+
+    delete[] g->rows;
+    g->rows = reduced;
+    g->rowCount = count;
+    memcpy(g->rowMask, changed, sizeof g->rowMask);
+    return g;
+}
+
+
+/** Convert a reduced glyph back to a complete snapshot. The character must be in the state that the glyph
+ *  was reduced against, so that the rows that were not saved can be taken from it.
+ *
+ *  @param  g       The saved glyph. This is released and replaced.
+ *  @param  c       The character.
+ *  @return         The complete snapshot.
+ */
+static NeoUndoGlyph *expandGlyph(NeoUndoGlyph *g, const NeoCharacter *c)
+{
+    NeoUndoGlyph *full = new NeoUndoGlyph;
+    full->next = 0;
+    full->index = g->index;
+    full->width = g->width;
+    full->height = g->height;
+    full->rowWords = g->rowWords;
+    full->rowCount = 0;
+    memset(full->rowMask, 0, sizeof full->rowMask);
+    full->rows = new uint64_t[g->height * g->rowWords]();
+
+    int words = (g->rowWords < c->rowWords()) ? g->rowWords : c->rowWords();
+    const uint64_t *in = g->rows;
+    for (int y = 0; y < kNeoCharacterMaxHeight; y++)
+    {
+        bool saved = testBit(g->rowMask, y);
+        if (y < g->height)
+        {
+            uint64_t *out = &full->rows[y * g->rowWords];
+            if (saved) memcpy(out, in, g->rowWords * sizeof out[0]);
+            else if (y < c->height()) memcpy(out, c->row(y), words * sizeof out[0]);
+            setBit(full->rowMask, y);
+            full->rowCount++;
+        }
+        if (saved) in += g->rowWords;
+    }
+    freeGlyph(g);
+    return full;
+}
+
+
+/** Save the font settings.
+ *
+ *  @param  font    The font.
+ *  @return         The saved settings.
+ */
+static NeoUndoHeader *captureHeader(NeoFont *font)
+{
+    NeoUndoHeader *h = new NeoUndoHeader;
+    memset(h, 0, sizeof *h);
+    strncpy(h->appletName, font->appletName(), sizeof h->appletName - 1);
+    strncpy(h->appletInfo, font->appletInfo(), sizeof h->appletInfo - 1);
+    strncpy(h->fontName, font->fontName(), sizeof h->fontName - 1);
+    strncpy(h->version, font->version(), sizeof h->version - 1);
+    h->ident = font->ident();
+    h->height = font->height();
+    return h;
+}
+
+
+/** Restore the font settings. The height of every character is also set to the font height.
+ *
+ *  @param  font    The font.
+ *  @param  h       The saved settings.
+ */
+static void applyHeader(NeoFont *font, const NeoUndoHeader *h)
+{
+    font->setFontName(h->fontName);
+    font->setAppletName(h->appletName);
+    font->setAppletInfo(h->appletInfo);
+    font->setVersion(h->version);
+    font->setIdent(h->ident);
+    font->setHeight(h->height);
+}
+
+
+/** Calculate the memory used by a record.
+ */
+static unsigned int recordBytes(const NeoUndoRecord *r)
+{
+    unsigned int bytes = sizeof *r;
+    if (0 != r->header) bytes += sizeof *r->header;
+    for (const NeoUndoGlyph *g = r->glyphs; 0 != g; g = g->next) bytes += glyphBytes(g);
+    return bytes;
+}
+
+
+/** Release a record and everything it holds.
+ */
+static void freeRecord(NeoUndoRecord *r)
+{
+    while (0 != r->glyphs)
+    {
+        NeoUndoGlyph *g = r->glyphs;
+        r->glyphs = g->next;
+        freeGlyph(g);
+    }
+    delete r->header;
+    delete r;
+}
+
+
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      NeoUndoJournal class definition.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+/** Class constructor.
+ *
+ *  @param  font    The font whose edits are to be recorded.
+ */
+NeoUndoJournal::NeoUndoJournal(NeoFont *font)
+    :
+        m_font(font),
+        m_open(0),
+        m_oldest(0),
+        m_newest(0),
+        m_redo(0),
+        m_undoCount(0),
+        m_memoryUsed(0),
+        m_memoryLimit(kNeoUndoDefaultMemoryLimit)
+{
+    // Nothing.
+}
+
+
+/** Class destructor.
+ */
+NeoUndoJournal::~NeoUndoJournal()
+{
+    clear();
+}
+
+
+/** Start recording an operation. Any record that is still open is committed first. The redo stack is kept
+ *  until the operation is committed, and is only discarded then if the operation changed the font.
+ *
+ *  @param  reason  Description of the operation (eg: "bold (all)").
+ *  @param  stroke  Stroke number. If this is non-zero and matches the stroke of the most recent record, and
+ *                  nothing has been undone since, the operation is added to that record instead of starting
+ *                  a new one.
+ *  @return         Logical true if a new record was started, false if the operation was coalesced.
+ */
+bool NeoUndoJournal::begin(const char *reason, int stroke)
+{
+    commit();
+
+    if (0 != stroke && 0 != m_newest && m_newest->stroke == stroke && 0 == m_redo)
+    {
+        // Reopen the previous record. The font is still in the state the record was committed against,
+        // so its glyphs can be expanded back to complete snapshots. They are marked as saved, so that the
+        // state before the stroke is kept rather than being joined by a snapshot from part way through it.
+        m_open = popUndo();
+        m_open->reopened = true;
+        for (NeoUndoGlyph **g = &m_open->glyphs; 0 != *g; g = &(*g)->next)
+        {
+            NeoUndoGlyph *next = (*g)->next;
+            *g = expandGlyph(*g, m_font->character((*g)->index));
+            (*g)->next = next;
+            setBit(m_open->saved, (*g)->index);
+        }
+        return false;
+    }
+
+    m_open = new NeoUndoRecord;
+    memset(m_open, 0, sizeof *m_open);
+    strncpy(m_open->reason, reason, sizeof m_open->reason - 1);
+    m_open->stroke = stroke;
+    return true;
+}
+
+
+/** Save a character before it is modified. This has no effect if no record is open, or if the character has
+ *  already been saved in the open record.
+ *
+ *  @param  index   The character number.
+ */
+void NeoUndoJournal::saveCharacter(int index)
+{
+    if (0 == m_open || index < 0 || index >= kNeoFontCharacterCount || testBit(m_open->saved, index)) return;
+
+    NeoUndoGlyph *g = captureGlyph(m_font->character(index), index, 0);
+    g->next = m_open->glyphs;
+    m_open->glyphs = g;
+    setBit(m_open->saved, index);
+}
+
+
+/** Save the font settings and every character, before an operation that may modify any of them.
+ */
+void NeoUndoJournal::saveFont()
+{
+    if (0 == m_open) return;
+
+    if (0 == m_open->header) m_open->header = captureHeader(m_font);
+    for (int i = 0; i < kNeoFontCharacterCount; i++) saveCharacter(i);
+}
+
+
+/** Complete the open record. The saved state is compared with the font and only the changes are kept. If
+ *  nothing changed, the record is discarded and the redo stack is left alone, unless the record was reopened
+ *  by begin() to coalesce a stroke: that record was already on the undo list, so it is kept (possibly empty)
+ *  to keep the list in step with any undo stack that mirrors it. Otherwise the redo stack is discarded.
+ *
+ *  @return         Logical true if a new record was added to the undo list.
+ */
+bool NeoUndoJournal::commit()
+{
+    if (0 == m_open) return false;
+    NeoUndoRecord *r = m_open;
+    m_open = 0;
+
+    NeoUndoGlyph **link = &r->glyphs;
+    while (0 != *link)
+    {
+        NeoUndoGlyph *next = (*link)->next;
+        NeoUndoGlyph *g = compactGlyph(*link, m_font->character((*link)->index));
+        if (0 == g)
+        {
+            *link = next;
+        }
+        else
+        {
+            *link = g;
+            link = &g->next;
+        }
+    }
+
+    if (0 != r->header)
+    {
+        NeoUndoHeader *current = captureHeader(m_font);
+        if (0 == memcmp(current, r->header, sizeof *current))
+        {
+            delete r->header;
+            r->header = 0;
+        }
+        delete current;
+    }
+
+    bool added = !r->reopened;
+    if (0 == r->header && 0 == r->glyphs && added)
+    {
+        freeRecord(r);
+        return false;
+    }
+
+    clearRedo();
+    memset(r->saved, 0, sizeof r->saved);
+    r->reopened = false;
+    pushUndo(r);
+    trim();
+    return added;
+}
+
+
+/** Discard all records.
+ */
+void NeoUndoJournal::clear()
+{
+    if (0 != m_open)
+    {
+        freeRecord(m_open);
+        m_open = 0;
+    }
+    clearRedo();
+    while (0 != m_newest) freeRecord(popUndo());
+}
+
+
+/** Test if there is an operation to undo.
+ */
+bool NeoUndoJournal::canUndo() const
+{
+    return 0 != m_newest || 0 != m_open;
+}
+
+
+/** Test if there is an operation to redo.
+ */
+bool NeoUndoJournal::canRedo() const
+{
+    return 0 != m_redo;
+}
+
+
+/** Get the description of the operation that undo() will reverse.
+ *
+ *  @return         The reason string, or zero if there is nothing to undo.
+ */
+const char *NeoUndoJournal::undoReason() const
+{
+    if (0 != m_open) return m_open->reason;
+    else return (0 != m_newest) ? m_newest->reason : 0;
+}
+
+
+/** Get the description of the operation that redo() will repeat.
+ *
+ *  @return         The reason string, or zero if there is nothing to redo.
+ */
+const char *NeoUndoJournal::redoReason() const
+{
+    return (0 != m_redo) ? m_redo->reason : 0;
+}
+
+
+/** Undo the most recent operation.
+ *
+ *  @return         Logical true if an operation was undone.
+ */
+bool NeoUndoJournal::undo()
+{
+    commit();
+    if (0 == m_newest) return false;
+
+    NeoUndoRecord *r = popUndo();
+    swap(r);
+    r->next = m_redo;
+    r->prev = 0;
+    m_redo = r;
+    m_memoryUsed += r->bytes;
+    return true;
+}
+
+
+/** Redo the most recently undone operation.
+ *
+ *  @return         Logical true if an operation was redone.
+ */
+bool NeoUndoJournal::redo()
+{
+    commit();
+    if (0 == m_redo) return false;
+
+    NeoUndoRecord *r = m_redo;
+    m_redo = r->next;
+    m_memoryUsed -= r->bytes;
+    swap(r);
+    pushUndo(r);
+    trim();
+    return true;
+}
+
+
+/** Get the number of operations that can be undone.
+ */
+int NeoUndoJournal::undoCount() const
+{
+    return m_undoCount;
+}
+
+
+/** Get the memory used by the journal.
+ *
+ *  @return         The number of bytes held by committed records.
+ */
+unsigned int NeoUndoJournal::memoryUsed() const
+{
+    return m_memoryUsed;
+}
+
+
+/** Get the memory limit.
+ *
+ *  @return         The limit, in bytes.
+ */
+unsigned int NeoUndoJournal::memoryLimit() const
+{
+    return m_memoryLimit;
+}
+
+
+/** Set the memory limit. The oldest records are discarded if necessary.
+ *
+ *  @param  bytes   The new limit, in bytes.
+ */
+void NeoUndoJournal::setMemoryLimit(unsigned int bytes)
+{
+    m_memoryLimit = bytes;
+    trim();
+}
+
+
+/** Add a record to the newest end of the undo list.
+ */
+void NeoUndoJournal::pushUndo(NeoUndoRecord *record)
+{
+    record->bytes = recordBytes(record);
+    record->prev = m_newest;
+    record->next = 0;
+    if (0 != m_newest) m_newest->next = record;
+    else m_oldest = record;
+    m_newest = record;
+    m_undoCount++;
+    m_memoryUsed += record->bytes;
+}
+
+
+/** Remove the newest record from the undo list.
+ *
+ *  @return         The record, or zero if the list is empty.
+ */
+NeoUndoRecord *NeoUndoJournal::popUndo()
+{
+    NeoUndoRecord *record = m_newest;
+    if (0 != record)
+    {
+        m_newest = record->prev;
+        if (0 != m_newest) m_newest->next = 0;
+        else m_oldest = 0;
+        m_undoCount--;
+        m_memoryUsed -= record->bytes;
+    }
+    return record;
+}
+
+
+/** Discard the redo stack.
+ */
+void NeoUndoJournal::clearRedo()
+{
+    while (0 != m_redo)
+    {
+        NeoUndoRecord *r = m_redo;
+        m_redo = r->next;
+        m_memoryUsed -= r->bytes;
+        freeRecord(r);
+    }
+}
+
+
+/** Discard the oldest records until the journal is within its memory limit.
+ */
+void NeoUndoJournal::trim()
+{
+    while (m_memoryUsed > m_memoryLimit && 0 != m_oldest)
+    {
+        NeoUndoRecord *r = m_oldest;
+        m_oldest = r->next;
+        if (0 != m_oldest) m_oldest->prev = 0;
+        else m_newest = 0;
+        m_undoCount--;
+        m_memoryUsed -= r->bytes;
+        freeRecord(r);
+    }
+}
+
+
+/** Exchange the state saved in a record with the current state of the font. Afterwards the record holds the
+ *  state needed to reverse the exchange. Subscribers to the font receive the changes together.
+ *
+ *  @param  record  The record. This must not be on the undo list or the redo stack.
+ */
+void NeoUndoJournal::swap(NeoUndoRecord *record)
+{
+    // Capture the current state before anything is applied, since restoring the font height changes every character
+    NeoUndoHeader *header = (0 != record->header) ? captureHeader(m_font) : 0;
+    NeoUndoGlyph *current = 0;
+    NeoUndoGlyph **tail = &current;
+    for (const NeoUndoGlyph *saved = record->glyphs; 0 != saved; saved = saved->next)
+    {
+        // The rows that differ are the same in both directions, so save the same rows from the character
+        *tail = captureGlyph(m_font->character(saved->index), saved->index, saved->rowMask);
+        tail = &(*tail)->next;
+    }
+
+    m_font->beginChanges();
+    if (0 != record->header)
+    {
+        applyHeader(m_font, record->header);
+        delete record->header;
+        record->header = header;
+    }
+    while (0 != record->glyphs)
+    {
+        NeoUndoGlyph *saved = record->glyphs;
+        record->glyphs = saved->next;
+        applyGlyph(m_font->character(saved->index), saved);
+        freeGlyph(saved);
+    }
+    m_font->endChanges();
+    record->glyphs = current;
+    record->bytes = recordBytes(record);
+}
@@ -0,0 +1,79 @@
+/** @file       NeoUndoJournal.h
+ *  @brief      Undo/redo journal for NeoFont edits.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+#ifndef _NEOUNDOJOURNAL_H_
+#define _NEOUNDOJOURNAL_H_  (1)
+
+#include <stdint.h>
+#include "NeoFont.h"
+
+
+#define kNeoUndoDefaultMemoryLimit  (4u * 1024u * 1024u)    /**< Default limit on the memory used by the journal, in bytes. */
+#define kNeoUndoReasonLength        (48)                    /**< Maximum length of a reason string, including the terminator. */
+
+
+struct NeoUndoRecord;
+struct NeoUndoGlyph;
+
+
+/** Class used to record changes to a font so that they can be undone and redone.
+ *
+ *  An operation is bracketed by begin() and commit(). Between these, saveCharacter() or saveFont() must be
+ *  called before the corresponding part of the font is modified. When the record is committed it is reduced
+ *  to just the glyph rows (and font settings) that actually changed. Undo and redo swap the saved state
+ *  with the state of the font, so a record holds only the rows that differ between the two.
+ *
+ *  Successive operations with the same non-zero stroke number are coalesced in to a single record, which
+ *  allows a pixel drag to be undone in one step. The oldest records are discarded if the journal grows
+ *  beyond its memory limit.
+ */
+class NeoUndoJournal
+{
+public:
+
+    NeoUndoJournal(NeoFont *font);
+    ~NeoUndoJournal();
+
+    bool begin(const char *reason, int stroke = 0);
+    void saveCharacter(int index);
+    void saveFont();
+    bool commit();
+    void clear();
+
+    bool canUndo() const;
+    bool canRedo() const;
+    const char *undoReason() const;
+    const char *redoReason() const;
+    bool undo();
+    bool redo();
+
+    int undoCount() const;
+    unsigned int memoryUsed() const;
+    unsigned int memoryLimit() const;
+    void setMemoryLimit(unsigned int bytes);
+
+private:
+
+    NeoFont *m_font;                /**< The font being edited. */
+    NeoUndoRecord *m_open;          /**< The record being built, or zero. */
+    NeoUndoRecord *m_oldest;        /**< The oldest record on the undo list. */
+    NeoUndoRecord *m_newest;        /**< The newest record on the undo list. */
+    NeoUndoRecord *m_redo;          /**< The top of the redo stack. */
+    int m_undoCount;                /**< The number of records on the undo list. */
+    unsigned int m_memoryUsed;      /**< Bytes used by the undo list and redo stack. */
+    unsigned int m_memoryLimit;     /**< Limit for m_memoryUsed. */
+
+    NeoUndoJournal(const NeoUndoJournal &other);
+    NeoUndoJournal &operator=(const NeoUndoJournal &other);
+
+    void pushUndo(NeoUndoRecord *record);
+    NeoUndoRecord *popUndo();
+    void clearRedo();
+    void trim();
+    void swap(NeoUndoRecord *record);
+};
+
+
+
+#endif  // _NEOUNDOJOURNAL_H_
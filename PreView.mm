@@ -40,7 +40,7 @@
     
     float x = 4.0;  // Leave some space to the left of the display.
 	
-	NSData *encoded_data = [[neoFontEditor previewString] dataUsingEncoding:NSWindowsCP1252StringEncoding allowLossyConversion:YES];
+	NSData *encoded_data = [neoFontEditor previewCodes];
 	const unsigned char *text = (const unsigned char *) [encoded_data bytes];
     const unsigned char *end = text + [encoded_data length];
 
@@ -56,7 +56,7 @@
             count ++;
         }
         NeoCharacter *character = font->character(code);
-        [neoFontEditor renderCharacter:character context:context x:x y:vertical_offset size:pixel_size];
+        [neoFontEditor renderCharacter:code context:context x:x y:vertical_offset size:pixel_size];
         x += character->width() * pixel_size;
     }
     
@@ -540,8 +540,8 @@ bool NeoFont::initWithPreset(int n)
 {
     int font_width = 6;
     uint8_t* data = 0;
-    if (n == 0) data = font_m100;
-    else if (n == 1) data = font_m10;
+    if (n == kNeoFontPresetModel100) data = font_m100;
+    else if (n == kNeoFontPresetModel10) data = font_m10;
     else data = 0;
     
     if (0 != data)
@@ -550,7 +550,7 @@ bool NeoFont::initWithPreset(int n)
         clear();
         for (int i = 0; i < 256; i++)
         {
-            CharacterDefinition *c = character(i);
+            NeoCharacter *c = character(i);
             c->clear();
             c->setWidth(font_width);
             for (int x = 0; x < font_width; x++)
@@ -6,4 +6,14 @@
  *  Copyright 2006 __MyCompanyName__. All rights reserved.
  *
  */
+#ifndef _PRESETFONTS_H_
+#define _PRESETFONTS_H_     (1)
 
+#include <stdint.h>
+#include "NeoFont.h"
+
+#define kNeoFontPresetModel100      (0)         /**< Tandy Model 100 font. */
+#define kNeoFontPresetModel10       (1)         /**< Tandy Model 10 font. */
+#define kNeoFontPresetCount         (2)         /**< Number of preset fonts. */
+
+#endif  // _PRESETFONTS_H_
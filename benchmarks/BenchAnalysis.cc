@@ -0,0 +1,266 @@
+/** @file       BenchAnalysis.cc
+ *  @brief      Benchmarks for font metrics analysis and trimming.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+
+#include <stdint.h>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "BenchFonts.h"
+#include "NeoFontAnalysis.h"
+#include "NeoFontOptimizer.h"
+
+
+/** Load a benchmark font (see benchFont()) and, for the odd numbered variants, make it look more like a
+ *  real font: some glyphs blank, some copies of others, and the rest moved so that they have margins.
+ *
+ *  @param  font    The font to fill.
+ *  @param  n       The variant, from 0 to (2 * kBenchFontCount) - 1.
+ */
+static void benchAnalysisFont(NeoFont *font, int n)
+{
+    benchFont(font, n / 2);
+    if (0 == (n & 1)) return;
+    uint32_t seed = 999 + n;
+    for (int i = 0; i < kNeoFontCharacterCount; i++)
+    {
+        NeoCharacter *c = font->character(i);
+        uint32_t r = benchRandom(&seed);
+        if (0 == (r % 5))
+        {
+            c->clear();
+        }
+        else if (1 == (r % 5) && 0 != i)
+        {
+            const NeoCharacter *source = font->character((r >> 8) % i);
+            c->setWidth(source->width());
+            for (int y = 0; y < c->height(); y++) c->setRow(y, source->row(y));
+        }
+        else
+        {
+            c->transformTranslate((int)((r >> 8) % 5) - 2, (int)((r >> 12) % 7) - 2);
+        }
+    }
+}
+
+
+/** Check an analysis against the font, pixel by pixel.
+ *
+ *  @param  font    The font.
+ *  @param  a       The analysis of the font.
+ *  @return         Logical true if every figure is correct.
+ */
+static bool benchAnalysisValid(const NeoFont *font, const NeoFontAnalysis *a)
+{
+    int top = font->height();
+    int bottom = 0;
+    int empty = 0;
+    int duplicates = 0;
+    unsigned int widths[kNeoCharacterMaxWidth + 1] = { 0 };
+    for (int i = 0; i < kNeoFontCharacterCount; i++)
+    {
+        const NeoCharacter *c = font->character(i);
+        const NeoGlyphMetrics *m = a->glyph(i);
+        NeoCharacterRect box = { c->width(), c->height(), 0, 0 };
+        int ink = 0;
+        for (int y = 0; y < c->height(); y++)
+        {
+            for (int x = 0; x < c->width(); x++)
+            {
+                if (!c->getPixel(x, y)) continue;
+                ink++;
+                if (x < box.x0) box.x0 = x;
+                if (y < box.y0) box.y0 = y;
+                if (x + 1 > box.x1) box.x1 = x + 1;
+                if (y + 1 > box.y1) box.y1 = y + 1;
+            }
+        }
+        if (0 == ink) box.x0 = box.y0 = 0;
+        if (m->width != c->width() || m->ink != ink || m->bounds.x0 != box.x0 || m->bounds.y0 != box.y0 ||
+            m->bounds.x1 != box.x1 || m->bounds.y1 != box.y1 || m->leftBearing != box.x0 ||
+            m->rightBearing != ((0 == ink) ? c->width() : (c->width() - box.x1)) ||
+            m->appletBytes != (unsigned int)(c->width() * ((c->height() + 7) / 8)))
+        {
+            return false;
+        }
+
+        int first = kNeoGlyphUnique;
+        for (int j = 0; j < i && kNeoGlyphUnique == first; j++)
+        {
+            const NeoCharacter *other = font->character(j);
+            bool same = (other->width() == c->width());
+            for (int y = 0; same && y < c->height(); y++)
+            {
+                for (int x = 0; same && x < c->width(); x++) same = (other->getPixel(x, y) == c->getPixel(x, y));
+            }
+            if (same) first = j;
+        }
+        if (m->duplicateOf != first) return false;
+
+        if (0 != ink && box.y0 < top) top = box.y0;
+        if (0 != ink && box.y1 > bottom) bottom = box.y1;
+        if (0 == ink) empty++;
+        if (kNeoGlyphUnique != first) duplicates++;
+        widths[c->width()]++;
+    }
+    if (0 == bottom) top = 0;
+    for (int w = 0; w <= kNeoCharacterMaxWidth; w++)
+    {
+        if (a->widthCount(w) != widths[w]) return false;
+    }
+
+    std::vector<char> json(a->jsonSize());
+    return a->inkTop() == top && a->inkBottom() == bottom && a->emptyCount() == empty && a->duplicateCount() == duplicates &&
+           a->appletSize() == font->appletSize() && a->bitmapBytes() == font->bitmapSize() &&
+           a->encodeJSON(&json[0], json.size()) == json.size() && 0 == a->encodeJSON(&json[0], json.size() - 1) &&
+           '{' == json[0] && '\n' == json[json.size() - 1];
+}
+
+
+/** Analyse a font. Items are glyphs. Variants are the benchmark fonts, each as is (even) and with blank,
+ *  copied and moved glyphs (odd).
+ */
+static void BM_Analyse(benchmark::State &state)
+{
+    NeoFont *font = new NeoFont;
+    benchAnalysisFont(font, (int)state.range(0));
+    NeoFontAnalysis *analysis = new NeoFontAnalysis;
+    analysis->analyse(font);
+    if (!benchAnalysisValid(font, analysis)) state.SkipWithError("analysis not correct");
+    for (auto _ : state)
+    {
+        analysis->analyse(font);
+        benchmark::DoNotOptimize(analysis->inkBottom());
+    }
+    state.SetItemsProcessed(state.iterations() * kNeoFontCharacterCount);
+    state.counters["empty"] = analysis->emptyCount();
+    state.counters["duplicates"] = analysis->duplicateCount();
+    delete analysis;
+    delete font;
+}
+BENCHMARK(BM_Analyse)->DenseRange(0, (2 * kBenchFontCount) - 1);
+
+
+/** Write an analysis as JSON. Bytes are bytes of JSON.
+ */
+static void BM_AnalysisJSON(benchmark::State &state)
+{
+    NeoFont *font = new NeoFont;
+    benchAnalysisFont(font, 1);
+    NeoFontAnalysis *analysis = new NeoFontAnalysis;
+    analysis->analyse(font);
+    std::vector<char> json(analysis->jsonSize());
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(analysis->encodeJSON(&json[0], json.size()));
+    }
+    state.SetBytesProcessed(state.iterations() * json.size());
+    delete analysis;
+    delete font;
+}
+BENCHMARK(BM_AnalysisJSON);
+
+
+/** Load a benchmark analysis font (see benchAnalysisFont()) and pad it as a converted font would be: blank
+ *  rows are added at the top and bottom, and blank columns either side of each glyph.
+ *
+ *  @param  font    The font to fill.
+ *  @param  n       The variant, from 0 to (2 * kBenchFontCount) - 1.
+ */
+static void benchPaddedFont(NeoFont *font, int n)
+{
+    benchAnalysisFont(font, n);
+    int top = 1 + (n % 3);
+    font->setHeight(font->height() + top + 3);
+    uint32_t seed = 4321 + n;
+    for (int i = 0; i < kNeoFontCharacterCount; i++)
+    {
+        NeoCharacter *c = font->character(i);
+        uint32_t r = benchRandom(&seed);
+        int left = r % 4;
+        c->setWidth(c->width() + left + ((r >> 8) % 4));
+        c->transformTranslate(left, top);
+    }
+}
+
+
+/** Check that an optimised font holds the same ink as the original, moved as planned, and that the glyph
+ *  widths, side bearings, height and applet size are as planned. The change is then undone, which must
+ *  restore the original font.
+ *
+ *  @param  original    The font before it was optimised.
+ *  @param  font        The optimised font.
+ *  @param  journal     The undo journal of the optimised font.
+ *  @param  o           The optimiser used.
+ *  @return             Logical true if the font is correct.
+ */
+static bool benchOptimiseValid(const NeoFont *original, NeoFont *font, NeoUndoJournal *journal, const NeoFontOptimizer *o)
+{
+    if (font->height() != o->heightAfter() || font->appletSize() != o->appletSizeAfter() ||
+        o->appletSizeBefore() - o->savedBytes() != o->appletSizeAfter() || original->appletSize() != o->appletSizeBefore())
+    {
+        return false;
+    }
+    NeoFontAnalysis *after = new NeoFontAnalysis;
+    after->analyse(font);
+    bool ok = (kNeoTrimHeightTight != o->heightMode() || after->inkBottom() == font->height());
+    for (int i = 0; ok && i < kNeoFontCharacterCount; i++)
+    {
+        const NeoCharacter *before = original->character(i);
+        const NeoCharacter *c = font->character(i);
+        const NeoGlyphMetrics *m = after->glyph(i);
+        int ink = 0;
+        for (int y = 0; ok && y < before->height(); y++)
+        {
+            for (int x = 0; ok && x < before->width(); x++)
+            {
+                if (!before->getPixel(x, y)) continue;
+                ink++;
+                int dy = y - o->rowsRaised();
+                int dx = x - o->shift(i);
+                ok = (dx >= 0 && dx < c->width() && dy >= 0 && dy < c->height() && c->getPixel(dx, dy));
+            }
+        }
+        ok = ok && m->ink == ink && c->width() == o->width(i);
+        if (ok && 0 != ink)
+        {
+            ok = m->leftBearing <= o->leftBearing() && m->rightBearing <= o->rightBearing();
+        }
+    }
+    delete after;
+    return ok && journal->undo() && font->height() == original->height() && font->contentHash() == original->contentHash();
+}
+
+
+/** Plan the trimming of a padded font. Items are glyphs. Variants are the padded analysis fonts and the
+ *  height mode, with the ink moved up.
+ */
+static void BM_OptimisePlan(benchmark::State &state)
+{
+    NeoFont *original = new NeoFont;
+    NeoFont *font = new NeoFont;
+    benchPaddedFont(original, (int)state.range(0));
+    benchPaddedFont(font, (int)state.range(0));
+    NeoUndoJournal *journal = new NeoUndoJournal(font);
+    NeoFontOptimizer *optimizer = new NeoFontOptimizer;
+    optimizer->setBearings(0, 1);
+    optimizer->setHeightMode((int)state.range(1));
+    optimizer->setRaise(true);
+    optimizer->apply(font, journal);
+    if (!benchOptimiseValid(original, font, journal, optimizer)) state.SkipWithError("optimised font not correct");
+    for (auto _ : state)
+    {
+        optimizer->plan(font);
+        benchmark::DoNotOptimize(optimizer->savedBytes());
+    }
+    state.SetItemsProcessed(state.iterations() * kNeoFontCharacterCount);
+    state.counters["saved"] = optimizer->savedBytes();
+    state.counters["strips"] = optimizer->stripsBefore() - optimizer->stripsAfter();
+    state.counters["columns"] = optimizer->columnsRemoved();
+    delete optimizer;
+    delete journal;
+    delete font;
+    delete original;
+}
+BENCHMARK(BM_OptimisePlan)->ArgsProduct({ benchmark::CreateDenseRange(0, (2 * kBenchFontCount) - 1, 1),
+                                          { kNeoTrimHeightTight, kNeoTrimHeightStrip } });
@@ -0,0 +1,208 @@
+/** @file       BenchArchive.cc
+ *  @brief      Benchmarks for font archives and for the memory used by fonts.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "BenchFonts.h"
+#include "NeoFontPack.h"
+
+
+/** Save a font archive.
+ */
+static void BM_SaveArchive(benchmark::State &state)
+{
+    NeoFont *font = new NeoFont;
+    benchFont(font, state.range(0));
+    std::vector<uint8_t> archive(font->archiveSize());
+    for (auto _ : state)
+    {
+        font->saveArchive(&archive[0]);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * archive.size());
+    state.counters["archive_bytes"] = archive.size();
+    state.counters["legacy_bytes"] = kBenchLegacyFontBytes;
+    delete font;
+}
+BENCHMARK(BM_SaveArchive)->DenseRange(0, kBenchFontCount - 1);
+
+
+/** Load a font archive.
+ */
+static void BM_LoadArchive(benchmark::State &state)
+{
+    NeoFont *font = new NeoFont;
+    benchFont(font, state.range(0));
+    std::vector<uint8_t> archive(font->archiveSize());
+    font->saveArchive(&archive[0]);
+    for (auto _ : state)
+    {
+        if (!font->loadArchive(&archive[0], archive.size())) state.SkipWithError("archive did not load");
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * archive.size());
+    delete font;
+}
+BENCHMARK(BM_LoadArchive)->DenseRange(0, kBenchFontCount - 1);
+
+
+/** Memory used by a resident font. The "fixed_bytes" counter is the size of the original fixed
+ *  128x66 pixel layout, "storage_bytes" is the size of the current layout.
+ *  The timed part is constructing and filling the font.
+ */
+static void BM_FontMemory(benchmark::State &state)
+{
+    unsigned int storage = 0;
+    unsigned int fixed = kBenchLegacyFontBytes;
+    for (auto _ : state)
+    {
+        NeoFont *font = new NeoFont;
+        benchFont(font, state.range(0));
+        storage = font->storageSize();
+        delete font;
+    }
+    state.counters["storage_bytes"] = storage;
+    state.counters["fixed_bytes"] = fixed;
+    state.counters["ratio"] = (double) fixed / storage;
+}
+BENCHMARK(BM_FontMemory)->DenseRange(0, kBenchFontCount - 1);
+
+
+#define kBenchPackFonts     (256)       /**< Number of fonts in the benchmark catalogue. */
+
+
+/** Make one font of a catalogue: a preset font with a few glyphs redrawn, and its own name and ID, as
+ *  the derived fonts in a real catalogue would be.
+ *
+ *  @param  font    The font to fill.
+ *  @param  n       The font number.
+ */
+static void benchCatalogueFont(NeoFont *font, int n)
+{
+    char name[16];
+    uint32_t seed = 1000 + n;
+    font->initWithPreset(n % kNeoFontPresetCount);
+    for (int i = 0; i < 8; i++)
+    {
+        NeoCharacter *c = font->character(128 + (benchRandom(&seed) % 128));
+        for (int k = 0; k < 16; k++) c->flipPixel(benchRandom(&seed) % c->width(), benchRandom(&seed) % c->height());
+    }
+    snprintf(name, sizeof name, "Font %03d", (n * 7) % kBenchPackFonts);
+    font->setFontName(name);
+    font->setIdent(0x4000 + ((n * 13) % kBenchPackFonts));
+}
+
+
+/** Build and save a pack holding the benchmark catalogue.
+ *
+ *  @param  pack        Receives the pack.
+ *  @param  fonts       The catalogue fonts.
+ */
+static void benchCataloguePack(std::vector<uint8_t> *pack, NeoFont **fonts)
+{
+    NeoFontPackWriter *writer = new NeoFontPackWriter;
+    for (int n = 0; n < kBenchPackFonts; n++) writer->add(fonts[n]);
+    pack->resize(writer->size());
+    writer->save(&(*pack)[0], pack->size());
+    delete writer;
+}
+
+
+/** Check that every font in a pack can be found by name, ID and content hash, and loads to the same font
+ *  that was added.
+ *
+ *  @param  pack    The pack.
+ *  @return         Logical true if every font matches.
+ */
+static bool benchPackValid(const NeoFontPack *pack)
+{
+    NeoFont *expected = new NeoFont;
+    NeoFont *loaded = new NeoFont;
+    bool ok = pack->isValid() && kBenchPackFonts == pack->count();
+    for (int n = 0; ok && n < kBenchPackFonts; n++)
+    {
+        benchCatalogueFont(expected, n);
+        std::vector<uint8_t> a(expected->archiveSize());
+        expected->saveArchive(&a[0]);
+        ok = pack->findName(expected->fontName()) == n &&
+            pack->findIdent(expected->ident()) == n &&
+            pack->findHash(expected->contentHash()) == n &&
+            pack->load(n, loaded) && loaded->archiveSize() == a.size();
+        if (ok)
+        {
+            std::vector<uint8_t> b(loaded->archiveSize());
+            loaded->saveArchive(&b[0]);
+            ok = 0 == memcmp(&a[0], &b[0], a.size());
+        }
+    }
+    ok = ok && kNeoFontPackNotFound == pack->findName("Missing") && kNeoFontPackNotFound == pack->findIdent(1);
+    delete loaded;
+    delete expected;
+    return ok;
+}
+
+
+/** Build and save a pack of the catalogue fonts. Items are fonts. The "pack_bytes" counter is the size of
+ *  the pack and "archive_bytes" is the total size of the individual font archives.
+ */
+static void BM_PackSave(benchmark::State &state)
+{
+    NeoFont *fonts[kBenchPackFonts];
+    unsigned int archives = 0;
+    for (int n = 0; n < kBenchPackFonts; n++)
+    {
+        fonts[n] = new NeoFont;
+        benchCatalogueFont(fonts[n], n);
+        archives += fonts[n]->archiveSize();
+    }
+
+    std::vector<uint8_t> pack;
+    for (auto _ : state)
+    {
+        benchCataloguePack(&pack, fonts);
+        benchmark::ClobberMemory();
+    }
+    NeoFontPack view(&pack[0], pack.size());
+    state.SetItemsProcessed(state.iterations() * kBenchPackFonts);
+    state.counters["pack_bytes"] = pack.size();
+    state.counters["archive_bytes"] = archives;
+    state.counters["glyphs"] = view.glyphCount();
+    for (int n = 0; n < kBenchPackFonts; n++) delete fonts[n];
+}
+BENCHMARK(BM_PackSave);
+
+
+/** Find a font in a pack by name and load it. Items are fonts. The pack is first checked against the fonts
+ *  that were added to it.
+ */
+static void BM_PackLoad(benchmark::State &state)
+{
+    NeoFont *fonts[kBenchPackFonts];
+    for (int n = 0; n < kBenchPackFonts; n++)
+    {
+        fonts[n] = new NeoFont;
+        benchCatalogueFont(fonts[n], n);
+    }
+    std::vector<uint8_t> pack;
+    benchCataloguePack(&pack, fonts);
+    for (int n = 0; n < kBenchPackFonts; n++) delete fonts[n];
+    NeoFontPack view(&pack[0], pack.size());
+    if (!benchPackValid(&view)) state.SkipWithError("pack does not match the fonts");
+
+    NeoFont *font = new NeoFont;
+    uint32_t seed = 777;
+    for (auto _ : state)
+    {
+        char name[16];
+        snprintf(name, sizeof name, "Font %03d", benchRandom(&seed) % kBenchPackFonts);
+        int index = view.findName(name);
+        benchmark::DoNotOptimize(view.load(index, font));
+    }
+    state.SetItemsProcessed(state.iterations());
+    delete font;
+}
+BENCHMARK(BM_PackLoad);
@@ -0,0 +1,440 @@
+/** @file       BenchChanges.cc
+ *  @brief      Benchmarks for change tracking with NeoFontSubscription.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+
+#include <string.h>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "BenchFonts.h"
+#include "NeoFontSubscription.h"
+#include "NeoGlyphAtlas.h"
+#include "NeoGlyphSelection.h"
+#include "NeoGlyphTable.h"
+#include "NeoTransformEngine.h"
+#include "NeoUndoJournal.h"
+
+
+#define kBenchStrokeCount       (1000)      /**< Number of strokes checked before timing. */
+#define kBenchStrokeLength      (16)        /**< Number of pixels visited by each stroke. */
+#define kBenchHashStrokes       (2000)      /**< Number of strokes checked before timing the glyph hashes. */
+#define kBenchBatchOperations   (9)         /**< Number of operations made by benchBatchStep(). */
+
+
+/** Drag across a character, setting or clearing each pixel visited, as the edit view does. The path is a
+ *  random walk from a random starting pixel.
+ *
+ *  @param  c       The character.
+ *  @param  seed    The random number generator state.
+ *  @param  box     Receives the bounding box of the pixels that changed. Empty if none did.
+ *  @return         The number of pixels that changed.
+ */
+static int benchStroke(NeoCharacter *c, uint32_t *seed, NeoCharacterRect *box)
+{
+    int x = benchRandom(seed) % c->width();
+    int y = benchRandom(seed) % c->height();
+    int v = benchRandom(seed) & 1;
+    int changes = 0;
+    NeoCharacterRect r = { 0, 0, 0, 0 };
+    for (int i = 0; i < kBenchStrokeLength; i++)
+    {
+        if (c->getPixel(x, y) != v)
+        {
+            if (0 == changes++)
+            {
+                r.x0 = x;
+                r.y0 = y;
+                r.x1 = x + 1;
+                r.y1 = y + 1;
+            }
+            if (x < r.x0) r.x0 = x;
+            if (y < r.y0) r.y0 = y;
+            if (x >= r.x1) r.x1 = x + 1;
+            if (y >= r.y1) r.y1 = y + 1;
+        }
+        c->changePixel(x, y, v);
+
+        uint32_t step = benchRandom(seed);
+        x += (int)(step % 3) - 1;
+        y += (int)((step / 3) % 3) - 1;
+        if (x < 0) x = 0;
+        if (x >= c->width()) x = c->width() - 1;
+        if (y < 0) y = 0;
+        if (y >= c->height()) y = c->height() - 1;
+    }
+    *box = r;
+    return changes;
+}
+
+
+/** Make a series of strokes on random characters, checking after each one that the subscription reports
+ *  exactly the stroked character (with the bounding box of its changed pixels), that no other character's
+ *  generation has moved, and that a glyph atlas redraws at most that one character.
+ *
+ *  @param  font    The font.
+ *  @return         Logical true if every stroke was reported correctly.
+ */
+static bool benchStrokesValid(NeoFont *font)
+{
+    NeoFontSubscription changes(font);
+    NeoGlyphAtlas atlas(font, 1);
+    atlas.update();
+    uint32_t generations[kNeoFontCharacterCount];
+    uint32_t seed = 97531;
+    for (int n = 0; n < kBenchStrokeCount; n++)
+    {
+        for (int i = 0; i < kNeoFontCharacterCount; i++) generations[i] = font->character(i)->generation();
+        uint32_t font_generation = font->generation();
+
+        int index = benchRandom(&seed) % kNeoFontCharacterCount;
+        NeoCharacterRect box;
+        int pixels = benchStroke(font->character(index), &seed, &box);
+
+        NeoCharacterRect r = changes.dirtyRect(index);
+        if (0 != changes.fields() || changes.characterCount() != ((0 == pixels) ? 0 : 1) ||
+            r.x0 != box.x0 || r.y0 != box.y0 || r.x1 != box.x1 || r.y1 != box.y1 ||
+            font->generation() != font_generation + pixels ||
+            atlas.update() != changes.characterCount())
+        {
+            return false;
+        }
+        for (int i = 0; i < kNeoFontCharacterCount; i++)
+        {
+            uint32_t expected = generations[i] + ((i == index) ? pixels : 0);
+            if (font->character(i)->generation() != expected) return false;
+        }
+        changes.clear();
+    }
+
+    // Fields are only reported when they really change
+    font->setFontName(font->fontName());
+    font->setHeight(font->height());
+    if (!changes.isEmpty()) return false;
+    font->setFontName("Changed");
+    if ((kNeoFontFieldFontName | kNeoFontFieldAppletName) != changes.fields() || 0 != changes.characterCount()) return false;
+    changes.clear();
+    font->setHeight(font->height() + 1);
+    return kNeoFontFieldHeight == changes.fields() && kNeoFontCharacterCount == changes.characterCount();
+}
+
+
+/** One stroke and the incremental update that follows it, with a number of subscriptions attached to the
+ *  font. Items are pixels visited. The change reports are first checked over a series of strokes.
+ */
+static void BM_DragStroke(benchmark::State &state)
+{
+    NeoFont *font = new NeoFont;
+    benchFont(font, 1);
+    if (!benchStrokesValid(font)) state.SkipWithError("changes not reported correctly");
+    benchFont(font, 1);
+
+    std::vector<NeoFontSubscription *> subscriptions;
+    for (int i = 0; i < state.range(0); i++) subscriptions.push_back(new NeoFontSubscription(font));
+
+    uint32_t seed = 8642;
+    NeoCharacter *c = font->character('A');
+    for (auto _ : state)
+    {
+        NeoCharacterRect box;
+        benchStroke(c, &seed, &box);
+        for (unsigned int i = 0; i < subscriptions.size(); i++)
+        {
+            benchmark::DoNotOptimize(subscriptions[i]->dirtyRect('A'));
+            subscriptions[i]->clear();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kBenchStrokeLength);
+
+    for (unsigned int i = 0; i < subscriptions.size(); i++) delete subscriptions[i];
+    delete font;
+}
+BENCHMARK(BM_DragStroke)->Arg(0)->Arg(1)->Arg(4);
+
+
+/** Hash a character from scratch, by copying its rows in to a new character.
+ *
+ *  @param  c       The character.
+ *  @return         The hash.
+ */
+static uint64_t benchFullHash(NeoCharacter *c)
+{
+    NeoCharacter copy;
+    copy.setHeight(c->height());
+    copy.setWidth(c->width());
+    for (int y = 0; y < c->height(); y++) copy.setRow(y, c->row(y));
+    return copy.hash();
+}
+
+
+/** Check the glyph hashes and a glyph table. After each of a series of strokes the incrementally updated
+ *  hash of the stroked character must match a hash calculated from scratch, and a glyph table must find
+ *  every character of the font as the same glyph it found before, or as a new one if it changed.
+ *
+ *  @param  font    The font.
+ *  @return         Logical true if the hashes and the table behaved correctly.
+ */
+static bool benchHashValid(NeoFont *font)
+{
+    NeoGlyphTable table;
+    int glyphs[kNeoFontCharacterCount];
+    for (int i = 0; i < kNeoFontCharacterCount; i++) glyphs[i] = table.intern(font->character(i));
+    for (int i = 0; i < kNeoFontCharacterCount; i++)
+    {
+        if (table.intern(font->character(i)) != glyphs[i]) return false;
+        if (font->character(i)->hash() != benchFullHash(font->character(i))) return false;
+    }
+
+    uint32_t seed = 24680;
+    uint64_t content = font->contentHash();
+    for (int n = 0; n < kBenchHashStrokes; n++)
+    {
+        int index = benchRandom(&seed) % kNeoFontCharacterCount;
+        NeoCharacter *c = font->character(index);
+        NeoCharacterRect box;
+        int pixels = benchStroke(c, &seed, &box);
+        if (c->hash() != benchFullHash(c)) return false;
+        if ((0 != pixels) == (font->contentHash() == content)) return false;
+        content = font->contentHash();
+
+        int glyph = table.find(c);
+        if (kNeoGlyphTableNotFound == glyph) glyph = table.intern(c);
+        const NeoCharacter *g = table.glyph(glyph);
+        if (g->hash() != c->hash() || g->width() != c->width() || g->height() != c->height()) return false;
+        for (int y = 0; y < c->height(); y++)
+        {
+            if (0 != memcmp(g->row(y), c->row(y), c->rowWords() * sizeof (uint64_t))) return false;
+        }
+    }
+    return true;
+}
+
+
+/** One stroke followed by reading the hash of the stroked character. Items are pixels visited. With an
+ *  argument of zero the hash is updated as each pixel changes; with an argument of one the character is
+ *  rewritten after the stroke so that the hash is calculated from scratch, for comparison. The hashes are
+ *  first checked over a series of strokes.
+ */
+static void BM_GlyphHashStroke(benchmark::State &state)
+{
+    NeoFont *font = new NeoFont;
+    benchFont(font, 2);
+    if (!benchHashValid(font)) state.SkipWithError("glyph hashes not correct");
+    benchFont(font, 2);
+
+    uint32_t seed = 13579;
+    NeoCharacter *c = font->character('W');
+    for (auto _ : state)
+    {
+        NeoCharacterRect box;
+        benchStroke(c, &seed, &box);
+        if (0 != state.range(0)) c->setRow(0, c->row(0));
+        benchmark::DoNotOptimize(c->hash());
+    }
+    state.SetItemsProcessed(state.iterations() * kBenchStrokeLength);
+    delete font;
+}
+BENCHMARK(BM_GlyphHashStroke)->Arg(0)->Arg(1);
+
+
+/** Intern every character of a font in an empty glyph table. Items are characters. The "distinct" counter
+ *  is the number of different glyphs in the font.
+ */
+static void BM_GlyphIntern(benchmark::State &state)
+{
+    NeoFont *font = new NeoFont;
+    benchFont(font, (int)state.range(0));
+    NeoGlyphTable table;
+    for (auto _ : state)
+    {
+        table.clear();
+        for (int i = 0; i < kNeoFontCharacterCount; i++) benchmark::DoNotOptimize(table.intern(font->character(i)));
+    }
+    state.SetItemsProcessed(state.iterations() * kNeoFontCharacterCount);
+    state.counters["distinct"] = table.count();
+    delete font;
+}
+BENCHMARK(BM_GlyphIntern)->DenseRange(0, kBenchFontCount - 1);
+
+
+/** Make one of the batch operations on the selected characters of a font, either through a NeoGlyphBatch or
+ *  (for comparison) one character at a time.
+ *
+ *  @param  font    The font.
+ *  @param  batch   The batch to use, or zero to change each character directly.
+ *  @param  s       The characters to change.
+ *  @param  source  The font to copy characters from.
+ *  @param  op      The operation (0 to kBenchBatchOperations - 1).
+ */
+static void benchBatchStep(NeoFont *font, NeoGlyphBatch *batch, const NeoGlyphSelection &s, const NeoFont *source, int op)
+{
+    NeoCharacterRect r = { 1, 2, 5, 7 };
+    if (0 != batch)
+    {
+        switch (op)
+        {
+            case 0: batch->translate(s, 1, -1); break;
+            case 1: batch->flipH(s); break;
+            case 2: batch->flipV(s); break;
+            case 3: batch->bold(s); break;
+            case 4: batch->setWidth(s, 7); break;
+            case 5: batch->adjustWidth(s, -2); break;
+            case 6: batch->setRegion(s, r); break;
+            case 7: batch->clearRegion(s, r); break;
+            default: batch->copyFrom(s, source); break;
+        }
+        return;
+    }
+    for (int i = s.next(0); i >= 0; i = s.next(i + 1))
+    {
+        NeoCharacter *c = font->character(i);
+        switch (op)
+        {
+            case 0: c->transformTranslate(1, -1); break;
+            case 1: c->transformFlipH(); break;
+            case 2: c->transformFlipV(); break;
+            case 3: c->transformBold(); break;
+            case 4: c->setWidth(7); break;
+            case 5: c->setWidth(c->width() - 2); break;
+            case 6:
+            case 7:
+                for (int y = r.y0; y < r.y1 && y < c->height(); y++)
+                {
+                    for (int x = r.x0; x < r.x1 && x < c->width(); x++) c->changePixel(x, y, (6 == op) ? 1 : 0);
+                }
+                break;
+            default:
+                *c = *source->character(i);
+                c->setHeight(font->height());
+                break;
+        }
+    }
+}
+
+
+/** Check the selection predicates and the batch operations. Each operation must leave the font as changing
+ *  the selected characters one at a time does, add exactly one undo record, advance the font generation
+ *  once, and report only selected characters to a subscription. Undoing every operation must then restore
+ *  the original font, and redoing them the final one. Bold must also give the same font as the transform
+ *  engine's kNeoTransformBold, including for characters already at the maximum width.
+ *
+ *  @return         Logical true if the selections and operations behaved correctly.
+ */
+static bool benchBatchValid()
+{
+    NeoFont *font = new NeoFont;
+    NeoFont *expected = new NeoFont;
+    NeoFont *source = new NeoFont;
+    benchFont(font, 1);
+    benchFont(expected, 1);
+    benchFont(source, 2);
+    bool valid = true;
+
+    NeoGlyphSelection widths;
+    NeoGlyphSelection blanks;
+    widths.addWidth(font, 5);
+    font->character('a')->clear();
+    expected->character('a')->clear();
+    blanks.addBlank(font);
+    for (int i = 0; i < kNeoFontCharacterCount; i++)
+    {
+        const NeoCharacter *c = font->character(i);
+        if (widths.contains(i) != (5 == c->width())) valid = false;
+        bool blank = true;
+        for (int y = 0; y < c->height(); y++)
+        {
+            for (int x = 0; x < c->width(); x++)
+            {
+                if (c->getPixel(x, y)) blank = false;
+            }
+        }
+        if (blanks.contains(i) != blank) valid = false;
+    }
+    if (!blanks.contains('a')) valid = false;
+
+    NeoGlyphSelection s('A', 'Z');
+    s.addRange('0', '9');
+    s.unite(widths);
+    s.remove('Q');
+    if (s.contains('Q') || !s.contains('A') || s.next('Q') != 'R' || s.count() < 35) valid = false;
+    NeoGlyphSelection inverse = s;
+    inverse.invert();
+    inverse.intersect(s);
+    if (!inverse.isEmpty()) valid = false;
+
+    {
+        NeoUndoJournal journal(font);
+        NeoGlyphBatch batch(font, &journal);
+        NeoFontSubscription changes(font);
+        uint64_t original = font->contentHash();
+        for (int op = 0; valid && op < kBenchBatchOperations; op++)
+        {
+            uint32_t generation = font->generation();
+            int undos = journal.undoCount();
+            changes.clear();
+            benchBatchStep(font, &batch, s, source, op);
+            benchBatchStep(expected, 0, s, source, op);
+
+            if (font->contentHash() != expected->contentHash() || journal.undoCount() != undos + 1) valid = false;
+            if (font->generation() != generation + (changes.isEmpty() ? 0 : 1)) valid = false;
+            for (int i = changes.nextDirty(0); i >= 0; i = changes.nextDirty(i + 1))
+            {
+                if (!s.contains(i)) valid = false;
+            }
+        }
+        uint64_t final = font->contentHash();
+        while (journal.canUndo()) journal.undo();
+        if (font->contentHash() != original) valid = false;
+        while (journal.canRedo()) journal.redo();
+        if (font->contentHash() != final) valid = false;
+    }
+
+    benchFont(font, 3);
+    benchFont(expected, 3);
+    font->character('W')->setWidth(kNeoCharacterMaxWidth);
+    expected->character('W')->setWidth(kNeoCharacterMaxWidth);
+    NeoGlyphSelection all;
+    all.selectAll();
+    NeoGlyphBatch batch(font);
+    batch.bold(all);
+    NeoTransformEngine engine(2);
+    NeoTransform bold = { kNeoTransformBold, 0, 0 };
+    engine.transform(expected, all.words(), bold);
+    if (font->contentHash() != expected->contentHash() || kNeoCharacterMaxWidth != font->character('W')->width()) valid = false;
+
+    delete source;
+    delete expected;
+    delete font;
+    return valid;
+}
+
+
+/** Translate a selection of characters as one batched operation, with a number of subscriptions attached
+ *  to the font and an undo journal. Items are characters. The selections and batch operations are first
+ *  checked against the same changes made one character at a time.
+ */
+static void BM_BatchTranslate(benchmark::State &state)
+{
+    if (!benchBatchValid()) state.SkipWithError("batch operations not correct");
+    NeoFont *font = new NeoFont;
+    benchFont(font, 1);
+    NeoUndoJournal *journal = new NeoUndoJournal(font);
+    NeoGlyphBatch batch(font, journal);
+
+    std::vector<NeoFontSubscription *> subscriptions;
+    for (int i = 0; i < state.range(0); i++) subscriptions.push_back(new NeoFontSubscription(font));
+
+    NeoGlyphSelection s(' ', '~');
+    int dx = 1;
+    for (auto _ : state)
+    {
+        batch.translate(s, dx, 0);
+        dx = -dx;
+        for (unsigned int i = 0; i < subscriptions.size(); i++) subscriptions[i]->clear();
+    }
+    state.SetItemsProcessed(state.iterations() * s.count());
+
+    for (unsigned int i = 0; i < subscriptions.size(); i++) delete subscriptions[i];
+    delete journal;
+    delete font;
+}
+BENCHMARK(BM_BatchTranslate)->Arg(0)->Arg(1)->Arg(4);
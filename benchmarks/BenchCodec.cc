@@ -0,0 +1,361 @@
+/** @file       BenchCodec.cc
+ *  @brief      Benchmarks for smart applet encoding and decoding.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "BenchFonts.h"
+#include "NeoAppletEncoder.h"
+#include "NeoAppletCorpus.h"
+#include "NeoAppletView.h"
+
+
+/** Encode a complete applet. Items are glyphs, bytes are applet bytes.
+ */
+static void BM_EncodeApplet(benchmark::State &state)
+{
+    NeoFont *font = new NeoFont;
+    benchFont(font, state.range(0));
+    std::vector<uint8_t> applet(font->appletSize());
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(font->encodeApplet(&applet[0], applet.size()));
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * kNeoFontCharacterCount);
+    state.SetBytesProcessed(state.iterations() * applet.size());
+    delete font;
+}
+BENCHMARK(BM_EncodeApplet)->DenseRange(0, kBenchFontCount - 1);
+
+
+/** Decode a complete applet. The applet is first checked to survive an encode -> decode -> encode
+ *  round trip unchanged.
+ */
+static void BM_DecodeApplet(benchmark::State &state)
+{
+    NeoFont *font = new NeoFont;
+    NeoFont *decoded = new NeoFont;
+    benchFont(font, state.range(0));
+    std::vector<uint8_t> applet(font->appletSize());
+    std::vector<uint8_t> again(font->appletSize());
+    unsigned int length = font->encodeApplet(&applet[0], applet.size());
+
+    if (!decoded->decodeApplet(&applet[0], length) ||
+        decoded->encodeApplet(&again[0], again.size()) != length ||
+        0 != memcmp(&applet[0], &again[0], length))
+    {
+        state.SkipWithError("applet round trip failed");
+    }
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(decoded->decodeApplet(&applet[0], length));
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * kNeoFontCharacterCount);
+    state.SetBytesProcessed(state.iterations() * length);
+    delete decoded;
+    delete font;
+}
+BENCHMARK(BM_DecodeApplet)->DenseRange(0, kBenchFontCount - 1);
+
+
+/** Check a complete applet without decoding it, as NeoFont::decodeApplet() does first. Compare with
+ *  BM_DecodeApplet to see the share of the decode time taken by the checks. A damaged copy of the applet
+ *  must first be rejected with the expected error.
+ */
+static void BM_AppletCheck(benchmark::State &state)
+{
+    NeoFont *font = new NeoFont;
+    benchFont(font, state.range(0));
+    std::vector<uint8_t> applet(font->appletSize());
+    unsigned int length = font->encodeApplet(&applet[0], applet.size());
+
+    NeoAppletView view;
+    std::vector<uint8_t> damaged(applet.begin(), applet.begin() + length - 1);
+    int error;
+    if (font->decodeApplet(&damaged[0], damaged.size(), &error) || kNeoAppletErrorFileSize != error ||
+        !view.attach(&applet[0], length) || kNeoAppletOK != view.error())
+    {
+        state.SkipWithError("applet checks not correct");
+    }
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(view.attach(&applet[0], length));
+    }
+    state.SetItemsProcessed(state.iterations() * kNeoFontCharacterCount);
+    state.SetBytesProcessed(state.iterations() * length);
+    delete font;
+}
+BENCHMARK(BM_AppletCheck)->DenseRange(0, kBenchFontCount - 1);
+
+
+/** Calculate the applet size.
+ */
+static void BM_AppletSize(benchmark::State &state)
+{
+    NeoFont *font = new NeoFont;
+    benchFont(font, state.range(0));
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(font->appletSize());
+    }
+    delete font;
+}
+BENCHMARK(BM_AppletSize)->DenseRange(0, kBenchFontCount - 1);
+
+
+/** Check the cached metrics of a font against values calculated from the characters.
+ *
+ *  @param  font        The font.
+ *  @return             Logical true if every metric matches.
+ */
+static bool benchMetricsValid(NeoFont *font)
+{
+    unsigned int count[kNeoCharacterMaxWidth + 1] = { 0 };
+    unsigned int total = 0;
+    int widest = 0;
+    for (int i = 0; i < kNeoFontCharacterCount; i++)
+    {
+        int w = font->character(i)->width();
+        count[w]++;
+        total += w;
+        if (w > widest) widest = w;
+    }
+    for (int w = 0; w <= kNeoCharacterMaxWidth; w++)
+    {
+        if (count[w] != font->widthCount(w)) return false;
+    }
+
+    unsigned int column = (font->height() + 7) / 8;
+    std::vector<uint8_t> applet(font->appletSize());
+    return font->maxWidth() == widest &&
+        font->bitmapSize() == total * column &&
+        font->maxBitmapSize() == widest * column &&
+        font->encodeApplet(&applet[0], applet.size()) == applet.size();
+}
+
+
+/** Random edits, each followed by a size query. The cached metrics are checked against a full recalculation
+ *  after every edit before timing starts.
+ */
+static void BM_EditMetrics(benchmark::State &state)
+{
+    NeoFont *font = new NeoFont;
+    NeoCharacter spare;
+    benchFont(font, state.range(0));
+    uint32_t seed = 4242;
+    for (int i = 0; i < 2000; i++)
+    {
+        NeoCharacter *c = font->character(benchRandom(&seed) % kNeoFontCharacterCount);
+        uint32_t r = benchRandom(&seed) % 100;
+        if (r < 70) c->setWidth(benchRandom(&seed) % (kNeoCharacterMaxWidth + 8));
+        else if (r < 80) c->transformBold();
+        else if (r < 90) *c = spare;
+        else if (r < 95) font->setHeight(1 + (benchRandom(&seed) % kNeoCharacterMaxHeight));
+        else font->setFontName((benchRandom(&seed) & 1) ? "A" : "A longer font name");
+        spare.setWidth(1 + (benchRandom(&seed) % kNeoCharacterMaxWidth));
+        if (!benchMetricsValid(font))
+        {
+            state.SkipWithError("cached metrics do not match the characters");
+            break;
+        }
+    }
+
+    for (auto _ : state)
+    {
+        NeoCharacter *c = font->character(benchRandom(&seed) % kNeoFontCharacterCount);
+        c->setWidth(1 + (benchRandom(&seed) % kNeoCharacterMaxWidth));
+        benchmark::DoNotOptimize(font->appletSize());
+        benchmark::DoNotOptimize(font->maxBitmapSize());
+    }
+    delete font;
+}
+BENCHMARK(BM_EditMetrics)->DenseRange(0, kBenchFontCount - 1);
+
+
+/** Make a series of random edits, checking after each one that an incremental encoder gives the same applet
+ *  as a full encode, and that pixel edits re-encode only the characters that changed.
+ *
+ *  @param  font        The font.
+ *  @return             Logical true if every update matched.
+ */
+static bool benchIncrementalValid(NeoFont *font)
+{
+    NeoAppletEncoder encoder(font);
+    std::vector<uint8_t> applet;
+    uint32_t seed = 24680;
+    encoder.update();
+    for (int n = 0; n < 500; n++)
+    {
+        NeoCharacter *c = font->character(benchRandom(&seed) % kNeoFontCharacterCount);
+        uint32_t r = benchRandom(&seed) % 100;
+        int expected = -1;
+        if (r < 50)
+        {
+            c->flipPixel(benchRandom(&seed) % c->width(), benchRandom(&seed) % c->height());
+            expected = 1;
+        }
+        else if (r < 80) c->setWidth(1 + (benchRandom(&seed) % kNeoCharacterMaxWidth));
+        else if (r < 85) c->transformBold();
+        else if (r < 88) font->setHeight(1 + (benchRandom(&seed) % kNeoCharacterMaxHeight));
+        else if (r < 91) font->setFontName((benchRandom(&seed) & 1) ? "A" : "A longer font name");
+        else if (r < 94) font->setAppletName((benchRandom(&seed) & 1) ? "B" : "A longer applet name");
+        else if (r < 97) font->setVersion((benchRandom(&seed) & 1) ? "1.2a" : "10.20");
+        else font->setIdent(benchRandom(&seed) & 0xffff);
+
+        int encoded;
+        unsigned int length = encoder.update(&encoded);
+        applet.resize(font->appletSize());
+        if (length != font->encodeApplet(&applet[0], applet.size()) ||
+            0 != memcmp(encoder.data(), &applet[0], length) ||
+            (expected >= 0 && encoded != expected))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/** Update an applet after editing a few characters. Each iteration changes one pixel in each of four random
+ *  characters and, if the second argument is set, also changes the width of one character. Items are
+ *  updates. The encoder is first checked against a full encode over a series of random edits.
+ */
+static void BM_EncodeIncremental(benchmark::State &state)
+{
+    NeoFont *font = new NeoFont;
+    benchFont(font, state.range(0));
+    if (!benchIncrementalValid(font)) state.SkipWithError("incremental applet does not match a full encode");
+    benchFont(font, state.range(0));
+
+    NeoAppletEncoder *encoder = new NeoAppletEncoder(font);
+    encoder->update();
+    uint32_t seed = 1357;
+    int grow = 1;
+    for (auto _ : state)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            NeoCharacter *c = font->character(benchRandom(&seed) % kNeoFontCharacterCount);
+            c->flipPixel(benchRandom(&seed) % c->width(), benchRandom(&seed) % c->height());
+        }
+        if (0 != state.range(1))
+        {
+            NeoCharacter *c = font->character('m');
+            c->setWidth(c->width() + grow);
+            grow = -grow;
+        }
+        benchmark::DoNotOptimize(encoder->update());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations());
+    delete encoder;
+    delete font;
+}
+BENCHMARK(BM_EncodeIncremental)->ArgsProduct({ benchmark::CreateDenseRange(0, kBenchFontCount - 1, 1), { 0, 1 } });
+
+
+#define kBenchCorpusCount       (1000)      /**< Number of applets in the corpus pack file. */
+
+
+/** Write a pack file of applets made from one font, each with its own ID and font name.
+ *
+ *  @param  font    The font.
+ *  @param  path    Receives the name of the file, which the caller must remove. At least 32 bytes.
+ *  @return         Logical true if the file was written.
+ */
+static bool benchWritePack(NeoFont *font, char *path)
+{
+    strcpy(path, "/tmp/neofont-corpus-XXXXXX");
+    int fd = mkstemp(path);
+    if (fd < 0) return false;
+    FILE *file = fdopen(fd, "wb");
+    std::vector<uint8_t> applet;
+    bool ok = true;
+    for (int i = 0; i < kBenchCorpusCount; i++)
+    {
+        char name[16];
+        snprintf(name, sizeof name, "Font %d", i);
+        font->setFontName(name);
+        font->setIdent(i);
+        applet.resize(font->appletSize());
+        unsigned int length = font->encodeApplet(&applet[0], applet.size());
+        ok = ok && length == fwrite(&applet[0], 1, length, file);
+    }
+    return 0 == fclose(file) && ok;
+}
+
+
+/** Check that a corpus holds the applets written by benchWritePack(), and that an applet loaded from the
+ *  corpus encodes to the same bytes.
+ *
+ *  @param  corpus  The corpus.
+ *  @param  font    The font.
+ *  @return         Logical true if the corpus is correct.
+ */
+static bool benchCorpusValid(NeoAppletCorpus *corpus, NeoFont *font)
+{
+    if (kBenchCorpusCount != corpus->count()) return false;
+    for (int i = 0; i < kBenchCorpusCount; i++)
+    {
+        char name[16];
+        snprintf(name, sizeof name, "Font %d", i);
+        const NeoAppletView *v = corpus->header(i);
+        if (0 == v || v->isComplete() || v->ident() != i || 0 != strcmp(v->fontName(), name)) return false;
+    }
+
+    NeoFont *decoded = new NeoFont;
+    std::vector<uint8_t> applet(font->appletSize());
+    unsigned int last = kBenchCorpusCount - 1;
+    bool ok = corpus->decode(last, decoded) && 0 != corpus->view(last) && corpus->view(last)->isComplete() &&
+        decoded->encodeApplet(&applet[0], applet.size()) == corpus->length(last) &&
+        0 == memcmp(&applet[0], corpus->view(last)->data(), corpus->length(last));
+    delete decoded;
+    return ok;
+}
+
+
+/** Map a pack file and list the ID and font name of every applet in it, reading only the applet headers.
+ *  Items are applets. The corpus is first checked against the fonts written to the pack.
+ */
+static void BM_CorpusList(benchmark::State &state)
+{
+    NeoFont *font = new NeoFont;
+    benchFont(font, state.range(0));
+    char path[32];
+    if (!benchWritePack(font, path))
+    {
+        state.SkipWithError("cannot write pack file");
+        delete font;
+        return;
+    }
+    NeoAppletCorpus *check = new NeoAppletCorpus;
+    if (!check->addFile(path) || !benchCorpusValid(check, font)) state.SkipWithError("corpus does not match the pack");
+    delete check;
+
+    for (auto _ : state)
+    {
+        NeoAppletCorpus corpus;
+        corpus.addFile(path);
+        unsigned int sum = 0;
+        for (unsigned int i = 0; i < corpus.count(); i++)
+        {
+            const NeoAppletView *v = corpus.header(i);
+            if (0 != v) sum += v->ident() + (uint8_t)v->fontName()[0];
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * kBenchCorpusCount);
+    unlink(path);
+    delete font;
+}
+BENCHMARK(BM_CorpusList)->DenseRange(0, kBenchFontCount - 1);
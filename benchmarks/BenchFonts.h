@@ -0,0 +1,78 @@
+/** @file       BenchFonts.h
+ *  @brief      Test fonts shared by the benchmarks.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+#ifndef _BENCHFONTS_H_
+#define _BENCHFONTS_H_  (1)
+
+#include <stdint.h>
+#include "NeoFont.h"
+#include "PresetFonts.h"
+
+
+/** Small deterministic random number generator (xorshift32), so that every run uses the same fonts.
+ *
+ *  @param  state   The generator state. Must not be zero.
+ *  @return         The next pseudo-random value.
+ */
+static inline uint32_t benchRandom(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+
+/** Fill a font with random glyphs.
+ *
+ *  @param  font        The font to fill.
+ *  @param  height      The font height, in pixels.
+ *  @param  maxWidth    The widest glyph to generate, in pixels.
+ *  @param  seed        Random seed (non-zero).
+ */
+static inline void benchRandomFont(NeoFont *font, int height, int maxWidth, uint32_t seed)
+{
+    font->setHeight(height);
+    for (int i = 0; i < kNeoFontCharacterCount; i++)
+    {
+        NeoCharacter *c = font->character(i);
+        c->setWidth(1 + (benchRandom(&seed) % maxWidth));
+        c->clear();
+        for (int y = 0; y < c->height(); y++)
+        {
+            for (int x = 0; x < c->width(); x++)
+            {
+                if (benchRandom(&seed) & 1) c->setPixel(x, y);
+            }
+        }
+    }
+}
+
+
+/** Load one of the standard benchmark fonts.
+ *
+ *  @param  font        The font to fill.
+ *  @param  n           0 for the 8x6 Model 100 preset, or 1-3 for random fonts of up to 16x12, 66x48 and 24x128
+ *                      pixels. The larger fonts are as big as the applet's 16 bit bitmap offsets allow.
+ */
+static inline void benchFont(NeoFont *font, int n)
+{
+    if (0 == n) font->initWithPreset(kNeoFontPresetModel100);
+    else if (1 == n) benchRandomFont(font, 16, 12, 12345);
+    else if (2 == n) benchRandomFont(font, kNeoCharacterMaxHeight, 48, 67890);
+    else benchRandomFont(font, 24, kNeoCharacterMaxWidth, 13579);
+}
+
+#define kBenchFontCount     (4)         /**< Number of fonts supported by benchFont(). */
+
+
+/* Sizes of the original fixed 128x66 pixel layout, which was also used for undo data.
+ */
+#define kBenchLegacyCharacterBytes  (1064)      /**< Bytes used by a character. */
+#define kBenchLegacyFontBytes       (272540)    /**< Bytes used by a font. */
+
+
+#endif  // _BENCHFONTS_H_
@@ -0,0 +1,100 @@
+/** @file       BenchFuzz.cc
+ *  @brief      Deterministic fuzzing of the parsers, for use where libFuzzer is not available.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+
+#include <stdint.h>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "BenchFonts.h"
+#include "FuzzTargets.h"
+#include "NeoAppletFormat.h"
+
+
+#define kBenchMutations         (8)         /**< Maximum number of mutations applied to each input. */
+
+
+/** Mutate a seed input: overwrite, flip, insert or delete bytes, or truncate it. When an applet changes
+ *  length, the file size in its header is usually updated so that the deeper checks are reached.
+ *
+ *  @param  input   The input to mutate.
+ *  @param  target  The fuzz target (kFuzzTargetDecodeApplet etc).
+ *  @param  seed    The random number generator state.
+ */
+static void benchMutate(std::vector<uint8_t> *input, int target, uint32_t *seed)
+{
+    std::vector<uint8_t> &data = *input;
+    int mutations = 1 + (benchRandom(seed) % kBenchMutations);
+    for (int n = 0; n < mutations; n++)
+    {
+        uint32_t r = benchRandom(seed);
+        unsigned int position = data.empty() ? 0 : (benchRandom(seed) % data.size());
+        switch (r % 6)
+        {
+            case 0:
+                if (!data.empty()) data[position] = (uint8_t)(r >> 8);
+                break;
+            case 1:
+                if (!data.empty()) data[position] ^= (uint8_t)(1 << ((r >> 8) & 7));
+                break;
+            case 2:
+                if (!data.empty()) data[position] = ((r >> 8) & 1) ? 0xff : 0;
+                break;
+            case 3:
+                data.insert(data.begin() + position, (uint8_t)(r >> 8));
+                break;
+            case 4:
+                if (!data.empty()) data.erase(data.begin() + position);
+                break;
+            default:
+                data.resize(position);
+                break;
+        }
+    }
+    if (kFuzzTargetDecodeApplet == target && data.size() >= 8 && (benchRandom(seed) & 3) != 0)
+    {
+        unsigned int length = data.size();
+        data[kAppletOffFileSize + 0] = (uint8_t)(length >> 24);
+        data[kAppletOffFileSize + 1] = (uint8_t)(length >> 16);
+        data[kAppletOffFileSize + 2] = (uint8_t)(length >> 8);
+        data[kAppletOffFileSize + 3] = (uint8_t)length;
+    }
+}
+
+
+/** Run mutated seed inputs through a fuzz target. Items are inputs. Every seed must first be accepted
+ *  unchanged, and no input may behave inconsistently. The "accepted" counter is the fraction of mutated
+ *  inputs that the parser accepted.
+ */
+static void BM_Fuzz(benchmark::State &state)
+{
+    int target = (int)state.range(0);
+    std::vector<std::vector<uint8_t> > seeds;
+    fuzzSeeds(target, &seeds);
+    for (unsigned int i = 0; i < seeds.size(); i++)
+    {
+        if (kFuzzAccepted != fuzzRun(target, &seeds[i][0], seeds[i].size())) state.SkipWithError("seed input not accepted");
+    }
+
+    uint32_t seed = 271828 + target;
+    uint64_t accepted = 0;
+    std::vector<uint8_t> input;
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        input = seeds[benchRandom(&seed) % seeds.size()];
+        benchMutate(&input, target, &seed);
+        state.ResumeTiming();
+
+        int result = fuzzRun(target, input.empty() ? 0 : &input[0], input.size());
+        if (kFuzzInconsistent == result)
+        {
+            state.SkipWithError("inconsistent result for a mutated input");
+            break;
+        }
+        if (kFuzzAccepted == result) accepted++;
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["accepted"] = (0 == state.iterations()) ? 0 : ((double)accepted / state.iterations());
+}
+BENCHMARK(BM_Fuzz)->DenseRange(0, kFuzzTargetCount - 1)->Iterations(20000);
@@ -0,0 +1,604 @@
+/** @file       BenchRaster.cc
+ *  @brief      Benchmarks for rendering text in to a frame buffer.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "BenchFonts.h"
+#include "NeoCharacterEncoding.h"
+#include "NeoFrameBuffer.h"
+#include "NeoGlyphAtlas.h"
+#include "NeoTextLayout.h"
+
+
+/** Text used for every benchmark: one screen width of printable characters.
+ */
+static const char bench_text[] = "The quick brown fox jumps over the lazy dog. 0123456789";
+
+
+/** Draw a line of text with word level blits.
+ */
+static void BM_DrawText(benchmark::State &state)
+{
+    NeoFont *font = new NeoFont;
+    benchFont(font, state.range(0));
+    NeoFrameBuffer screen;
+    unsigned int length = strlen(bench_text);
+    for (auto _ : state)
+    {
+        screen.clear();
+        benchmark::DoNotOptimize(screen.drawText(font, (const uint8_t *) bench_text, length, 0, 0));
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * length);
+    delete font;
+}
+BENCHMARK(BM_DrawText)->DenseRange(0, kBenchFontCount - 1);
+
+
+/** Draw the same line of text a pixel at a time, in the same way as the editor's renderCharacter method
+ *  (which issues one rectangle fill per set pixel). Used as the baseline for BM_DrawText.
+ */
+static void BM_DrawTextPerPixel(benchmark::State &state)
+{
+    NeoFont *font = new NeoFont;
+    benchFont(font, state.range(0));
+    std::vector<uint8_t> screen(kNeoScreenWidth * kNeoScreenHeight);
+    unsigned int length = strlen(bench_text);
+    for (auto _ : state)
+    {
+        memset(&screen[0], 0, screen.size());
+        int x = 0;
+        for (unsigned int i = 0; i < length; i++)
+        {
+            NeoCharacter *c = font->character((uint8_t) bench_text[i]);
+            for (int cx = 0; cx < c->width(); cx++)
+            {
+                for (int cy = 0; cy < c->height(); cy++)
+                {
+                    if (c->getPixel(cx, cy) && x + cx < kNeoScreenWidth && cy < kNeoScreenHeight)
+                    {
+                        screen[(cy * kNeoScreenWidth) + x + cx] = 1;
+                    }
+                }
+            }
+            x += c->width();
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * length);
+    delete font;
+}
+BENCHMARK(BM_DrawTextPerPixel)->DenseRange(0, kBenchFontCount - 1);
+
+
+/** Export a full screen as PBM and PNG.
+ */
+static void BM_ExportImage(benchmark::State &state)
+{
+    NeoFont *font = new NeoFont;
+    benchFont(font, 0);
+    NeoFrameBuffer screen;
+    screen.drawText(font, (const uint8_t *) bench_text, strlen(bench_text), 0, 0);
+    bool png = (0 != state.range(0));
+    std::vector<uint8_t> file(png ? screen.pngSize() : screen.pbmSize());
+    for (auto _ : state)
+    {
+        if (png) benchmark::DoNotOptimize(screen.encodePNG(&file[0], file.size()));
+        else benchmark::DoNotOptimize(screen.encodePBM(&file[0], file.size()));
+    }
+    state.SetBytesProcessed(state.iterations() * file.size());
+    delete font;
+}
+BENCHMARK(BM_ExportImage)->Arg(0)->Arg(1);
+
+
+#define kBenchDragScale         (2)     /**< Pixel scale used by the navigation and preview views. */
+#define kBenchDragNeighbours    (32)    /**< Characters drawn either side of the current one by the navigation view. */
+#define kBenchDragGlyphs        (1 + (2 * kBenchDragNeighbours))
+
+
+/** Change the next pixel of a drag across the current character, as the edit view does on each mouse event.
+ *
+ *  @param  c       The character being edited.
+ *  @param  step    The number of pixels changed so far.
+ */
+static void benchDragStep(NeoCharacter *c, unsigned int step)
+{
+    int x = step % c->width();
+    int y = (step / c->width()) % c->height();
+    c->flipPixel(x, y);
+}
+
+
+/** Check every character in an atlas against the character pixels.
+ *
+ *  @param  atlas   The atlas, which must be up to date.
+ *  @return         Logical true if every character matches.
+ */
+static bool benchAtlasValid(NeoGlyphAtlas *atlas)
+{
+    int s = atlas->scale();
+    for (int i = 0; i < kNeoFontCharacterCount; i++)
+    {
+        NeoCharacter *c = atlas->font()->character(i);
+        const uint8_t *cell = atlas->glyph(i);
+        for (int y = 0; y < atlas->cellHeight(); y++)
+        {
+            for (int x = 0; x < atlas->cellWidth(); x++)
+            {
+                int expected = c->getPixel(x / s, y / s) ? 255 : 0;
+                if (cell[(y * atlas->width()) + x] != expected) return false;
+            }
+        }
+    }
+    return true;
+}
+
+
+/** Redraw the navigation view after each pixel of a drag by rebuilding every visible character from its
+ *  pixels, as the views did before the glyph atlas (one scaled rectangle per set pixel). The view background
+ *  is the same for both methods and is not drawn.
+ *  Used as the baseline for BM_DragRedrawAtlas.
+ */
+static void BM_DragRedrawDirect(benchmark::State &state)
+{
+    NeoFont *font = new NeoFont;
+    benchFont(font, state.range(0));
+    int stride = kBenchDragGlyphs * kNeoCharacterMaxWidth * kBenchDragScale;
+    std::vector<uint8_t> view(stride * kNeoCharacterMaxHeight * kBenchDragScale);
+    NeoCharacter *current = font->character('A');
+    unsigned int step = 0;
+    for (auto _ : state)
+    {
+        benchDragStep(current, step++);
+        int left = 0;
+        for (int i = -kBenchDragNeighbours; i <= kBenchDragNeighbours; i++)
+        {
+            NeoCharacter *c = font->character('A' + i);
+            for (int cx = 0; cx < c->width(); cx++)
+            {
+                for (int cy = 0; cy < c->height(); cy++)
+                {
+                    if (c->getPixel(cx, cy))
+                    {
+                        uint8_t *p = &view[(cy * kBenchDragScale * stride) + left + (cx * kBenchDragScale)];
+                        for (int r = 0; r < kBenchDragScale; r++) memset(&p[r * stride], 255, kBenchDragScale);
+                    }
+                }
+            }
+            left += c->width() * kBenchDragScale;
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * kBenchDragGlyphs);
+    delete font;
+}
+BENCHMARK(BM_DragRedrawDirect)->DenseRange(0, kBenchFontCount - 1);
+
+
+/** Redraw the navigation view after each pixel of a drag by updating a glyph atlas (which redraws only the
+ *  edited character) and copying the visible characters from it. The atlas is first checked against the
+ *  character pixels after a series of random edits.
+ */
+static void BM_DragRedrawAtlas(benchmark::State &state)
+{
+    NeoFont *font = new NeoFont;
+    benchFont(font, state.range(0));
+    NeoGlyphAtlas *atlas = new NeoGlyphAtlas(font, kBenchDragScale);
+
+    uint32_t seed = 2468;
+    for (int i = 0; i < 200; i++)
+    {
+        NeoCharacter *c = font->character(benchRandom(&seed) % kNeoFontCharacterCount);
+        uint32_t r = benchRandom(&seed) % 100;
+        if (r < 60) c->flipPixel(benchRandom(&seed) % c->width(), benchRandom(&seed) % c->height());
+        else if (r < 80) c->setWidth(1 + (benchRandom(&seed) % kNeoCharacterMaxWidth));
+        else if (r < 90) c->transformTranslate(1, 1);
+        else font->setHeight(1 + (benchRandom(&seed) % kNeoCharacterMaxHeight));
+        atlas->update();
+        if ((i % 10) == 0 && !benchAtlasValid(atlas))
+        {
+            state.SkipWithError("atlas does not match the characters");
+            break;
+        }
+    }
+    benchFont(font, state.range(0));
+    if (kNeoFontCharacterCount != atlas->update() || !benchAtlasValid(atlas))
+    {
+        state.SkipWithError("atlas does not match the characters");
+    }
+
+    int stride = kBenchDragGlyphs * kNeoCharacterMaxWidth * kBenchDragScale;
+    std::vector<uint8_t> view(stride * kNeoCharacterMaxHeight * kBenchDragScale);
+    NeoCharacter *current = font->character('A');
+    unsigned int step = 0;
+    for (auto _ : state)
+    {
+        benchDragStep(current, step++);
+        atlas->update();
+        int left = 0;
+        for (int i = -kBenchDragNeighbours; i <= kBenchDragNeighbours; i++)
+        {
+            const uint8_t *cell = atlas->glyph('A' + i);
+            int w = font->character('A' + i)->width() * kBenchDragScale;
+            for (int y = 0; y < atlas->cellHeight(); y++)
+            {
+                memcpy(&view[(y * stride) + left], &cell[y * atlas->width()], w);
+            }
+            left += w;
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * kBenchDragGlyphs);
+    delete atlas;
+    delete font;
+}
+BENCHMARK(BM_DragRedrawAtlas)->DenseRange(0, kBenchFontCount - 1);
+
+
+#define kBenchUTF8Bytes         (1 << 20)   /**< Approximate size of the UTF-8 texts. */
+#define kBenchUTF8Fallback      ('?')       /**< Fallback character used by the transcoder benchmarks. */
+
+
+/** Append a character to a UTF-8 text.
+ *
+ *  @param  text    The text.
+ *  @param  u       The Unicode character.
+ */
+static void benchPutUTF8(std::vector<uint8_t> *text, uint32_t u)
+{
+    if (u < 0x80)
+    {
+        text->push_back((uint8_t)u);
+    }
+    else if (u < 0x800)
+    {
+        text->push_back((uint8_t)(0xc0 | (u >> 6)));
+        text->push_back((uint8_t)(0x80 | (u & 0x3f)));
+    }
+    else if (u < 0x10000)
+    {
+        text->push_back((uint8_t)(0xe0 | (u >> 12)));
+        text->push_back((uint8_t)(0x80 | ((u >> 6) & 0x3f)));
+        text->push_back((uint8_t)(0x80 | (u & 0x3f)));
+    }
+    else
+    {
+        text->push_back((uint8_t)(0xf0 | (u >> 18)));
+        text->push_back((uint8_t)(0x80 | ((u >> 12) & 0x3f)));
+        text->push_back((uint8_t)(0x80 | ((u >> 6) & 0x3f)));
+        text->push_back((uint8_t)(0x80 | (u & 0x3f)));
+    }
+}
+
+
+/** Make a UTF-8 text and the Neo characters it should convert to. Text 0 is English prose with line
+ *  breaks. Text 1 mixes prose with characters shown by every Neo glyph, characters with no Neo glyph (CJK
+ *  and emoji) and malformed UTF-8.
+ *
+ *  @param  kind        0 or 1.
+ *  @param  text        Receives the text.
+ *  @param  expected    Receives the Neo characters.
+ *  @return             The number of fallback characters in expected.
+ */
+static unsigned int benchUTF8Text(int kind, std::vector<uint8_t> *text, std::vector<uint8_t> *expected)
+{
+    uint32_t seed = 424242;
+    unsigned int fallbacks = 0;
+    text->clear();
+    expected->clear();
+    while (text->size() < kBenchUTF8Bytes)
+    {
+        uint32_t r = benchRandom(&seed);
+        if (0 == kind || (r % 8) < 5)
+        {
+            unsigned int start = r % (sizeof bench_text - 16);
+            for (unsigned int i = start; i < start + 16; i++)
+            {
+                text->push_back(bench_text[i]);
+                expected->push_back(bench_text[i]);
+            }
+            if (0 == (r & 0x1f00))
+            {
+                text->push_back('\n');
+                expected->push_back('\n');
+            }
+        }
+        else if ((r % 8) < 7)
+        {
+            int code = (r >> 8) & 255;
+            if (code < 0x20) code += 0x80;                 // Controls pass through, so use another glyph
+            int shown = NeoCharacterFromUnicode(NeoCharacterToUTF16(code));
+            benchPutUTF8(text, NeoCharacterToUTF16(code));
+            expected->push_back((uint8_t)shown);
+        }
+        else
+        {
+            switch ((r >> 8) % 4)
+            {
+                case 0: benchPutUTF8(text, 0x4e00 + ((r >> 16) & 0xff)); break;    // CJK
+                case 1: benchPutUTF8(text, 0x1f600 + ((r >> 16) & 0x3f)); break;  // Emoji
+                case 2: text->push_back(0x80 | ((r >> 16) & 0x3f)); break;         // Stray continuation byte
+                default:
+                    text->push_back(0xe2);                  // Truncated sequence, then a character
+                    text->push_back(0x82);
+                    text->push_back('x');
+                    expected->push_back(kBenchUTF8Fallback);
+                    fallbacks++;
+                    break;
+            }
+            if ('x' == text->back())
+            {
+                expected->push_back('x');
+            }
+            else
+            {
+                expected->push_back(kBenchUTF8Fallback);
+                fallbacks++;
+            }
+        }
+    }
+    return fallbacks;
+}
+
+
+/** Check the reverse index and the transcoder. Every Neo character must be found from the character it
+ *  shows (or from an equivalent character with a lower or equal code), and the texts must convert to the
+ *  expected characters whether converted whole or in randomly sized pieces.
+ *
+ *  @return         Logical true if the conversions are correct.
+ */
+static bool benchTranscodeValid()
+{
+    for (int code = 0; code < 256; code++)
+    {
+        int found = NeoCharacterFromUnicode(NeoCharacterToUTF16(code));
+        if (found < 0 || NeoCharacterToUTF16(found) != NeoCharacterToUTF16(code)) return false;
+    }
+    if (kNeoCharacterNotMapped != NeoCharacterFromUnicode(0x4e00) || kNeoCharacterNotMapped != NeoCharacterFromUnicode(0x1f600) ||
+        0xac != NeoCharacterFromUnicode(0xac) || 0x80 != NeoCharacterFromUnicode(0x20ac))
+    {
+        return false;
+    }
+
+    for (int kind = 0; kind < 2; kind++)
+    {
+        std::vector<uint8_t> text;
+        std::vector<uint8_t> expected;
+        unsigned int fallbacks = benchUTF8Text(kind, &text, &expected);
+        std::vector<uint8_t> out(text.size() + kNeoTranscodeSlack);
+
+        NeoUTF8Transcoder whole(kBenchUTF8Fallback);
+        unsigned int n = whole.transcode(&text[0], text.size(), &out[0]);
+        n += whole.finish(&out[n]);
+        if (n != expected.size() || 0 != memcmp(&out[0], &expected[0], n) || whole.fallbackCount() != fallbacks) return false;
+
+        NeoUTF8Transcoder pieces(kBenchUTF8Fallback);
+        uint32_t seed = 1357;
+        unsigned int written = 0;
+        std::vector<uint8_t> chunk(64 + kNeoTranscodeSlack);
+        for (unsigned int i = 0; i < text.size(); )
+        {
+            unsigned int length = 1 + (benchRandom(&seed) % 64);
+            if (length > text.size() - i) length = text.size() - i;
+            unsigned int count = pieces.transcode(&text[i], length, &chunk[0]);
+            if (written + count > expected.size() || 0 != memcmp(&chunk[0], &expected[written], count)) return false;
+            written += count;
+            i += length;
+        }
+        written += pieces.finish(&chunk[0]);
+        if (written != expected.size()) return false;
+    }
+    return true;
+}
+
+
+/** Convert a large UTF-8 text to Neo characters. With an argument of zero the text is ASCII prose, which
+ *  takes the fast path; with an argument of one it is mixed with other characters and malformed input.
+ *  The conversions are first checked.
+ */
+static void BM_TranscodeUTF8(benchmark::State &state)
+{
+    if (!benchTranscodeValid()) state.SkipWithError("transcoded text not correct");
+    std::vector<uint8_t> text;
+    std::vector<uint8_t> expected;
+    benchUTF8Text((int)state.range(0), &text, &expected);
+    std::vector<uint8_t> out(text.size() + kNeoTranscodeSlack);
+
+    NeoUTF8Transcoder transcoder(kBenchUTF8Fallback);
+    for (auto _ : state)
+    {
+        unsigned int n = transcoder.transcode(&text[0], text.size(), &out[0]);
+        benchmark::DoNotOptimize(n + transcoder.finish(&out[n]));
+    }
+    state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_TranscodeUTF8)->Arg(0)->Arg(1);
+
+
+/** Build a text encoding table that moves the Greek capitals on to the ASCII capitals, and the binary
+ *  table for the same encoding.
+ *
+ *  @param  text    Receives the text table.
+ *  @param  binary  Receives the binary table.
+ *  @return         The encoding, to be deleted by the caller, or zero if the text table was rejected.
+ */
+static NeoEncoding *benchEncodingTables(std::vector<uint8_t> *text, std::vector<uint8_t> *binary)
+{
+    char line[64];
+    text->clear();
+    const char header[] = "# Greek capitals in place of the Latin capitals\r\nname greek\r\n";
+    text->insert(text->end(), header, header + strlen(header));
+    for (int code = 'A'; code <= 'Y'; code++)
+    {
+        int n = snprintf(line, sizeof line, "0x%02X\tU+%04X   # %c\n", code, 0x391 + (code - 'A'), code);
+        text->insert(text->end(), line, line + n);
+    }
+    NeoEncoding *encoding = NeoEncoding::load(&(*text)[0], text->size());
+    if (0 != encoding)
+    {
+        binary->resize(encoding->archiveSize());
+        encoding->saveArchive(&(*binary)[0]);
+    }
+    return encoding;
+}
+
+
+/** Check the built-in encodings, loading of text and binary tables, and conversion with an encoding that
+ *  does not map ASCII to itself.
+ */
+static bool benchEncodingValid()
+{
+    const NeoEncoding *neo = NeoEncoding::builtIn(kNeoEncodingNeo);
+    const NeoEncoding *controls = NeoEncoding::builtIn(kNeoEncodingControls);
+    if (neo != NeoEncoding::defaultEncoding() || 0 != NeoEncoding::builtIn(kNeoEncodingBuiltInCount) ||
+        0x2193 != neo->toUnicode(10) || 10 != controls->toUnicode(10) || 10 != controls->fromUnicode(10) ||
+        kNeoCharacterNotMapped != controls->fromUnicode(0x2193) || !neo->isASCII() || !controls->isASCII())
+    {
+        return false;
+    }
+
+    std::vector<uint8_t> text;
+    std::vector<uint8_t> binary;
+    NeoEncoding *greek = benchEncodingTables(&text, &binary);
+    if (0 == greek) return false;
+    NeoEncoding *again = NeoEncoding::load(&binary[0], binary.size());
+    bool valid = (0 != again) && 0 == strcmp(greek->name(), "greek") && 0 == strcmp(again->name(), "greek") && !greek->isASCII();
+    for (int code = 0; valid && code < 256; code++)
+    {
+        uint16_t u = greek->toUnicode(code);
+        valid = (u == again->toUnicode(code)) && (greek->fromUnicode(u) == again->fromUnicode(u)) &&
+                (greek->toUnicode(greek->fromUnicode(u)) == u) &&
+                (u == ((code >= 'A' && code <= 'Y') ? (0x391 + (code - 'A')) : neo->toUnicode(code)));
+    }
+    delete again;
+
+    // Truncated or corrupt tables are rejected (an empty text table is valid)
+    for (unsigned int n = 1; valid && n < binary.size(); n++)
+    {
+        again = NeoEncoding::load(&binary[0], n);
+        valid = (0 == again);
+        delete again;
+    }
+    const char *bad[] = { "0x100 0x41\n", "0x41\n", "0x41 0x10000\n", "0x41 0x42 0x43\n", "0x4g 0x41\n" };
+    for (unsigned int i = 0; valid && i < sizeof bad / sizeof bad[0]; i++)
+    {
+        again = NeoEncoding::load((const uint8_t *)bad[i], strlen(bad[i]));
+        valid = (0 == again);
+        delete again;
+    }
+
+    // Conversion without the ASCII fast path: Latin capitals are not mapped, Greek capitals are (omega is
+    // also shown by code 29, which wins as the lower code)
+    const char sample[] = "ABC \xce\x91\xce\x92\xce\xa9 xyz";
+    const uint8_t expected[] = { '?', '?', '?', ' ', 'A', 'B', 29, ' ', 'x', 'y', 'z' };
+    uint8_t out[sizeof sample + kNeoTranscodeSlack];
+    NeoUTF8Transcoder transcoder(kBenchUTF8Fallback, true, greek);
+    unsigned int n = transcoder.transcode((const uint8_t *)sample, strlen(sample), out);
+    n += transcoder.finish(&out[n]);
+    valid = valid && (n == sizeof expected) && 0 == memcmp(out, expected, n) && 3 == transcoder.fallbackCount();
+    delete greek;
+    return valid;
+}
+
+
+/** Load an encoding table: binary (0) or text (1). Items are tables.
+ */
+static void BM_EncodingLoad(benchmark::State &state)
+{
+    if (!benchEncodingValid()) state.SkipWithError("encoding tables not correct");
+    std::vector<uint8_t> text;
+    std::vector<uint8_t> binary;
+    delete benchEncodingTables(&text, &binary);
+    const std::vector<uint8_t> &table = (0 == state.range(0)) ? binary : text;
+    for (auto _ : state)
+    {
+        NeoEncoding *encoding = NeoEncoding::load(&table[0], table.size());
+        benchmark::DoNotOptimize(encoding);
+        delete encoding;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EncodingLoad)->Arg(0)->Arg(1);
+
+
+
+#define kBenchLayoutLength      (1 << 20)   /**< Characters of text laid out by BM_Layout. */
+
+
+/** Check line wrapping, blank lines, words wider than a line and pagination against a known layout.
+ */
+static bool benchLayoutValid()
+{
+    static const char text[] = "ab  cd\n\nefghijklmn";
+    static const unsigned int expected[][3] = { { 0, 2, 12 }, { 4, 2, 12 }, { 7, 0, 0 }, { 8, 5, 30 }, { 13, 5, 30 } };
+    NeoFont *font = new NeoFont;
+    font->setHeight(6);
+    for (int i = 0; i < kNeoFontCharacterCount; i++) font->character(i)->setWidth(6);
+    NeoTextLayout layout;
+    layout.layout(font, (const uint8_t *)text, strlen(text), 30, 12);
+    delete font;
+
+    bool valid = (5 == layout.lineCount()) && (3 == layout.pageCount()) && (7 == layout.pageStart(1)) &&
+                 (13 == layout.pageStart(2)) && (5 == layout.pageLength(2)) && (3 == layout.lineAt(9)) && (36 == layout.textWidth(0, 6));
+    for (unsigned int i = 0; valid && i < 5; i++)
+    {
+        const NeoTextLine *line = layout.line(i);
+        valid = (line->start == expected[i][0]) && (line->length == expected[i][1]) && (line->width == expected[i][2]);
+    }
+    return valid;
+}
+
+
+/** Build a text of words of 1 to 12 letters, with a paragraph break every 40 to 200 words.
+ *
+ *  @param  text    Receives the text.
+ */
+static void benchLayoutText(std::vector<uint8_t> *text)
+{
+    uint32_t seed = 4242;
+    int words = 0;
+    text->clear();
+    while (text->size() < kBenchLayoutLength)
+    {
+        int letters = 1 + (benchRandom(&seed) % 12);
+        for (int i = 0; i < letters; i++) text->push_back('a' + (benchRandom(&seed) % 26));
+        if (0 == words--)
+        {
+            text->push_back(kNeoTextNewline);
+            words = 40 + (benchRandom(&seed) % 160);
+        }
+        else
+        {
+            text->push_back(kNeoTextSpace);
+        }
+    }
+    text->resize(kBenchLayoutLength);
+}
+
+
+/** Lay out a long text on the Neo screen. Bytes are characters of text. The "screen" counter is the
+ *  average number of characters on each screen.
+ */
+static void BM_Layout(benchmark::State &state)
+{
+    if (!benchLayoutValid()) state.SkipWithError("layout not correct");
+    NeoFont *font = new NeoFont;
+    benchFont(font, (int)state.range(0));
+    std::vector<uint8_t> text;
+    benchLayoutText(&text);
+    NeoTextLayout layout;
+    for (auto _ : state)
+    {
+        layout.layout(font, &text[0], text.size());
+        benchmark::DoNotOptimize(layout.lineCount());
+    }
+    state.SetBytesProcessed(state.iterations() * text.size());
+    state.counters["screen"] = layout.charactersPerPage();
+    delete font;
+}
+BENCHMARK(BM_Layout)->DenseRange(0, kBenchFontCount - 1)->Unit(benchmark::kMillisecond);
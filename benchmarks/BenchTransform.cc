@@ -0,0 +1,341 @@
+/** @file       BenchTransform.cc
+ *  @brief      Benchmarks for the character transforms, applied to all glyphs as the editor's "(all)" operations do.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+
+#include <string.h>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "BenchFonts.h"
+#include "NeoTransformEngine.h"
+
+
+#define kBenchCatalogueFonts    (32)        /**< Number of fonts transformed by BM_EngineCatalogue. */
+#define kBenchWideGlyphs        (16)        /**< Glyphs given the maximum width by benchKernelValid(). */
+
+
+/** Apply a transform to a character a pixel at a time, as the original code did before the row kernels.
+ *  Used as the reference for benchKernelValid().
+ *
+ *  @param  c       The character.
+ *  @param  t       The transform (kNeoTransformTranslate, kNeoTransformFlipH, kNeoTransformFlipV or
+ *                  kNeoTransformBold).
+ */
+static void benchBaselineTransform(NeoCharacter *c, const NeoTransform &t)
+{
+    int w = c->width();
+    int h = c->height();
+    if (kNeoTransformBold == t.type)
+    {
+        c->setWidth(w + 1);
+        w = c->width();
+        for (int y = 0; y < h; y++) c->clearPixel(w - 1, y);
+        for (int x = w - 2; x >= 0; x--)
+        {
+            for (int y = 0; y < h; y++)
+            {
+                if (c->getPixel(x, y)) c->setPixel(x + 1, y);
+            }
+        }
+        return;
+    }
+
+    int dx = t.x;
+    int dy = t.y;
+    if (dx < 0) dx = w - ((-dx) % w);
+    if (dy < 0) dy = h - ((-dy) % h);
+
+    NeoCharacter temp(*c);
+    c->clear();
+    for (int x = 0; x < w; x++)
+    {
+        for (int y = 0; y < h; y++)
+        {
+            if (!temp.getPixel(x, y)) continue;
+            if (kNeoTransformTranslate == t.type) c->setPixel((x + dx) % w, (y + dy) % h);
+            else if (kNeoTransformFlipH == t.type) c->setPixel(w - x - 1, y);
+            else c->setPixel(x, h - y - 1);
+        }
+    }
+}
+
+
+/** Check that the row kernels give the same bitmaps as the per-pixel reference, bit for bit, for random
+ *  fonts of several heights. Some glyphs are given the maximum width, so that bold is checked where the
+ *  width is clamped and the right-hand column is lost.
+ *
+ *  @param  t       The transform.
+ *  @return         Logical true if every glyph matched.
+ */
+static bool benchKernelValid(const NeoTransform &t)
+{
+    static const int heights[] = { kNeoCharacterMinHeight, 7, 24, kNeoCharacterMaxHeight };
+
+    bool ok = true;
+    NeoFont *expected = new NeoFont;
+    NeoFont *actual = new NeoFont;
+    for (unsigned int n = 0; ok && n < sizeof heights / sizeof heights[0]; n++)
+    {
+        uint32_t seed = 24681 + n;
+        benchRandomFont(expected, heights[n], kNeoCharacterMaxWidth, seed);
+        benchRandomFont(actual, heights[n], kNeoCharacterMaxWidth, seed);
+        for (int i = 0; i < kBenchWideGlyphs; i++)
+        {
+            NeoCharacter *e = expected->character(i);
+            NeoCharacter *a = actual->character(i);
+            e->setWidth(kNeoCharacterMaxWidth);
+            a->setWidth(kNeoCharacterMaxWidth);
+            for (int y = 0; y < e->height(); y++)
+            {
+                for (int x = 0; x < e->width(); x++)
+                {
+                    if (benchRandom(&seed) & 1)
+                    {
+                        e->setPixel(x, y);
+                        a->setPixel(x, y);
+                    }
+                }
+            }
+        }
+
+        for (int i = 0; ok && i < kNeoFontCharacterCount; i++)
+        {
+            NeoCharacter *e = expected->character(i);
+            NeoCharacter *a = actual->character(i);
+            benchBaselineTransform(e, t);
+            NeoTransformEngine::transformKernel(a, i, (void *)&t);
+            ok = e->width() == a->width() && e->height() == a->height() && e->rowWords() == a->rowWords();
+            for (int y = 0; ok && y < e->height(); y++)
+            {
+                ok = 0 == memcmp(e->row(y), a->row(y), e->rowWords() * sizeof (uint64_t));
+            }
+        }
+    }
+    delete actual;
+    delete expected;
+    return ok;
+}
+
+
+/** Translate every glyph by (1, 1). The kernel is first checked against the per-pixel reference, for this
+ *  and for translations that wrap round more than once.
+ */
+static void BM_TransformTranslate(benchmark::State &state)
+{
+    NeoTransform t = { kNeoTransformTranslate, 1, 1 };
+    NeoTransform u = { kNeoTransformTranslate, -131, 70 };
+    NeoTransform v = { kNeoTransformTranslate, 200, -67 };
+    if (!benchKernelValid(t) || !benchKernelValid(u) || !benchKernelValid(v)) state.SkipWithError("translate does not match the reference");
+
+    NeoFont *font = new NeoFont;
+    benchFont(font, state.range(0));
+    for (auto _ : state)
+    {
+        for (int i = 0; i < kNeoFontCharacterCount; i++) font->character(i)->transformTranslate(1, 1);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * kNeoFontCharacterCount);
+    delete font;
+}
+BENCHMARK(BM_TransformTranslate)->DenseRange(0, kBenchFontCount - 1);
+
+
+/** Reflect every glyph horizontally. The kernel is first checked against the per-pixel reference.
+ */
+static void BM_TransformFlipH(benchmark::State &state)
+{
+    NeoTransform t = { kNeoTransformFlipH, 0, 0 };
+    if (!benchKernelValid(t)) state.SkipWithError("flipH does not match the reference");
+
+    NeoFont *font = new NeoFont;
+    benchFont(font, state.range(0));
+    for (auto _ : state)
+    {
+        for (int i = 0; i < kNeoFontCharacterCount; i++) font->character(i)->transformFlipH();
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * kNeoFontCharacterCount);
+    delete font;
+}
+BENCHMARK(BM_TransformFlipH)->DenseRange(0, kBenchFontCount - 1);
+
+
+/** Reflect every glyph vertically. The kernel is first checked against the per-pixel reference.
+ */
+static void BM_TransformFlipV(benchmark::State &state)
+{
+    NeoTransform t = { kNeoTransformFlipV, 0, 0 };
+    if (!benchKernelValid(t)) state.SkipWithError("flipV does not match the reference");
+
+    NeoFont *font = new NeoFont;
+    benchFont(font, state.range(0));
+    for (auto _ : state)
+    {
+        for (int i = 0; i < kNeoFontCharacterCount; i++) font->character(i)->transformFlipV();
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * kNeoFontCharacterCount);
+    delete font;
+}
+BENCHMARK(BM_TransformFlipV)->DenseRange(0, kBenchFontCount - 1);
+
+
+/** Embolden every glyph. The width is restored afterwards so that the glyphs do not grow without limit;
+ *  the time includes the setWidth() call. The kernel is first checked against the per-pixel reference.
+ */
+static void BM_TransformBold(benchmark::State &state)
+{
+    NeoTransform t = { kNeoTransformBold, 0, 0 };
+    if (!benchKernelValid(t)) state.SkipWithError("bold does not match the reference");
+
+    NeoFont *font = new NeoFont;
+    benchFont(font, state.range(0));
+    for (auto _ : state)
+    {
+        for (int i = 0; i < kNeoFontCharacterCount; i++)
+        {
+            NeoCharacter *c = font->character(i);
+            int width = c->width();
+            c->transformBold();
+            c->setWidth(width);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * kNeoFontCharacterCount);
+    delete font;
+}
+BENCHMARK(BM_TransformBold)->DenseRange(0, kBenchFontCount - 1);
+
+
+/** Test if two fonts have the same archive.
+ */
+static bool benchSameFont(const NeoFont *a, const NeoFont *b)
+{
+    std::vector<uint8_t> x(a->archiveSize());
+    std::vector<uint8_t> y(b->archiveSize());
+    a->saveArchive(&x[0]);
+    b->saveArchive(&y[0]);
+    return x == y;
+}
+
+
+/** Kernel that cancels the job when it reaches character 100, and otherwise flips the character.
+ *
+ *  @param  c       The character.
+ *  @param  index   The character number.
+ *  @param  context The engine.
+ */
+static void benchCancelKernel(NeoCharacter *c, int index, void *context)
+{
+    if (100 == index) ((NeoTransformEngine *)context)->cancel();
+    c->transformFlipH();
+}
+
+
+/** Check that the engine gives the same results as transforming the characters one by one, for every
+ *  built-in transform, for all characters and for a subset, and for a batch of fonts. A cancelled job must
+ *  leave the font unchanged.
+ *
+ *  @param  engine  The engine.
+ *  @return         Logical true if every result was correct.
+ */
+static bool benchEngineValid(NeoTransformEngine *engine)
+{
+    static const NeoTransform transforms[] =
+    {
+        { kNeoTransformTranslate, 3, -2 }, { kNeoTransformFlipH, 0, 0 }, { kNeoTransformFlipV, 0, 0 },
+        { kNeoTransformBold, 0, 0 }, { kNeoTransformSetWidth, 5, 0 }, { kNeoTransformWidthDelta, -1, 0 }
+    };
+    uint64_t odd[kNeoFontCharacterSetWords];
+    memset(odd, 0xaa, sizeof odd);
+
+    bool ok = true;
+    NeoFont *expected = new NeoFont;
+    NeoFont *actual = new NeoFont;
+    for (unsigned int n = 0; ok && n < sizeof transforms / sizeof transforms[0]; n++)
+    {
+        for (int subset = 0; ok && subset < 2; subset++)
+        {
+            benchFont(expected, 3);
+            benchFont(actual, 3);
+            for (int i = 0; i < kNeoFontCharacterCount; i++)
+            {
+                if (0 == subset || 1 == (i & 1)) NeoTransformEngine::transformKernel(expected->character(i), i, (void *)&transforms[n]);
+            }
+            ok = engine->transform(actual, subset ? odd : 0, transforms[n]) && benchSameFont(expected, actual);
+        }
+    }
+
+    benchFont(expected, 1);
+    benchFont(actual, 1);
+    ok = ok && !engine->apply(actual, 0, benchCancelKernel, engine) && benchSameFont(expected, actual);
+
+    NeoFont *fonts[8];
+    for (int f = 0; f < 8; f++)
+    {
+        fonts[f] = new NeoFont;
+        benchFont(fonts[f], f % kBenchFontCount);
+    }
+    bool done[8];
+    ok = ok && 8 == engine->applyFonts(fonts, 8, odd, NeoTransformEngine::transformKernel, (void *)&transforms[0], done);
+    for (int f = 0; f < 8; f++)
+    {
+        benchFont(expected, f % kBenchFontCount);
+        for (int i = 1; i < kNeoFontCharacterCount; i += 2) expected->character(i)->transformTranslate(3, -2);
+        ok = ok && done[f] && benchSameFont(expected, fonts[f]);
+        delete fonts[f];
+    }
+
+    delete actual;
+    delete expected;
+    return ok;
+}
+
+
+/** Translate every glyph of a font by (1, 1) with a transform engine. Items are glyphs. The first argument
+ *  is the font and the second the number of threads (one does everything on the calling thread). The
+ *  engine's results are first checked against the serial transforms.
+ */
+static void BM_EngineTranslate(benchmark::State &state)
+{
+    NeoTransformEngine *engine = new NeoTransformEngine((int)state.range(1));
+    if (!benchEngineValid(engine)) state.SkipWithError("engine results do not match");
+
+    NeoFont *font = new NeoFont;
+    benchFont(font, state.range(0));
+    NeoTransform t = { kNeoTransformTranslate, 1, 1 };
+    for (auto _ : state)
+    {
+        engine->transform(font, 0, t);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * kNeoFontCharacterCount);
+    delete font;
+    delete engine;
+}
+BENCHMARK(BM_EngineTranslate)->ArgsProduct({ { 1, 3 }, { 1, 2, 4 } })->UseRealTime();
+
+
+/** Translate every glyph of a catalogue of fonts by (1, 1), as a batch job. Items are glyphs. The argument
+ *  is the number of threads.
+ */
+static void BM_EngineCatalogue(benchmark::State &state)
+{
+    NeoTransformEngine *engine = new NeoTransformEngine((int)state.range(0));
+    NeoFont *fonts[kBenchCatalogueFonts];
+    for (int f = 0; f < kBenchCatalogueFonts; f++)
+    {
+        fonts[f] = new NeoFont;
+        benchFont(fonts[f], f % kBenchFontCount);
+    }
+    NeoTransform t = { kNeoTransformTranslate, 1, 1 };
+    for (auto _ : state)
+    {
+        engine->applyFonts(fonts, kBenchCatalogueFonts, 0, NeoTransformEngine::transformKernel, &t);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * kBenchCatalogueFonts * kNeoFontCharacterCount);
+    for (int f = 0; f < kBenchCatalogueFonts; f++) delete fonts[f];
+    delete engine;
+}
+BENCHMARK(BM_EngineCatalogue)->Arg(1)->Arg(2)->Arg(4)->UseRealTime();
@@ -0,0 +1,309 @@
+/** @file       BenchUndo.cc
+ *  @brief      Benchmarks for the undo journal.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <benchmark/benchmark.h>
+#include "BenchFonts.h"
+#include "NeoUndoJournal.h"
+
+
+#define kSessionLength      (10000)     /**< Number of edits in a session. */
+#define kTrimLimit          (64 << 10)  /**< Journal memory limit used to check that old records are trimmed. */
+
+
+/** Replay a scripted edit session, recording each edit in a journal. The mix of edits follows the editor:
+ *  mostly pixel strokes, with some single character changes and a few whole font changes.
+ *
+ *  @param  font        The font to edit.
+ *  @param  journal     The journal to record in.
+ *  @param  seed        Random seed (non-zero).
+ *  @param  added       Set to the number of commits that reported a new record, as the editor counts the
+ *                      actions it registers with its undo manager.
+ *  @param  peak        Set to the most memory used by the journal after any edit, or zero.
+ *  @return             The bytes that the original editor would have held for the same edits. It archived the
+ *                      fixed layout of the character or font for each edit, and pixel edits held no archive.
+ */
+static unsigned long benchSession(NeoFont *font, NeoUndoJournal *journal, uint32_t seed, int *added, unsigned int *peak = 0)
+{
+    unsigned long legacy = 0;
+    int stroke = 0;
+    int remaining = 0;
+    int ch = 0;
+    *added = 0;
+    if (0 != peak) *peak = 0;
+
+    for (int op = 0; op < kSessionLength; op++)
+    {
+        uint32_t r = benchRandom(&seed) % 100;
+        if (r < 75)
+        {
+            // Pixel stroke of up to eight pixels within one character
+            if (0 == remaining)
+            {
+                stroke++;
+                remaining = 1 + (benchRandom(&seed) % 8);
+                ch = benchRandom(&seed) % kNeoFontCharacterCount;
+            }
+            remaining--;
+            NeoCharacter *c = font->character(ch);
+            journal->begin("set pixel", stroke);
+            journal->saveCharacter(ch);
+            c->flipPixel(benchRandom(&seed) % c->width(), benchRandom(&seed) % c->height());
+            if (journal->commit()) (*added)++;
+            if (0 != peak && journal->memoryUsed() > *peak) *peak = journal->memoryUsed();
+            continue;
+        }
+
+        remaining = 0;
+        ch = benchRandom(&seed) % kNeoFontCharacterCount;
+        NeoCharacter *c = font->character(ch);
+        if (r < 88)
+        {
+            journal->begin("adjust character width");
+            journal->saveCharacter(ch);
+            c->setWidth(c->width() + ((benchRandom(&seed) & 1) ? 1 : -1));
+            legacy += kBenchLegacyCharacterBytes;
+        }
+        else if (r < 95)
+        {
+            journal->begin("bold");
+            journal->saveCharacter(ch);
+            c->setWidth(c->width() + 1);
+            c->transformBold();
+            legacy += kBenchLegacyCharacterBytes;
+        }
+        else if (r < 99)
+        {
+            journal->begin("cut");
+            journal->saveCharacter(ch);
+            c->clear();
+            legacy += kBenchLegacyCharacterBytes;
+        }
+        else if (0 == (benchRandom(&seed) & 1))
+        {
+            journal->begin("set font height");
+            journal->saveFont();
+            font->setHeight(font->height() + ((benchRandom(&seed) & 1) ? 1 : -1));
+            legacy += kBenchLegacyFontBytes;
+        }
+        else
+        {
+            char name[16];
+            snprintf(name, sizeof name, "Bench %d", op);
+            journal->begin("set font name");
+            journal->saveFont();
+            font->setFontName(name);
+            legacy += kBenchLegacyFontBytes;
+        }
+        if (journal->commit()) (*added)++;
+        if (0 != peak && journal->memoryUsed() > *peak) *peak = journal->memoryUsed();
+    }
+    return legacy;
+}
+
+
+/** Test if two fonts are the same: the same glyphs, widths, height and names.
+ *
+ *  @param  a           The first font.
+ *  @param  b           The second font.
+ *  @return             Logical true if the fonts are the same.
+ */
+static bool benchSameFont(const NeoFont *a, const NeoFont *b)
+{
+    if (a->contentHash() != b->contentHash() || a->height() != b->height() || 0 != strcmp(a->fontName(), b->fontName()))
+    {
+        return false;
+    }
+    for (int i = 0; i < kNeoFontCharacterCount; i++)
+    {
+        if (a->character(i)->width() != b->character(i)->width()) return false;
+    }
+    return true;
+}
+
+
+/** Check that commit() reports a new record only when the undo list grows, so that an undo stack which
+ *  mirrors the journal (as the editor's undo manager does) stays in step: an edit that changes nothing adds
+ *  no record, and a stroke that is coalesced, even one that puts the pixel back, keeps its single record.
+ *  An edit that changes nothing must also leave the redo stack alone, while one that changes the font
+ *  discards it.
+ *
+ *  @return             Logical true if the journal behaves correctly.
+ */
+static bool benchMirrorValid()
+{
+    NeoFont *font = new NeoFont;
+    benchFont(font, 0);
+    NeoUndoJournal *journal = new NeoUndoJournal(font);
+    uint64_t hash = font->contentHash();
+    NeoCharacter *c = font->character('A');
+
+    journal->begin("set character width");
+    journal->saveCharacter('A');
+    c->setWidth(c->width());
+    bool ok = !journal->commit() && 0 == journal->undoCount();
+
+    for (int i = 0; i < 2; i++)
+    {
+        journal->begin("set pixel", 1);
+        journal->saveCharacter('A');
+        c->flipPixel(0, 0);
+        ok = ok && (journal->commit() == (0 == i)) && 1 == journal->undoCount();
+    }
+    ok = ok && font->contentHash() == hash && journal->undo() && !journal->undo() && font->contentHash() == hash;
+
+    journal->begin("adjust character width");
+    journal->saveCharacter('A');
+    c->setWidth(c->width() + 1);
+    ok = ok && journal->commit();
+    uint64_t wider = font->contentHash();
+    ok = ok && journal->undo() && font->contentHash() == hash;
+    journal->begin("set character width");
+    journal->saveCharacter('A');
+    c->setWidth(c->width());
+    ok = ok && !journal->commit() && journal->canRedo() && journal->redo() && font->contentHash() == wider;
+
+    ok = ok && journal->undo();
+    journal->begin("set pixel", 2);
+    journal->saveCharacter('A');
+    c->flipPixel(1, 1);
+    ok = ok && journal->commit() && !journal->canRedo();
+    delete journal;
+    delete font;
+    return ok;
+}
+
+
+/** Record a session. The "journal_bytes" counter is the memory held by the journal at the end of the
+ *  session (with no memory limit), "legacy_bytes" is the memory the original editor would have held.
+ */
+static void BM_UndoSession(benchmark::State &state)
+{
+    unsigned long legacy = 0;
+    unsigned int used = 0;
+    int records = 0;
+    int added = 0;
+    if (!benchMirrorValid()) state.SkipWithError("commit results out of step with the undo list");
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        NeoFont *font = new NeoFont;
+        benchFont(font, state.range(0));
+        NeoUndoJournal *journal = new NeoUndoJournal(font);
+        journal->setMemoryLimit(UINT_MAX);
+        state.ResumeTiming();
+
+        legacy = benchSession(font, journal, 24680, &added);
+
+        state.PauseTiming();
+        used = journal->memoryUsed();
+        records = journal->undoCount();
+        if (records != added) state.SkipWithError("commit results out of step with the undo list");
+        delete journal;
+        delete font;
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * kSessionLength);
+    state.counters["records"] = records;
+    state.counters["journal_bytes"] = used;
+    state.counters["legacy_bytes"] = legacy;
+    state.counters["ratio"] = (double) legacy / used;
+}
+BENCHMARK(BM_UndoSession)->DenseRange(0, kBenchFontCount - 1)->Unit(benchmark::kMillisecond);
+
+
+/** Check that undoing a whole session restores the original font, and that redoing it restores the final
+ *  font.
+ *
+ *  @param  font        The font after the session.
+ *  @param  journal     The journal holding the whole session.
+ *  @param  n           The benchmark font that the session started from.
+ *  @return             Logical true if undo and redo restored the fonts.
+ */
+static bool benchReplayValid(NeoFont *font, NeoUndoJournal *journal, int n)
+{
+    NeoFont *original = new NeoFont;
+    NeoFont *final = new NeoFont;
+    benchFont(original, n);
+    benchFont(final, n);
+    NeoUndoJournal *other = new NeoUndoJournal(final);
+    int added;
+    benchSession(final, other, 24680, &added);
+
+    bool ok = benchSameFont(font, final);
+    while (journal->undo()) { }
+    ok = ok && benchSameFont(font, original);
+    while (journal->redo()) { }
+    ok = ok && benchSameFont(font, final);
+    delete other;
+    delete final;
+    delete original;
+    return ok;
+}
+
+
+/** Check the memory limit. The same session is recorded in a journal with a small limit and in one with no
+ *  limit. The limited journal must stay within its limit after every edit and must have dropped its oldest
+ *  records, and undoing every record it still holds must give the same fonts as undoing as many records in
+ *  the unlimited journal.
+ *
+ *  @param  n           The benchmark font to edit.
+ *  @return             Logical true if the journal kept to its limit and undid correctly.
+ */
+static bool benchTrimValid(int n)
+{
+    NeoFont *font = new NeoFont;
+    NeoFont *reference = new NeoFont;
+    benchFont(font, n);
+    benchFont(reference, n);
+    NeoUndoJournal *journal = new NeoUndoJournal(font);
+    NeoUndoJournal *full = new NeoUndoJournal(reference);
+    journal->setMemoryLimit(kTrimLimit);
+    full->setMemoryLimit(UINT_MAX);
+    int added;
+    unsigned int peak;
+    benchSession(font, journal, 13579, &added, &peak);
+    benchSession(reference, full, 13579, &added);
+
+    bool ok = peak <= kTrimLimit && journal->undoCount() > 0 && journal->undoCount() < full->undoCount();
+    while (ok && journal->canUndo())
+    {
+        ok = journal->undo() && full->undo() && benchSameFont(font, reference);
+    }
+    delete full;
+    delete journal;
+    delete reference;
+    delete font;
+    return ok;
+}
+
+
+/** Undo a whole session and then redo it. Undo and redo are first checked to restore the original and
+ *  final fonts, and the memory limit to be kept to.
+ */
+static void BM_UndoReplay(benchmark::State &state)
+{
+    NeoFont *font = new NeoFont;
+    benchFont(font, state.range(0));
+    NeoUndoJournal *journal = new NeoUndoJournal(font);
+    journal->setMemoryLimit(UINT_MAX);
+    int added;
+    benchSession(font, journal, 24680, &added);
+    if (!benchReplayValid(font, journal, (int)state.range(0))) state.SkipWithError("undo and redo do not restore the fonts");
+    if (!benchTrimValid((int)state.range(0))) state.SkipWithError("memory limit not kept, or trimmed journal not correct");
+
+    int records = journal->undoCount();
+    for (auto _ : state)
+    {
+        while (journal->undo()) { }
+        while (journal->redo()) { }
+    }
+    state.SetItemsProcessed(state.iterations() * records * 2);
+    delete journal;
+    delete font;
+}
+BENCHMARK(BM_UndoReplay)->DenseRange(0, kBenchFontCount - 1)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,84 @@
+/** @file       FuzzReplay.cc
+ *  @brief      Runs saved inputs through a fuzz target, for compilers without libFuzzer.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <vector>
+
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+
+/** Run one file through the target.
+ *
+ *  @param  path    The file.
+ *  @return         Logical true if the file was read.
+ */
+static bool replayFile(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (0 == file) return false;
+    std::vector<uint8_t> data;
+    uint8_t buffer[65536];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof buffer, file)) > 0) data.insert(data.end(), buffer, buffer + count);
+    fclose(file);
+    LLVMFuzzerTestOneInput(data.empty() ? buffer : &data[0], data.size());
+    return true;
+}
+
+
+/** Run every regular file in a directory, and in its subdirectories, through the target. Other entries,
+ *  such as devices and symbolic links to directories, are skipped.
+ *
+ *  @param  path    The directory.
+ *  @return         The number of files run.
+ */
+static unsigned int replayDirectory(const char *path)
+{
+    unsigned int inputs = 0;
+    DIR *dir = opendir(path);
+    struct dirent *entry;
+    while (0 != dir && 0 != (entry = readdir(dir)))
+    {
+        if ('.' == entry->d_name[0]) continue;
+        char child[4096];
+        snprintf(child, sizeof child, "%s/%s", path, entry->d_name);
+        struct stat st;
+        if (0 != lstat(child, &st)) continue;
+        if (S_ISDIR(st.st_mode)) inputs += replayDirectory(child);
+        else if (S_ISREG(st.st_mode) && replayFile(child)) inputs++;
+    }
+    if (0 != dir) closedir(dir);
+    return inputs;
+}
+
+
+/** Run each file named on the command line, or each file in a named directory tree, through the target.
+ */
+int main(int argc, char **argv)
+{
+    unsigned int inputs = 0;
+    int failed = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if ('-' == argv[i][0]) continue;        // libFuzzer options are ignored
+        struct stat st;
+        bool exists = (0 == stat(argv[i], &st));
+        if (exists && S_ISDIR(st.st_mode)) inputs += replayDirectory(argv[i]);
+        else if (exists && S_ISREG(st.st_mode) && replayFile(argv[i])) inputs++;
+        else
+        {
+            fprintf(stderr, "%s: cannot read input\n", argv[i]);
+            failed = 1;
+        }
+    }
+    printf("%u inputs\n", inputs);
+    return failed;
+}
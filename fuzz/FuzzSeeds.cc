@@ -0,0 +1,47 @@
+/** @file       FuzzSeeds.cc
+ *  @brief      Writes the seed corpus for the fuzz targets.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <vector>
+#include "FuzzTargets.h"
+
+
+/** Write the seed inputs for each target to <directory>/<target>/seed-<n>.
+ */
+int main(int argc, char **argv)
+{
+    static const char *const names[kFuzzTargetCount] = { "decode-applet", "load-archive", "set-version" };
+    if (2 != argc)
+    {
+        fprintf(stderr, "usage: %s <directory>\n", argv[0]);
+        return 2;
+    }
+
+    mkdir(argv[1], 0777);
+    for (int target = 0; target < kFuzzTargetCount; target++)
+    {
+        char path[4096];
+        snprintf(path, sizeof path, "%s/%s", argv[1], names[target]);
+        mkdir(path, 0777);
+
+        std::vector<std::vector<uint8_t> > seeds;
+        fuzzSeeds(target, &seeds);
+        for (unsigned int i = 0; i < seeds.size(); i++)
+        {
+            snprintf(path, sizeof path, "%s/%s/seed-%u", argv[1], names[target], i);
+            FILE *file = fopen(path, "wb");
+            if (0 == file || fwrite(&seeds[i][0], 1, seeds[i].size(), file) != seeds[i].size())
+            {
+                fprintf(stderr, "%s: write failed\n", path);
+                if (0 != file) fclose(file);
+                return 1;
+            }
+            fclose(file);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,17 @@
+/** @file       FuzzSetVersion.cc
+ *  @brief      Fuzz target for NeoFont::setVersion().
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include "FuzzTargets.h"
+
+
+/** libFuzzer entry point. Inconsistent behaviour is reported as a crash.
+ */
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    if (kFuzzInconsistent == fuzzRun(kFuzzTargetSetVersion, data, size)) __builtin_trap();
+    return 0;
+}
@@ -0,0 +1,263 @@
+/** @file       FuzzTargets.h
+ *  @brief      Parser fuzz targets and seed inputs, shared by the fuzzers and the fuzz benchmark.
+ *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
+ */
+#ifndef _FUZZTARGETS_H_
+#define _FUZZTARGETS_H_ (1)
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include "NeoFont.h"
+#include "NeoAppletView.h"
+#include "PresetFonts.h"
+
+
+/* Fuzz targets.
+ */
+#define kFuzzTargetDecodeApplet     (0)         /**< NeoFont::decodeApplet(). */
+#define kFuzzTargetLoadArchive      (1)         /**< NeoFont::loadArchive(). */
+#define kFuzzTargetSetVersion       (2)         /**< NeoFont::setVersion(). */
+#define kFuzzTargetCount            (3)         /**< Number of fuzz targets. */
+
+/* Results from fuzzRun().
+ */
+#define kFuzzInconsistent           (-1)        /**< The input was accepted but did not behave consistently. */
+#define kFuzzRejected               (0)         /**< The input was rejected. */
+#define kFuzzAccepted               (1)         /**< The input was accepted and behaved consistently. */
+
+#define kFuzzMaxInput               (1 << 20)   /**< Longer inputs are ignored. */
+#define kFuzzMaxVersion             (64)        /**< Longer version strings are truncated. */
+
+#define kFuzzLegacyFontHeader       (156)       /**< Size of the font header in the original archive layout. */
+#define kFuzzLegacyRowBytes         (kNeoCharacterMaxWidth / 8)     /**< Bytes per row in an original character archive. */
+
+
+/** Encode a font as an applet.
+ *
+ *  @param  font    The font.
+ *  @param  out     Receives the applet. Empty if the font is too large to encode.
+ */
+static inline void fuzzEncodeApplet(const NeoFont *font, std::vector<uint8_t> *out)
+{
+    out->resize(font->appletSize());
+    out->resize(font->encodeApplet(&(*out)[0], out->size()));
+}
+
+
+/** Save a font as an archive.
+ *
+ *  @param  font    The font.
+ *  @param  out     Receives the archive.
+ */
+static inline void fuzzSaveArchive(const NeoFont *font, std::vector<uint8_t> *out)
+{
+    out->resize(font->archiveSize());
+    font->saveArchive(&(*out)[0]);
+}
+
+
+/** Save a font in the original fixed archive layout, which holds host byte order ints.
+ *
+ *  @param  font    The font.
+ *  @param  out     Receives the archive.
+ */
+static inline void fuzzSaveLegacyArchive(const NeoFont *font, std::vector<uint8_t> *out)
+{
+    int header[] = { 1, 0, ' ', 0, 0, 0, 0, 0, font->ident(), font->height() };
+    out->assign(kFuzzLegacyFontHeader + (kNeoFontCharacterCount * kNeoCharacterLegacyArchiveSize), 0);
+    strncpy((char *)&(*out)[0], font->appletName(), 35);
+    strncpy((char *)&(*out)[36], font->appletInfo(), 59);
+    strncpy((char *)&(*out)[96], font->fontName(), 23);
+    memcpy(&(*out)[120], header, 3 * sizeof (int));
+    memcpy(&(*out)[148], &header[8], 2 * sizeof (int));
+    for (int i = 0; i < kNeoFontCharacterCount; i++)
+    {
+        const NeoCharacter *c = font->character(i);
+        uint8_t *record = &(*out)[kFuzzLegacyFontHeader + (i * kNeoCharacterLegacyArchiveSize)];
+        int size[2] = { c->width(), c->height() };
+        memcpy(record, size, sizeof size);
+        for (int y = 0; y < c->height(); y++)
+        {
+            for (int x = 0; x < c->width(); x++)
+            {
+                if (c->getPixel(x, y)) record[sizeof size + (y * kFuzzLegacyRowBytes) + (x / 8)] |= (uint8_t)(1 << (x & 7));
+            }
+        }
+    }
+}
+
+
+/** Check that a font is usable: every character has the font height and a width in range.
+ *
+ *  @param  font    The font.
+ *  @return         Logical true if the font is consistent.
+ */
+static inline bool fuzzFontValid(const NeoFont *font)
+{
+    if (font->height() < kNeoCharacterMinHeight || font->height() > kNeoCharacterMaxHeight) return false;
+    for (int i = 0; i < kNeoFontCharacterCount; i++)
+    {
+        const NeoCharacter *c = font->character(i);
+        if (c->height() != font->height() || c->width() < kNeoCharacterMinWidth || c->width() > kNeoCharacterMaxWidth) return false;
+    }
+    return true;
+}
+
+
+/** Decode an applet. An applet that is accepted must give the same applet each time it is re-encoded and
+ *  decoded, and the reported error must agree with the result.
+ */
+static inline int fuzzDecodeApplet(const uint8_t *data, size_t size)
+{
+    NeoFont *font = new NeoFont;
+    NeoFont *again = new NeoFont;
+    int error = -1;
+    bool valid = font->decodeApplet(data, (unsigned int)size, &error);
+    int result = valid ? kFuzzAccepted : kFuzzRejected;
+    if (valid != (kNeoAppletOK == error) || !fuzzFontValid(font)) result = kFuzzInconsistent;
+    if (valid)
+    {
+        std::vector<uint8_t> first;
+        std::vector<uint8_t> second;
+        fuzzEncodeApplet(font, &first);
+        if (!first.empty())
+        {
+            if (!again->decodeApplet(&first[0], first.size())) result = kFuzzInconsistent;
+            fuzzEncodeApplet(again, &second);
+            if (first != second) result = kFuzzInconsistent;
+        }
+        std::vector<uint8_t> archive;
+        fuzzSaveArchive(font, &archive);
+        if (!again->loadArchive(&archive[0], archive.size()) || again->contentHash() != font->contentHash()) result = kFuzzInconsistent;
+    }
+    delete again;
+    delete font;
+    return result;
+}
+
+
+/** Load an archive. The font must be usable afterwards even if the archive is rejected. An archive that is
+ *  accepted must give the same archive each time it is saved and reloaded, and must encode as an applet.
+ */
+static inline int fuzzLoadArchive(const uint8_t *data, size_t size)
+{
+    NeoFont *font = new NeoFont;
+    NeoFont *again = new NeoFont;
+    bool valid = font->loadArchive(data, (unsigned int)size);
+    int result = valid ? kFuzzAccepted : kFuzzRejected;
+    if (!fuzzFontValid(font)) result = kFuzzInconsistent;
+    if (valid)
+    {
+        std::vector<uint8_t> first;
+        std::vector<uint8_t> second;
+        fuzzSaveArchive(font, &first);
+        if (!again->loadArchive(&first[0], first.size())) result = kFuzzInconsistent;
+        fuzzSaveArchive(again, &second);
+        if (first != second || again->contentHash() != font->contentHash()) result = kFuzzInconsistent;
+
+        std::vector<uint8_t> applet;
+        fuzzEncodeApplet(font, &applet);
+        if (!applet.empty() && !again->decodeApplet(&applet[0], applet.size())) result = kFuzzInconsistent;
+    }
+    delete again;
+    delete font;
+    return result;
+}
+
+
+/** Set the version from a string. The input is truncated and terminated. The version string produced must
+ *  be printable and must give itself back when set as the version.
+ */
+static inline int fuzzSetVersion(const uint8_t *data, size_t size)
+{
+    char text[kFuzzMaxVersion + 1];
+    if (size > kFuzzMaxVersion) size = kFuzzMaxVersion;
+    if (0 != size) memcpy(text, data, size);
+    text[size] = 0;
+
+    NeoFont *font = new NeoFont;
+    char first[kFuzzMaxVersion];
+    strncpy(first, font->setVersion(text), sizeof first - 1);
+    first[sizeof first - 1] = 0;
+    int result = (0 == strcmp(first, font->setVersion(first))) ? kFuzzAccepted : kFuzzInconsistent;
+    for (const char *p = first; 0 != *p; p++)
+    {
+        if (*p < 0x20 || *p > 0x7e) result = kFuzzInconsistent;
+    }
+    delete font;
+    return result;
+}
+
+
+/** Run a fuzz target.
+ *
+ *  @param  target  The target (kFuzzTargetDecodeApplet etc).
+ *  @param  data    The input.
+ *  @param  size    The number of bytes of input.
+ *  @return         kFuzzAccepted, kFuzzRejected or kFuzzInconsistent.
+ */
+static inline int fuzzRun(int target, const uint8_t *data, size_t size)
+{
+    if (size > kFuzzMaxInput) return kFuzzRejected;
+    if (kFuzzTargetDecodeApplet == target) return fuzzDecodeApplet(data, size);
+    else if (kFuzzTargetLoadArchive == target) return fuzzLoadArchive(data, size);
+    else return fuzzSetVersion(data, size);
+}
+
+
+/** Build the seed inputs for a fuzz target: round trips of the preset fonts and of a font with glyphs of
+ *  many widths (as applets, or as archives in both layouts), and a set of version strings.
+ *
+ *  @param  target  The target (kFuzzTargetDecodeApplet etc).
+ *  @param  seeds   Receives the seed inputs.
+ */
+static inline void fuzzSeeds(int target, std::vector<std::vector<uint8_t> > *seeds)
+{
+    static const char *const versions[] = { "1.0", "1.1", "2.10a", "99.99z", "0.0", "3.5 ", "1.", ".5b", "-1.-1" };
+    seeds->clear();
+    if (kFuzzTargetSetVersion == target)
+    {
+        for (unsigned int i = 0; i < sizeof versions / sizeof versions[0]; i++)
+        {
+            seeds->push_back(std::vector<uint8_t>(versions[i], versions[i] + strlen(versions[i])));
+        }
+        return;
+    }
+
+    NeoFont *font = new NeoFont;
+    for (int n = 0; n < 3; n++)
+    {
+        if (n < 2)
+        {
+            font->initWithPreset((0 == n) ? kNeoFontPresetModel100 : kNeoFontPresetModel10);
+        }
+        else
+        {
+            font->setHeight(12);
+            for (int i = 0; i < kNeoFontCharacterCount; i++)
+            {
+                NeoCharacter *c = font->character(i);
+                c->setWidth(1 + (i % 32));
+                for (int y = 0; y < c->height(); y++) c->changePixel((i + y) % c->width(), y, 1);
+            }
+        }
+        std::vector<uint8_t> seed;
+        if (kFuzzTargetDecodeApplet == target)
+        {
+            fuzzEncodeApplet(font, &seed);
+            seeds->push_back(seed);
+        }
+        else
+        {
+            fuzzSaveArchive(font, &seed);
+            seeds->push_back(seed);
+            fuzzSaveLegacyArchive(font, &seed);
+            seeds->push_back(seed);
+        }
+    }
+    delete font;
+}
+
+
+#endif  // _FUZZTARGETS_H_